@@ -119,17 +119,20 @@ public:
 			if(name != "sequence") {
 				// in all but "sequence", all commands are floats
 				for(vector<float>::iterator i = commands.begin(); i != commands.end(); i++) {
-					commandString += string( ftoa(*i) ) + " ";
+					appendFloat( commandString, *i );
+					commandString += ' ';
 				}
 			}
 			else {
 				// if this is a "sequence", only the first two commands are floats
 				for(vector<float>::iterator i = commands.begin(); i != commands.begin() + 2; i++) {
-					commandString += string( ftoa(*i) ) + " ";
+					appendFloat( commandString, *i );
+					commandString += ' ';
 				}
 				// the rest are ints
 				for(vector<float>::iterator i = commands.begin() + 2; i != commands.end(); i++) {
-					commandString += string( itoa((int)(*i)) ) + " ";
+					appendInt( commandString, (int)(*i) );
+					commandString += ' ';
 				}
 			}
 			return name + " " + commandString + "\n";
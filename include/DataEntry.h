@@ -45,6 +45,7 @@ public:
 		header = _header;
 		keys = _keys;
 		text = "";
+		revision = 0;
 		setChanged();
 	}
 	
@@ -53,6 +54,7 @@ public:
 		header = string(_header);
 		keys = string(_keys);
 		text = string(_data);	
+		revision = 0;
 		setChanged();
 	}
 	
@@ -190,14 +192,21 @@ public:
 	void setKeys(const char* c) { keys = string(c); }
 	
 	// set changed
-	void setChanged() { changed = true; }
-	void setChanged(bool value) { changed = value; }
+	void setChanged() { changed = true; revision++; }
+	void setChanged(bool value) { changed = value; if( value ) revision++; }
+	
+	// has the data changed since it was last saved?
+	bool isChanged() { return changed; }
+	
+	// goes up every time the data changes (saving doesn't reset it)
+	unsigned int getRevision() { return revision; }
 	
 protected:
 	string header;
 	string keys;
 	string text;
 	bool changed;
+	unsigned int revision;
 };
 
 #endif /*DATAENTRY_H_*/
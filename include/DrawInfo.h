@@ -63,6 +63,10 @@ public:
 	bool isDlist() { return dlist; }
 	bool isDecorative() { return decorative; }
 
+	// binary setters
+	void setExtents( const Point3D& low, const Point3D& high ) { minExtents = low; maxExtents = high; }
+	void setSphere( const Point3D& position, float radiusSquared ) { spherePosition = position; sphereRadius = radiusSquared; }
+
 	bool parse( std::string& line );
 	
 private:
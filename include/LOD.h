@@ -162,6 +162,7 @@ public:
 	
 	vector<MaterialSet*>& getMaterialSets() {return matSets;}
 	float getLengthPerPixel() {return lengthPerPixel;}
+	void setLengthPerPixel( float value ) { lengthPerPixel = value; }
 	
 private:
 	
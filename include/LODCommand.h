@@ -38,6 +38,14 @@ public:
 		this->update(data);	
 	}
 	
+	// constructor with a name and indices
+	LODCommand(const string& newName, const vector<int>& newArgs) : DataEntry("", "<dlist><sphere><points><lines><lineloop><linestrip><tris><tristrip><trifan><quads><quadstrip><polygon>") {
+		name = newName;
+		args = newArgs;
+		rad = 0;
+		x = y = z = 0;
+	}
+	
 	// getter
 	string get(void) { return this->toString(); }
 	
@@ -256,6 +264,7 @@ public:
 	
 	string getName() {return name;}
 	vector<int> getArgs() {return args;}
+	void setArgs( const vector<int>& newArgs ) { args = newArgs; }
 	
 private:
 
@@ -265,7 +274,8 @@ private:
 		
 		if(values.size() > 0) {
 			for(vector<int>::iterator i = values.begin(); i != values.end(); i++) {
-				ret += string(itoa(*i)) + " ";	
+				appendInt( ret, *i );
+				ret += ' ';
 			}	
 		}
 		
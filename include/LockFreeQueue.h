@@ -0,0 +1,77 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef LOCKFREEQUEUE_H_
+#define LOCKFREEQUEUE_H_
+
+#include <stddef.h>
+
+#include <OpenThreads/Atomic>
+
+/**
+ * A queue that any number of threads can push onto without locking, and that one thread
+ * empties all at once.  Items are linked through their own "next" member, so pushing never
+ * allocates.  The queue does NOT own the items.
+ *
+ * Pushes go onto a stack with a compare-and-swap; the consumer swaps the whole stack out
+ * and reverses it, so it gets the items in the order they were pushed.  Since nothing is
+ * ever popped off of the top alone, the usual ABA problem doesn't come up.
+ */
+
+template< class T >
+class LockFreeQueue {
+
+public:
+
+	LockFreeQueue() : top( NULL ) { }
+
+	// add an item (any thread)
+	void push( T* item ) {
+		void* old;
+		do {
+			old = top.get();
+			item->next = (T*)old;
+		} while( !top.assign( item, old ) );
+	}
+
+	// take everything pushed so far, oldest first, linked through next (one thread only)
+	T* takeAll() {
+		void* old;
+		do {
+			old = top.get();
+		} while( old != NULL && !top.assign( NULL, old ) );
+
+		// reverse the stack
+		T* ret = NULL;
+		T* item = (T*)old;
+		while( item != NULL ) {
+			T* next = item->next;
+			item->next = ret;
+			ret = item;
+			item = next;
+		}
+
+		return ret;
+	}
+
+	bool empty() { return top.get() == NULL; }
+
+private:
+
+	// no copying
+	LockFreeQueue( const LockFreeQueue& );
+	LockFreeQueue& operator =( const LockFreeQueue& );
+
+	OpenThreads::AtomicPtr top;
+};
+
+#endif /*LOCKFREEQUEUE_H_*/
@@ -17,121 +17,257 @@
 #include "model/BZWParser.h"
 #include "objects/physics.h"
 #include "objects/material.h"
+
+#include <osg/Vec2>
+#include <osg/Vec3>
+
+#include <map>
 #include <vector>
 #include <string>
 
+class MeshData;
+
 /**
- * This is a class for reading, parsing, writing, and storing information about
- * a "mesh" object's faces.  It assists "mesh" similar to how "ColorCommand" assists
- * "dynamicColor" and "Transform" assists "bz2object"
+ * One face of a "mesh".  This is only a view into the mesh's MeshData, which holds every
+ * face's indices and properties packed together; it's cheap to make and copy, and is only
+ * good as long as the MeshData isn't changed.
  */
 
-class MeshFace : public DataEntry {
+class MeshFace {
 
 public:
 
-	// default constructor
-	MeshFace();
-
-	// constructor with data
-	MeshFace(material* mat, physics* phydrv, bool noclusters, bool smoothbounce, bool drivethrough, bool shootthrough);
+	// what a face has and is
+	enum Flags {
+		HAS_NORMALS = 1 << 0,
+		HAS_TEXCOORDS = 1 << 1,
+		DRIVE_THROUGH = 1 << 2,
+		SHOOT_THROUGH = 1 << 3,
+		NO_CLUSTERS = 1 << 4,
+		SMOOTH_BOUNCE = 1 << 5,
+		RICOCHET = 1 << 6
+	};
 
-	~MeshFace();
+	struct LinkGeometry {
+		LinkGeometry()
+		: centerIndex(-1) // index to a vertex
+		, sDirIndex(-1)   // index to a normal
+		, tDirIndex(-1)   // index to a normal
+		, pDirIndex(-1)   // index to a normal
+		, sScale(1.0f)
+		, tScale(1.0f)
+		, pScale(0.0f) // note the 0.0f
+		, angle(0.0f)
+		, LinkAutoSscale(true)
+		, LinkAutoTscale(true)
+		, LinkAutoPscale(true)
+		{}
+		int centerIndex;
+		int sDirIndex;
+		int tDirIndex;
+		int pDirIndex;
+		osg::Vec3 center;
+		osg::Vec3 sDir; // usually points right,   looking towards the plane
+		osg::Vec3 tDir; // usually points upwards, looking towards the plane
+		osg::Vec3 pDir; // usually the -plane.xyz() for srcs, +plane.xyz() for dsts
+		float sScale;
+		float tScale;
+		float pScale;
+		float angle;   // calculated
+		bool LinkAutoSscale;
+		bool LinkAutoTscale;
+		bool LinkAutoPscale ;
+	};
 
-	// getter
-	string get(void);
-
-	bool parse( std::string& line );
-
-	// toString
-	string toString(void);
-
-	// render
-	int render(void);
-
-	vector<int> getVertices() { return vertices; }
-	vector<int> getNormals() { return normals; }
-	vector<int> getTexcoords() { return texcoords; }
-	material* getMaterial() { return mat; }
-
-	    struct LinkGeometry {
-      LinkGeometry()
-      : centerIndex(-1) // index to a vertex
-      , sDirIndex(-1)   // index to a normal
-      , tDirIndex(-1)   // index to a normal
-      , pDirIndex(-1)   // index to a normal
-      , sScale(1.0f)
-      , tScale(1.0f)
-      , pScale(0.0f) // note the 0.0f
-      , angle(0.0f)
-	  , LinkAutoSscale(true)
-	  , LinkAutoTscale(true)
-	  , LinkAutoPscale(true)
-      {}
-      int centerIndex;
-      int sDirIndex;
-      int tDirIndex;
-      int pDirIndex;
-	  osg::Vec3 center;
-      osg::Vec3 sDir; // usually points right,   looking towards the plane
-      osg::Vec3 tDir; // usually points upwards, looking towards the plane
-      osg::Vec3 pDir; // usually the -plane.xyz() for srcs, +plane.xyz() for dsts
-      float sScale;
-      float tScale;
-      float pScale;
-      float angle;   // calculated
-	  bool LinkAutoSscale;
-      bool LinkAutoTscale;
-      bool LinkAutoPscale ;
-    };
-
-    struct SpecialData {
-      SpecialData()
-		  : baseTeam(-1),
+	struct SpecialData {
+		SpecialData()
+			: baseTeam(-1),
 			LinkSrcRebound(false),
 			LinkSrcNoGlow(false),
 			LinkSrcNoRadar(false),
 			LinkSrcNoSound(false),
 			LinkSrcNoEffect(false)
-      {}
+		{}
+
+		unsigned short stateBits; // uses SpecialBits enum
+
+		int baseTeam;
+
+		std::string  linkName;
+		LinkGeometry linkSrcGeo;
+		LinkGeometry linkDstGeo;
+		std::string  linkSrcShotFail;
+		std::string  linkSrcTankFail;
+
+		bool LinkSrcRebound;
+		bool LinkSrcNoGlow;
+		bool LinkSrcNoRadar;
+		bool LinkSrcNoSound;
+		bool LinkSrcNoEffect;
+	};
+
+	MeshFace( const MeshData* data, unsigned int index ) : data( data ), index( index ) { }
+
+	// which face of the mesh this is
+	unsigned int getIndex() const { return index; }
+
+	// the number of corners
+	inline unsigned int getCount() const;
 
-      unsigned short stateBits; // uses SpecialBits enum
+	// the corners' indices into the mesh's vertices, normals, and texcoords (getCount() of each);
+	// normals and texcoords are NULL if the face doesn't have them
+	inline const int* getVertices() const;
+	inline const int* getNormals() const;
+	inline const int* getTexcoords() const;
 
-      int baseTeam;
+	inline material* getMaterial() const;
+	inline physics* getPhysicsDriver() const;
+	inline unsigned int getFlags() const;
 
-      std::string  linkName;
-      LinkGeometry linkSrcGeo;
-      LinkGeometry linkDstGeo;
-      std::string  linkSrcShotFail;
-      std::string  linkSrcTankFail;
+	// the face's base and link data, or NULL if it has none
+	inline const SpecialData* getSpecialData() const;
 
-	  bool LinkSrcRebound;
-	  bool LinkSrcNoGlow;
-	  bool LinkSrcNoRadar;
-	  bool LinkSrcNoSound;
-	  bool LinkSrcNoEffect;
-    };
+	// append the face's bzw text to out
+	void appendTo( std::string& out ) const;
+
+	// toString
+	string toString(void) const;
 
 private:
-	/**
-	 * Helper method: convert an array of ints into a string
-	 */
-
-	string stringify(vector<int>& values);
-	vector<int> vertices;
-	vector<int> normals;
-	vector<int> texcoords;
-	physics* physicsDriver;
-	material* mat;
-
-	bool driveThrough;
-	bool shootThrough;
-	bool noClusters;
-	bool smoothbounce;
-	bool ricochet;
-
-	// special data
-	SpecialData specialData;
+
+	const MeshData* data;
+	unsigned int index;
 };
 
+/**
+ * The vertices, normals, texture coordinates and faces of a "mesh", stored compactly:
+ * the attributes in contiguous arrays of floats, and the faces' indices packed one after the
+ * other into a single array, found through a table of offsets.  The materials, physics drivers
+ * and flags that faces have are kept once for each different combination, and the rarely used
+ * base and link data only for the faces that have it.
+ *
+ * Faces are read with beginFace(), then parseFace() for each line until it returns false.
+ */
+
+class MeshData {
+
+public:
+
+	MeshData();
+
+	// attributes
+	const std::vector< osg::Vec3 >& getVertices() const { return vertices; }
+	const std::vector< osg::Vec3 >& getNormals() const { return normals; }
+	const std::vector< osg::Vec2 >& getTexcoords() const { return texcoords; }
+
+	void addVertex( const osg::Vec3& v ) { vertices.push_back( v ); }
+	void addNormal( const osg::Vec3& n ) { normals.push_back( n ); }
+	void addTexcoord( const osg::Vec2& t ) { texcoords.push_back( t ); }
+
+	// faces
+	unsigned int getFaceCount() const { return faceStart.size() - 1; }
+	MeshFace getFace( unsigned int i ) const { return MeshFace( this, i ); }
+
+	// add a face of count corners; normals and texcoords may be NULL
+	void addFace( const int* vertexIndices, const int* normalIndices, const int* texcoordIndices, unsigned int count,
+				  material* mat, physics* phydrv, unsigned int flags, const MeshFace::SpecialData* special = NULL );
+
+	// start reading a face, with the properties it gets from its mesh
+	void beginFace( material* mat, physics* phydrv, bool noclusters, bool smoothbounce, bool drivethrough, bool shootthrough );
+
+	// read a line of the face; returns false at "endface", when the face has been added.
+	// Errors are thrown as BZWReadErrors against owner.
+	bool parseFace( std::string& line, DataEntry* owner );
+
+	// is a face being read?
+	bool isParsingFace() const { return parsing; }
+
+	// drop everything
+	void clear();
+
+	// the bytes the mesh is using
+	size_t getMemoryUsage() const;
+
+private:
+
+	friend class MeshFace;
+
+	// what faces share
+	struct Properties {
+		material* mat;
+		physics* phydrv;
+		unsigned int flags;
+	};
+
+	// the index of a combination of properties, adding it if it's new
+	unsigned int propertiesFor( material* mat, physics* phydrv, unsigned int flags );
+
+	std::vector< osg::Vec3 > vertices;
+	std::vector< osg::Vec3 > normals;
+	std::vector< osg::Vec2 > texcoords;
+
+	// face i's indices are indices[ faceStart[i] ] up to indices[ faceStart[i + 1] ]:  its vertices,
+	// then its normals and its texcoords if it has them
+	std::vector< unsigned int > faceStart;
+	std::vector< int > indices;
+
+	// each face's properties, as an index into properties
+	std::vector< unsigned int > faceProperties;
+	std::vector< Properties > properties;
+
+	// the faces with base or link data
+	std::map< unsigned int, MeshFace::SpecialData > specialData;
+
+	// the face being read
+	bool parsing;
+	std::vector< int > pendingVertices;
+	std::vector< int > pendingNormals;
+	std::vector< int > pendingTexcoords;
+	material* pendingMaterial;
+	physics* pendingPhysics;
+	unsigned int pendingFlags;
+	MeshFace::SpecialData pendingSpecial;
+	bool pendingHasSpecial;
+};
+
+unsigned int MeshFace::getFlags() const {
+	return data->properties[ data->faceProperties[ index ] ].flags;
+}
+
+unsigned int MeshFace::getCount() const {
+	unsigned int flags = getFlags();
+	unsigned int lists = 1 + ( flags & HAS_NORMALS ? 1 : 0 ) + ( flags & HAS_TEXCOORDS ? 1 : 0 );
+	return ( data->faceStart[ index + 1 ] - data->faceStart[ index ] ) / lists;
+}
+
+const int* MeshFace::getVertices() const {
+	return &data->indices[ data->faceStart[ index ] ];
+}
+
+const int* MeshFace::getNormals() const {
+	if ( !( getFlags() & HAS_NORMALS ) )
+		return NULL;
+	return getVertices() + getCount();
+}
+
+const int* MeshFace::getTexcoords() const {
+	unsigned int flags = getFlags();
+	if ( !( flags & HAS_TEXCOORDS ) )
+		return NULL;
+	return getVertices() + getCount() * ( flags & HAS_NORMALS ? 2 : 1 );
+}
+
+material* MeshFace::getMaterial() const {
+	return data->properties[ data->faceProperties[ index ] ].mat;
+}
+
+physics* MeshFace::getPhysicsDriver() const {
+	return data->properties[ data->faceProperties[ index ] ].phydrv;
+}
+
+const MeshFace::SpecialData* MeshFace::getSpecialData() const {
+	std::map< unsigned int, SpecialData >::const_iterator i = data->specialData.find( index );
+	return ( i != data->specialData.end() ? &i->second : NULL );
+}
+
 #endif /*MESHFACE_H_*/
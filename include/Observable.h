@@ -15,6 +15,8 @@
 
 #include <vector>
 #include "Observer.h"
+#include "model/ObserverMessage.h"
+#include "model/ObserverChangeSet.h"
 
 using namespace std;
 
@@ -23,6 +25,10 @@ using namespace std;
  *  This is similar to the Observable interface in Java.
  * 
  *  NOTE: it is NOT the job of the Observables to delete Observers
+ *
+ *  Notifications can be batched:  between beginBatch() and commitBatch(), the messages
+ *  (which must be ObserverMessages, or NULL) are collected instead of delivered, and the
+ *  commit hands the observers a single CHANGE_SET message with all of them coalesced.
  */
 
  
@@ -32,6 +38,7 @@ public:
 
 	Observable() {
 		observers = vector<Observer*>();
+		batchDepth = 0;
 	}
 	
 	virtual ~Observable() { }
@@ -56,6 +63,12 @@ public:
 	
 	// notify observers
 	virtual void notifyObservers(void* data) {
+		// hold on to it until the batch is done
+		if( batchDepth > 0 ) {
+			batch.add( (ObserverMessage*)data );
+			return;
+		}
+
 		// call each observer's update() method
 		if(observers.size() > 0) {
 			for(vector<Observer*>::iterator i = observers.begin(); i != observers.end(); i++) {
@@ -64,10 +77,37 @@ public:
 		}
 	}
 	
+	// start collecting notifications instead of sending them.  Batches nest; only the
+	// outermost commitBatch() sends anything.
+	void beginBatch() { batchDepth++; }
+	
+	// send everything collected since beginBatch() as one CHANGE_SET message
+	void commitBatch() {
+		if( batchDepth == 0 || --batchDepth > 0 )
+			return;
+		
+		if( batch.isEmpty() )
+			return;
+		
+		// observers may start batches of their own, so deliver a copy
+		batch.finish();
+		ObserverChangeSet changes = batch;
+		batch.clear();
+		
+		ObserverMessage msg( ObserverMessage::CHANGE_SET, &changes );
+		notifyObservers( &msg );
+	}
+	
+	bool isBatching() { return batchDepth > 0; }
+	
 private:
 
 	// the observers
 	vector<Observer*> observers;
+	
+	// messages held back by beginBatch()
+	ObserverChangeSet batch;
+	unsigned int batchDepth;
 };
 
 #endif /*OBSERVABLE_H_*/
@@ -365,6 +365,10 @@ namespace TextUtils {
    *  make last char a '~' if truncation took place
    */  
   std::string str_trunc_continued (const std::string &text, int len);
+
+  /** 64-bit FNV-1a hash of a run of bytes
+   */
+  unsigned long long hash(const char* begin, const char* end);
 }
 
 
@@ -0,0 +1,106 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef WORKERPOOL_H_
+#define WORKERPOOL_H_
+
+#include <stddef.h>
+#include <vector>
+#include <deque>
+
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+
+/**
+ * A unit of work for the WorkerPool.
+ */
+class WorkerTask {
+
+public:
+	virtual ~WorkerTask() { }
+
+	// do the work (called on a worker thread)
+	virtual void run() = 0;
+};
+
+/**
+ * Work that can be split into index ranges, i.e. the body of a for() loop.
+ * run() is called concurrently for disjoint [begin, end) ranges.
+ */
+class WorkerRange {
+
+public:
+	virtual ~WorkerRange() { }
+
+	virtual void run( unsigned int begin, unsigned int end ) = 0;
+};
+
+/**
+ * A fixed set of worker threads fed from a single queue.
+ * The pool does NOT own the tasks passed to it.
+ */
+class WorkerPool {
+
+public:
+
+	// pass 0 to use one thread per processor
+	WorkerPool( int threadCount = 0 );
+	~WorkerPool();
+
+	// queue a task
+	void add( WorkerTask* task );
+
+	// block until every queued task has finished
+	void wait();
+
+	// run a range [0, count) across the pool in chunks of (at most) grain indexes, and wait for it.
+	// The calling thread runs chunks too, so it's safe to call from a task on the pool.
+	void runRange( WorkerRange* range, unsigned int count, unsigned int grain = 1 );
+
+	int getThreadCount() { return (int)threads.size(); }
+
+	// the number of threads to use when none is given
+	static int defaultThreadCount();
+
+	// a shared pool for short-lived jobs
+	static WorkerPool* getSharedPool();
+
+private:
+
+	class Worker;
+	friend class Worker;
+
+	// no copying
+	WorkerPool( const WorkerPool& );
+	WorkerPool& operator =( const WorkerPool& );
+
+	// get the next task (blocks); returns NULL when the pool is shutting down
+	WorkerTask* next();
+
+	// mark a task as finished
+	void done();
+
+	std::vector< Worker* > threads;
+	std::deque< WorkerTask* > queue;
+
+	OpenThreads::Mutex mutex;
+	OpenThreads::Condition workAvailable;
+	OpenThreads::Condition workFinished;
+
+	// number of tasks queued or running
+	unsigned int pending;
+
+	bool stopping;
+};
+
+#endif /*WORKERPOOL_H_*/
@@ -27,7 +27,13 @@ public:
 	// constructor
 	ConfigurationDialog( DataEntry* data, const char* title, int width, int height ) :
 		Fl_Dialog( title, width, height, Fl_Dialog::Fl_OK | Fl_Dialog::Fl_CANCEL )
-		{ this->data = data; }
+		{
+			this->data = data;
+
+			// assume the dialog will change the data, so it is written out fresh on the next save
+			if( data != NULL )
+				data->setChanged();
+		}
 	
 	// static initializer
 	static ConfigurationDialog* init( DataEntry* data, const char* title, int width, int height ) { return new ConfigurationDialog( data, title, width, height ); }
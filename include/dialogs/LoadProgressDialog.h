@@ -0,0 +1,82 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef LOADPROGRESSDIALOG_H_
+#define LOADPROGRESSDIALOG_H_
+
+#include "Fl_Dialog.h"
+
+#include <FL/Fl_Progress.H>
+
+#include <string>
+
+#include "model/BZWLoader.h"
+
+class MainWindow;
+
+/**
+ * A (non-modal) window that loads a world in the background, showing how far along it is.
+ * The load runs from an FLTK timeout, so the rest of the interface keeps working and the
+ * world shows up in the view as it comes in.  Cancel throws the half-loaded world away.
+ */
+class LoadProgressDialog : public Fl_Dialog {
+
+public:
+
+	LoadProgressDialog( MainWindow* parent );
+
+	// stops the load if it's still running
+	virtual ~LoadProgressDialog();
+
+	// start loading a world; returns false if it can't be opened
+	bool load( const char* filename );
+
+	// stop loading
+	void cancel();
+
+	bool isLoading() { return loading; }
+
+	// Cancel callback
+	static void CancelCallback( Fl_Widget* w, void* data ) {
+		LoadProgressDialog* dialog = (LoadProgressDialog*)(data);
+		dialog->CancelCallback_real( w );
+	}
+
+	// timeout callback that does the next bit of loading
+	static void LoadCallback( void* data ) {
+		LoadProgressDialog* dialog = (LoadProgressDialog*)(data);
+		dialog->LoadCallback_real();
+	}
+
+private:
+
+	// real callbacks
+	void CancelCallback_real( Fl_Widget* w );
+	void LoadCallback_real();
+
+	// close up once the load is over, and report any errors
+	void finish();
+
+	MainWindow* parent;
+
+	BZWLoader loader;
+	bool loading;
+
+	Fl_Box* status;
+	Fl_Progress* progress;
+
+	// the widgets only keep pointers to these
+	std::string statusText;
+	std::string progressText;
+};
+
+#endif /*LOADPROGRESSDIALOG_H_*/
@@ -22,6 +22,8 @@
 
 #include <FL/filename.H>
 
+#include <osgViewer/ViewerBase>
+
 #include <iostream>
 #include <fstream>
 
@@ -31,6 +33,7 @@
 #include "../dialogs/Fl_Error.h"
 
 class MainWindow;
+class LoadProgressDialog;
 
 using namespace std;
 /**
@@ -44,7 +47,10 @@ class MenuBar : public Fl_Menu_Bar {
 public:
 	// constructor and destructor
 	MenuBar( MainWindow* parent );
-	~MenuBar() { }
+	~MenuBar();
+
+	// is a world being loaded in the background?
+	bool isLoading();
 
 	// static callbacks
 	static void new_world( Fl_Widget* w, void* data ) {
@@ -72,6 +78,16 @@ public:
 		mb->save_selection_real( w );
 	}
 
+	static void parallel_loading( Fl_Widget* w, void* data) {
+		MenuBar* mb = (MenuBar*)(data);
+		mb->parallel_loading_real( w );
+	}
+
+	static void cache_worlds( Fl_Widget* w, void* data) {
+		MenuBar* mb = (MenuBar*)(data);
+		mb->cache_worlds_real( w );
+	}
+
 	static void exit_bzwb( Fl_Widget* w, void* data) {
 		MenuBar* mb = (MenuBar*)(data);
 		mb->exit_bzwb_real( w );
@@ -127,6 +143,26 @@ public:
 		mb->unselect_all_real( w );
 	}
 
+	static void invert_selection( Fl_Widget* w, void* data) {
+		MenuBar* mb = (MenuBar*)(data);
+		mb->invert_selection_real( w );
+	}
+
+	static void click_select( Fl_Widget* w, void* data) {
+		MenuBar* mb = (MenuBar*)(data);
+		mb->click_select_real( w );
+	}
+
+	static void box_select( Fl_Widget* w, void* data) {
+		MenuBar* mb = (MenuBar*)(data);
+		mb->box_select_real( w );
+	}
+
+	static void lasso_select( Fl_Widget* w, void* data) {
+		MenuBar* mb = (MenuBar*)(data);
+		mb->lasso_select_real( w );
+	}
+
 	static void addBoxCallback(Fl_Widget* w, void* data) {
 		MenuBar* m = (MenuBar*)data;
 		m->addBoxCallback_real(w);
@@ -262,6 +298,51 @@ public:
 		m->linkCallback_real(w);
 	}
 
+	static void optimizeMeshesCallback(Fl_Widget* w, void* data) {
+		MenuBar* m = (MenuBar*)data;
+		m->optimizeMeshesCallback_real(w);
+	}
+
+	static void generateLODsCallback(Fl_Widget* w, void* data) {
+		MenuBar* m = (MenuBar*)data;
+		m->generateLODsCallback_real(w);
+	}
+
+	static void single_threaded(Fl_Widget* w, void* data) {
+		MenuBar* m = (MenuBar*)data;
+		m->threading_real( w, osgViewer::ViewerBase::SingleThreaded );
+	}
+
+	static void draw_thread(Fl_Widget* w, void* data) {
+		MenuBar* m = (MenuBar*)data;
+		m->threading_real( w, osgViewer::ViewerBase::DrawThreadPerContext );
+	}
+
+	static void cull_draw_thread(Fl_Widget* w, void* data) {
+		MenuBar* m = (MenuBar*)data;
+		m->threading_real( w, osgViewer::ViewerBase::CullDrawThreadPerContext );
+	}
+
+	static void instancingCallback(Fl_Widget* w, void* data) {
+		MenuBar* m = (MenuBar*)data;
+		m->instancingCallback_real(w);
+	}
+
+	static void statisticsCallback(Fl_Widget* w, void* data) {
+		MenuBar* m = (MenuBar*)data;
+		m->statisticsCallback_real(w);
+	}
+
+	static void statsHUDCallback(Fl_Widget* w, void* data) {
+		MenuBar* m = (MenuBar*)data;
+		m->statsHUDCallback_real(w);
+	}
+
+	static void frameTraceCallback(Fl_Widget* w, void* data) {
+		MenuBar* m = (MenuBar*)data;
+		m->frameTraceCallback_real(w);
+	}
+
 	// do a world save
 	void do_world_save( const char* filename );
 
@@ -273,6 +354,8 @@ private:
 	void save_world_real( Fl_Widget* w );
 	void save_world_as_real( Fl_Widget* w );
 	void save_selection_real( Fl_Widget* w );
+	void parallel_loading_real( Fl_Widget* w );
+	void cache_worlds_real( Fl_Widget* w );
 	void exit_bzwb_real( Fl_Widget* w );
 
 	void undo_real(Fl_Widget* w );
@@ -285,6 +368,10 @@ private:
 	void paste_saved_selection_real( Fl_Widget* w );
 	void select_all_real( Fl_Widget* w );
 	void unselect_all_real( Fl_Widget* w );
+	void invert_selection_real( Fl_Widget* w );
+	void click_select_real( Fl_Widget* w );
+	void box_select_real( Fl_Widget* w );
+	void lasso_select_real( Fl_Widget* w );
 
 	void addBoxCallback_real(Fl_Widget* w);
 	void addPyramidCallback_real(Fl_Widget* w);
@@ -314,10 +401,20 @@ private:
 	void materialEditorCallback_real(Fl_Widget* w);
 	void physicsEditorCallback_real(Fl_Widget* w);
 	void linkCallback_real(Fl_Widget* w);
+	void optimizeMeshesCallback_real(Fl_Widget* w);
+	void generateLODsCallback_real(Fl_Widget* w);
+	void threading_real( Fl_Widget* w, osgViewer::ViewerBase::ThreadingModel model );
+	void statisticsCallback_real(Fl_Widget* w);
+	void instancingCallback_real(Fl_Widget* w);
+	void statsHUDCallback_real(Fl_Widget* w);
+	void frameTraceCallback_real(Fl_Widget* w);
 
 	// reference to the MainWindow parent
 	MainWindow* parent;
 
+	// shows the progress of the last world opened, while it loads
+	LoadProgressDialog* loadDialog;
+
 	// build the menu
 	void buildMenu(void);
 
@@ -13,17 +13,41 @@
 #ifndef FTOA_H_
 #define FTOA_H_
 
+#include <stddef.h>
 #include <string>
 #include "TextUtils.h"
 
 using namespace std;
 
+// big enough for anything formatFloat() or formatInt() writes, plus the null
+#define FTOA_BUFFER_SIZE 64
+
+// write the shortest decimal number that reads back as exactly the same float
+// (no exponent, no trailing zeros) into buffer; returns the length
+size_t formatFloat( char* buffer, float f );
+
+// write an integer into buffer; returns the length
+size_t formatInt( char* buffer, int i );
+
+// append a number to a string without any temporaries
+inline void appendFloat( string& out, float f ) {
+	char buffer[ FTOA_BUFFER_SIZE ];
+	out.append( buffer, formatFloat( buffer, f ) );
+}
+
+inline void appendInt( string& out, int i ) {
+	char buffer[ FTOA_BUFFER_SIZE ];
+	out.append( buffer, formatInt( buffer, i ) );
+}
+
 inline string ftoa(float f) {
-	return TextUtils::format("%f", f);
+	char buffer[ FTOA_BUFFER_SIZE ];
+	return string( buffer, formatFloat( buffer, f ) );
 }
 
 inline string itoa(int i) {
-	return TextUtils::format("%i", i);	
+	char buffer[ FTOA_BUFFER_SIZE ];
+	return string( buffer, formatInt( buffer, i ) );
 }
 
 #endif /*FTOA_H_*/
@@ -0,0 +1,137 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef BZWCACHE_H_
+#define BZWCACHE_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "model/BZWMappedFile.h"
+
+#include <osg/ref_ptr>
+
+class DataEntry;
+class bz2object;
+
+/**
+ * A binary snapshot of a loaded world, kept next to its .bzw file (world.bzw -> world.bzwc)
+ * so that the world can be reopened without parsing its text.
+ *
+ * Boxes and pyramids, which make up most of a world, are stored field by field:  name,
+ * position, rotation, size, flags, transformations and per-face data go into fixed-size
+ * records, and their materials and physics drivers are indices into a table of references
+ * that is resolved once per load.  Everything else (the world, options, materials, physics
+ * drivers, texture matrices, dynamic colors, definitions, links, and any object that can't
+ * be stored field by field) is kept as the text Model::toString() writes for it, and goes
+ * through the usual parser.
+ *
+ * The file is laid out as a header followed by arrays of plain structs, so it is read
+ * straight out of a BZWMappedFile.  It is only used if it was made by the same version of
+ * the format, from a .bzw with the same length and hash as the one being opened, and if
+ * its contents hash to what was written; otherwise the world is parsed from its text.
+ * Every record is checked when the cache is written by decoding it again and comparing
+ * the object's text, so a world loaded from the cache writes back out the same text.
+ */
+
+class BZWCache {
+
+public:
+
+	BZWCache();
+	~BZWCache() { close(); }
+
+	// the name of the cache that goes with a world file
+	static std::string fileNameFor( const char* worldFile );
+
+	// snapshot the Model's world, which was loaded from (or saved to) a world file with the
+	// given length and hash.  Returns false if the file could not be written.
+	static bool write( const char* filename, unsigned long long sourceHash, size_t sourceLength );
+
+	// map a snapshot; returns false if it's missing, damaged, or was made from a different world file
+	bool open( const char* filename, unsigned long long sourceHash, size_t sourceLength );
+
+	void close();
+
+	// the text of everything that isn't stored field by field, in the order Model::_write() puts it
+	const char* getText() { return text; }
+	size_t getTextLength() { return textLength; }
+
+	// the objects, in the Model's order.  Objects kept as text are in the text in the same order.
+	size_t getObjectCount() { return objectCount; }
+	bool isTextObject( size_t index );
+
+	// look up the materials and physics drivers the objects refer to; call once the Model has
+	// built them.  Returns false if any of them is missing.
+	bool resolveReferences();
+
+	// construct an object from its record (main thread only); returns NULL if it can't be rebuilt
+	osg::ref_ptr< bz2object > buildObject( size_t index );
+
+	// the records, in the file (or, while writing, in memory)
+	struct Header;
+	struct Object;
+	struct Transform;
+	struct Slot;
+	struct Face;
+	struct Reference;
+	struct String;
+
+	// the tables of a cache being written
+	struct Tables;
+
+private:
+
+	// no copying
+	BZWCache( const BZWCache& );
+	BZWCache& operator =( const BZWCache& );
+
+	// add an object's record to the tables, field by field if it can be; returns false if it has to be kept as text
+	static bool encode( bz2object* obj, Tables& tables );
+
+	// set an object's fields from its record; returns false if they don't fit the object
+	bool decode( size_t index, bz2object* obj );
+
+	std::string getString( unsigned int index );
+
+	BZWMappedFile file;
+
+	const Object* objects;
+	size_t objectCount;
+
+	const Transform* transforms;
+	size_t transformCount;
+
+	const Slot* slots;
+	size_t slotCount;
+
+	const Face* faces;
+	size_t faceCount;
+
+	const Reference* references;
+	size_t referenceCount;
+
+	const String* strings;
+	size_t stringCount;
+
+	const char* stringData;
+	size_t stringDataLength;
+
+	const char* text;
+	size_t textLength;
+
+	// what the references point to, once resolved
+	std::vector< DataEntry* > resolved;
+};
+
+#endif /*BZWCACHE_H_*/
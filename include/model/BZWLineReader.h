@@ -0,0 +1,133 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef BZWLINEREADER_H_
+#define BZWLINEREADER_H_
+
+#include <string.h>
+#include <ctype.h>
+#include <string>
+
+#include "TextUtils.h"
+
+/**
+ * A single line of BZW text, referenced in place inside a larger buffer.
+ * Comments and the whitespace on either side have already been cut, so this
+ * is exactly what BZWParser::cutWhiteSpace() would have returned--without the copy.
+ */
+
+struct BZWLine {
+	const char* begin;
+	const char* end;
+
+	// byte offset of the NEXT line in the buffer (useful for progress reporting)
+	size_t offset;
+
+	// 1-based line number
+	int number;
+
+	bool empty() const { return begin == end; }
+	size_t length() const { return end - begin; }
+
+	// end of the first token on the line
+	const char* keyEnd() const {
+		const char* c = begin;
+		while( c != end && !TextUtils::isWhitespace( *c ) )
+			c++;
+		return c;
+	}
+
+	// does the line's key match (case-insensitively) a lower-case string?
+	bool keyIs( const char* lowerKey ) const {
+		const char* k = keyEnd();
+		const char* c = begin;
+		for( ; c != k && *lowerKey != 0; c++, lowerKey++ ) {
+			if( ::tolower( *c ) != *lowerKey )
+				return false;
+		}
+		return c == k && *lowerKey == 0;
+	}
+
+	// the lower-case key of the line (same as BZWParser::key())
+	std::string key() const {
+		std::string ret( begin, keyEnd() );
+		for( std::string::iterator i = ret.begin(); i != ret.end(); ++i )
+			*i = ::tolower( *i );
+		return ret;
+	}
+
+	// adapter for the per-object parse( std::string& ) methods:  copy the line into a
+	// caller-owned string, reusing its storage so that no allocation happens per line
+	void assignTo( std::string& str ) const { str.assign( begin, end ); }
+};
+
+/**
+ * Walks a buffer of BZW text one line at a time without copying anything.
+ */
+
+class BZWLineReader {
+
+public:
+
+	BZWLineReader( const char* _begin, const char* _end ) {
+		start = _begin;
+		cur = _begin;
+		stop = _end;
+		lineCount = 0;
+	}
+
+	// get the next line; returns false once the buffer is exhausted
+	bool next( BZWLine& line ) {
+		if( cur >= stop )
+			return false;
+
+		const char* lineEnd = (const char*)memchr( cur, '\n', stop - cur );
+		if( lineEnd == NULL )
+			lineEnd = stop;
+
+		const char* b = cur;
+		const char* e = lineEnd;
+
+		cur = ( lineEnd == stop ? stop : lineEnd + 1 );
+		lineCount++;
+
+		// cut any comments
+		const char* comment = (const char*)memchr( b, '#', e - b );
+		if( comment != NULL )
+			e = comment;
+
+		// skip outside whitespace (including '\r' from DOS line endings)
+		while( b != e && TextUtils::isWhitespace( *b ) )
+			b++;
+		while( e != b && TextUtils::isWhitespace( *(e - 1) ) )
+			e--;
+
+		line.begin = b;
+		line.end = e;
+		line.offset = cur - start;
+		line.number = lineCount;
+
+		return true;
+	}
+
+	// how far into the buffer we are
+	size_t offset() { return cur - start; }
+
+private:
+
+	const char* start;
+	const char* cur;
+	const char* stop;
+	int lineCount;
+};
+
+#endif /*BZWLINEREADER_H_*/
@@ -0,0 +1,143 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef BZWLOADER_H_
+#define BZWLOADER_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "model/Model.h"
+#include "model/BZWMappedFile.h"
+#include "model/BZWSectionSplitter.h"
+
+#include "WorkerPool.h"
+#include "LockFreeQueue.h"
+
+/**
+ * Loads a world a little at a time, so the main thread can keep handling events (and
+ * drawing the world as it comes in) while it loads.
+ *
+ * start() builds everything that objects refer to by name, which is quick.  After that,
+ * each call to step() does a bounded amount of work on the main thread:  it constructs the
+ * next few batches of objects and hands them to the worker pool to be parsed, and it takes
+ * the batches the workers have finished off of a lock-free queue, then finalizes them and
+ * adds them to the Model in file order, one CHANGE_SET notification per batch.
+ *
+ * If there is an up-to-date BZWCache next to the world, start() rebuilds the whole world
+ * from that instead, and the load is already done.  Otherwise the cache is written once
+ * the world has loaded cleanly.
+ *
+ * Everything but parsing stays on the main thread, since object constructors, finalize()
+ * (which builds geometry, materials and textures through SceneBuilder's and material's
+ * shared caches) and the Model's observers touch the scene graph.
+ */
+
+class BZWLoader {
+
+public:
+
+	BZWLoader( Model* model );
+	~BZWLoader();
+
+	// open a world and build everything its objects refer to by name; returns false if the file can't be read
+	bool start( const char* filename );
+
+	// do about the given number of seconds' worth of work (main thread only).  Returns true while
+	// there is more to do.
+	bool step( double seconds );
+
+	// stop loading, and throw away the half-loaded world
+	void cancel();
+
+	bool isDone() { return done; }
+	bool isCancelled() { return cancelled; }
+
+	// false if the world had errors (see Model::getErrors())
+	bool succeeded() { return success; }
+
+	// how far along the load is, from 0 to 1
+	float getProgress();
+
+	// how many objects have been added so far, out of how many
+	size_t getObjectsLoaded() { return loaded; }
+	size_t getObjectCount() { return objectSections.size(); }
+
+	const std::string& getFileName() { return filename; }
+
+private:
+
+	// a run of objects that is parsed on the worker pool
+	struct Batch : public WorkerTask {
+		BZWLoader* loader;
+		unsigned int index;
+		std::vector< Model::ParseJob > jobs;
+
+		// link in the parsed queue
+		Batch* next;
+
+		virtual void run();
+	};
+
+	// no copying
+	BZWLoader( const BZWLoader& );
+	BZWLoader& operator =( const BZWLoader& );
+
+	// construct the next batch of objects and send it off to be parsed
+	void dispatch();
+
+	// finalize a parsed batch, and add its objects to the Model
+	void add( Batch* batch );
+
+	// build the links and wrap up
+	void finish();
+
+	// wait for the workers to hand back every batch of this loader's, then free them
+	void drain();
+
+	Model* model;
+
+	// the world file (the sections point into it)
+	BZWMappedFile file;
+
+	std::vector< BZWSection > sections;
+	std::vector< BZWSection* > objectSections;
+	std::vector< BZWSection* > linkSections;
+
+	// the next object section to construct
+	size_t nextSection;
+
+	// the index of the next batch to send out, and of the next one to add to the Model
+	unsigned int nextBatch;
+	unsigned int nextAdd;
+
+	// batches out on the worker pool or waiting in the queue
+	unsigned int outstanding;
+
+	// batches the workers are done with
+	LockFreeQueue< Batch > parsed;
+
+	// parsed batches that are waiting for the batches before them
+	std::map< unsigned int, Batch* > waiting;
+
+	// read by the workers, which skip the rest of the work once it's set
+	volatile bool cancelled;
+
+	bool done;
+	bool success;
+	size_t loaded;
+
+	std::string filename;
+};
+
+#endif /*BZWLOADER_H_*/
@@ -0,0 +1,65 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef BZWMAPPEDFILE_H_
+#define BZWMAPPEDFILE_H_
+
+#include <stddef.h>
+
+/**
+ * A read-only view of an entire file on disk.  The file is memory mapped where the
+ * platform allows it; otherwise it is read into a single heap buffer.  Either way,
+ * the contents can be tokenized in place without copying individual lines.
+ */
+
+class BZWMappedFile {
+
+public:
+
+	BZWMappedFile();
+	~BZWMappedFile();
+
+	// map a file; returns false if it can't be opened
+	bool open( const char* filename );
+
+	// unmap the file (called automatically by the destructor)
+	void close();
+
+	bool isOpen() { return data != NULL || isEmpty; }
+
+	// the file contents (NOT null-terminated)
+	const char* begin() { return data; }
+	const char* end() { return data + length; }
+	size_t size() { return length; }
+
+private:
+
+	// no copying
+	BZWMappedFile( const BZWMappedFile& );
+	BZWMappedFile& operator =( const BZWMappedFile& );
+
+	const char* data;
+	size_t length;
+
+	// zero-length files can't be mapped, but they are still valid
+	bool isEmpty;
+
+	// set if we had to fall back to reading the file into memory
+	char* buffer;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+};
+
+#endif /*BZWMAPPEDFILE_H_*/
@@ -89,6 +89,10 @@ class BZWParser {
   // the big tamale: the top-level file loader
   static bool loadFile(const char* filename);
 
+  // load worlds from (and keep) the binary cache next to each world file
+  static void setUseCache( bool value ) { _useCache = value; }
+  static bool getUseCache() { return _useCache; }
+
   // get list of integers from a string
   static vector<int> getIntList( const char* line );
 
@@ -102,6 +106,8 @@ class BZWParser {
 
   static Model* _modelRef;
 
+  static bool _useCache;
+
 };
 
 #endif /*BZWPARSER_H_*/
@@ -0,0 +1,90 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef BZWSECTIONCACHE_H_
+#define BZWSECTIONCACHE_H_
+
+#include <stddef.h>
+#include <string>
+#include <map>
+
+#include "Observer.h"
+
+class DataEntry;
+class BZWWriter;
+
+/**
+ * Remembers the text each object was last saved as, so that the next save only has to
+ * re-serialize the objects that changed.  Everything else is written straight out of the
+ * cached text.
+ *
+ * An object's section is reused while its change flag (DataEntry::setChanged()) is clear;
+ * writing a section clears the flag.  The cache watches the Model:  REMOVE_OBJECT and ADD_OBJECT
+ * drop an object's section, and UPDATE_OBJECT marks the object as changed (as do the same lists
+ * in a CHANGE_SET).
+ *
+ * Objects print the names of the materials, physics drivers and group definitions they
+ * use, so every write is given a description of those.  If it differs from the last write,
+ * nothing is reused.
+ */
+
+class BZWSectionCache : public Observer {
+
+public:
+
+	BZWSectionCache();
+
+	virtual ~BZWSectionCache() { }
+
+	// track added, removed and updated objects
+	void update( Observable* obs, void* data );
+
+	// start writing a new copy of the world
+	void begin( const std::string& dependencies );
+
+	// write an object's section to out: the cached text if the object hasn't changed, otherwise toString()
+	void write( DataEntry* entry, BZWWriter& out );
+
+	// finish the world started with begin(), dropping the sections of objects it didn't write
+	void end();
+
+	// forget everything
+	void clear();
+
+	// how many sections the last write copied, and how many it serialized
+	size_t getSectionsReused() { return reused; }
+	size_t getSectionsWritten() { return written; }
+
+private:
+
+	// an object's text, and the write it was last used in
+	struct Section {
+		Section() { generation = 0; }
+
+		std::string text;
+		unsigned int generation;
+	};
+
+	std::map< DataEntry*, Section > sections;
+
+	// what the cached sections refer to by name, and whether that still holds for this write
+	std::string dependencies;
+	bool reuse;
+
+	// the write in progress
+	unsigned int generation;
+
+	size_t reused;
+	size_t written;
+};
+
+#endif /*BZWSECTIONCACHE_H_*/
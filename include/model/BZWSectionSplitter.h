@@ -0,0 +1,77 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef BZWSECTIONSPLITTER_H_
+#define BZWSECTIONSPLITTER_H_
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "model/BZWLineReader.h"
+
+/**
+ * One top-level object's worth of BZW text, referenced in place inside the file buffer.
+ */
+struct BZWSection {
+	// lower-case key of the header line
+	std::string header;
+
+	// from the start of the header line to the end of the terminator line
+	const char* begin;
+	const char* end;
+
+	// line number of the header line
+	int line;
+
+	// false if the file ended before the terminator was found
+	bool terminated;
+};
+
+/**
+ * Splits a buffer of BZW text into top-level sections by finding the header and terminator
+ * of each object.  Nested objects (mesh faces, drawinfo blocks, objects in a define...) are
+ * followed using the hierarchy and terminator tables registered with the Model.
+ */
+class BZWSectionSplitter {
+
+public:
+
+	BZWSectionSplitter() { }
+
+	// register a top-level header (lower case)
+	void addHeader( const std::string& header ) { headers[ header ] = true; }
+
+	// split the text.  A line outside of any section whose key is not a registered header
+	// becomes a section of its own, so the caller can report it.
+	void split( const char* begin, const char* end, std::vector< BZWSection >& sections );
+
+private:
+
+	// what a header expects inside of it
+	struct Scope {
+		std::string terminator;
+		std::vector< std::string > subobjects;
+	};
+
+	// get (and cache) the scope for a header
+	const Scope* scopeOf( const std::string& header );
+
+	// find a subobject header in the current scope
+	const Scope* subobjectOf( const Scope* scope, const BZWLine& line );
+
+	std::map< std::string, Scope > scopes;
+
+	std::map< std::string, bool > headers;
+};
+
+#endif /*BZWSECTIONSPLITTER_H_*/
@@ -0,0 +1,98 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef BZWWRITER_H_
+#define BZWWRITER_H_
+
+#include <stdio.h>
+#include <string>
+
+/**
+ * Buffered output for BZW text.  The text goes to a file, to an already-open stream
+ * (i.e. a pipe or stdout), or to a string in memory, a buffer's worth at a time, so a
+ * world can be written out section by section without ever holding all of it.
+ *
+ * Files are written atomically by default:  the text goes to a temporary file next to
+ * the real one, which only replaces it once close() has written everything.
+ */
+
+class BZWWriter {
+
+public:
+
+	// write to a file (call open() first)
+	BZWWriter();
+
+	// write to an open stream (it is flushed, but not closed)
+	BZWWriter( FILE* stream );
+
+	// append to a string
+	BZWWriter( std::string& str );
+
+	~BZWWriter();
+
+	// open a file for writing; returns false if it can't be created
+	bool open( const char* filename, bool atomic = true );
+
+	// flush everything, and (for an atomic file) move it into place.
+	// Returns false if anything failed to be written, in which case an
+	// atomically written file is left untouched.
+	bool close();
+
+	// throw away an unfinished file
+	void abort();
+
+	void write( const char* text, size_t length );
+	void write( const std::string& text ) { write( text.data(), text.size() ); }
+	void write( const char* text );
+
+	BZWWriter& operator <<( const std::string& text ) { write( text ); return *this; }
+	BZWWriter& operator <<( const char* text ) { write( text ); return *this; }
+
+	// push the buffer out to the target
+	bool flush();
+
+	// false once a write has failed
+	bool good() { return !failed; }
+
+	// how many bytes have been written so far
+	size_t getBytesWritten() { return bytesWritten; }
+
+private:
+
+	// no copying
+	BZWWriter( const BZWWriter& );
+	BZWWriter& operator =( const BZWWriter& );
+
+	void init();
+
+	// where the text goes
+	FILE* file;
+	std::string* memory;
+
+	// set if we opened the file (and have to close it)
+	bool ownsFile;
+
+	// the real file name, and the temporary one being written (atomic writes only)
+	std::string path;
+	std::string tempPath;
+
+	char* buffer;
+	size_t used;
+
+	size_t bytesWritten;
+
+	bool failed;
+};
+
+#endif /*BZWWRITER_H_*/
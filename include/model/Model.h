@@ -32,18 +32,34 @@ class DataEntry;
 class material;
 class teleporter;
 class group;
+class BZWWriter;
+class BZWCache;
+struct BZWSection;
 
 // supported query commands.
 #define MODEL_GET "get"
 
 #include "Observable.h"
 #include "ObserverMessage.h"
+#include "BZWSectionCache.h"
 
 #include "dialogs/ConfigurationDialog.h"
 
 #include <osg/ref_ptr>
 #include <osg/Vec3>
 
+// a hash table, from TR1 on compilers without C++11
+#if __cplusplus >= 201103L || ( defined( _MSC_VER ) && _MSC_VER >= 1600 )
+#include <unordered_map>
+#define BZWB_HASH_MAP std::unordered_map
+#elif defined( _MSC_VER )
+#include <unordered_map>
+#define BZWB_HASH_MAP std::tr1::unordered_map
+#else
+#include <tr1/unordered_map>
+#define BZWB_HASH_MAP std::tr1::unordered_map
+#endif
+
 
 // thrown when there is an error reading a bzw file
 struct BZWReadError {
@@ -80,9 +96,63 @@ public:
 	// build the model from a stream of bzw data
 	static bool build( std::istream& data );
 
-	// the real build method
+	// build the model from a buffer of bzw data (i.e. a memory mapped file)
+	static bool build( const char* data, size_t length );
+
+	// build the model from a world cache written by an earlier load or save.  Returns false if the
+	// world couldn't be rebuilt from it, in which case the world's text should be parsed instead.
+	static bool build( BZWCache& cache );
+
+	// the real build methods
 	// returns false if it fails
 	bool _build( std::istream& data );
+	bool _build( const char* data, size_t length );
+	bool _build( BZWCache& cache );
+
+	// build on this thread, one line at a time
+	bool _buildSerial( const char* data, size_t length );
+
+	// split the data into sections, then parse the sections on a thread pool
+	bool _buildParallel( const char* data, size_t length );
+
+	// parse sections that were already split out of the data (on the thread pool when building in parallel)
+	bool _buildSections( std::vector< BZWSection >& sections, size_t length );
+
+	// a top-level object being built from its section
+	struct ParseJob {
+		BZWSection* section;
+		osg::ref_ptr< bz2object > object;
+
+		// set once parse() reports the end of the object
+		bool complete;
+
+		std::vector< BZWReadError > errors;
+	};
+
+	// the steps of a build, for builds that don't happen all at once (see BZWLoader):
+	// build everything that objects refer to by name, and sort out the sections of the other objects
+	void _beginBuild( std::vector< BZWSection >& sections, std::vector< BZWSection* >& objectSections, std::vector< BZWSection* >& linkSections );
+
+	// construct an object for its section (main thread only)
+	void _buildJob( BZWSection& section, ParseJob& job );
+
+	// parse the object (safe on any thread, as long as the job isn't shared, since parse() only sets the object's fields)
+	static void parseJob( ParseJob& job );
+
+	// collect the job's errors and finalize its object (main thread only:  finalize() builds the object's
+	// geometry, materials and textures through shared caches); returns true if the object should be added
+	bool _finishJob( ParseJob& job );
+
+	// build the links; returns false if there were any errors during the build
+	bool _endBuild( std::vector< BZWSection* >& linkSections );
+
+	// split bzw text into its top-level objects
+	static void splitSections( const char* begin, const char* end, std::vector< BZWSection >& sections );
+	void _splitSections( const char* begin, const char* end, std::vector< BZWSection >& sections );
+
+	// choose between the serial and parallel builds
+	static void setParallelBuild( bool value );
+	static bool getParallelBuild();
 
 	// universal getter
 	static std::string& toString(void);
@@ -90,6 +160,13 @@ public:
 	// the "real" universal getter
 	std::string& _toString(void);
 
+	// write the world out section by section; returns false if the writer failed
+	static bool write( BZWWriter& out );
+	bool _write( BZWWriter& out );
+
+	// the objects' text from the last write, reused for objects that haven't changed since
+	BZWSectionCache& _getSectionCache() { return sectionCache; }
+
 	// BZWB-specific API for built-in objects
 	static world* getWorldData();
 	static waterLevel* getWaterLevelData();
@@ -104,12 +181,17 @@ public:
 	static std::map< std::string, define* >& getGroups();
 
 	static void addObject( bz2object* obj );
+	static void addObjects( objRefList& objs );
+	static void addMaterial( material* mat );
 	static DataEntry* buildObject( const char* header );
 	static void removeObject( bz2object* obj );
+	static void updateObject( bz2object* obj );
 	static void setSelected( bz2object* obj );
+	static void setSelected( const std::vector< bz2object* >& objs );
 	static void setUnselected( bz2object* obj );
 	static void selectAll();
 	static void unselectAll();
+	static void invertSelection();
 	static bool isSelected( bz2object* obj );
 	static objRefList& getSelection();
 	static void assignMaterial( const std::string& matref, bz2object* obj );
@@ -122,6 +204,7 @@ public:
 	static bool renamePhysicsDriver( std::string oldName, std::string newName );
 	static bool renameTeleporterLink( std::string oldName, std::string newName );
 	static bool renameGroup( std::string oldName, std::string newName );
+	static void renameObject( bz2object* obj, const std::string& oldName );
 
 	// editor-like methods (BZWB-specific)
 	static bool cutSelection();
@@ -147,19 +230,24 @@ public:
 	std::map< std::string, define* >& _getGroups() { return this->groups; }
 
 	void _addObject( bz2object* obj );
+	void _addObjects( objRefList& objs );
+	void _addMaterial( material* mat );
 	DataEntry* _buildObject( const char* header );
 	void _removeObject( bz2object* obj );
+	void _updateObject( bz2object* obj );
 	void _removeMaterial( material* mat );
 	void _removePhysicsDriver( physics* phydrv );
 	void _removeTextureMatrix( texturematrix* texmat );
 	void _removeDynamicColor( dynamicColor* dyncol );
 	void _removeGroup( define* def );
 	void _setSelected( bz2object* obj );
+	void _setSelected( const std::vector< bz2object* >& objs );
 	void _setUnselected( bz2object* obj );
 	void _selectAll();
 	void _unselectAll();
+	void _invertSelection();
 	bool _isSelected( bz2object* obj );
-	objRefList& _getSelection() { return this->selectedObjects; }
+	objRefList& _getSelection() { _sweepSelection(); return this->selectedObjects; }
 	void _assignMaterial( const std::string& matref, bz2object* obj );
 	void _assignMaterial( material* matref, bz2object* obj );
 	ConfigurationDialog* _configureObject( DataEntry* obj );
@@ -170,6 +258,7 @@ public:
 	bool _renamePhysicsDriver( std::string oldName, std::string newName );
 	bool _renameTeleporterLink( std::string oldName, std::string newName );
 	bool _renameGroup( std::string oldName, std::string newName );
+	void _renameObject( bz2object* obj, const std::string& oldName );
 
 	// editor-like methods (BZWB-specific)--instantiated
 	bool _cutSelection();
@@ -250,6 +339,9 @@ private:
 	std::map< std::string, osg::ref_ptr< material > > materials;
 	osg::ref_ptr< material > defaultMaterial; 		// default material
 
+// materials in the order they were added (materials can be referenced by index)
+	std::vector< material* > materialIndex;
+
 // group definitions (map refname to object)
 	std::map< std::string, define* > groups;
 
@@ -265,6 +357,22 @@ private:
 // objects
 	objRefList objects;
 
+// objects by type and name (for "get" commands), in the order they were added; kept up to date by renameObject().
+// Objects of different types may share a name, so the key is nameKey( type, name ).
+	typedef BZWB_HASH_MAP< std::string, std::vector< bz2object* > > NameIndex;
+	NameIndex objectNames;
+
+	static std::string nameKey( const std::string& type, const std::string& name ) { return type + " " + name; }
+
+// take an object out of the name index; returns false if it wasn't there under that name
+	bool _unindexObject( bz2object* obj, const std::string& name );
+
+// the text of each object in the last world written out
+	BZWSectionCache sectionCache;
+
+// the names objects print for their materials, physics drivers and group definitions
+	std::string _sectionDependencies();
+
 // world data (array of all objects in BZW format)
 	std::vector<std::string> data;
 
@@ -292,12 +400,19 @@ private:
 // save unused data chunks
 	std::vector<std::string> unusedData;
 
-// vector of selected objects
+// vector of selected objects, in the order they were selected.  An object's own selection
+// flag is what counts; unselecting only clears the flag, and the stale entries are swept
+// out the next time the selection is read.
 	objRefList selectedObjects;
+	unsigned int staleSelections;
+	void _sweepSelection();
 
 // cut/copy buffer
 	objRefList objectBuffer;
 
+// parse on the worker pool when building
+	bool parallelBuild;
+
 	static Model* modRef;
 };
 
@@ -0,0 +1,76 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef OBSERVERCHANGESET_H_
+#define OBSERVERCHANGESET_H_
+
+#include <stddef.h>
+#include <vector>
+#include <set>
+
+#include "model/ObserverMessage.h"
+
+/**
+ * The messages sent during an Observable batch (see Observable::beginBatch()), boiled down
+ * to what changed.  The Observable delivers it as a single CHANGE_SET message.
+ *
+ * Each object shows up at most once per list.  An object that was added and removed in the
+ * same batch doesn't show up at all, one that was removed and added back is only listed as
+ * updated, and updates to removed objects are dropped.  For UPDATE_WORLD and UPDATE_WATERLEVEL,
+ * only the last one counts.
+ */
+
+class ObserverChangeSet {
+
+public:
+
+	ObserverChangeSet() { clear(); }
+
+	// fold a message (or a NULL refresh request) into the set
+	void add( ObserverMessage* message );
+
+	// sort out the lists; call once all of the messages are in
+	void finish();
+
+	void clear();
+
+	bool isEmpty() { return count == 0; }
+
+	// objects added, in the order they were added
+	std::vector< void* > added;
+
+	// objects removed
+	std::vector< void* > removed;
+
+	// objects updated (including ones added in this batch and updated after)
+	std::vector< void* > updated;
+
+	// the world was resized, and the last data sent with UPDATE_WORLD
+	bool worldChanged;
+	void* world;
+
+	// the water level changed, and the last data sent with UPDATE_WATERLEVEL
+	bool waterLevelChanged;
+	void* waterLevel;
+
+private:
+
+	// what's in the lists so far, for checking against later messages
+	std::set< void* > addedSet;
+	std::set< void* > removedSet;
+	std::set< void* > updatedSet;
+
+	// messages folded in
+	unsigned int count;
+};
+
+#endif /*OBSERVERCHANGESET_H_*/
@@ -27,7 +27,8 @@ public:
 		REMOVE_OBJECT,		// remove an object
 		ADD_OBJECT,			// add an object
 		UPDATE_WORLD,		// re-size the world
-		UPDATE_WATERLEVEL	// alter the water level
+		UPDATE_WATERLEVEL,	// alter the water level
+		CHANGE_SET			// everything that changed during a batch (data is an ObserverChangeSet*)
 	};
 
 	ObserverMessageType type;
@@ -16,6 +16,7 @@
 #include <osg/Node>
 #include <osg/Geode>
 #include <osg/Texture2D>
+#include <osg/Array>
 #include "render/Point2D.h"
 #include "Transform.h"
 
@@ -43,6 +44,24 @@ public:
 							 osg::Vec3 pos, osg::ref_ptr<BZTransform> transforms);
 
 	static osg::Group* buildUntexturedBox( osg::Vec3 size );
+
+	// Unit boxes and pyramids (the ones box, base, zone and pyramid build) share their
+	// vertex and normal arrays and primitive sets.  Given the vertex array of one of their
+	// sides, this returns where each vertex sits in the side's texture rectangle (0 or 1 along
+	// each axis, 0.5 for a pyramid's apex), or NULL if the array isn't shared.
+	static osg::Vec2Array* getUnitCorners( const osg::Array* vertices );
+
+private:
+
+	// the shared unit meshes, built the first time one is asked for
+	static void buildUnitMeshes();
+
+	// the untextured meshes, at any size
+	static osg::Group* buildBoxMesh( osg::Vec3 size );
+	static osg::Group* buildPyramidMesh( osg::Vec3 size, bool flipz );
+
+	// a new box or pyramid with its own nodes and Geometries, but the arrays of the given one
+	static osg::Group* shareUnitMesh( osg::Group* mesh );
 };
 
 #endif /* PRIMITIVES_H_ */
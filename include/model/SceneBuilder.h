@@ -124,24 +124,23 @@ public:
 	}
 	
 	// indicate that this is a node
-	static string nameNode( const char* str ) {
-		return itoa( ++nameCount ) + "|" + str + SCENEBUILDER_TAIL_NODE;	
-	}
+	static string nameNode( const char* str );
 	
 	// indicate that this is a selected node
 	static string nameSelectedNode( const char* str) {
 		return nameSelected( nameNode( str ).c_str() );
 	}
 	
-	// make a unique name
-	static string makeUniqueName( const char* name ) {
-		return string(name) + "_" + string(itoa(nameCount++));
-	}
+	// make a unique name (safe to call from the parser's worker threads)
+	static string makeUniqueName( const char* name );
 
 	static bz2object* cloneBZObject( bz2object* );
 	
 	static void clearStateCache();
 	
+	// how many StateSets the cache holds
+	static unsigned int getStateCacheSize();
+	
 private:
 	
 	/*
@@ -0,0 +1,138 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef TEXTURECACHE_H_
+#define TEXTURECACHE_H_
+
+#include <osg/Image>
+
+#include <OpenThreads/Mutex>
+
+#include <map>
+#include <set>
+#include <string>
+
+/**
+ * The on-disk cache of downloaded textures (share/textures/bzwb_cache).
+ *
+ * Downloads are stored by the hash of their contents, so URLs that serve the same image
+ * share one copy.  Next to each one goes its decoded image, mipmaps and all, so a texture
+ * that was seen before never goes through the PNG decoder again.  An index file maps each
+ * URL to its content hash, along with the ETag and Last-Modified the server sent, so that
+ * later downloads can ask the server whether the texture changed instead of fetching it.
+ *
+ * The cache is kept under a size budget by throwing out the contents that were least
+ * recently used.  Every method is safe to call from any thread.
+ */
+
+class TextureCache {
+
+public:
+
+	// what the cache knows about a URL
+	struct Entry {
+		// the hash of the URL's contents, in hex; it names the files they're stored in
+		std::string hash;
+
+		// what the server said to revalidate the contents with (either may be empty)
+		std::string etag;
+		std::string lastModified;
+
+		// the bytes the contents and their decoded image take up
+		unsigned long long size;
+
+		// when it was last used (seconds since the epoch)
+		unsigned long long lastUsed;
+	};
+
+	// the default size budget, in bytes
+	static const unsigned long long DEFAULT_BUDGET;
+
+	TextureCache( const std::string& directory, unsigned long long budget = DEFAULT_BUDGET );
+
+	// saves the index
+	~TextureCache();
+
+	// look up a URL, marking it used; returns false if it isn't cached
+	bool lookup( const std::string& url, Entry& entry );
+
+	// store what a URL served, and return the hash it's stored under (empty if it couldn't be written)
+	std::string store( const std::string& url, const std::string& contents, const std::string& etag, const std::string& lastModified );
+
+	// the file the contents with a hash are in
+	std::string getContentPath( const std::string& hash );
+
+	// the decoded image for the contents with a hash, or NULL if there isn't one
+	osg::Image* readImage( const std::string& hash );
+
+	// store the decoded image for the contents with a hash.  Returns the image with mipmaps
+	// added (which may be the same image).
+	osg::Image* storeImage( const std::string& hash, osg::Image* image );
+
+	// write the index out, if it changed; returns false if it couldn't be written
+	bool save();
+
+	// throw out everything
+	void clear();
+
+	// the size of everything in the cache, and the size it's kept under
+	unsigned long long getSize();
+	unsigned long long getBudget() { return budget; }
+	void setBudget( unsigned long long size );
+
+	// how many decoded images have been read and stored
+	unsigned int getImagesRead() { return imagesRead; }
+	unsigned int getImagesStored() { return imagesStored; }
+
+	// the image with a full chain of mipmaps, built with a box filter, or NULL if the
+	// image's format isn't one that can be filtered
+	static osg::Image* buildMipmaps( osg::Image* image );
+
+private:
+
+	// no copying
+	TextureCache( const TextureCache& );
+	TextureCache& operator =( const TextureCache& );
+
+	// read the index
+	void load();
+
+	// the file the decoded image for the contents with a hash is in
+	std::string getImagePath( const std::string& hash );
+
+	// throw out the least recently used contents (other than keep) until the cache fits
+	// in its budget (call with the mutex held)
+	void evict( const std::string& keep );
+
+	// remove the files for the contents with a hash (call with the mutex held)
+	void removeContents( const std::string& hash );
+
+	static unsigned long long now();
+
+	std::string directory;
+	unsigned long long budget;
+
+	// by URL
+	std::map< std::string, Entry > entries;
+
+	// contents being written, so two threads don't write the same file at once
+	std::set< std::string > writing;
+
+	bool dirty;
+
+	unsigned int imagesRead;
+	unsigned int imagesStored;
+
+	OpenThreads::Mutex mutex;
+};
+
+#endif /*TEXTURECACHE_H_*/
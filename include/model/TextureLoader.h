@@ -0,0 +1,157 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef TEXTURELOADER_H_
+#define TEXTURELOADER_H_
+
+#include <osg/Image>
+#include <osg/Texture2D>
+
+#include <OpenThreads/Mutex>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "WorkerPool.h"
+#include "LockFreeQueue.h"
+#include "TextureCache.h"
+
+/**
+ * Loads textures in the background.  load() hands back a texture straight away, showing a
+ * placeholder image; the file is downloaded (for http:// textures) and decoded on worker
+ * threads, and the main thread swaps the real image in when it calls update().
+ *
+ * Each texture name is only loaded once, however many times it's asked for, until clear()
+ * forgets the textures that have finished loading (when a world is closed).  Downloads run
+ * on a pool of their own, so at most DOWNLOAD_THREADS of them are open at a time, and go
+ * into a TextureCache.  A URL that's already cached is revalidated with the server (which
+ * only sends it again if it changed) each time it's loaded after a clear(), and its decoded
+ * image is read back from the cache.
+ */
+
+class TextureLoader {
+
+public:
+
+	// the most downloads to run at once
+	static const int DOWNLOAD_THREADS;
+
+	// downloads are cached in cacheDirectory (share/textures/bzwb_cache/ by default)
+	TextureLoader( const std::string& cacheDirectory = "" );
+	~TextureLoader();
+
+	// a texture for a name from a world file (a file in the textures directory, with or
+	// without ".png", or an http:// URL).  Its image is a placeholder until update() swaps
+	// the real one in.
+	osg::Texture2D* load( const std::string& name );
+
+	// swap the images that have finished loading into their textures (main thread only).
+	// Returns true if any were swapped in.
+	bool update();
+
+	// are there textures still loading?
+	bool isBusy();
+
+	// block until every texture asked for so far has loaded, then update()
+	void wait();
+
+	// forget the textures that have been swapped in, so they're freed once nothing else uses
+	// them and the next load() reads (or revalidates) them again.  Ones still loading are kept.
+	void clear();
+
+	// the image textures show while they load
+	static osg::Image* getPlaceholder();
+
+	// the loader SceneBuilder uses
+	static TextureLoader* getSharedLoader();
+
+	TextureCache* getCache() { return cache; }
+
+private:
+
+	// one texture name being loaded
+	struct Request : public WorkerTask {
+		TextureLoader* loader;
+
+		// the name it was asked for by, the URL to download it from (if any), and the file to read
+		std::string name;
+		std::string url;
+		std::string path;
+
+		// what the download is cached under (empty if it isn't)
+		std::string hash;
+
+		// where the "not found" and "error downloading" images are (FindShareFile() isn't thread-safe)
+		std::string uiPath;
+
+		osg::ref_ptr< osg::Texture2D > texture;
+		osg::ref_ptr< osg::Image > image;
+
+		// whether it's been downloaded (or didn't have to be)
+		bool fetched;
+
+		// whether update() has swapped its image in
+		bool swapped;
+
+		// link in the finished queue
+		Request* next;
+
+		virtual void run();
+	};
+
+	// no copying
+	TextureLoader( const TextureLoader& );
+	TextureLoader& operator =( const TextureLoader& );
+
+	// work out the URL and file for a name
+	static void resolve( Request* request );
+
+	enum FetchResult {
+		FETCH_OK,				// the contents came back
+		FETCH_NOT_MODIFIED,		// the cached copy is still good
+		FETCH_FAILED
+	};
+
+	// download a URL, sending the cached copy's ETag and Last-Modified (if any) so the
+	// server can say it hasn't changed
+	static FetchResult fetch( const std::string& url, const TextureCache::Entry* cached,
+							  std::string& contents, std::string& etag, std::string& lastModified );
+
+	static bool exists( const std::string& path );
+
+	// start the pools the first time they're needed
+	WorkerPool* getDownloadPool();
+	WorkerPool* getDecodePool();
+
+	WorkerPool* downloadPool;
+	WorkerPool* decodePool;
+
+	TextureCache* cache;
+
+	// the requests, by name
+	std::map< std::string, Request* > requests;
+
+	// requests the workers are done with
+	LockFreeQueue< Request > finished;
+
+	// requests sent to the pools, and not swapped in yet
+	unsigned int outstanding;
+
+	// guards requests and outstanding
+	OpenThreads::Mutex mutex;
+
+	// read by the workers, which skip the rest of the work once it's set
+	volatile bool cancelled;
+};
+
+#endif /*TEXTURELOADER_H_*/
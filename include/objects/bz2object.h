@@ -38,6 +38,9 @@ class bz2object : public Renderable, public DataEntry
 	// allow SceneBuilder to modify bz2objects
 	friend class SceneBuilder;
 
+	// allow BZWCache to save and restore bz2objects field by field
+	friend class BZWCache;
+
 	public:
 
 		// default constructor
@@ -55,10 +58,14 @@ class bz2object : public Renderable, public DataEntry
 		// specific update message
 		virtual int update(UpdateMessage& msg);
 
-		// parse a single bzw line
+		// parse a single bzw line.  Worlds are parsed on worker threads, so this may only
+		// set the object's own fields; geometry, materials and textures are built in finalize()
 		virtual bool parse( std::string& line );
 
-		// called after done parsing to finalize the changes
+		// rename the object, keeping the Model's index of names up to date
+		void setName( const std::string& name );
+
+		// called after done parsing (on the main thread) to finalize the changes
 		virtual void finalize();
 
 		// toString
@@ -109,21 +116,22 @@ class bz2object : public Renderable, public DataEntry
 		virtual void setRotation( float x, float y, float z ) {
 			// only set z rotation, other rotation should be done with a transform
 			orientation->setRotation( 0, 0, z );
+			setChanged();
 		}
 		virtual void setRotation( const osg::Vec3& rot ) { setRotation( 0, 0, rot.z() ); }
 
 		virtual const osg::Vec3& getRotation() { return orientation->getRotation(); }
 
 		// override Renderable's setRotationZ() method
-		virtual void setRotationZ( float r ) { orientation->setRotationZ( r ); }
+		virtual void setRotationZ( float r ) { orientation->setRotationZ( r ); setChanged(); }
 
 		// data setters (makes MasterConfigurationDialog code easier)
-		void setPhyDrv( physics* phydrv, std::string slot = "" ) { physicsSlots[ slot ].phydrv = phydrv; }
-		void setTransforms( osg::ref_ptr<BZTransform> _transformations ) { this->transformations = _transformations; }
+		void setPhyDrv( physics* phydrv, std::string slot = "" ) { physicsSlots[ slot ].phydrv = phydrv; setChanged(); }
+		void setTransforms( osg::ref_ptr<BZTransform> _transformations ) { this->transformations = _transformations; setChanged(); }
 		void setMaterials( vector< material* >& _materials, std::string slot = ""  );
 		void setSelected( bool value ) { selected = value; }
-		void setFlatshading( bool value ) { flatshading = value; updateShadeModel(); }
-		void setSmoothbounce( bool value ) { smoothbounce = value; }
+		void setFlatshading( bool value ) { flatshading = value; updateShadeModel(); setChanged(); }
+		void setSmoothbounce( bool value ) { smoothbounce = value; setChanged(); }
 
 		// set/set the thisNode
 		osg::Node* getThisNode() { return thisNode.get(); }
@@ -196,9 +204,9 @@ class bz2object : public Renderable, public DataEntry
 		osg::Vec3f getPosition() { return orientation->getPosition(); }
 		osg::Vec3f getScale() { return orientation->getScale(); }
 		osg::Quat getAttitude() { return orientation->getAttitude(); }
-		void setPosition( const osg::Vec3d& newPosition ) { orientation->setPosition( newPosition ); }
-		void setScale( const osg::Vec3d& newScale ) { orientation->setScale( newScale ); }
-		void setAttitude( const osg::Quat& newAttitude ) { orientation->setAttitude( newAttitude ); }
+		void setPosition( const osg::Vec3d& newPosition ) { orientation->setPosition( newPosition ); setChanged(); }
+		void setScale( const osg::Vec3d& newScale ) { orientation->setScale( newScale ); setChanged(); }
+		void setAttitude( const osg::Quat& newAttitude ) { orientation->setAttitude( newAttitude ); setChanged(); }
 
 		// update the shade model based on flatshading
 		void updateShadeModel();
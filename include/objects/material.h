@@ -21,6 +21,7 @@
 #include <string.h>
 #include <vector>
 #include <list>
+#include <map>
 
 #include <osg/Material>
 #include <osg/Texture2D>
@@ -142,8 +143,17 @@ public:
 	void reset();
 
 	// use this to compute the osg stateset to apply
-	// this entails merging parts of other materials
-	static material* computeFinalMaterial( vector< material* >& materialList );
+	// this entails merging parts of other materials.
+	// Lists that come out the same (colors, shininess, alpha threshold, texture and culling)
+	// share one material, so the scene has one StateSet for each distinct look.  The default
+	// texture is used if none of the materials has one (and they allow textures).
+	static material* computeFinalMaterial( vector< material* >& materialList, osg::Texture2D* defaultTexture = NULL );
+
+	// how many final materials have been asked for, and how many distinct ones they share
+	static void getFinalMaterialStats( unsigned int& requested, unsigned int& distinct );
+
+	// forget the shared final materials (objects using them keep them)
+	static void clearFinalMaterials();
 
 	// get the current material
 	osg::Material* getCurrentMaterial();
@@ -202,6 +212,23 @@ private:
 
 	// build the alias map
 	void buildAliases();
+
+	// a shared final material, and what it was made from
+	struct FinalMaterial {
+		std::string key;
+		osg::ref_ptr< material > mat;
+	};
+
+	// the shared final materials, by the hash of their key
+	static std::map< unsigned long long, std::vector< FinalMaterial > > finalMaterials;
+	static unsigned int finalMaterialCount;
+	static unsigned int finalMaterialRequests;
+
+	// the count at which finalMaterials is next pruned
+	static unsigned int finalMaterialPruneAt;
+
+	// drop the final materials nothing uses anymore
+	static void pruneFinalMaterials();
 };
 
 #endif /*MATERIAL_H_*/
@@ -21,13 +21,13 @@
 #include "LOD.h"
 #include "LODCommand.h"
 #include "DrawInfo.h"
+#include "render/MeshOptimizer.h"
+#include "render/MeshSimplifier.h"
 
 #include <map>
 
 #include <osg/Vec3>
 
-struct MeshVertex;
-struct TriIndices;
 
 class mesh : public bz2object {
 	
@@ -54,17 +54,23 @@ public:
 	// render
 	int render(void);
 
+	// the vertices, normals, texcoords and faces
+	const MeshData& getData() const { return data; }
+
+	// weld the vertices and reorder the faces (and drawinfo) for the vertex cache;
+	// see MeshOptimizer.  Adds what it did to report.
+	void optimize( float weldDistance, MeshOptimizer::Report& report );
+
+	// does the mesh have a drawinfo?
+	bool hasDrawInfo() const { return drawInfo != NULL; }
+
+	// replace the drawinfo with one of up to levels levels of detail, made by simplifying the
+	// faces; see MeshSimplifier.  Returns false (leaving the mesh alone) if it can't be made.
+	bool generateLODs( unsigned int levels, std::vector< MeshSimplifier::Level >& made );
 
-	
 private:
-	// vertices
-	std::vector<Point3D> vertices;
-	
-	// texture coordinates
-	std::vector<Point2D> texCoords;
-	
-	// normals
-	std::vector<Point3D> normals;
+	// vertices, texture coordinates, normals and faces
+	MeshData data;
 	
 	// inside points
 	std::vector<Point3D> insidePoints;
@@ -72,9 +78,6 @@ private:
 	// outside points
 	std::vector<Point3D> outsidePoints;
 	
-	// faces
-	std::vector<MeshFace*> faces;
-	
 	std::vector<std::string> lodOptions;
 	bool decorative;
 
@@ -83,15 +86,14 @@ private:
 
 	void updateGeometry();
 
+	// build a Geometry for each material the faces use
+	void buildFaces( osg::Group* group );
+
 	// for parsing bzw
-	MeshFace* currentFace;
 	material* currentMaterial;
 	DrawInfo* currentDrawInfo;
 	physics* phydrv;
 	bool noclusters;
-
-	void triangulateFace(const std::vector<MeshVertex>& verts,
-		     std::vector<TriIndices>& tris);
 };
 
 #endif /*MESH_H_*/
@@ -27,6 +27,10 @@ using namespace std;
  */
 
 class pyramid : public bz2object {
+
+	// allow BZWCache to restore flipz without rebuilding the geometry
+	friend class BZWCache;
+
 public:
 	enum {
 		XP = 0,
@@ -79,6 +83,9 @@ public:
 private:
 	bool flipz;
 
+	// which way up the geometry was last built
+	bool builtFlipz;
+
 	Point2D texSizes[FaceCount];
 	Point2D texOffsets[FaceCount];
 	bool driveThroughs[FaceCount];
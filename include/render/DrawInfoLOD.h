@@ -0,0 +1,44 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef DRAWINFOLOD_H_
+#define DRAWINFOLOD_H_
+
+#include <osg/LOD>
+
+/**
+ * The levels of detail of a mesh's drawinfo block.  Like BZFlag, it picks a level by how
+ * much of the mesh one pixel covers:  a level is drawn once a pixel covers at least its
+ * lengthPerPixel, until the next level's lengthPerPixel is reached.  The first level is
+ * also drawn closer up than its own lengthPerPixel.
+ *
+ * Only culling picks a level that way.  Other visitors that look at the active children
+ * (picking, merging) see the first level, and ones that look at all children see them all.
+ */
+class DrawInfoLOD : public osg::LOD {
+
+public:
+
+	DrawInfoLOD();
+
+	// add a level of detail.  Levels have to be added by increasing lengthPerPixel.
+	void addLevel( osg::Node* node, float lengthPerPixel );
+
+	// draw only the level that fits the distance
+	virtual void traverse( osg::NodeVisitor& nv );
+
+protected:
+
+	virtual ~DrawInfoLOD() { }
+};
+
+#endif /*DRAWINFOLOD_H_*/
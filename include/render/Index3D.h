@@ -72,11 +72,22 @@ class Index3D {
 	}
 	
 	string toString() {
-		string tIndices("");
-		if(t1 >= 0 && t2 >= 0 && t3 >= 0)
-			tIndices += string(itoa(t1)) + " " + string(itoa(t2)) + " " + string(itoa(t3));
-			
-		return string("") + string(itoa(a)) + " " + string(itoa(b)) + " " + string(itoa(c)) + " " + tIndices + "\n";
+		string ret;
+		appendInt( ret, a );
+		ret += ' ';
+		appendInt( ret, b );
+		ret += ' ';
+		appendInt( ret, c );
+		ret += ' ';
+		if(t1 >= 0 && t2 >= 0 && t3 >= 0) {
+			appendInt( ret, t1 );
+			ret += ' ';
+			appendInt( ret, t2 );
+			ret += ' ';
+			appendInt( ret, t3 );
+		}
+		ret += '\n';
+		return ret;
 	}
 	
 	virtual ~Index3D() {}
@@ -0,0 +1,101 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef MESHOPTIMIZER_H_
+#define MESHOPTIMIZER_H_
+
+#include <vector>
+
+class MeshData;
+class DrawInfo;
+
+/**
+ * Cleans up a mesh, typically one made by another program, for drawing.
+ *
+ * Vertices closer together than the weld distance are merged, through a spatial hash, and
+ * normals and texture coordinates that are the same (to within a small tolerance) are too.
+ * Vertices nothing uses are dropped, and the rest are numbered in the order they're first used.
+ *
+ * The faces are then put in an order that reuses the GPU's post-transform vertex cache well,
+ * with Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and
+ * Reduced Overdraw", 2007), taking each face, with the triangles it's cut into, as a unit.
+ * A vertex here is a corner's vertex, normal and texcoord together, since that's what the GPU
+ * gets.  The triangles of each drawinfo "tris" command are reordered the same way, its corners
+ * are remapped to the welded vertices and merged when they become the same, and the commands'
+ * indices are rewritten to match.
+ *
+ * Cache use is measured as the average cache miss ratio (ACMR):  vertices transformed per
+ * triangle, through a FIFO cache of CACHE_SIZE entries.  It's 3 at worst, and about 0.5 to
+ * 0.7 for a well ordered regular grid.
+ */
+class MeshOptimizer {
+
+public:
+
+	// the cache that orders are made for and measured with
+	static const unsigned int CACHE_SIZE;
+
+	// normals and texcoords closer than these are merged
+	static const float NORMAL_TOLERANCE;
+	static const float TEXCOORD_TOLERANCE;
+
+	// what an optimization did; each pair is before and after
+	struct Report {
+		Report();
+
+		// add another mesh's report to this one
+		void add( const Report& other );
+
+		unsigned int vertices[2];
+		unsigned int normals[2];
+		unsigned int texcoords[2];
+
+		// faces, and how many were dropped for having indices out of range
+		unsigned int faces;
+		unsigned int droppedFaces;
+
+		// cache misses and triangles of the faces
+		unsigned int faceMisses[2];
+		unsigned int faceTriangles;
+
+		// drawinfo corners, and the cache misses and triangles of its "tris" commands
+		unsigned int corners[2];
+		unsigned int drawInfoMisses[2];
+		unsigned int drawInfoTriangles;
+
+		double getFaceACMR( int i ) const { return ( faceTriangles > 0 ? (double)faceMisses[i] / faceTriangles : 0.0 ); }
+		double getDrawInfoACMR( int i ) const { return ( drawInfoTriangles > 0 ? (double)drawInfoMisses[i] / drawInfoTriangles : 0.0 ); }
+	};
+
+	// vertices closer than weldDistance are merged (0 merges only identical ones)
+	MeshOptimizer( float weldDistance );
+
+	// optimize a mesh's faces, and its drawinfo if it has one
+	void optimize( MeshData& data, DrawInfo* drawInfo, Report& report );
+
+	// the cache misses of a list of triangles (three ids to a triangle, each less than idCount)
+	static unsigned int countMisses( const std::vector< unsigned int >& triangles, unsigned int idCount );
+
+	// put polygons in an order that reuses the vertex cache.  Polygon i's ids are
+	// ids[ start[i] ] up to ids[ start[i + 1] ], each less than idCount.
+	static void tipsify( const std::vector< unsigned int >& start, const std::vector< unsigned int >& ids,
+						 unsigned int idCount, std::vector< unsigned int >& order );
+
+private:
+
+	// merge a drawinfo's corners, and reorder its triangles
+	void optimizeDrawInfo( DrawInfo* drawInfo, Report& report );
+
+	float weldDistance;
+};
+
+#endif /*MESHOPTIMIZER_H_*/
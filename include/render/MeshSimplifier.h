@@ -0,0 +1,161 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef MESHSIMPLIFIER_H_
+#define MESHSIMPLIFIER_H_
+
+#include <osg/Vec3d>
+
+#include <map>
+#include <set>
+#include <vector>
+#include <utility>
+
+class MeshData;
+class DrawInfo;
+
+/**
+ * Makes a drawinfo with levels of detail for a mesh, by simplifying its faces.
+ *
+ * The faces are triangulated, then simplified with quadric error metrics (Garland and
+ * Heckbert, "Surface Simplification Using Quadric Error Metrics", 1997):  edges are collapsed
+ * cheapest first, each moving one end onto the other, so the levels only ever use the mesh's
+ * own vertices and the drawinfo can share its arrays.  Each level has about REDUCTION of the
+ * triangles of the one before.
+ *
+ * Material boundaries and the mesh's open edges are kept:  a vertex on one can only slide
+ * along it, weighted to keep its shape, and a vertex where boundaries meet doesn't move at all.
+ * Collapses that would fold a triangle over or pinch the surface are skipped.
+ *
+ * A level's lengthPerPixel is how far (roughly) its surface strays from the full mesh, in the
+ * mesh's own units, so it is only drawn once that is less than a pixel.
+ *
+ * A MeshSimplifier makes one drawinfo; use a new one for each mesh.
+ */
+class MeshSimplifier {
+
+public:
+
+	// each level keeps about this fraction of the triangles of the one before
+	static const float REDUCTION;
+
+	// one level of detail that was made
+	struct Level {
+		unsigned int triangles;
+		float lengthPerPixel;
+	};
+
+	MeshSimplifier();
+
+	// make a drawinfo with up to levels levels of detail (the full mesh and simplifications
+	// of it), stopping early once simplifying doesn't help.  Returns NULL if there's nothing to
+	// draw, or if a face has no material (since a drawinfo needs a matref for everything).
+	DrawInfo* buildDrawInfo( const MeshData& data, unsigned int levels, std::vector< Level >& made );
+
+private:
+
+	// a plane's squared distance, summed:  the symmetric matrix a, the vector b, and c
+	struct Quadric {
+		Quadric();
+		void addPlane( const osg::Vec3d& normal, double d, double weight );
+		void add( const Quadric& other );
+		double evaluate( const osg::Vec3d& p ) const;
+
+		double a[6];
+		double b[3];
+		double c;
+	};
+
+	struct Triangle {
+		unsigned int vertex[3];
+		unsigned int corner[3];
+		unsigned int group;
+		bool removed;
+	};
+
+	// a possible collapse of one vertex onto another
+	struct Collapse {
+		double cost;
+		unsigned int from;
+		unsigned int to;
+
+		// the vertices' versions when it was queued; it's stale if either changed since
+		unsigned int fromVersion;
+		unsigned int toVersion;
+
+		// the cheapest comes out of the heap first
+		bool operator <( const Collapse& other ) const { return cost > other.cost; }
+	};
+
+	typedef std::pair< unsigned int, unsigned int > Edge;
+
+	static Edge edge( unsigned int a, unsigned int b ) { return ( a < b ? Edge( a, b ) : Edge( b, a ) ); }
+
+	// the corner with a vertex, normal and texcoord, adding it if it's new
+	unsigned int cornerFor( int vertex, int normal, int texcoord );
+
+	// find the material and open boundaries, and add their constraints to the quadrics
+	void findBoundaries();
+
+	// may from be moved onto to?
+	bool canCollapse( unsigned int from, unsigned int to );
+
+	// queue the cheaper way of collapsing an edge, if either is allowed
+	void consider( unsigned int a, unsigned int b );
+
+	// queue every edge around a vertex
+	void considerAround( unsigned int v );
+
+	void collapse( unsigned int from, unsigned int to );
+
+	// collapse edges until there are no more than target triangles
+	void simplify( unsigned int target );
+
+	// the triangles that are left, as corner indices, for each group
+	void snapshot( std::vector< std::vector< unsigned int > >& groups );
+
+	std::vector< osg::Vec3d > positions;
+
+	// for each vertex, the quadric of its faces and boundaries, which measures how far a
+	// collapse moves the surface; and the same with the boundaries weighted, to order collapses
+	std::vector< Quadric > errorQuadrics;
+	std::vector< Quadric > quadrics;
+
+	std::vector< std::vector< unsigned int > > vertexTriangles;
+	std::vector< unsigned int > versions;
+	std::vector< unsigned char > removed;
+
+	// the boundary edges, and how many each vertex is on
+	std::set< Edge > boundaryEdges;
+	std::vector< unsigned int > boundaryCount;
+
+	std::vector< Triangle > triangles;
+	unsigned int liveTriangles;
+
+	// corners as (vertex, normal, texcoord)
+	std::vector< int > cornerVertex;
+	std::vector< int > cornerNormal;
+	std::vector< int > cornerTexcoord;
+	std::map< std::pair< int, std::pair< int, int > >, unsigned int > cornerIndex;
+
+	std::vector< Collapse > heap;
+
+	// room for canCollapse() to work in
+	std::vector< unsigned int > fromNeighbors;
+	std::vector< unsigned int > toNeighbors;
+	std::vector< unsigned int > commonNeighbors;
+
+	// the largest distance (as a square) a collapse has moved the surface so far
+	double error;
+};
+
+#endif /*MESHSIMPLIFIER_H_*/
@@ -0,0 +1,141 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef OBJECTBVH_H_
+#define OBJECTBVH_H_
+
+#include <osg/BoundingBox>
+#include <osg/Polytope>
+#include <osg/Vec3>
+
+#include <map>
+#include <vector>
+
+class bz2object;
+
+/**
+ * A bounding volume hierarchy over the world-space bounds of the world objects, so that
+ * picking only has to test the triangles of the few objects a ray actually passes near.
+ *
+ * The tree is built top-down with the surface area heuristic.  Adding or removing an object
+ * only marks it for a rebuild, which happens on the next query, so loading a world builds it
+ * once.  Objects that move are refit in place:  each query first updates the bounds of the
+ * objects passed to updateObject() since the last one, and grows their ancestors to match.
+ * Nothing else is looked at, so whatever moves an object has to say so.  After enough refits
+ * the tree is rebuilt.
+ */
+
+class ObjectBVH {
+
+public:
+
+	// objects per leaf, at most
+	static const unsigned int LEAF_SIZE;
+
+	ObjectBVH();
+
+	// track an object, or stop tracking it
+	void addObject( bz2object* obj );
+	void removeObject( bz2object* obj );
+
+	// an object may have moved; its bounds are updated on the next query
+	void updateObject( bz2object* obj );
+
+	// forget everything
+	void clear();
+
+	// the objects whose bounds the segment from start to end crosses, nearest first
+	void intersect( const osg::Vec3& start, const osg::Vec3& end, std::vector< bz2object* >& hits );
+
+	// the nearest object whose triangles the segment hits (only looking at nodes in mask), or NULL.
+	// If point isn't NULL, it gets where the object was hit.
+	bz2object* pick( const osg::Vec3& start, const osg::Vec3& end, unsigned int mask = ~0u, osg::Vec3* point = NULL );
+
+	// the objects whose bounds lie entirely inside a volume (such as the slab of the view
+	// frustum behind a rectangle on the screen)
+	void intersect( const osg::Polytope& volume, std::vector< bz2object* >& hits );
+
+	// an object's bounds as of the last query (invalid if it isn't tracked)
+	osg::BoundingBox getBound( bz2object* obj );
+
+	unsigned int getObjectCount() { return leaves.size(); }
+
+	// how many objects the last pick() ran the exact triangle test on
+	unsigned int getTestedCount() { return tested; }
+
+private:
+
+	struct Leaf {
+		bz2object* object;
+		osg::BoundingBox bound;
+
+		// whether the bounds have to be recomputed (and the object is in moved)
+		bool dirty;
+
+		// the tree node the leaf is in, or -1 if it has no bounds and isn't in the tree
+		int node;
+	};
+
+	struct Node {
+		osg::BoundingBox bound;
+		int parent;
+
+		// the children of an inner node, or -1 for a leaf node
+		int left;
+		int right;
+
+		// the leaves of a leaf node
+		unsigned int first;
+		unsigned int count;
+	};
+
+	// a leaf the segment crosses, and how far along the segment it starts
+	struct Candidate {
+		unsigned int leaf;
+		float distance;
+
+		bool operator<( const Candidate& other ) const { return distance < other.distance; }
+	};
+
+	// bring the tree up to date before a query
+	void refresh();
+
+	void build();
+	int buildNode( unsigned int first, unsigned int count, int parent );
+
+	// recompute a leaf's bounds; refit() also grows its ancestors to fit
+	void updateBound( unsigned int leaf );
+	void refit( unsigned int leaf );
+
+	// an object's bounds in world space
+	static osg::BoundingBox computeBound( bz2object* obj );
+
+	// the leaves the segment crosses, in no particular order
+	void collect( const osg::Vec3& start, const osg::Vec3& end, std::vector< Candidate >& candidates );
+
+	// every object under a node
+	void collect( int node, std::vector< bz2object* >& hits );
+
+	std::vector< Leaf > leaves;
+	std::map< bz2object*, unsigned int > leafIndex;
+
+	std::vector< Node > nodes;
+
+	// the objects whose bounds are out of date (some may have been removed since)
+	std::vector< bz2object* > moved;
+
+	bool needsBuild;
+	unsigned int refits;
+	unsigned int tested;
+};
+
+#endif /*OBJECTBVH_H_*/
@@ -49,7 +49,17 @@ class Point2D : public osg::Vec2
 	Point2D( std::string desc ) { Point2D( desc.c_str() ); }
 	
 	string toString(void) {
-	  return std::string("") + std::string(ftoa(x())) + " " + std::string(ftoa(y())) + "\n";
+	  string ret;
+	  appendTo( ret );
+	  return ret;
+	}
+	
+	// append "x y\n" to out
+	void appendTo( string& out ) const {
+	  appendFloat( out, x() );
+	  out += ' ';
+	  appendFloat( out, y() );
+	  out += '\n';
 	}
 	
 	virtual ~Point2D() { }
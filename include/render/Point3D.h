@@ -50,7 +50,19 @@ class Point3D : public osg::Vec3
 	Point3D( string desc ) { Point3D( desc.c_str() ); }
 	
 	string toString(void) {
-	  return string("") + string(ftoa(x())) + " " + string(ftoa(y())) + " " + string(ftoa(z())) + "\n";
+	  string ret;
+	  appendTo( ret );
+	  return ret;
+	}
+	
+	// append "x y z\n" to out
+	void appendTo( string& out ) const {
+	  appendFloat( out, x() );
+	  out += ' ';
+	  appendFloat( out, y() );
+	  out += ' ';
+	  appendFloat( out, z() );
+	  out += '\n';
 	}
 	
 	virtual ~Point3D() { }
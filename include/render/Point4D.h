@@ -51,9 +51,16 @@ class Point4D : public osg::Vec4
 	Point4D( std::string desc ) { Point4D( desc.c_str() ); }
 	
 	string toString(void) {
-		return std::string("") + std::string(ftoa(x())) + " " + 
-			std::string(ftoa(y())) + " " + std::string(ftoa(z())) + " " + 
-			std::string(ftoa(w())) + "\n";
+		string ret;
+		appendFloat( ret, x() );
+		ret += ' ';
+		appendFloat( ret, y() );
+		ret += ' ';
+		appendFloat( ret, z() );
+		ret += ' ';
+		appendFloat( ret, w() );
+		ret += '\n';
+		return ret;
 	}
 	
 	virtual ~Point4D() { }
@@ -933,7 +933,16 @@ public:
 	}
 	
 	string toString(void) {
-		return string(ftoa(r())) + " " + string(ftoa(g())) + " " + string(ftoa(b())) + " " + string(ftoa(a())) + "\n";
+		string ret;
+		appendFloat( ret, r() );
+		ret += ' ';
+		appendFloat( ret, g() );
+		ret += ' ';
+		appendFloat( ret, b() );
+		ret += ' ';
+		appendFloat( ret, a() );
+		ret += '\n';
+		return ret;
 	}
 	
 	
@@ -0,0 +1,49 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef RUBBERBAND_H_
+#define RUBBERBAND_H_
+
+#include <osg/Camera>
+#include <osg/Geometry>
+#include <osg/Vec2>
+
+#include <vector>
+
+/**
+ * The outline dragged out by box and lasso selection.  It's a camera of its own that
+ * draws a line loop in window coordinates over the rest of the scene.
+ */
+class RubberBand : public osg::Camera {
+
+public:
+
+	RubberBand();
+
+	// show an outline (in window coordinates, y up); fewer than two points hide it
+	void setOutline( const std::vector< osg::Vec2 >& points );
+
+	// the size of the window the outline is drawn in
+	void setWindowSize( int width, int height );
+
+protected:
+
+	virtual ~RubberBand() { }
+
+private:
+
+	osg::ref_ptr< osg::Vec3Array > vertices;
+	osg::ref_ptr< osg::DrawArrays > loop;
+	osg::ref_ptr< osg::Geometry > geometry;
+};
+
+#endif /*RUBBERBAND_H_*/
@@ -0,0 +1,157 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef STATICBATCH_H_
+#define STATICBATCH_H_
+
+#include <osg/Group>
+#include <osg/StateSet>
+
+#include <map>
+#include <set>
+#include <vector>
+#include <utility>
+
+class bz2object;
+
+/**
+ * Draws the unselected world objects out of a few large, merged geometries instead of
+ * one node per face.
+ *
+ * The world is cut into square cells.  Each cell gets one Geometry per distinct stack of
+ * StateSets (compared by content, so equal StateSets that weren't shared through
+ * computeFinalMaterial() still share a batch), holding the world-space triangles of every
+ * unselected object in the cell.  The objects themselves stay in the scene for picking, but their
+ * node mask is set to PICK_MASK so the camera (which only draws DRAW_MASK) skips them.
+ * A selected object is taken out of its cell and drawn by itself again, so it can be
+ * highlighted and dragged.
+ *
+ * refresh() is called before every frame.  It checks each object's selection and edit
+ * revision (DataEntry::getRevision()) and rebuilds only the cells that changed.
+ *
+ * With instancing switched on (it's off by default), sides of the shared unit boxes and
+ * pyramids (see Primitives::getUnitCorners()) aren't copied at all where the OpenSceneGraph
+ * is new enough to draw instances:  each one adds a transform and a texture rectangle to the
+ * instance arrays of its side and StateSet stack, and the batch draws the side's one mesh
+ * once per instance.  When an object made only of
+ * instances is edited, refresh() rewrites its slots instead of rebuilding the cell.
+ * Instances are drawn with a shader that lights them like the fixed-function pipeline, except
+ * that it can't tell whether a light is switched off; see the shader for details.
+ *
+ * Objects whose geometry can't be merged (anything but triangles in Geometries with
+ * per-vertex or overall attributes and at most one set of texture coordinates, or
+ * anything with an LOD or Billboard) are always drawn by themselves.
+ */
+
+class StaticBatch : public osg::Group {
+
+public:
+
+	// node mask bits:  the camera draws DRAW_MASK, and picking looks at PICK_MASK
+	static const unsigned int PICK_MASK;
+	static const unsigned int DRAW_MASK;
+
+	// the width of a cell, in world units
+	static const float CELL_SIZE;
+
+	StaticBatch();
+
+	// draw the sides of unit boxes and pyramids as instances, where the OpenSceneGraph can.
+	// Every batch picks it up at its next refresh.
+	static void setInstancing( bool value );
+	static bool getInstancing();
+
+	// start or stop batching an object
+	void addObject( bz2object* obj );
+	void removeObject( bz2object* obj );
+
+	// rebuild the cells whose objects were selected, unselected, or edited since the last refresh.
+	// Call it from the update traversal:  batches it replaces are held until the next refresh,
+	// since the draw thread may still be drawing them.
+	void refresh();
+
+	// how many objects are merged into a batch right now, and how many batches there are
+	unsigned int getBatchedCount() { return batchedCount; }
+	unsigned int getBatchCount() { return batchCount; }
+
+	// how many bytes the batches' own arrays and indices take
+	unsigned int getBatchBytes() { return batchBytes; }
+
+protected:
+
+	virtual ~StaticBatch();
+
+private:
+
+	typedef std::pair< int, int > CellKey;
+
+	// the instance arrays of one side of a unit mesh
+	class Instances;
+
+	// where an instance lives
+	struct Slot {
+		osg::ref_ptr< Instances > instances;
+		unsigned int index;
+	};
+
+	struct Cell {
+		// the objects in this cell, and the merged geometry of the ones that aren't selected
+		std::set< bz2object* > members;
+		osg::ref_ptr< osg::Group > node;
+		bool dirty;
+		unsigned int batched;
+		unsigned int batches;
+		unsigned int bytes;
+
+		// the instances of each object drawn only by instancing
+		std::map< bz2object*, std::vector< Slot > > slots;
+	};
+
+	struct Entry {
+		bz2object* object;
+		CellKey cell;
+
+		// the object's state when its cell was last built
+		unsigned int revision;
+		bool selected;
+		bool built;
+	};
+
+	// the cell an object belongs in now
+	CellKey cellFor( bz2object* obj );
+
+	void markDirty( const CellKey& key );
+	void rebuild( const CellKey& key, Cell& cell );
+
+	// rewrite an edited object's instances in place; false if its cell has to be rebuilt
+	bool updateInstances( Cell& cell, bz2object* obj );
+
+	std::vector< Entry > entries;
+	std::map< bz2object*, unsigned int > entryIndex;
+
+	std::map< CellKey, Cell > cells;
+	std::vector< CellKey > dirtyCells;
+
+	// the batches the last refresh replaced
+	std::vector< osg::ref_ptr< osg::Node > > retired;
+
+	unsigned int batchedCount;
+	unsigned int batchCount;
+	unsigned int batchBytes;
+
+	static bool instancing;
+
+	// whether the cells were built with instancing
+	bool builtInstancing;
+};
+
+#endif /*STATICBATCH_H_*/
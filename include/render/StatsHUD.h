@@ -0,0 +1,94 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef STATSHUD_H_
+#define STATSHUD_H_
+
+#include <osg/Camera>
+#include <osgText/Text>
+
+#include <string>
+
+/**
+ * What one frame cost, and how much of the scene it drew.
+ *
+ * The times come from the viewer's own statistics; the scene counts are what was left
+ * after culling, as the cull traversal counted them, except for the objects, which are
+ * counted from the model (visibleObjects being the ones whose bounds touch the view frustum).
+ */
+struct FrameStats {
+	unsigned int frame;
+
+	// when the frame started (seconds since the viewer started), and how long each traversal took (ms)
+	double time;
+	double event;
+	double update;
+	double cull;
+	double draw;
+
+	// objects in the world, in the view, and selected
+	unsigned int objects;
+	unsigned int visibleObjects;
+	unsigned int selectedObjects;
+
+	// objects merged into the static batch, the batches they're in, and the bytes the batches' arrays take
+	unsigned int batchedObjects;
+	unsigned int batches;
+	unsigned int batchBytes;
+
+	// what was drawn
+	unsigned int drawables;
+	unsigned int primitiveSets;
+	unsigned int triangles;
+	unsigned int vertices;
+
+	// the distinct StateSets drawn, which is how many times the state changes
+	unsigned int stateGraphs;
+
+	// distinct final materials, and the StateSets SceneBuilder holds on to
+	unsigned int materials;
+	unsigned int cachedStateSets;
+
+	FrameStats();
+
+	// the column names, and this frame's row, of a CSV trace (newline included)
+	static std::string getCSVHeader();
+	std::string getCSVRow() const;
+};
+
+/**
+ * The statistics overlay.  Like the RubberBand, it's a camera of its own that draws in
+ * window coordinates over the rest of the scene; it shows the text of the last FrameStats
+ * it was given in the top left corner.
+ */
+class StatsHUD : public osg::Camera {
+
+public:
+
+	StatsHUD();
+
+	// show a frame's statistics
+	void setStats( const FrameStats& stats );
+
+	// the size of the window the text is drawn in
+	void setWindowSize( int width, int height );
+
+protected:
+
+	virtual ~StatsHUD() { }
+
+private:
+
+	osg::ref_ptr< osgText::Text > text;
+};
+
+#endif /*STATSHUD_H_*/
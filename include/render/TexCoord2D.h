@@ -49,7 +49,11 @@ class TexCoord2D {
 	}
 
 	string toString(void) {
-		return string(ftoa(u)) + " " + string(ftoa(v));
+		string ret;
+		appendFloat( ret, u );
+		ret += ' ';
+		appendFloat( ret, v );
+		return ret;
 	}
 };
 
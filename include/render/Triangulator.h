@@ -0,0 +1,151 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef TRIANGULATOR_H_
+#define TRIANGULATOR_H_
+
+#include <osg/Vec2d>
+#include <osg/Vec3d>
+
+#include <vector>
+
+/**
+ * Cuts mesh faces (planar, or nearly planar, simple polygons) into triangles by ear clipping.
+ *
+ * The face is projected onto the axis plane that its Newell normal is closest to being
+ * perpendicular to.  Ears are clipped sharpest first, from a heap.  Only the reflex corners can
+ * keep a corner from being an ear, so only they are checked, through a grid of their own.  That
+ * makes most faces of n corners take about O(n log n), instead of the O(n^2) or worse of
+ * checking every corner for every candidate; long straight runs of corners are the slow case.
+ *
+ * Every triangle keeps the winding of the face (a corner, then the ones before and after it in
+ * the face's order), so it faces the same way BZFlag says the face does.  Faces that aren't
+ * simple polygons still come out as count - 2 triangles, just not necessarily good ones.
+ *
+ * A Triangulator keeps nothing between calls but the memory it works in, so each thread can
+ * triangulate with one of its own.
+ */
+class Triangulator {
+
+public:
+
+	Triangulator() { }
+
+	// Triangulate a face whose corners are vertices[ face[0] ], vertices[ face[1] ], ...
+	// (or vertices[0], vertices[1], ... if face is NULL).  Appends count - 2 triangles to
+	// triangles, as corner numbers (0 to count - 1), three to a triangle.
+	template< class Vertex >
+	void triangulate( const Vertex* vertices, const int* face, unsigned int count, std::vector< unsigned int >& triangles ) {
+		if( count < 3 )
+			return;
+
+		// Newell's method, relative to the first corner to keep the sums small
+		const osg::Vec3d origin( corner( vertices, face, 0 ) );
+		osg::Vec3d normal( 0.0, 0.0, 0.0 );
+		osg::Vec3d v0 = osg::Vec3d( corner( vertices, face, count - 1 ) ) - origin;
+		for( unsigned int i = 0; i < count; i++ ) {
+			osg::Vec3d v1 = osg::Vec3d( corner( vertices, face, i ) ) - origin;
+			normal[0] += ( v0.y() - v1.y() ) * ( v0.z() + v1.z() );
+			normal[1] += ( v0.z() - v1.z() ) * ( v0.x() + v1.x() );
+			normal[2] += ( v0.x() - v1.x() ) * ( v0.y() + v1.y() );
+			v0 = v1;
+		}
+
+		int axis = project( normal );
+		if( axis < 0 ) {
+			fan( count, triangles );
+			return;
+		}
+
+		// drop the normal's largest axis, keeping the face counterclockwise
+		const int u = ( normal[ axis ] > 0.0 ? ( axis + 1 ) % 3 : ( axis + 2 ) % 3 );
+		const int v = ( normal[ axis ] > 0.0 ? ( axis + 2 ) % 3 : ( axis + 1 ) % 3 );
+
+		points.resize( count );
+		for( unsigned int i = 0; i < count; i++ ) {
+			osg::Vec3d p = osg::Vec3d( corner( vertices, face, i ) ) - origin;
+			points[i].set( p[u], p[v] );
+		}
+
+		clip( triangles );
+	}
+
+private:
+
+	// no copying
+	Triangulator( const Triangulator& );
+	Triangulator& operator =( const Triangulator& );
+
+	template< class Vertex >
+	static const Vertex& corner( const Vertex* vertices, const int* face, unsigned int i ) {
+		return vertices[ face != NULL ? face[i] : i ];
+	}
+
+	// the axis to drop, or -1 if the face has no area
+	static int project( const osg::Vec3d& normal );
+
+	// triangles from the first corner, for faces with no normal
+	static void fan( unsigned int count, std::vector< unsigned int >& triangles );
+
+	// clip the ears off the projected face
+	void clip( std::vector< unsigned int >& triangles );
+
+	// twice the signed area of a triangle of corners
+	double area( unsigned int a, unsigned int b, unsigned int c ) const;
+
+	// is a convex corner an ear (no reflex corner inside it)?
+	bool isEar( unsigned int corner );
+
+	// queue a corner if it's an ear
+	void consider( unsigned int corner );
+
+	// put the reflex corners in the grid
+	void buildGrid();
+
+	// an ear, keyed by how sharp it is
+	struct Candidate {
+		double sharpness;
+		unsigned int corner;
+
+		// the corner's stamp when it was queued; it's stale if the corner changed since
+		unsigned int stamp;
+
+		bool operator <( const Candidate& other ) const {
+			return sharpness < other.sharpness || ( sharpness == other.sharpness && corner > other.corner );
+		}
+	};
+
+	// the projected face
+	std::vector< osg::Vec2d > points;
+
+	// the corners that are left, as a ring
+	std::vector< unsigned int > next;
+	std::vector< unsigned int > prev;
+
+	std::vector< unsigned char > reflex;
+	std::vector< unsigned char > removed;
+	std::vector< unsigned int > stamps;
+
+	std::vector< Candidate > heap;
+
+	// the reflex corners by cell:  the ones in cell i are cellItems[ cellStart[i] ] up to cellItems[ cellEnd[i] ]
+	std::vector< unsigned int > cellStart;
+	std::vector< unsigned int > cellEnd;
+	std::vector< unsigned int > cellItems;
+	osg::Vec2d gridMin;
+	osg::Vec2d gridMax;
+	osg::Vec2d cellScale;
+	int columns;
+	int rows;
+};
+
+#endif /*TRIANGULATOR_H_*/
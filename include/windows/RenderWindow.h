@@ -42,16 +42,32 @@ public:
 	virtual int handle(int);
 	void resize(int x, int y, int w, int h);
 
+	// with a threaded context, OSG draws (and swaps) from its own thread, so FLTK mustn't
+	// make its context current or swap buffers; this just calls draw()
+	virtual void flush();
+
 	// get the embedded view
 	osgViewer::GraphicsWindowEmbedded* getOSGGraphicsWindow() { return _gw.get(); }
 
 	// set the embedded view
 	void setOSGGraphicsWindow( osgViewer::GraphicsWindowEmbedded* gw ) { _gw = gw; }
 
+	// draw through a graphics window of OSG's own, which renders into this window from
+	// OSG's draw thread, instead of through FLTK's context on the FLTK thread.  Returns
+	// false if that can't be done here (the window has to be shown first).
+	bool setThreadedContext( bool threaded );
+	bool isThreadedContext() { return _threadedGW.valid(); }
+
+	// the graphics window the camera should draw to
+	osgViewer::GraphicsWindow* getActiveGraphicsWindow();
+
 protected:
 
 	// reference to an embedded OSG render window
 	osg::ref_ptr<osgViewer::GraphicsWindowEmbedded> _gw;
+
+	// OSG's own window onto this one, while drawing from OSG's threads
+	osg::ref_ptr<osgViewer::GraphicsWindow> _threadedGW;
 };
 
 #endif /*RENDERWINDOW_H_*/
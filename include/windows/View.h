@@ -42,7 +42,18 @@
 
 #include "render/Selection.h"
 
+#include "render/StaticBatch.h"
+
+#include "render/ObjectBVH.h"
+
+#include "render/RubberBand.h"
+
+#include "render/StatsHUD.h"
+
+#include "model/BZWWriter.h"
+
 #include "model/ObserverMessage.h"
+#include "model/ObserverChangeSet.h"
 
 #include "model/Model.h"
 
@@ -69,15 +80,41 @@ class View : public osgViewer::Viewer, public RenderWindow, public Observer
         // FLTK event handler
         virtual int handle(int);
 
-        // Observer update() method
+        // Observer update() method.  Picking is updated straight away; the scene is changed
+        // in the next update traversal (see applyChanges()).
         void update( Observable* obs, void* data );
 
+        // apply the model's changes to the scene (called from the update traversal, so that
+        // the draw thread never sees a half-made change)
+        void applyChanges();
+
+        // run cull and draw on threads of their own (DrawThreadPerContext or
+        // CullDrawThreadPerContext), or everything on the FLTK thread (SingleThreaded).
+        // Returns false if this window can't be drawn from another thread.
+        bool setThreading( osgViewer::ViewerBase::ThreadingModel model );
+
+        // show or hide the per-frame statistics over the scene
+        void setStatsHUD( bool show );
+        bool isStatsHUDShown() { return statsShown; }
+
+        // write each frame's statistics to a CSV file, until stopFrameTrace().
+        // Returns false if the file can't be created, or (when stopping) written.
+        bool startFrameTrace( const char* filename );
+        bool stopFrameTrace();
+        bool isTracingFrames() { return frameTrace != NULL; }
+
+        // the statistics of the last frame that's finished drawing; false if there isn't one
+        bool getFrameStats( FrameStats& stats );
+
         // set an object as selected
         void setSelected( bz2object* object );
 
         // set an object as unselected
         void setUnselected( bz2object* object );
 
+        // an object was moved without the Model hearing of it (i.e. while dragging the selection)
+        void updateObject( bz2object* object ) { pickTree.updateObject( object ); }
+
         // see if a renderable is contained
        	bool contains( Renderable* node ) { return root->containsNode( node ); }
 
@@ -109,6 +146,22 @@ class View : public osgViewer::Viewer, public RenderWindow, public Observer
         // get the selection reference
         Selection* getSelectionNode() { return selection; }
 
+        // get the merged geometry of the unselected objects
+        StaticBatch* getStaticBatch() { return batch.get(); }
+
+        // get the bounding volume hierarchy objects are picked from
+        ObjectBVH* getPickTree() { return &pickTree; }
+
+        // the nearest object under a point in the window, or NULL
+        bz2object* pickObject( float x, float y );
+
+        // show the outline of a box or lasso being dragged out (in window coordinates); empty hides it
+        void setSelectionOutline( const std::vector< osg::Vec2 >& outline );
+
+        // select the objects that lie entirely inside an outline in the window,
+        // adding them to the selection or replacing it
+        void selectRegion( const std::vector< osg::Vec2 >& outline, bool add );
+
 		// get the selection handler
 		selectHandler* getSelectHandler() { return selHandler; }
 
@@ -128,6 +181,12 @@ class View : public osgViewer::Viewer, public RenderWindow, public Observer
 		void setScaleSnapSize( float value ) { scaleSnapSize = value; }
 		void setRotateSnapSize( float value ) { rotateSnapSize = value; }
 
+		// swap in the textures that have finished loading, and redraw if there were any
+		static void TextureCallback( void* data ) {
+			View* view = (View*)(data);
+			view->TextureCallback_real();
+		}
+
     protected:
 
     	// draw method
@@ -145,6 +204,18 @@ class View : public osgViewer::Viewer, public RenderWindow, public Observer
 		// ground node
 		Renderable* ground;
 
+		// draws the unselected objects
+		osg::ref_ptr< StaticBatch > batch;
+
+		// the objects' bounds, for picking
+		ObjectBVH pickTree;
+
+		// the outline of the region being selected
+		osg::ref_ptr< RubberBand > rubberBand;
+
+		// the per-frame statistics overlay
+		osg::ref_ptr< StatsHUD > statsHUD;
+
 		// modifier key map.
 		// maps FLTK key values to bools
 		map< int, bool > modifiers;
@@ -163,6 +234,50 @@ class View : public osgViewer::Viewer, public RenderWindow, public Observer
 
 	private:
 
+		// a message from the model, waiting for the update traversal
+		struct PendingChange {
+			Observable* observable;
+
+			// false for a plain refresh
+			bool hasMessage;
+			ObserverMessage::ObserverMessageType type;
+			void* data;
+
+			// a copy of a CHANGE_SET's changes
+			ObserverChangeSet changes;
+
+			// the objects it names, kept alive until it's applied
+			std::vector< osg::ref_ptr< osg::Node > > keep;
+		};
+
+		std::vector< PendingChange > pendingChanges;
+
+		// what the last update took out of the scene; the draw thread may still be drawing
+		// it, so it's let go at the next update
+		std::vector< osg::ref_ptr< osg::Node > > retired;
+
+		// apply a change to the picking tree, or to the scene
+		void updatePickTree( ObserverMessage::ObserverMessageType type, void* data );
+		void applyChange( PendingChange& change );
+
+		// selected objects get edited, so the draw thread has to be done with them before
+		// frame() returns; the rest can be drawn while the next frame is culled
+		void setDrawVariance( bz2object* obj );
+
+		// turn the viewer's statistics on while the HUD or a trace needs them
+		void collectStats();
+
+		// show and trace the statistics of the frame that just finished
+		void recordFrameStats();
+
+		bool statsShown;
+
+		// the CSV trace being written, or NULL
+		BZWWriter* frameTrace;
+
+		// the last frame written to it
+		unsigned int tracedFrame;
+
 		// the collection of evnet handlers
 		EventHandlerCollection* eventHandlers;
 
@@ -175,6 +290,8 @@ class View : public osgViewer::Viewer, public RenderWindow, public Observer
 		// build the mouse button map
 		void buildMouseButtonMap();
 
+		void TextureCallback_real();
+
 		// update the selection's axes
 		void updateSelection( float distance );
 
@@ -24,14 +24,23 @@ class View;
 
 #include <osg/NodeVisitor>
 #include <osg/Matrix>
+#include <osg/Vec2>
 
 #include <string>
 #include <map>
+#include <vector>
 
 class selectHandler : public BZEventHandler {
 
 public:
 
+	// what a left-drag over empty space does
+	enum RegionMode {
+		REGION_NONE,		// nothing; clicks pick single objects
+		REGION_BOX,			// drag out a rectangle
+		REGION_LASSO		// draw a freehand outline
+	};
+
 	// constructor
 	selectHandler( View* view, osgGA::MatrixManipulator* baseManipulator );
 	~selectHandler() {}
@@ -69,6 +78,10 @@ public:
 	// sets the lastSelected variable to NULL (should be called if an bz2object is deleted)
 	void clearLastSelected();
 
+	// region selection mode getter/setter
+	RegionMode getRegionMode() { return regionMode; }
+	void setRegionMode( RegionMode mode ) { regionMode = mode; }
+
 private:
     // the last Renderable to be selected
     Renderable* lastSelected;
@@ -92,6 +105,21 @@ private:
 	osg::Vec3 translateSnap;
 	osg::Vec3 scaleSnap;
 	float rotateSnap;
+
+	// start, extend, and finish dragging out a region to select
+	void beginRegion( View* viewer, const osgGA::GUIEventAdapter& ea );
+	void dragRegion( View* viewer, const osgGA::GUIEventAdapter& ea );
+	void endRegion( View* viewer, const osgGA::GUIEventAdapter& ea );
+
+	// variables for region selection
+	RegionMode regionMode;
+	bool regionActive;
+	bool regionAdd;
+	std::vector< osg::Vec2 > region;
+	osg::Vec2 regionStart;
+
+	// the camera manipulator's ignore mask from before the drag
+	unsigned int manipulatorMask;
 };
 
 #endif /*SELECTHANDLER_H_*/
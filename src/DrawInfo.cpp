@@ -248,19 +248,23 @@ string DrawInfo::toString(void) {
 
 	if(vertices.size() > 0) {
 		for(vector<Point3D>::iterator i = vertices.begin(); i != vertices.end(); i++) {
-			vertexString += "    vertex " + i->toString();
+			vertexString += "    vertex ";
+			i->appendTo( vertexString );
 		}		
 	}
 
 	if(normals.size() > 0) {
 		for(vector<Point3D>::iterator i = normals.begin(); i != normals.end(); i++) {
-			normalString += "    normal " + i->toString();
+			normalString += "    normal ";
+			i->appendTo( normalString );
 		}		
 	}
 
 	if(texcoords.size() > 0) {
 		for(vector<Point2D>::iterator i = texcoords.begin(); i != texcoords.end(); i++) {
-			texcoordString += "    texcoord " + i->toString() + "\n";	
+			texcoordString += "    texcoord ";
+			i->appendTo( texcoordString );
+			texcoordString += "\n";
 		}
 	}
 
@@ -276,18 +280,24 @@ string DrawInfo::toString(void) {
 		}
 	}
 	
-	string extentsString = "    extents " + 
-							ftoa(minExtents.x()) + " " + 
-							ftoa(minExtents.y()) + " " + 
-							ftoa(minExtents.z()) + " " + 
-							ftoa(maxExtents.x()) + " " + 
-							ftoa(maxExtents.y()) + " " + 
-							ftoa(maxExtents.z()) + "\n";
-	string sphereString = "    sphere "+ 
-							ftoa(spherePosition.x()) + " " + 
-							ftoa(spherePosition.y()) + " " + 
-							ftoa(spherePosition.z()) + " " + 
-							ftoa(sphereRadius) + "\n";
+	string extentsString = "    extents ";
+	appendFloat( extentsString, minExtents.x() );
+	extentsString += ' ';
+	appendFloat( extentsString, minExtents.y() );
+	extentsString += ' ';
+	appendFloat( extentsString, minExtents.z() );
+	extentsString += ' ';
+	maxExtents.appendTo( extentsString );
+
+	string sphereString = "    sphere ";
+	appendFloat( sphereString, spherePosition.x() );
+	sphereString += ' ';
+	appendFloat( sphereString, spherePosition.y() );
+	sphereString += ' ';
+	appendFloat( sphereString, spherePosition.z() );
+	sphereString += ' ';
+	appendFloat( sphereString, sphereRadius );
+	sphereString += '\n';
 
 	return string("drawinfo\n") +
 		(dlist == true ? "    dlist\n" : "") +
@@ -409,7 +419,8 @@ string DrawInfo::stringify(vector<float>& values) {
 
 	if(values.size() > 0) {
 		for(vector<float>::iterator i = values.begin(); i != values.end(); i++) {
-			ret += string(ftoa(*i)) + " ";	
+			appendFloat( ret, *i );
+			ret += ' ';
 		}	
 	}
 
@@ -12,209 +12,306 @@
 
 #include "MeshFace.h"
 
-MeshFace::MeshFace() :
-DataEntry("face", "<vertices><normals><texcoords><phydrv><matref><drivethrough><shootthrough><passable>") {
-	vertices = vector<int>();
-	normals = vector<int>();
-	texcoords = vector<int>();
-	physicsDriver = NULL;
-	driveThrough = shootThrough = smoothbounce = false;
-	mat = NULL;
+// append a face's index list
+static void appendIndices( string& out, const char* key, const int* values, unsigned int count ) {
+	out += "    ";
+	out += key;
+	out += ' ';
+	for ( unsigned int i = 0; i < count; i++ ) {
+		appendInt( out, values[i] );
+		out += ' ';
+	}
+	out += '\n';
 }
 
-// constructor with data
-MeshFace::MeshFace(material* mat, physics* phydrv, bool noclusters, bool smoothbounce, bool drivethrough, bool shootthrough) : DataEntry("face", "<vertices><normals><texcoords><phydrv><matref><drivethrough><shootthrough><passable>") {
-	vertices = vector<int>();
-	normals = vector<int>();
-	texcoords = vector<int>();
-	physicsDriver = phydrv;
-	this->driveThrough = drivethrough;
-	this->shootThrough = shootthrough;
-	this->smoothbounce = smoothbounce;
-	this->mat = mat;
+void MeshFace::appendTo( string& out ) const {
+	// FIXME: some data is read in but not written out
+	unsigned int count = getCount();
+	material* mat = getMaterial();
+	physics* physicsDriver = getPhysicsDriver();
+	unsigned int flags = getFlags();
+
+	out += "face\n";
+	appendIndices( out, "vertices", getVertices(), count );
+	if ( flags & HAS_TEXCOORDS )
+		appendIndices( out, "texcoords", getTexcoords(), count );
+	if ( flags & HAS_NORMALS )
+		appendIndices( out, "normals", getNormals(), count );
+	if ( mat != NULL )
+		out += "    matref " + mat->getName() + "\n";
+	if ( physicsDriver != NULL )
+		out += "    phydrv " + physicsDriver->getName() + "\n";
+	if ( flags & SHOOT_THROUGH )
+		out += "    shootthrough\n";
+	if ( flags & DRIVE_THROUGH )
+		out += "    drivethrough\n";
+	out += "  endface\n";
+}
+
+// toString
+string MeshFace::toString(void) const {
+	string ret;
+	appendTo( ret );
+	return ret;
+}
+
+MeshData::MeshData() {
+	faceStart.push_back( 0 );
+	parsing = false;
+	pendingMaterial = NULL;
+	pendingPhysics = NULL;
+	pendingFlags = 0;
+	pendingHasSpecial = false;
+}
+
+unsigned int MeshData::propertiesFor( material* mat, physics* phydrv, unsigned int flags ) {
+	// faces in a row usually share their properties
+	if ( !faceProperties.empty() ) {
+		const Properties& last = properties[ faceProperties.back() ];
+		if ( last.mat == mat && last.phydrv == phydrv && last.flags == flags )
+			return faceProperties.back();
+	}
+
+	for ( unsigned int i = 0; i < properties.size(); i++ ) {
+		if ( properties[i].mat == mat && properties[i].phydrv == phydrv && properties[i].flags == flags )
+			return i;
+	}
 
-	//this->update(data);
+	Properties p;
+	p.mat = mat;
+	p.phydrv = phydrv;
+	p.flags = flags;
+	properties.push_back( p );
+	return properties.size() - 1;
 }
 
-MeshFace::~MeshFace() {
+void MeshData::addFace( const int* vertexIndices, const int* normalIndices, const int* texcoordIndices, unsigned int count,
+						material* mat, physics* phydrv, unsigned int flags, const MeshFace::SpecialData* special ) {
+	flags &= ~( MeshFace::HAS_NORMALS | MeshFace::HAS_TEXCOORDS );
+	if ( normalIndices != NULL )
+		flags |= MeshFace::HAS_NORMALS;
+	if ( texcoordIndices != NULL )
+		flags |= MeshFace::HAS_TEXCOORDS;
+
+	indices.insert( indices.end(), vertexIndices, vertexIndices + count );
+	if ( normalIndices != NULL )
+		indices.insert( indices.end(), normalIndices, normalIndices + count );
+	if ( texcoordIndices != NULL )
+		indices.insert( indices.end(), texcoordIndices, texcoordIndices + count );
 
+	if ( special != NULL )
+		specialData[ faceProperties.size() ] = *special;
+
+	faceProperties.push_back( propertiesFor( mat, phydrv, flags ) );
+	faceStart.push_back( indices.size() );
 }
 
-// getter
-string MeshFace::get(void) { return this->toString(); }
+void MeshData::beginFace( material* mat, physics* phydrv, bool noclusters, bool smoothbounce, bool drivethrough, bool shootthrough ) {
+	parsing = true;
+	pendingVertices.clear();
+	pendingNormals.clear();
+	pendingTexcoords.clear();
+	pendingMaterial = mat;
+	pendingPhysics = phydrv;
+	pendingFlags = ( noclusters ? MeshFace::NO_CLUSTERS : 0 ) |
+				   ( smoothbounce ? MeshFace::SMOOTH_BOUNCE : 0 ) |
+				   ( drivethrough ? MeshFace::DRIVE_THROUGH : 0 ) |
+				   ( shootthrough ? MeshFace::SHOOT_THROUGH : 0 );
+	pendingSpecial = MeshFace::SpecialData();
+	pendingHasSpecial = false;
+}
 
-bool MeshFace::parse( string& line ) {
+bool MeshData::parseFace( string& line, DataEntry* owner ) {
 	string key = BZWParser::key( line.c_str() );
 	string value = BZWParser::value( key.c_str(), line.c_str() );
 	
 	// check if we reached the end of the section
-	if ( key == "endface" )
+	if ( key == "endface" ) {
+		parsing = false;
+
+		// check that the face has enough vertices, and as many normals and texcoords
+		if ( pendingVertices.size() < 3 )
+			throw BZWReadError( owner, "Faces need at least 3 vertices." );
+		if ( pendingNormals.size() > 0 && pendingNormals.size() != pendingVertices.size() )
+			throw BZWReadError( owner, "Number of normals doesn't match number of vertices." );
+		if ( pendingTexcoords.size() > 0 && pendingTexcoords.size() != pendingVertices.size() )
+			throw BZWReadError( owner, "Number of textcoords doesn't match number of vertices." );
+
+		addFace( &pendingVertices[0],
+				 pendingNormals.size() > 0 ? &pendingNormals[0] : NULL,
+				 pendingTexcoords.size() > 0 ? &pendingTexcoords[0] : NULL,
+				 pendingVertices.size(), pendingMaterial, pendingPhysics, pendingFlags,
+				 pendingHasSpecial ? &pendingSpecial : NULL );
 		return false;
+	}
+
+	// base and link data is kept apart, for the few faces that have it
+	if ( key == "baseteam" || key.compare( 0, 4, "link" ) == 0 )
+		pendingHasSpecial = true;
 
 	if ( key == "vertices" ) {
-		vertices = BZWParser::getIntList( value.c_str() );
-		if ( vertices.size() < 3 ) {
-			throw BZWReadError( this, "Faces need at least 3 vertices." );
+		pendingVertices = BZWParser::getIntList( value.c_str() );
+		if ( pendingVertices.size() < 3 ) {
+			throw BZWReadError( owner, "Faces need at least 3 vertices." );
 		}
 	}
 	else if ( key == "normals" ) {
-		normals = BZWParser::getIntList( value.c_str() );
-		if ( normals.size() < 3 ) {
-			throw BZWReadError( this, "Faces need at least 3 normals." );
+		pendingNormals = BZWParser::getIntList( value.c_str() );
+		if ( pendingNormals.size() < 3 ) {
+			throw BZWReadError( owner, "Faces need at least 3 normals." );
 		}
 	}
 	else if ( key == "texcoords" ) {
-		texcoords = BZWParser::getIntList( value.c_str() );
-		if ( texcoords.size() < 3 ) {
-			throw BZWReadError( this, "Faces need at least 3 texcoords." );
+		pendingTexcoords = BZWParser::getIntList( value.c_str() );
+		if ( pendingTexcoords.size() < 3 ) {
+			throw BZWReadError( owner, "Faces need at least 3 texcoords." );
 		}
 	}
 	else if ( key == "phydrv" ) {
 		string drvname = BZWParser::value( "phydrv", line.c_str() );
 		physics* phys = (physics*)Model::command( MODEL_GET, "phydrv", drvname.c_str() );
 		if (phys != NULL)
-			physicsDriver = phys;
+			pendingPhysics = phys;
 		else
-			throw BZWReadError( this, string( "Couldn't find physics driver, " ) + drvname );
+			throw BZWReadError( owner, string( "Couldn't find physics driver, " ) + drvname );
 	}
 	else if ( key == "noclusters" ) {
-		noClusters = true;
+		pendingFlags |= MeshFace::NO_CLUSTERS;
 	}
 	else if ( key == "drivethrough" ) {
-		driveThrough = true;
+		pendingFlags |= MeshFace::DRIVE_THROUGH;
 	}
 	else if ( key == "shootthrough" ) {
-		shootThrough = true;
+		pendingFlags |= MeshFace::SHOOT_THROUGH;
 	}
 	else if ( key == "passable" ) {
-		driveThrough = true;
-		shootThrough = true;
+		pendingFlags |= MeshFace::DRIVE_THROUGH | MeshFace::SHOOT_THROUGH;
 	}
 	else if ( key == "ricochet" ) {
-		ricochet = true;
+		pendingFlags |= MeshFace::RICOCHET;
 	}
 	else if ( key == "baseteam" ) {
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing baseteam parameter." );
+			throw BZWReadError( owner, "Missing baseteam parameter." );
 		}
-		specialData.baseTeam = atoi( value.c_str() );
+		pendingSpecial.baseTeam = atoi( value.c_str() );
 	}
 	else if ( key == "linkname" ) {
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkname parameter." );
+			throw BZWReadError( owner, "Missing linkname parameter." );
 		}
-		specialData.linkName = value;
+		pendingSpecial.linkName = value;
 	}
 	else if ( key == "linksrcrebound") {
-		specialData.LinkSrcRebound = true;
+		pendingSpecial.LinkSrcRebound = true;
 	}
 	else if ( key == "linksrcnoglow" ) {
-		specialData.LinkSrcNoGlow = true;
+		pendingSpecial.LinkSrcNoGlow = true;
 	}
 	else if ( key == "linksrcnoradar" ) {
-		specialData.LinkSrcNoRadar = true;
+		pendingSpecial.LinkSrcNoRadar = true;
 	}
 	else if ( key == "linksrcnosound" ) {
-		specialData.LinkSrcNoSound = true;
+		pendingSpecial.LinkSrcNoSound = true;
 	}
 	else if ( key == "linksrcnoeffect" ) {
-		specialData.LinkSrcNoEffect = true;
+		pendingSpecial.LinkSrcNoEffect = true;
 	}
 	else if ( key == "linksrccenter" ) {
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkSrcCenter index." );
+			throw BZWReadError( owner, "Missing linkSrcCenter index." );
 		}
-		specialData.linkSrcGeo.centerIndex = atoi( value.c_str() );
+		pendingSpecial.linkSrcGeo.centerIndex = atoi( value.c_str() );
 	}
 	else if ( key == "linksrcsdir" ) {
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkSrcSdir index." );
+			throw BZWReadError( owner, "Missing linkSrcSdir index." );
 		}
-		specialData.linkSrcGeo.sDirIndex = atoi( value.c_str() );
+		pendingSpecial.linkSrcGeo.sDirIndex = atoi( value.c_str() );
 	}
 	else if ( key == "linksrctdir" ) {
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkSrcTdir index" );
+			throw BZWReadError( owner, "Missing linkSrcTdir index" );
 		}
-		specialData.linkSrcGeo.tDirIndex = atoi( value.c_str() );
+		pendingSpecial.linkSrcGeo.tDirIndex = atoi( value.c_str() );
 	}
 	else if ( key == "linksrcpdir" ) {
 		string value = BZWParser::value( "linksrcpdir", line.c_str() );
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkSrcPdir index" );
+			throw BZWReadError( owner, "Missing linkSrcPdir index" );
 		}
-		specialData.linkSrcGeo.pDirIndex = atoi( value.c_str() );
+		pendingSpecial.linkSrcGeo.pDirIndex = atoi( value.c_str() );
 	}
 	else if ( key == "linksrcsscale" ) {
 		string value = BZWParser::value( "linksrcsscale", line.c_str() );
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkSrcSscale parameter" );
+			throw BZWReadError( owner, "Missing linkSrcSscale parameter" );
 		}
-		specialData.linkSrcGeo.sScale = atof( value.c_str() );
-		specialData.linkSrcGeo.LinkAutoSscale = false;
+		pendingSpecial.linkSrcGeo.sScale = atof( value.c_str() );
+		pendingSpecial.linkSrcGeo.LinkAutoSscale = false;
 	}
 	else if ( key == "linksrctscale" ) {
 		string value = BZWParser::value( "linksrctscale", line.c_str() );
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkSrcTscale parameter" );
+			throw BZWReadError( owner, "Missing linkSrcTscale parameter" );
 		}
-		specialData.linkSrcGeo.tScale = atof( value.c_str() );
-		specialData.linkSrcGeo.LinkAutoTscale = false;
+		pendingSpecial.linkSrcGeo.tScale = atof( value.c_str() );
+		pendingSpecial.linkSrcGeo.LinkAutoTscale = false;
 	}
 	else if ( key == "linksrcpscale" ) {
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkSrcPscale parameter" );
+			throw BZWReadError( owner, "Missing linkSrcPscale parameter" );
 		}
-		specialData.linkSrcGeo.pScale = atof( value.c_str() );
-		specialData.linkSrcGeo.LinkAutoPscale = false;
+		pendingSpecial.linkSrcGeo.pScale = atof( value.c_str() );
+		pendingSpecial.linkSrcGeo.LinkAutoPscale = false;
 	}
 	//
 	//  Link destination parameters
 	//
 	else if ( key == "linkdstcenter" ) {
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkDstCenter index" );
+			throw BZWReadError( owner, "Missing linkDstCenter index" );
 		}
-		specialData.linkDstGeo.centerIndex = atoi( value.c_str() );
+		pendingSpecial.linkDstGeo.centerIndex = atoi( value.c_str() );
 	}
 	else if ( key == "linkdstsdir" ) {
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkDstSdir index" );
+			throw BZWReadError( owner, "Missing linkDstSdir index" );
 		}
-		specialData.linkDstGeo.sDirIndex = atoi( value.c_str() );
+		pendingSpecial.linkDstGeo.sDirIndex = atoi( value.c_str() );
 	}
 	else if ( key == "linkdsttdir" ) {
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkDstTdir index" );
+			throw BZWReadError( owner, "Missing linkDstTdir index" );
 		}
-		specialData.linkDstGeo.tDirIndex = atoi( value.c_str() );
+		pendingSpecial.linkDstGeo.tDirIndex = atoi( value.c_str() );
 	}
 	else if ( key == "linkdstpdir" ) {
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkDstPdir index" );
+			throw BZWReadError( owner, "Missing linkDstPdir index" );
 		}
-		specialData.linkDstGeo.pDirIndex = atoi( value.c_str() );
+		pendingSpecial.linkDstGeo.pDirIndex = atoi( value.c_str() );
 	}
 	else if ( key == "linkdstsscale" ) {
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkDstSscale parameter" );
+			throw BZWReadError( owner, "Missing linkDstSscale parameter" );
 		}
-		specialData.linkDstGeo.sScale = atof( value.c_str() );
-		specialData.linkDstGeo.LinkAutoSscale = false;
+		pendingSpecial.linkDstGeo.sScale = atof( value.c_str() );
+		pendingSpecial.linkDstGeo.LinkAutoSscale = false;
 	}
 	else if ( key == "linkdsttscale" ) {
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkDstTscale parameter" );
+			throw BZWReadError( owner, "Missing linkDstTscale parameter" );
 		}
-		specialData.linkDstGeo.tScale = atof( value.c_str() );
-		specialData.linkDstGeo.LinkAutoTscale = false;
+		pendingSpecial.linkDstGeo.tScale = atof( value.c_str() );
+		pendingSpecial.linkDstGeo.LinkAutoTscale = false;
 	}
 	else if ( key == "linkdstpscale" ) {
 		if ( BZWParser::allWhitespace( value.c_str() ) ) {
-			throw BZWReadError( this, "Missing linkDstPscale parameter" );
+			throw BZWReadError( owner, "Missing linkDstPscale parameter" );
 		}
-		specialData.linkDstGeo.pScale = atof( value.c_str() );
-		specialData.linkDstGeo.LinkAutoPscale = false;
+		pendingSpecial.linkDstGeo.pScale = atof( value.c_str() );
+		pendingSpecial.linkDstGeo.LinkAutoPscale = false;
 	}
 	//
 	//  Link failure messages
@@ -231,46 +328,37 @@ bool MeshFace::parse( string& line ) {
 	else if ( key == "matref" ) {
 		material* mat = (material*)Model::command( MODEL_GET, "material", value );
 		if (mat != NULL)
-			this->mat = mat;
+			pendingMaterial = mat;
 		else
-			throw BZWReadError( this, string( "Couldn't find material, " ) + value );
+			throw BZWReadError( owner, string( "Couldn't find material, " ) + value );
 	}
 	else {
-		throw BZWReadError( this, string( "Unknown key, " ) + key );
+		throw BZWReadError( owner, string( "Unknown key, " ) + key );
 	}
 
 	return true;
 }
 
-// toString
-string MeshFace::toString(void) {
-	// FIXME: some data is read in but not written out
-	string ret("face\n");
-	ret += (vertices.size() > 0 ? "    vertices " + stringify(vertices) + "\n" : "");
-	ret += (texcoords.size() > 0 ? "    texcoords " + stringify(texcoords) + "\n" : "");
-	ret += (normals.size() > 0 ? "    normals " + stringify(normals) + "\n" : "");
-	ret += (mat != NULL ? "    matref " + mat->getName() + "\n" : "");
-	ret += (physicsDriver != NULL ? "    phydrv " + physicsDriver->getName() + "\n" : "");
-	ret += (shootThrough == true ? "    shootthrough\n" : "");
-	ret += (driveThrough == true ? "    drivethrough\n" : "");
-	ret += "  endface\n";
-
-	return ret;
+void MeshData::clear() {
+	vertices.clear();
+	normals.clear();
+	texcoords.clear();
+	faceStart.assign( 1, 0 );
+	indices.clear();
+	faceProperties.clear();
+	properties.clear();
+	specialData.clear();
+	parsing = false;
 }
 
-// render
-int MeshFace::render(void) {
-	return 0;
-}
-
-string MeshFace::stringify(vector<int>& values) {
-	string ret = string("");
-
-	if(values.size() > 0) {
-		for(vector<int>::iterator i = values.begin(); i != values.end(); i++) {
-			ret += string(itoa(*i)) + " ";
-		}
-	}
-
-	return ret;
+size_t MeshData::getMemoryUsage() const {
+	return sizeof( *this ) +
+		   vertices.capacity() * sizeof( osg::Vec3 ) +
+		   normals.capacity() * sizeof( osg::Vec3 ) +
+		   texcoords.capacity() * sizeof( osg::Vec2 ) +
+		   faceStart.capacity() * sizeof( unsigned int ) +
+		   indices.capacity() * sizeof( int ) +
+		   faceProperties.capacity() * sizeof( unsigned int ) +
+		   properties.capacity() * sizeof( Properties ) +
+		   specialData.size() * ( sizeof( MeshFace::SpecialData ) + 4 * sizeof( void* ) );
 }
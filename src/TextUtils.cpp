@@ -320,6 +320,17 @@ namespace TextUtils
       retstr[len-1] = '~';
     return retstr;
   }
+
+  // 64-bit FNV-1a
+  unsigned long long hash(const char* begin, const char* end)
+  {
+    unsigned long long h = 14695981039346656037ULL;
+    for (const unsigned char* c = (const unsigned char*)begin; c != (const unsigned char*)end; c++) {
+      h ^= *c;
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
     
 }
 
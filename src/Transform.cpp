@@ -79,23 +79,27 @@ int BZTransform::parse(string& newData) {
 string BZTransform::toString(void) {
 	string ret;
 	for(vector<TransformData>::iterator i = data.begin(); i != data.end(); i++) {
+		// spin carries an angle and an axis, the rest only three values
+		int count = 3;
 		if ( (*i).type == ShiftTransform )
-			ret += "  shift " + string( ftoa( (*i).data.x() ) ) + " " + 
-			                    string( ftoa( (*i).data.y() ) ) + " " + 
-								string( ftoa( (*i).data.z() ) ) + "\n";
+			ret += "  shift ";
 		else if ( (*i).type == ScaleTransform )
-			ret += "  scale " + string( ftoa( (*i).data.x() ) ) + " " + 
-			                    string( ftoa( (*i).data.y() ) ) + " " + 
-								string( ftoa( (*i).data.z() ) ) + "\n";
+			ret += "  scale ";
 		else if ( (*i).type == ShearTransform )
-			ret += "  shear " + string( ftoa( (*i).data.x() ) ) + " " + 
-			                    string( ftoa( (*i).data.y() ) ) + " " + 
-								string( ftoa( (*i).data.z() ) ) + "\n";
-		else if ( (*i).type == SpinTransform )
-			ret += "  spin " +  string( ftoa( (*i).data.x() ) ) + " " + 
-			                    string( ftoa( (*i).data.y() ) ) + " " + 
-								string( ftoa( (*i).data.z() ) ) + " " + 
-								string( ftoa( (*i).data.w() ) ) + "\n";
+			ret += "  shear ";
+		else if ( (*i).type == SpinTransform ) {
+			ret += "  spin ";
+			count = 4;
+		}
+		else
+			continue;
+
+		for ( int j = 0; j < count; j++ ) {
+			if ( j > 0 )
+				ret += ' ';
+			appendFloat( ret, (*i).data[j] );
+		}
+		ret += '\n';
 	}
 
 	return ret;
@@ -0,0 +1,237 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "WorkerPool.h"
+
+#include <OpenThreads/ScopedLock>
+
+using namespace std;
+
+// a thread that pulls tasks off of its pool until told to stop
+class WorkerPool::Worker : public OpenThreads::Thread {
+
+public:
+	Worker( WorkerPool* _pool ) : OpenThreads::Thread() { pool = _pool; }
+
+	virtual void run() {
+		while( true ) {
+			WorkerTask* task = pool->next();
+			if( task == NULL )
+				break;
+
+			task->run();
+			pool->done();
+		}
+	}
+
+private:
+	WorkerPool* pool;
+};
+
+// a WorkerRange being run.  Its chunks go to whichever thread asks first, the one that called
+// runRange() included, and the last thread to let go of it deletes it.
+class RangeJob {
+
+public:
+	RangeJob( WorkerRange* _range, unsigned int _count, unsigned int _grain, unsigned int _users ) {
+		range = _range;
+		count = _count;
+		grain = _grain;
+		chunks = ( count + grain - 1 ) / grain;
+		nextIndex = 0;
+		finished = 0;
+		users = _users;
+	}
+
+	// run chunks until they've all been handed out
+	void work() {
+		unsigned int begin, end;
+		while( claim( begin, end ) ) {
+			range->run( begin, end );
+
+			OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+			finished++;
+			if( finished == chunks )
+				allFinished.broadcast();
+		}
+	}
+
+	// block until every chunk has been run
+	void wait() {
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+		while( finished < chunks )
+			allFinished.wait( &mutex );
+	}
+
+	void release() {
+		bool last;
+		{
+			OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+			last = ( --users == 0 );
+		}
+		if( last )
+			delete this;
+	}
+
+private:
+
+	bool claim( unsigned int& begin, unsigned int& end ) {
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+		if( nextIndex >= count )
+			return false;
+
+		begin = nextIndex;
+		end = ( count - begin > grain ? begin + grain : count );
+		nextIndex = end;
+		return true;
+	}
+
+	WorkerRange* range;
+	unsigned int count, grain, chunks;
+
+	// the first index not handed out yet, and the number of chunks run
+	unsigned int nextIndex;
+	unsigned int finished;
+
+	// the threads holding on to the job
+	unsigned int users;
+
+	OpenThreads::Mutex mutex;
+	OpenThreads::Condition allFinished;
+};
+
+// a worker's share of a RangeJob.  It may only get to run after the job is done (when the
+// queue was busy), so it deletes itself rather than have runRange() wait for it.
+class RangeTask : public WorkerTask {
+
+public:
+	RangeTask( RangeJob* _job ) { job = _job; }
+
+	virtual void run() {
+		job->work();
+		job->release();
+		delete this;
+	}
+
+private:
+	RangeJob* job;
+};
+
+WorkerPool::WorkerPool( int threadCount ) {
+	pending = 0;
+	stopping = false;
+
+	if( threadCount <= 0 )
+		threadCount = defaultThreadCount();
+
+	for( int i = 0; i < threadCount; i++ ) {
+		Worker* w = new Worker( this );
+		threads.push_back( w );
+		w->start();
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+		stopping = true;
+		workAvailable.broadcast();
+	}
+
+	for( vector< Worker* >::iterator i = threads.begin(); i != threads.end(); i++ ) {
+		(*i)->join();
+		delete *i;
+	}
+	threads.clear();
+}
+
+int WorkerPool::defaultThreadCount() {
+	int count = OpenThreads::GetNumberOfProcessors();
+	return ( count > 0 ? count : 1 );
+}
+
+// guards the shared pool, which the first of several threads may ask for
+static OpenThreads::Mutex sharedMutex;
+
+WorkerPool* WorkerPool::getSharedPool() {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( sharedMutex );
+
+	static WorkerPool* sharedPool = NULL;
+	if( sharedPool == NULL )
+		sharedPool = new WorkerPool();
+
+	return sharedPool;
+}
+
+void WorkerPool::add( WorkerTask* task ) {
+	if( task == NULL )
+		return;
+
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+	queue.push_back( task );
+	pending++;
+	workAvailable.signal();
+}
+
+void WorkerPool::wait() {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+	while( pending > 0 )
+		workFinished.wait( &mutex );
+}
+
+WorkerTask* WorkerPool::next() {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+	while( queue.empty() && !stopping )
+		workAvailable.wait( &mutex );
+
+	if( queue.empty() )
+		return NULL;
+
+	WorkerTask* task = queue.front();
+	queue.pop_front();
+	return task;
+}
+
+void WorkerPool::done() {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+	pending--;
+	if( pending == 0 )
+		workFinished.broadcast();
+}
+
+void WorkerPool::runRange( WorkerRange* range, unsigned int count, unsigned int grain ) {
+	if( range == NULL || count == 0 )
+		return;
+
+	if( grain == 0 )
+		grain = 1;
+
+	// don't bother with threads for a single chunk
+	if( count <= grain || threads.size() == 0 ) {
+		range->run( 0, count );
+		return;
+	}
+
+	// a task per worker (at most) takes chunks, and so does this thread.  Only the range's own chunks
+	// are waited for, so other work on the pool doesn't hold it up, and calling this from a worker
+	// can't deadlock:  this thread runs whatever the others don't get to.
+	unsigned int chunks = ( count + grain - 1 ) / grain;
+	unsigned int helpers = ( threads.size() < chunks - 1 ? threads.size() : chunks - 1 );
+
+	RangeJob* job = new RangeJob( range, count, grain, helpers + 1 );
+	for( unsigned int i = 0; i < helpers; i++ )
+		add( new RangeTask( job ) );
+
+	job->work();
+	job->wait();
+	job->release();
+}
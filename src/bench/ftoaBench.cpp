@@ -0,0 +1,149 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Microbenchmark for the number formatting used when saving worlds.
+ *
+ * Every number in a BZW file is pulled out and written back as text, first
+ * the old way (TextUtils::format( "%f" ) into a new string), then through
+ * ftoa(), and then appended into one reused string with appendFloat().
+ *
+ *   make ftoabench
+ *   ./ftoabench [world.bzw] [rounds]
+ *
+ * The world defaults to ../share/pythonian.bzw.
+ */
+
+#include "ftoa.h"
+#include "TextUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+// seconds on a clock that doesn't care about the process being idle
+static double now() {
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+// pull every token that reads completely as a number out of the text
+static void collectNumbers( const string& text, vector<float>& floats, vector<int>& ints ) {
+	istringstream in( text );
+	string token;
+	while( in >> token ) {
+		const char* start = token.c_str();
+		char* end;
+		double value = strtod( start, &end );
+		if( end == start || *end != 0 )
+			continue;
+
+		floats.push_back( (float)value );
+		if( token.find_first_of( ".eE" ) == string::npos )
+			ints.push_back( (int)value );
+	}
+}
+
+int main( int argc, char** argv ) {
+	const char* path = ( argc > 1 ? argv[1] : "../share/pythonian.bzw" );
+	int rounds = ( argc > 2 ? atoi( argv[2] ) : 200 );
+
+	ifstream file( path, ios::in | ios::binary );
+	if( !file ) {
+		fprintf( stderr, "could not open %s\n", path );
+		return 1;
+	}
+	stringstream contents;
+	contents << file.rdbuf();
+
+	vector<float> floats;
+	vector<int> ints;
+	collectNumbers( contents.str(), floats, ints );
+	if( floats.empty() ) {
+		fprintf( stderr, "no numbers in %s\n", path );
+		return 1;
+	}
+
+	// everything written has to read back as the same float
+	int mismatches = 0;
+	for( vector<float>::iterator i = floats.begin(); i != floats.end(); i++ ) {
+		if( (float)atof( ftoa( *i ).c_str() ) != *i )
+			mismatches++;
+	}
+
+	printf( "%s: %d floats, %d ints, %d rounds\n", path, (int)floats.size(), (int)ints.size(), rounds );
+
+	// keep the compiler from throwing the work away
+	size_t bytes = 0;
+
+	double start = now();
+	for( int r = 0; r < rounds; r++ ) {
+		for( vector<float>::iterator i = floats.begin(); i != floats.end(); i++ )
+			bytes += TextUtils::format( "%f", *i ).length();
+	}
+	double oldFloat = now() - start;
+
+	start = now();
+	for( int r = 0; r < rounds; r++ ) {
+		for( vector<float>::iterator i = floats.begin(); i != floats.end(); i++ )
+			bytes += ftoa( *i ).length();
+	}
+	double newFloat = now() - start;
+
+	string out;
+	start = now();
+	for( int r = 0; r < rounds; r++ ) {
+		out.clear();
+		for( vector<float>::iterator i = floats.begin(); i != floats.end(); i++ ) {
+			appendFloat( out, *i );
+			out += ' ';
+		}
+		bytes += out.length();
+	}
+	double appendedFloat = now() - start;
+
+	start = now();
+	for( int r = 0; r < rounds; r++ ) {
+		for( vector<int>::iterator i = ints.begin(); i != ints.end(); i++ )
+			bytes += TextUtils::format( "%i", *i ).length();
+	}
+	double oldInt = now() - start;
+
+	start = now();
+	for( int r = 0; r < rounds; r++ ) {
+		out.clear();
+		for( vector<int>::iterator i = ints.begin(); i != ints.end(); i++ ) {
+			appendInt( out, *i );
+			out += ' ';
+		}
+		bytes += out.length();
+	}
+	double appendedInt = now() - start;
+
+	double floatCount = (double)floats.size() * rounds;
+	double intCount = (double)ints.size() * rounds;
+	if( intCount == 0 )
+		intCount = 1;
+
+	printf( "  TextUtils::format( \"%%f\" )  %8.1f ns/float\n", oldFloat * 1e9 / floatCount );
+	printf( "  ftoa()                     %8.1f ns/float\n", newFloat * 1e9 / floatCount );
+	printf( "  appendFloat()              %8.1f ns/float\n", appendedFloat * 1e9 / floatCount );
+	printf( "  TextUtils::format( \"%%i\" )  %8.1f ns/int\n", oldInt * 1e9 / intCount );
+	printf( "  appendInt()                %8.1f ns/int\n", appendedInt * 1e9 / intCount );
+	printf( "  %d of %d floats did not read back exactly (%lu bytes written)\n",
+			mismatches, (int)floats.size(), (unsigned long)bytes );
+
+	return ( mismatches == 0 ? 0 : 1 );
+}
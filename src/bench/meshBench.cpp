@@ -0,0 +1,151 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Microbenchmark for building mesh geometry.
+ *
+ * Makes a terrain mesh, a grid of quads with normals and texcoords over a
+ * bumpy height field, and times finalizing it (which builds its geometry,
+ * triangulating the faces on the worker pool).  It has to make two triangles
+ * per quad.  It also reports how much memory the mesh's vertices and faces take.
+ *
+ *   make meshbench
+ *   ./meshbench [faces...]
+ *
+ * The face counts default to 10000, 100000 and 500000.
+ */
+
+#include "model/Model.h"
+#include "model/SceneBuilder.h"
+#include "objects/mesh.h"
+#include "WorkerPool.h"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Timer>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// seconds on the wall clock, since the build runs on several threads
+static double now() {
+	return osg::Timer::instance()->time_s();
+}
+
+// make a mesh of a side x side grid of quads
+static mesh* makeTerrain( int side ) {
+	mesh* terrain = new mesh();
+
+	vector< string > lines;
+	char buffer[256];
+	for( int y = 0; y <= side; y++ ) {
+		for( int x = 0; x <= side; x++ ) {
+			float height = 5.0f * sinf( x * 0.1f ) * cosf( y * 0.13f );
+			snprintf( buffer, sizeof( buffer ), "vertex %d %d %f", x, y, height );
+			lines.push_back( buffer );
+			snprintf( buffer, sizeof( buffer ), "normal %f %f 1", -0.5f * cosf( x * 0.1f ), 0.65f * sinf( y * 0.13f ) );
+			lines.push_back( buffer );
+			snprintf( buffer, sizeof( buffer ), "texcoord %f %f", x / 8.0f, y / 8.0f );
+			lines.push_back( buffer );
+		}
+	}
+
+	for( int y = 0; y < side; y++ ) {
+		for( int x = 0; x < side; x++ ) {
+			int a = y * ( side + 1 ) + x;
+			int b = a + 1;
+			int c = b + side + 1;
+			int d = a + side + 1;
+			snprintf( buffer, sizeof( buffer ), "%d %d %d %d", a, b, c, d );
+
+			lines.push_back( "face" );
+			lines.push_back( string( "vertices " ) + buffer );
+			lines.push_back( string( "normals " ) + buffer );
+			lines.push_back( string( "texcoords " ) + buffer );
+			lines.push_back( "endface" );
+		}
+	}
+
+	for( vector< string >::iterator i = lines.begin(); i != lines.end(); i++ )
+		terrain->parse( *i );
+
+	return terrain;
+}
+
+// the triangles in the mesh's geometry
+static unsigned int countTriangles( osg::Node* node ) {
+	unsigned int triangles = 0;
+
+	osg::Group* group = node->asGroup();
+	if( group != NULL ) {
+		for( unsigned int i = 0; i < group->getNumChildren(); i++ )
+			triangles += countTriangles( group->getChild( i ) );
+	}
+
+	osg::Geode* geode = dynamic_cast< osg::Geode* >( node );
+	if( geode != NULL ) {
+		for( unsigned int i = 0; i < geode->getNumDrawables(); i++ ) {
+			osg::Geometry* geometry = geode->getDrawable( i )->asGeometry();
+			if( geometry == NULL )
+				continue;
+			for( unsigned int j = 0; j < geometry->getNumPrimitiveSets(); j++ )
+				triangles += geometry->getPrimitiveSet( j )->getNumIndices() / 3;
+		}
+	}
+
+	return triangles;
+}
+
+static bool run( int faces ) {
+	int side = (int)sqrtf( (float)faces );
+	printf( "%d faces:\n", side * side );
+
+	osg::ref_ptr< mesh > terrain = makeTerrain( side );
+	size_t bytes = terrain->getData().getMemoryUsage();
+	printf( "  %-24s %10.1f MB  %.1f bytes/face\n", "mesh data", bytes / 1048576.0, (double)bytes / ( side * side ) );
+
+	double start = now();
+	terrain->finalize();
+	double seconds = now() - start;
+
+	unsigned int triangles = countTriangles( terrain.get() );
+	printf( "  %-24s %10.3f ms  %u triangles\n", "build", seconds * 1e3, triangles );
+
+	return triangles == 2u * side * side;
+}
+
+int main( int argc, char** argv ) {
+	SceneBuilder::init();
+	Model model;
+
+	printf( "%d worker threads\n", WorkerPool::getSharedPool()->getThreadCount() );
+
+	vector< int > counts;
+	for( int i = 1; i < argc; i++ )
+		counts.push_back( atoi( argv[i] ) );
+	if( counts.empty() ) {
+		counts.push_back( 10000 );
+		counts.push_back( 100000 );
+		counts.push_back( 500000 );
+	}
+
+	bool ok = true;
+	for( unsigned int i = 0; i < counts.size(); i++ )
+		ok = run( counts[i] ) && ok;
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Microbenchmark for picking.
+ *
+ * Scatters boxes over a map and shoots rays down at it from above, first the
+ * old way (a LineSegmentIntersector over the whole scene, then a dynamic_cast
+ * down each hit's node path), then through ObjectBVH.  It also times building
+ * the BVH, and refitting it after some of the boxes move.  Both ways have to
+ * pick the same boxes.
+ *
+ *   make pickbench
+ *   ./pickbench [count...]
+ *
+ * The counts default to 1000, 10000 and 50000, with 1000 rays each.
+ */
+
+#include "render/ObjectBVH.h"
+#include "model/SceneBuilder.h"
+#include "objects/box.h"
+
+#include <osg/Group>
+#include <osgUtil/IntersectionVisitor>
+#include <osgUtil/LineSegmentIntersector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+#include <vector>
+
+using namespace std;
+
+static const int RAYS = 1000;
+
+// seconds on a clock that doesn't care about the process being idle
+static double now() {
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static float randomFloat( float low, float high ) {
+	return low + ( high - low ) * ( (float)rand() / RAND_MAX );
+}
+
+static void report( const char* what, double seconds, int count ) {
+	printf( "  %-24s %10.3f ms %10.3f ms each\n", what, seconds * 1e3, seconds * 1e3 / count );
+}
+
+// what selectHandler::pickObject() used to do
+static bz2object* pickScene( osg::Group* root, const osg::Vec3& start, const osg::Vec3& end ) {
+	osg::ref_ptr< osgUtil::LineSegmentIntersector > intersector = new osgUtil::LineSegmentIntersector( start, end );
+	osgUtil::IntersectionVisitor visitor( intersector.get() );
+	root->accept( visitor );
+
+	osgUtil::LineSegmentIntersector::Intersections& intersections = intersector->getIntersections();
+	for( osgUtil::LineSegmentIntersector::Intersections::iterator hit = intersections.begin(); hit != intersections.end(); hit++ ) {
+		for( unsigned int i = 0; i < hit->nodePath.size(); i++ ) {
+			bz2object* obj = dynamic_cast< bz2object* >( hit->nodePath[i] );
+			if( obj != NULL )
+				return obj;
+		}
+	}
+	return NULL;
+}
+
+static bool run( int count ) {
+	srand( count );
+
+	// a square map with about one box per 400 square units, like a busy BZFlag map
+	float half = sqrtf( count * 400.0f ) / 2;
+
+	osg::ref_ptr< osg::Group > root = new osg::Group();
+	vector< bz2object* > boxes;
+	for( int i = 0; i < count; i++ ) {
+		box* b = new box();
+		b->setPos( osg::Vec3( randomFloat( -half, half ), randomFloat( -half, half ), randomFloat( 0, 20 ) ) );
+		b->setSize( osg::Vec3( randomFloat( 1, 10 ), randomFloat( 1, 10 ), randomFloat( 1, 10 ) ) );
+		b->setRotationZ( randomFloat( 0, 360 ) );
+		root->addChild( b );
+		boxes.push_back( b );
+	}
+
+	vector< osg::Vec3 > starts, ends;
+	for( int i = 0; i < RAYS; i++ ) {
+		starts.push_back( osg::Vec3( randomFloat( -half, half ), randomFloat( -half, half ), 200 ) );
+		ends.push_back( osg::Vec3( randomFloat( -half, half ), randomFloat( -half, half ), -10 ) );
+	}
+
+	printf( "%d boxes\n", count );
+	bool ok = true;
+
+	vector< bz2object* > expected;
+	double start = now();
+	for( int i = 0; i < RAYS; i++ )
+		expected.push_back( pickScene( root.get(), starts[i], ends[i] ) );
+	report( "scene intersector", now() - start, RAYS );
+
+	ObjectBVH tree;
+	for( vector< bz2object* >::iterator i = boxes.begin(); i != boxes.end(); i++ )
+		tree.addObject( *i );
+
+	// the first query builds the tree
+	start = now();
+	tree.pick( starts[0], ends[0] );
+	report( "build", now() - start, 1 );
+
+	int mismatches = 0;
+	unsigned int tested = 0;
+	start = now();
+	for( int i = 0; i < RAYS; i++ ) {
+		if( tree.pick( starts[i], ends[i] ) != expected[i] )
+			mismatches++;
+		tested += tree.getTestedCount();
+	}
+	report( "bvh", now() - start, RAYS );
+	printf( "  %-24s %10.2f\n", "objects tested per pick", (double)tested / RAYS );
+
+	// move a hundredth of the boxes, as dragging a selection would
+	for( int i = 0; i < count; i += 100 ) {
+		osg::Vec3 position = boxes[i]->getPos();
+		boxes[i]->setPos( position + osg::Vec3( randomFloat( -20, 20 ), randomFloat( -20, 20 ), 0 ) );
+		tree.updateObject( boxes[i] );
+	}
+
+	start = now();
+	tree.pick( starts[0], ends[0] );
+	report( "refit 1% and pick", now() - start, 1 );
+
+	for( int i = 0; i < RAYS; i++ ) {
+		if( tree.pick( starts[i], ends[i] ) != pickScene( root.get(), starts[i], ends[i] ) )
+			mismatches++;
+	}
+
+	if( mismatches > 0 ) {
+		fprintf( stderr, "  %d of %d picks didn't match the scene intersector\n", mismatches, 2 * RAYS );
+		ok = false;
+	}
+
+	return ok;
+}
+
+int main( int argc, char** argv ) {
+	SceneBuilder::init();
+
+	bool ok = true;
+
+	if( argc > 1 ) {
+		for( int i = 1; i < argc; i++ )
+			ok = run( atoi( argv[i] ) ) && ok;
+	}
+	else {
+		ok = run( 1000 ) && ok;
+		ok = run( 10000 ) && ok;
+		ok = run( 50000 ) && ok;
+	}
+
+	return ( ok ? 0 : 1 );
+}
@@ -0,0 +1,138 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Microbenchmark for the Model's selection.
+ *
+ * Fills a Model with bare objects and times select all, unselect all,
+ * invert selection, selecting every object one at a time (as clicking
+ * would), and asking whether each object is selected.
+ *
+ *   make selectbench
+ *   ./selectbench [count...]
+ *
+ * The counts default to 10000, 100000 and 1000000.
+ */
+
+#include "model/Model.h"
+#include "objects/bz2object.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// seconds on a clock that doesn't care about the process being idle
+static double now() {
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static void report( const char* what, double seconds, int count ) {
+	printf( "  %-24s %10.2f ms %8.1f ns/object\n", what, seconds * 1e3, seconds * 1e9 / count );
+}
+
+// make sure the selection holds exactly what it should
+static bool check( Model& model, int expected ) {
+	Model::objRefList& selection = model._getSelection();
+	if( (int)selection.size() != expected ) {
+		fprintf( stderr, "  expected %d selected objects, found %d\n", expected, (int)selection.size() );
+		return false;
+	}
+	for( Model::objRefList::iterator i = selection.begin(); i != selection.end(); i++ ) {
+		if( !(*i)->isSelected() ) {
+			fprintf( stderr, "  an unselected object was left in the selection\n" );
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool run( int count ) {
+	Model model;
+
+	Model::objRefList objs;
+	objs.reserve( count );
+	for( int i = 0; i < count; i++ )
+		objs.push_back( new bz2object( "box", "<position><rotation><size>" ) );
+	model._addObjects( objs );
+	objs.clear();
+
+	Model::objRefList& all = model._getObjects();
+
+	printf( "%d objects\n", count );
+	bool ok = true;
+
+	double start = now();
+	model._selectAll();
+	report( "select all", now() - start, count );
+	ok = check( model, count ) && ok;
+
+	start = now();
+	model._unselectAll();
+	report( "unselect all", now() - start, count );
+	ok = check( model, 0 ) && ok;
+
+	// every other object, then flip it
+	for( int i = 0; i < count; i += 2 )
+		model._setSelected( all[i].get() );
+
+	start = now();
+	model._invertSelection();
+	report( "invert selection", now() - start, count );
+	ok = check( model, count / 2 ) && ok;
+
+	model._unselectAll();
+
+	start = now();
+	for( Model::objRefList::iterator i = all.begin(); i != all.end(); i++ )
+		model._setSelected( i->get() );
+	report( "select one at a time", now() - start, count );
+	ok = check( model, count ) && ok;
+
+	// keep the compiler from throwing the work away
+	int selected = 0;
+	start = now();
+	for( Model::objRefList::iterator i = all.begin(); i != all.end(); i++ ) {
+		if( model._isSelected( i->get() ) )
+			selected++;
+	}
+	report( "is selected", now() - start, count );
+	if( selected != count ) {
+		fprintf( stderr, "  %d of %d objects reported as selected\n", selected, count );
+		ok = false;
+	}
+
+	// unselecting one at a time leaves entries to sweep out on the next read
+	start = now();
+	for( int i = 0; i < count; i += 2 )
+		model._setUnselected( all[i].get() );
+	model._getSelection();
+	report( "unselect half, one by one", now() - start, ( count + 1 ) / 2 );
+	ok = check( model, count / 2 ) && ok;
+
+	return ok;
+}
+
+int main( int argc, char** argv ) {
+	bool ok = true;
+
+	if( argc > 1 ) {
+		for( int i = 1; i < argc; i++ )
+			ok = run( atoi( argv[i] ) ) && ok;
+	}
+	else {
+		ok = run( 10000 ) && ok;
+		ok = run( 100000 ) && ok;
+		ok = run( 1000000 ) && ok;
+	}
+
+	return ( ok ? 0 : 1 );
+}
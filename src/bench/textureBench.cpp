@@ -0,0 +1,421 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Benchmark for loading remote textures, offline.
+ *
+ * Starts a small HTTP server on 127.0.0.1 that answers every request with
+ * share/textures/boxwall.png after a delay (standing in for a slow texture
+ * server), then asks a TextureLoader for that many textures by URL, each one
+ * twice.  It times how long the load() calls hold up the caller and how long
+ * it takes for every image to come in, and checks that each URL was only
+ * downloaded once, that no more than TextureLoader::DOWNLOAD_THREADS downloads
+ * were open at a time, and that every texture got its real image.
+ *
+ * Then it checks the TextureCache the downloads went into:  a second loader on
+ * the same cache should only revalidate (every answer a 304) and read every
+ * image back decoded; after the server changes some of the textures, only
+ * those should come back in full; and a small budget should shrink the cache.
+ *
+ *   make texturebench
+ *   ./texturebench [count [delay-ms]]
+ *
+ * Run it from the top of the source tree, so it finds share/.  The count
+ * defaults to 200 and the delay to 50 ms.  The cache goes in bzwb_bench_cache/
+ * and is removed afterwards.
+ */
+
+#include "model/TextureLoader.h"
+#include "model/TextureCache.h"
+#include "OSFile.h"
+
+#include <osg/Timer>
+#include <OpenThreads/Thread>
+#include <OpenThreads/ScopedLock>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define CACHE_DIRECTORY "bzwb_bench_cache/"
+
+// a web server that is just slow enough to show whether downloads overlap.  Each path
+// has a version (which is its ETag); changing it changes what the path serves.
+class StandInServer : public OpenThreads::Thread {
+
+public:
+
+	StandInServer( const string& body, const string& changedBody, int _delay ) {
+		bodies[0] = body;
+		bodies[1] = changedBody;
+		delay = _delay;
+		open = 0;
+		mostOpen = 0;
+		full = 0;
+		notModified = 0;
+		port = 0;
+
+		listener = socket( AF_INET, SOCK_STREAM, 0 );
+
+		sockaddr_in address;
+		memset( &address, 0, sizeof( address ) );
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+		address.sin_port = 0;
+
+		socklen_t length = sizeof( address );
+		if( listener >= 0 &&
+			bind( listener, (sockaddr*)&address, sizeof( address ) ) == 0 &&
+			listen( listener, 64 ) == 0 &&
+			getsockname( listener, (sockaddr*)&address, &length ) == 0 )
+			port = ntohs( address.sin_port );
+	}
+
+	int getPort() { return port; }
+
+	// how many times each path was asked for, and the most connections open at once
+	map< string, int > served;
+	int mostOpen;
+
+	// how many answers were 200s and 304s
+	int full;
+	int notModified;
+
+	// serve something new for a path
+	void change( const string& path ) {
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+		versions[ path ]++;
+	}
+
+	void resetCounts() {
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+		served.clear();
+		mostOpen = 0;
+		full = 0;
+		notModified = 0;
+	}
+
+	virtual void run() {
+		while( true ) {
+			int connection = accept( listener, NULL, NULL );
+			if( connection < 0 )
+				break;
+
+			// each connection gets a thread, so the server never limits how many overlap
+			Connection* handler = new Connection( this, connection );
+			handler->start();
+		}
+	}
+
+	OpenThreads::Mutex mutex;
+
+private:
+
+	class Connection : public OpenThreads::Thread {
+
+	public:
+		Connection( StandInServer* _server, int _socket ) { server = _server; socket = _socket; }
+
+		virtual void run() { server->answer( socket ); }
+
+	private:
+		StandInServer* server;
+		int socket;
+	};
+
+	void answer( int connection ) {
+		{
+			OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+			open++;
+			if( open > mostOpen )
+				mostOpen = open;
+		}
+
+		// read the request line and headers
+		string request;
+		char buffer[ 1024 ];
+		while( request.find( "\r\n\r\n" ) == string::npos ) {
+			ssize_t got = recv( connection, buffer, sizeof( buffer ), 0 );
+			if( got <= 0 )
+				break;
+			request.append( buffer, got );
+		}
+
+		string path;
+		string::size_type start = request.find( ' ' );
+		if( start != string::npos )
+			path = request.substr( start + 1, request.find( ' ', start + 1 ) - start - 1 );
+
+		// headers are matched without regard to case
+		string lowered = request;
+		for( string::size_type i = 0; i < lowered.length(); i++ )
+			lowered[i] = tolower( lowered[i] );
+
+		string ifNoneMatch;
+		string::size_type field = lowered.find( "\r\nif-none-match:" );
+		if( field != string::npos ) {
+			string::size_type valueStart = request.find_first_not_of( ' ', field + strlen( "\r\nif-none-match:" ) );
+			ifNoneMatch = request.substr( valueStart, request.find( "\r\n", valueStart ) - valueStart );
+		}
+
+		int version;
+		bool unchanged;
+		{
+			OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+			served[ path ]++;
+
+			version = versions[ path ];
+			unchanged = ( ifNoneMatch == etagFor( version ) );
+			if( unchanged )
+				notModified++;
+			else
+				full++;
+		}
+
+		OpenThreads::Thread::microSleep( delay * 1000 );
+
+		const string& body = bodies[ version % 2 ];
+		char header[ 256 ];
+		if( unchanged )
+			snprintf( header, sizeof( header ), "HTTP/1.0 304 Not Modified\r\nETag: %s\r\nConnection: close\r\n\r\n", etagFor( version ).c_str() );
+		else
+			snprintf( header, sizeof( header ), "HTTP/1.0 200 OK\r\nContent-Type: image/png\r\nContent-Length: %u\r\nETag: %s\r\nConnection: close\r\n\r\n",
+					  (unsigned int)body.size(), etagFor( version ).c_str() );
+		string response = string( header ) + ( unchanged ? string() : body );
+
+		// the client can't finish (and free up its slot) before it has the response,
+		// so this never counts two downloads from one slot as overlapping
+		{
+			OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+			open--;
+		}
+
+		for( size_t sent = 0; sent < response.size(); ) {
+			ssize_t wrote = send( connection, response.data() + sent, response.size() - sent, 0 );
+			if( wrote <= 0 )
+				break;
+			sent += wrote;
+		}
+		close( connection );
+	}
+
+	static string etagFor( int version ) {
+		char etag[ 32 ];
+		snprintf( etag, sizeof( etag ), "\"v%d\"", version );
+		return etag;
+	}
+
+	int listener;
+	int port;
+
+	// what a path serves, by whether its version is even or odd
+	string bodies[2];
+	map< string, int > versions;
+
+	int delay;
+	int open;
+};
+
+static string readFile( const string& path ) {
+	string contents;
+	FILE* file = fopen( path.c_str(), "rb" );
+	if( file == NULL )
+		return contents;
+
+	char buffer[ 4096 ];
+	size_t got;
+	while( ( got = fread( buffer, 1, sizeof( buffer ), file ) ) > 0 )
+		contents.append( buffer, got );
+	fclose( file );
+
+	return contents;
+}
+
+int main( int argc, char** argv ) {
+	int count = ( argc > 1 ? atoi( argv[1] ) : 200 );
+	int delay = ( argc > 2 ? atoi( argv[2] ) : 50 );
+
+	string texturePath( FindShareFile( "textures/" ) );
+	string body = readFile( texturePath + "boxwall.png" );
+	string changedBody = readFile( texturePath + "pyrwall.png" );
+	if( body.size() == 0 || changedBody.size() == 0 ) {
+		fprintf( stderr, "can't read %sboxwall.png or pyrwall.png; run this from the top of the source tree\n", texturePath.c_str() );
+		return 1;
+	}
+
+	StandInServer* server = new StandInServer( body, changedBody, delay );
+	if( server->getPort() == 0 ) {
+		fprintf( stderr, "can't start the stand-in server\n" );
+		return 1;
+	}
+	server->start();
+
+	char host[ 64 ];
+	snprintf( host, sizeof( host ), "127.0.0.1:%d", server->getPort() );
+
+	vector< string > urls;
+	for( int i = 0; i < count; i++ ) {
+		char url[ 128 ];
+		snprintf( url, sizeof( url ), "http://%s/textures/texture%d.png", host, i );
+		urls.push_back( url );
+	}
+
+	printf( "%d textures, %d ms each from %s\n", count, delay, host );
+
+	bool ok = true;
+
+	// a fresh cache downloads everything
+	TextureLoader* loader = new TextureLoader( CACHE_DIRECTORY );
+	loader->getCache()->clear();
+	vector< osg::ref_ptr< osg::Texture2D > > textures;
+
+	osg::Timer_t start = osg::Timer::instance()->tick();
+	for( int pass = 0; pass < 2; pass++ ) {
+		for( vector< string >::iterator i = urls.begin(); i != urls.end(); i++ )
+			textures.push_back( loader->load( *i ) );
+	}
+	double asking = osg::Timer::instance()->delta_s( start, osg::Timer::instance()->tick() );
+
+	loader->wait();
+	double loading = osg::Timer::instance()->delta_s( start, osg::Timer::instance()->tick() );
+
+	printf( "  %-24s %10.3f ms\n", "load() calls", asking * 1e3 );
+	printf( "  %-24s %10.3f ms (%.3f ms one at a time)\n", "until all loaded", loading * 1e3, (double)count * delay );
+
+	// each URL once, and no more downloads at a time than the loader allows
+	{
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( server->mutex );
+		int repeats = 0;
+		for( map< string, int >::iterator i = server->served.begin(); i != server->served.end(); i++ ) {
+			if( i->second != 1 )
+				repeats++;
+		}
+		printf( "  %-24s %10d of %d\n", "urls downloaded", (int)server->served.size(), count );
+		printf( "  %-24s %10d (limit %d)\n", "most open at once", server->mostOpen, TextureLoader::DOWNLOAD_THREADS );
+
+		if( (int)server->served.size() != count || repeats > 0 ) {
+			fprintf( stderr, "  %d urls were downloaded more than once, or not at all\n", repeats + count - (int)server->served.size() );
+			ok = false;
+		}
+		if( server->mostOpen > TextureLoader::DOWNLOAD_THREADS ) {
+			fprintf( stderr, "  too many downloads were open at once\n" );
+			ok = false;
+		}
+	}
+
+	// the second request for each URL gets the same texture, and every one got its image
+	int placeholders = 0;
+	for( int i = 0; i < count; i++ ) {
+		if( textures[i] != textures[ i + count ] ) {
+			fprintf( stderr, "  %s was loaded twice\n", urls[i].c_str() );
+			ok = false;
+		}
+		if( textures[i]->getImage() == TextureLoader::getPlaceholder() )
+			placeholders++;
+	}
+	if( placeholders > 0 ) {
+		fprintf( stderr, "  %d textures still show the placeholder\n", placeholders );
+		ok = false;
+	}
+
+	unsigned long long cacheSize = loader->getCache()->getSize();
+	if( loader->getCache()->getImagesStored() != 1 ) {
+		// every URL serves the same bytes, so they share one decoded image
+		fprintf( stderr, "  %u decoded images were cached, not 1\n", loader->getCache()->getImagesStored() );
+		ok = false;
+	}
+	delete loader;
+
+	// a new loader on the same cache only revalidates, and never decodes
+	server->resetCounts();
+	loader = new TextureLoader( CACHE_DIRECTORY );
+	textures.clear();
+
+	start = osg::Timer::instance()->tick();
+	for( vector< string >::iterator i = urls.begin(); i != urls.end(); i++ )
+		textures.push_back( loader->load( *i ) );
+	loader->wait();
+	double reloading = osg::Timer::instance()->delta_s( start, osg::Timer::instance()->tick() );
+
+	printf( "  %-24s %10.3f ms\n", "reloaded from the cache", reloading * 1e3 );
+	printf( "  %-24s %10u read, %u stored\n", "decoded images", loader->getCache()->getImagesRead(), loader->getCache()->getImagesStored() );
+	{
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( server->mutex );
+		printf( "  %-24s %10d full, %d not modified\n", "answers", server->full, server->notModified );
+
+		if( server->full != 0 || server->notModified != count ) {
+			fprintf( stderr, "  every cached texture should have been revalidated\n" );
+			ok = false;
+		}
+	}
+	if( (int)loader->getCache()->getImagesRead() != count || loader->getCache()->getImagesStored() != 0 ) {
+		fprintf( stderr, "  every image should have come from the cache\n" );
+		ok = false;
+	}
+	for( int i = 0; i < count; i++ ) {
+		if( textures[i]->getImage() == TextureLoader::getPlaceholder() || !textures[i]->getImage()->isMipmap() ) {
+			fprintf( stderr, "  %s didn't get its cached image\n", urls[i].c_str() );
+			ok = false;
+			break;
+		}
+	}
+	delete loader;
+
+	// after the server changes some textures, only those come back in full
+	int changed = ( count < 10 ? count : 10 );
+	for( int i = 0; i < changed; i++ )
+		server->change( urls[i].substr( urls[i].find( '/', strlen( "http://" ) ) ) );
+
+	server->resetCounts();
+	loader = new TextureLoader( CACHE_DIRECTORY );
+	for( vector< string >::iterator i = urls.begin(); i != urls.end(); i++ )
+		loader->load( *i );
+	loader->wait();
+
+	{
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( server->mutex );
+		printf( "  %-24s %10d full, %d not modified (%d changed)\n", "answers after changes", server->full, server->notModified, changed );
+
+		if( server->full != changed || server->notModified != count - changed || loader->getCache()->getImagesStored() != 1 ) {
+			fprintf( stderr, "  only the changed textures should have been downloaded and decoded\n" );
+			ok = false;
+		}
+	}
+
+	// shrinking the budget throws out the least recently used contents
+	unsigned long long budget = cacheSize;
+	loader->getCache()->setBudget( budget );
+	printf( "  %-24s %10llu bytes (budget %llu)\n", "cache size", loader->getCache()->getSize(), budget );
+	if( loader->getCache()->getSize() > budget ) {
+		fprintf( stderr, "  the cache is over its budget\n" );
+		ok = false;
+	}
+
+	// leave nothing behind
+	loader->getCache()->clear();
+	delete loader;
+	rmdir( CACHE_DIRECTORY );
+
+	return ( ok ? 0 : 1 );
+}
@@ -0,0 +1,306 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Microbenchmark for mesh face triangulation.
+ *
+ * Triangulates star-shaped faces with random radii, combs (a row of thin teeth,
+ * which is mostly reflex corners) and squares with many corners along each
+ * side, first the old way (the ear clipper that was in mesh.cpp, which checks
+ * every corner for each candidate ear), then through the Triangulator.  Both
+ * have to cover the face exactly, with every triangle wound the way the face is.
+ *
+ *   make triangulatebench
+ *   ./triangulatebench [corners...]
+ *
+ * The corner counts default to 100, 1000 and 10000; the old way is skipped
+ * above 2000 corners.
+ */
+
+#include "render/Triangulator.h"
+
+#include <osg/Vec3>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <vector>
+
+using namespace std;
+
+// faces with more corners than this take too long the old way
+static const unsigned int OLD_LIMIT = 2000;
+
+// seconds on a clock that doesn't care about the process being idle
+static double now() {
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static float randomFloat( float low, float high ) {
+	return low + ( high - low ) * ( (float)rand() / RAND_MAX );
+}
+
+/*
+ * The old triangulator, as it was in mesh.cpp (with its plane setup fixed so
+ * that it checks all three edges)
+ */
+
+static osg::Vec3 Normal;
+static const osg::Vec3* Verts;
+static int Count = 0;
+static int* WorkSet = NULL;
+
+static void makeNormal() {
+	Normal.set( 0, 0, 0 );
+	for( int i = 0; i < Count; i++ ) {
+		const osg::Vec3& v0 = Verts[i];
+		const osg::Vec3& v1 = Verts[ ( i + 1 ) % Count ];
+		Normal[0] += ( v0.y() - v1.y() ) * ( v0.z() + v1.z() );
+		Normal[1] += ( v0.z() - v1.z() ) * ( v0.x() + v1.x() );
+		Normal[2] += ( v0.x() - v1.x() ) * ( v0.y() + v1.y() );
+	}
+	Normal.normalize();
+}
+
+static bool isConvex( int w0, int w1, int w2 ) {
+	const osg::Vec3 e0 = Verts[ WorkSet[w1] ] - Verts[ WorkSet[w0] ];
+	const osg::Vec3 e1 = Verts[ WorkSet[w2] ] - Verts[ WorkSet[w1] ];
+	return ( ( e0 ^ e1 ) * Normal > 0.0f );
+}
+
+static bool isFaceClear( int w0, int w1, int w2 ) {
+	const int v[3] = { WorkSet[w0], WorkSet[w1], WorkSet[w2] };
+	osg::Vec3 edges[3];
+	for( int i = 0; i < 3; i++ )
+		edges[i] = Verts[ v[ ( i + 1 ) % 3 ] ] - Verts[ v[i] ];
+	osg::Vec3 normal = edges[0] ^ edges[1];
+
+	osg::Vec3 planes[3];
+	float offsets[3];
+	for( int i = 0; i < 3; i++ ) {
+		planes[i] = edges[i] ^ normal;
+		offsets[i] = -( planes[i] * Verts[ v[i] ] );
+	}
+
+	for( int w = 0; w < Count; w++ ) {
+		if( w == w0 || w == w1 || w == w2 )
+			continue;
+		int i;
+		for( i = 0; i < 3; i++ ) {
+			if( Verts[ WorkSet[w] ] * planes[i] + offsets[i] > 0.0f )
+				break;
+		}
+		if( i == 3 )
+			return false;
+	}
+	return true;
+}
+
+static float getDot( int w0, int w1, int w2 ) {
+	osg::Vec3 e0 = Verts[ WorkSet[w1] ] - Verts[ WorkSet[w0] ];
+	osg::Vec3 e1 = Verts[ WorkSet[w2] ] - Verts[ WorkSet[w1] ];
+	e0.normalize();
+	e1.normalize();
+	return e0 * e1;
+}
+
+static void oldTriangulate( const vector< osg::Vec3 >& verts, vector< unsigned int >& tris ) {
+	tris.clear();
+	Verts = &verts[0];
+	Count = verts.size();
+	WorkSet = new int[ Count ];
+	for( int i = 0; i < Count; i++ )
+		WorkSet[i] = i;
+	makeNormal();
+
+	int best = 0;
+	bool left = false;
+	bool first = true;
+	float score = 0.0f;
+
+	while( Count >= 3 ) {
+		bool convex = false;
+		bool faceClear = false;
+
+		int offset = ( best == Count ? Count - 1 : best % Count );
+		if( left )
+			offset = ( offset + ( Count - 1 ) ) % Count;
+		left = !left;
+
+		for( int w = offset; w < offset + ( Count - 2 ); w++ ) {
+			const int w0 = ( w + 0 ) % Count;
+			const int w1 = ( w + 1 ) % Count;
+			const int w2 = ( w + 2 ) % Count;
+
+			const bool convex2 = isConvex( w0, w1, w2 );
+			if( convex && !convex2 )
+				continue;
+
+			const bool faceClear2 = isFaceClear( w0, w1, w2 );
+			if( ( faceClear && !faceClear2 ) && ( convex || !convex2 ) )
+				continue;
+
+			if( first ) {
+				const float score2 = 2.0f - getDot( w0, w1, w2 );
+				if( ( score2 < score ) && ( convex || !convex2 ) && ( faceClear || !faceClear2 ) )
+					continue;
+				score = score2;
+			}
+
+			best = w0;
+			if( convex && faceClear )
+				break;
+			convex = convex2;
+			faceClear = faceClear2;
+		}
+
+		first = false;
+
+		for( int i = 0; i < 3; i++ )
+			tris.push_back( WorkSet[ ( best + i ) % Count ] );
+
+		const int m = ( best + 1 ) % Count;
+		memmove( WorkSet + m, WorkSet + m + 1, ( Count - m - 1 ) * sizeof( int ) );
+		Count--;
+	}
+
+	delete[] WorkSet;
+}
+
+/*
+ * Faces
+ */
+
+static void makeStar( unsigned int corners, vector< osg::Vec3 >& face ) {
+	face.clear();
+	for( unsigned int i = 0; i < corners; i++ ) {
+		float angle = 2.0f * M_PI * i / corners;
+		float radius = randomFloat( 50.0f, 250.0f );
+		face.push_back( osg::Vec3( radius * cosf( angle ), radius * sinf( angle ), 0.0f ) );
+	}
+}
+
+static void makeComb( unsigned int corners, vector< osg::Vec3 >& face ) {
+	unsigned int teeth = ( corners - 2 ) / 2;
+	face.clear();
+	face.push_back( osg::Vec3( 0.0f, 0.0f, 0.0f ) );
+	face.push_back( osg::Vec3( 2.0f * teeth, 0.0f, 0.0f ) );
+	for( int i = teeth - 1; i >= 0; i-- ) {
+		face.push_back( osg::Vec3( 2.0f * i + 2.0f, 10.0f, 0.0f ) );
+		face.push_back( osg::Vec3( 2.0f * i + 1.0f, 1.0f, 0.0f ) );
+	}
+}
+
+static void makeSquare( unsigned int corners, vector< osg::Vec3 >& face ) {
+	unsigned int side = corners / 4;
+	face.clear();
+	for( unsigned int i = 0; i < side; i++ )
+		face.push_back( osg::Vec3( i, 0.0f, 0.0f ) );
+	for( unsigned int i = 0; i < side; i++ )
+		face.push_back( osg::Vec3( side, i, 0.0f ) );
+	for( unsigned int i = 0; i < side; i++ )
+		face.push_back( osg::Vec3( side - i, side, 0.0f ) );
+	for( unsigned int i = 0; i < side; i++ )
+		face.push_back( osg::Vec3( 0.0f, side - i, 0.0f ) );
+}
+
+// twice the signed area of a face, or of a triangle
+static double area( const vector< osg::Vec3 >& face ) {
+	double sum = 0.0;
+	for( unsigned int i = 0; i < face.size(); i++ ) {
+		const osg::Vec3& a = face[i];
+		const osg::Vec3& b = face[ ( i + 1 ) % face.size() ];
+		sum += (double)a.x() * b.y() - (double)b.x() * a.y();
+	}
+	return sum;
+}
+
+static double area( const osg::Vec3& a, const osg::Vec3& b, const osg::Vec3& c ) {
+	return ( (double)b.x() - a.x() ) * ( (double)c.y() - a.y() ) - ( (double)b.y() - a.y() ) * ( (double)c.x() - a.x() );
+}
+
+// do the triangles cover the face, each one wound the same way?
+static bool covers( const vector< osg::Vec3 >& face, const vector< unsigned int >& tris ) {
+	if( tris.size() != 3 * ( face.size() - 2 ) )
+		return false;
+
+	double total = area( face );
+	double sum = 0.0;
+	for( unsigned int i = 0; i < tris.size(); i += 3 ) {
+		double a = area( face[ tris[i] ], face[ tris[i + 1] ], face[ tris[i + 2] ] );
+		if( ( total > 0.0 ? a : -a ) < -1e-6 * fabs( total ) )
+			return false;
+		sum += a;
+	}
+
+	return fabs( sum - total ) <= 1e-6 * fabs( total );
+}
+
+static bool run( const char* name, unsigned int corners, void (*make)( unsigned int, vector< osg::Vec3 >& ) ) {
+	srand( corners );
+
+	vector< osg::Vec3 > face;
+	make( corners, face );
+
+	// both windings
+	bool ok = true;
+	for( int flip = 0; flip < 2; flip++ ) {
+		if( flip )
+			face = vector< osg::Vec3 >( face.rbegin(), face.rend() );
+
+		printf( "%s, %u corners%s:\n", name, (unsigned int)face.size(), flip ? ", clockwise" : "" );
+
+		vector< unsigned int > tris;
+		if( face.size() <= OLD_LIMIT ) {
+			double start = now();
+			oldTriangulate( face, tris );
+			double seconds = now() - start;
+			printf( "  %-24s %10.3f ms%s\n", "old", seconds * 1e3, covers( face, tris ) ? "" : "  (doesn't cover the face)" );
+		}
+
+		Triangulator triangulator;
+		tris.clear();
+		double start = now();
+		triangulator.triangulate( &face[0], NULL, face.size(), tris );
+		double seconds = now() - start;
+		bool covered = covers( face, tris );
+		printf( "  %-24s %10.3f ms%s\n", "Triangulator", seconds * 1e3, covered ? "" : "  (doesn't cover the face)" );
+
+		ok = ok && covered;
+	}
+
+	return ok;
+}
+
+int main( int argc, char** argv ) {
+	vector< unsigned int > counts;
+	for( int i = 1; i < argc; i++ )
+		counts.push_back( atoi( argv[i] ) );
+	if( counts.empty() ) {
+		counts.push_back( 100 );
+		counts.push_back( 1000 );
+		counts.push_back( 10000 );
+	}
+
+	bool ok = true;
+	for( unsigned int i = 0; i < counts.size(); i++ ) {
+		if( counts[i] < 4 )
+			continue;
+		ok = run( "star", counts[i], makeStar ) && ok;
+		ok = run( "comb", counts[i], makeComb ) && ok;
+		ok = run( "square", counts[i], makeSquare ) && ok;
+	}
+
+	return ok ? 0 : 1;
+}
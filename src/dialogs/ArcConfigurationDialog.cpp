@@ -11,6 +11,7 @@
  */
 
 #include "dialogs/ArcConfigurationDialog.h"
+#include "model/Model.h"
 
 // constructor
 ArcConfigurationDialog::ArcConfigurationDialog( arc* _theArc ) :
@@ -94,6 +95,9 @@ void ArcConfigurationDialog::OKCallback_real( Fl_Widget* w ) {
 	theArc->setDivisions( (int)subdivisionCounter->value() );
 	theArc->setFlatshading( flatShadingButton->value() == 1 ? true : false );
 	theArc->setTexsize( Point4D( texsizeXField->value(), texsizeYField->value(), texsizeZField->value(), texsizeWField->value() ) );
+
+	// its shape may have changed, so the View has to find its new bounds
+	Model::updateObject( theArc );
 	
 	// don't delete this dialog box just yet...just hide it
 	hide();
@@ -11,6 +11,7 @@
  */
 
 #include "dialogs/ConeConfigurationDialog.h"
+#include "model/Model.h"
 
 // constructor
 ConeConfigurationDialog::ConeConfigurationDialog( cone* _theCone ) :
@@ -75,6 +76,9 @@ void ConeConfigurationDialog::OKCallback_real( Fl_Widget* w ) {
 	theCone->setFlatshading( flatShadingButton->value() == 1 ? true : false );
 	theCone->setTexsize( Point2D( texsizeXField->value(), texsizeYField->value() ) );
 	theCone->setFlipz( flipzButton->value() == 1 ? true : false );
+
+	// its shape may have changed, so the View has to find its new bounds
+	Model::updateObject( theCone );
 	
 	// don't delete this dialog box just yet...just hide it
 	hide();
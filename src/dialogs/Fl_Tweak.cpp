@@ -11,6 +11,7 @@
  */
 
 #include "dialogs/Fl_Tweak.h"
+#include "model/Model.h"
 
 // constructor function
 Fl_Tweak::Fl_Tweak( bz2object* _obj, TweakOp _op ) : Fl_Dialog( "Configure", DEFAULT_WIDTH, DEFAULT_HEIGHT, Fl_Dialog::Fl_OK | Fl_Dialog::Fl_CANCEL ) {
@@ -97,6 +98,9 @@ void Fl_Tweak::tweak_callback_real( Fl_Widget* w ) {
 		default:
 			break;
 	}
+
+	// tell the View it moved
+	Model::updateObject( obj );
 	
 	// close the window
 	Fl::delete_widget( this );
@@ -11,6 +11,7 @@
  */
 
 #include "dialogs/GroupConfigurationDialog.h"
+#include "model/Model.h"
 
 // constructor
 GroupConfigurationDialog::GroupConfigurationDialog( group* _theGroup ) :
@@ -45,6 +46,9 @@ void GroupConfigurationDialog::OKCallback_real( Fl_Widget* w ) {
 		theGroup->setDefine( def );
 	}
 
+	// its shape may have changed, so the View has to find its new bounds
+	Model::updateObject( theGroup );
+
 	// don't delete this dialog box just yet...just hide it
 	hide();
 }
@@ -0,0 +1,97 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "dialogs/LoadProgressDialog.h"
+#include "windows/MainWindow.h"
+
+#include "defines.h"
+
+// how long each timeout spends loading, and how long it leaves the rest of the interface
+#define LOAD_SLICE 0.02
+#define IDLE_SLICE 0.005
+
+LoadProgressDialog::LoadProgressDialog( MainWindow* _parent ) :
+	Fl_Dialog( "Loading BZW File", 320, 70, Fl_Dialog::Fl_CANCEL ),
+	loader( _parent->getModel() )
+{
+	parent = _parent;
+	loading = false;
+
+	begin();
+
+	status = new Fl_Box( FL_FLAT_BOX, 10, 5, 300, 20, "" );
+	status->align( FL_ALIGN_LEFT | FL_ALIGN_INSIDE | FL_ALIGN_CLIP );
+	status->labelsize( 12 );
+
+	progress = new Fl_Progress( 10, 30, 300, 30 );
+	progress->minimum( 0.0f );
+	progress->maximum( 1.0f );
+	progress->value( 0.0f );
+
+	end();
+
+	setCancelEventHandler( CancelCallback, this );
+}
+
+LoadProgressDialog::~LoadProgressDialog() {
+	Fl::remove_timeout( LoadCallback, this );
+}
+
+bool LoadProgressDialog::load( const char* filename ) {
+	if( !loader.start( filename ) )
+		return false;
+
+	loading = true;
+
+	statusText = string( "Loading " ) + filename;
+	status->label( statusText.c_str() );
+	show();
+
+	Fl::add_timeout( 0.0, LoadCallback, this );
+	return true;
+}
+
+void LoadProgressDialog::cancel() {
+	if( !loading )
+		return;
+
+	Fl::remove_timeout( LoadCallback, this );
+	loader.cancel();
+	loading = false;
+	hide();
+}
+
+void LoadProgressDialog::CancelCallback_real( Fl_Widget* w ) {
+	cancel();
+}
+
+void LoadProgressDialog::LoadCallback_real() {
+	bool more = loader.step( LOAD_SLICE );
+
+	float value = loader.getProgress();
+	progress->value( value );
+	progressText = itoa( (int)( value * 100.0f ) ) + "% (" + itoa( (int)loader.getObjectsLoaded() ) + " objects)";
+	progress->label( progressText.c_str() );
+
+	if( more )
+		Fl::repeat_timeout( IDLE_SLICE, LoadCallback, this );
+	else
+		finish();
+}
+
+void LoadProgressDialog::finish() {
+	loading = false;
+	hide();
+
+	if( !loader.succeeded() )
+		parent->error( parent->getModel()->getErrors().c_str() );
+}
@@ -11,6 +11,7 @@
  */
 
 #include "dialogs/MasterConfigurationDialog.h"
+#include "model/Model.h"
 #include "defines.h"
 #include <iostream>
 
@@ -296,6 +297,9 @@ void MasterConfigurationDialog::OKButtonCallback_real(Fl_Widget* w) {
 		object->setRotation( spinVals );
 	}*/
 	object->update( transformUpdate );
+
+	// tell the View it moved
+	Model::updateObject( object );
 	
 	printf("data: \n|%s|\n", object->toString().c_str());
 	
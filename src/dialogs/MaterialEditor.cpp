@@ -145,7 +145,7 @@ void MaterialEditor::MaterialAddCallback_real( Fl_Widget* w ) {
 	if(!newObj)
 		return;
 
-	model->_getMaterials()[ newObj->getName() ] = newObj;
+	model->_addMaterial( newObj );
 
 	// make sure the material shows up
 	refreshMaterialList();
@@ -11,17 +11,27 @@
  */
 
 #include "dialogs/MenuBar.h"
+
+#include <FL/fl_ask.H>
+
 #include "dialogs/MaterialEditor.h"
 #include "dialogs/PhysicsEditor.h"
 #include "dialogs/DefineEditor.h"
 #include "dialogs/RenameDialog.h"
+#include "dialogs/LoadProgressDialog.h"
 #include "model/Model.h"
+#include "model/BZWWriter.h"
+#include "model/BZWMappedFile.h"
+#include "model/BZWCache.h"
+#include "render/StaticBatch.h"
 #include "commonControls.h"
 
 #include "objects/base.h"
 #include "objects/group.h"
 #include "objects/teleporter.h"
 #include "objects/define.h"
+#include "objects/material.h"
+#include "objects/mesh.h"
 
 #include "dialogs/InfoConfigurationDialog.h"
 #include "dialogs/GroupConfigurationDialog.h"
@@ -36,6 +46,8 @@ void MenuBar::buildMenu(void) {
 		add("File/Save", FL_CTRL + 's', save_world, this);
 		add("File/Save As...", 0, save_world_as, this, FL_MENU_DIVIDER);
 		//add("File/Save Selection...", 0, save_selection, this, FL_MENU_DIVIDER);
+		add("File/Parallel Loading", 0, parallel_loading, this, FL_MENU_TOGGLE);
+		add("File/Cache Loaded Worlds", 0, cache_worlds, this, FL_MENU_TOGGLE | FL_MENU_VALUE | FL_MENU_DIVIDER);
 		add("File/Exit", 0, exit_bzwb, this);
 
 	add("Edit", 0, 0, 0, FL_SUBMENU);
@@ -49,6 +61,10 @@ void MenuBar::buildMenu(void) {
 		add("Edit/Delete", FL_Delete, delete_callback, this, FL_MENU_DIVIDER);
 		add("Edit/Select All", FL_CTRL + 'a', select_all, this);
 		add("Edit/Unselect All", FL_CTRL + FL_ALT + 'a', unselect_all, this);
+		add("Edit/Invert Selection", FL_CTRL + 'i', invert_selection, this, FL_MENU_DIVIDER);
+		add("Edit/Click Select", 0, click_select, this, FL_MENU_RADIO | FL_MENU_VALUE);
+		add("Edit/Box Select", 0, box_select, this, FL_MENU_RADIO);
+		add("Edit/Lasso Select", 0, lasso_select, this, FL_MENU_RADIO);
 
 	add("Objects", 0, 0, 0, FL_SUBMENU);
 		add("Objects/Add box", FL_CTRL+'b', addBoxCallback, this);
@@ -83,17 +99,43 @@ void MenuBar::buildMenu(void) {
 
 		add("Scene/Define World Weapon...", FL_CTRL+'w', worldWeaponCallback, this);
 		add("Scene/Link Teleporters", 0, linkCallback, this);
+		add("Scene/Optimize Meshes...", 0, optimizeMeshesCallback, this);
+		add("Scene/Generate Mesh LODs...", 0, generateLODsCallback, this, FL_MENU_DIVIDER);
+
+		add("Scene/Threading", 0, 0, 0, FL_SUBMENU);
+			add("Scene/Threading/Single Threaded", 0, single_threaded, this, FL_MENU_RADIO | FL_MENU_VALUE);
+			add("Scene/Threading/Draw Thread", 0, draw_thread, this, FL_MENU_RADIO);
+			add("Scene/Threading/Cull and Draw Thread", 0, cull_draw_thread, this, FL_MENU_RADIO);
+		add("Scene/Instanced Drawing", 0, instancingCallback, this, FL_MENU_TOGGLE);
+		add("Scene/Statistics...", 0, statisticsCallback, this);
+		add("Scene/Statistics Overlay", 0, statsHUDCallback, this, FL_MENU_TOGGLE);
+		add("Scene/Record Frame Statistics...", 0, frameTraceCallback, this, FL_MENU_TOGGLE);
 }
 
 // constructor
 MenuBar::MenuBar( MainWindow* mw ) : Fl_Menu_Bar(0, 0, mw->w(), 30) {
 	this->parent = mw;
+	this->loadDialog = NULL;
 	printf("MenuBar: parent mw addr: %p\n", parent);
 	printf("MenuBar: parent mw model addr: %p\n", parent->getModel());
 	this->buildMenu();
 }
 
+MenuBar::~MenuBar() {
+	if( loadDialog != NULL )
+		delete loadDialog;
+}
+
+// is a world being loaded in the background?
+bool MenuBar::isLoading() {
+	return loadDialog != NULL && loadDialog->isLoading();
+}
+
 void MenuBar::new_world_real( Fl_Widget* w ) {
+	// don't let a load in progress keep adding to the new world
+	if( loadDialog != NULL )
+		loadDialog->cancel();
+
 	Model* model = this->parent->getModel();
 	model->_newWorld();
 
@@ -133,11 +175,13 @@ void MenuBar::open_world_real( Fl_Widget* w ) {
 
 	printf("file: %s\n", filename.c_str());
 
-	// invoke BZWParser and load it
-	bool success = BZWParser::loadFile( filename.c_str() );
+	// load it in the background; the old loader (and any load it's still doing) goes away first
+	if( loadDialog != NULL )
+		delete loadDialog;
 
-	if (!success) {
-		parent->error( parent->getModel()->getErrors().c_str() );
+	loadDialog = new LoadProgressDialog( parent );
+	if( !loadDialog->load( filename.c_str() ) ) {
+		parent->error( TextUtils::format("Could not open %s\n", filename.c_str()).c_str() );
 	}
 }
 
@@ -182,18 +226,34 @@ void MenuBar::save_world_as_real( Fl_Widget* w ) {
 // save the world
 void MenuBar::do_world_save( const char* filename ) {
 
-	ofstream fileOutput( filename );
+	// the world is only partly there until it's done loading
+	if( isLoading() ) {
+		parent->error( "Please wait for the world to finish loading (or cancel it) before saving\n" );
+		return;
+	}
+
+	// write to a temporary file, which replaces the old world only once it's complete
+	BZWWriter fileOutput;
 
 	// if we can't open a new file (access permissions, etc), then bail
-	if(!fileOutput.is_open()) {
+	if(!fileOutput.open( filename )) {
 		parent->error( TextUtils::format("Could not open %s for writing\n", filename).c_str() );
 		return;
 	}
 
-	string text = parent->getModel()->toString();
+	bool written = Model::write( fileOutput );
+
+	if(!fileOutput.close() || !written) {
+		parent->error( TextUtils::format("Could not write %s\n", filename).c_str() );
+		return;
+	}
 
-	fileOutput.write( text.c_str(), text.size() );
-	fileOutput.close();
+	// the file now holds exactly the Model's world, so cache it for the next open
+	if( BZWParser::getUseCache() ) {
+		BZWMappedFile saved;
+		if( saved.open( filename ) )
+			BZWCache::write( BZWCache::fileNameFor( filename ).c_str(), TextUtils::hash( saved.begin(), saved.end() ), saved.size() );
+	}
 
 }
 
@@ -201,6 +261,24 @@ void MenuBar::save_selection_real( Fl_Widget* w ) {
 
 }
 
+// toggle parsing worlds on the worker pool
+void MenuBar::parallel_loading_real( Fl_Widget* w ) {
+	const Fl_Menu_Item* item = mvalue();
+	if( item == NULL )
+		return;
+
+	Model::setParallelBuild( item->value() != 0 );
+}
+
+// toggle keeping a binary cache next to each world that is opened or saved
+void MenuBar::cache_worlds_real( Fl_Widget* w ) {
+	const Fl_Menu_Item* item = mvalue();
+	if( item == NULL )
+		return;
+
+	BZWParser::setUseCache( item->value() != 0 );
+}
+
 void MenuBar::exit_bzwb_real( Fl_Widget* w ) {
 	while (Fl::first_window())
 		Fl::first_window()->hide();
@@ -238,6 +316,23 @@ void MenuBar::unselect_all_real( Fl_Widget* w ) {
 	parent->getModel()->unselectAll();
 }
 
+void MenuBar::invert_selection_real( Fl_Widget* w ) {
+	parent->getModel()->invertSelection();
+}
+
+// left-drags over empty space select nothing, a box, or a lasso
+void MenuBar::click_select_real( Fl_Widget* w ) {
+	parent->getView()->getSelectHandler()->setRegionMode( selectHandler::REGION_NONE );
+}
+
+void MenuBar::box_select_real( Fl_Widget* w ) {
+	parent->getView()->getSelectHandler()->setRegionMode( selectHandler::REGION_BOX );
+}
+
+void MenuBar::lasso_select_real( Fl_Widget* w ) {
+	parent->getView()->getSelectHandler()->setRegionMode( selectHandler::REGION_LASSO );
+}
+
 // add a box
 void MenuBar::addBoxCallback_real(Fl_Widget* w) {
 	makeObject( "box" );
@@ -520,6 +615,76 @@ void MenuBar::configureInfoCallback_real(Fl_Widget* w) {
 	value(0);
 }
 
+// draw from OSG's threads, or from FLTK's
+void MenuBar::threading_real( Fl_Widget* w, osgViewer::ViewerBase::ThreadingModel model ) {
+	if( parent->getView()->setThreading( model ) )
+		return;
+
+	fl_alert( "This window can't be drawn from another thread here." );
+
+	// back to what's still in use
+	Fl_Menu_Item* item = (Fl_Menu_Item*)find_item( "Scene/Threading/Single Threaded" );
+	if( item != NULL )
+		item->setonly();
+}
+
+// show what the scene is made of
+void MenuBar::statisticsCallback_real(Fl_Widget* w) {
+	unsigned int requested, distinct;
+	material::getFinalMaterialStats( requested, distinct );
+
+	fl_message( "Objects: %u\n"
+				"Final materials asked for: %u\n"
+				"Distinct final materials (StateSets): %u\n"
+				"Shared %.1f ways on average",
+				(unsigned int)parent->getModel()->_getObjects().size(),
+				requested, distinct,
+				( distinct > 0 ? (double)requested / distinct : 0.0 ) );
+
+	value(0);
+}
+
+// toggle drawing unit boxes and pyramids as instances
+void MenuBar::instancingCallback_real(Fl_Widget* w) {
+	const Fl_Menu_Item* item = mvalue();
+	if( item == NULL )
+		return;
+
+	StaticBatch::setInstancing( item->value() != 0 );
+}
+
+// toggle the per-frame statistics over the scene
+void MenuBar::statsHUDCallback_real(Fl_Widget* w) {
+	const Fl_Menu_Item* item = mvalue();
+	if( item == NULL )
+		return;
+
+	parent->getView()->setStatsHUD( item->value() != 0 );
+}
+
+// start or stop writing each frame's statistics to a CSV file
+void MenuBar::frameTraceCallback_real(Fl_Widget* w) {
+	Fl_Menu_Item* item = (Fl_Menu_Item*)mvalue();
+	if( item == NULL )
+		return;
+
+	View* view = parent->getView();
+
+	if( item->value() == 0 ) {
+		if( !view->stopFrameTrace() )
+			fl_alert( "The frame statistics couldn't all be written." );
+		return;
+	}
+
+	string filename;
+	if( !callSaveFileDialog( filename, "frames.csv", FindShareFile(""), "*.csv", "Record Frame Statistics..." ) ||
+		!view->startFrameTrace( filename.c_str() ) ) {
+		if( filename.size() > 0 )
+			fl_alert( "Couldn't write to %s", filename.c_str() );
+		item->clear();
+	}
+}
+
 // handle teleporter linking
 void MenuBar::linkCallback_real(Fl_Widget* w) {
 	// get all selected objects
@@ -561,6 +726,124 @@ void MenuBar::linkCallback_real(Fl_Widget* w) {
 	value(0);
 }
 
+// weld the selected meshes' vertices and reorder their faces for the vertex cache
+void MenuBar::optimizeMeshesCallback_real(Fl_Widget* w) {
+	value(0);
+
+	vector< mesh* > meshes;
+	Model::objRefList selection = parent->getModel()->_getSelection();
+	for( Model::objRefList::iterator i = selection.begin(); i != selection.end(); i++ ) {
+		mesh* m = dynamic_cast< mesh* >( i->get() );
+		if( m != NULL )
+			meshes.push_back( m );
+	}
+
+	if( meshes.size() == 0 ) {
+		fl_alert( "Select the meshes to optimize." );
+		return;
+	}
+
+	const char* answer = fl_input( "Weld vertices closer than:", "0.001" );
+	if( answer == NULL )
+		return;
+
+	float weldDistance = atof( answer );
+	if( weldDistance < 0.0f ) {
+		fl_alert( "The weld distance can't be negative." );
+		return;
+	}
+
+	MeshOptimizer::Report report;
+	parent->getModel()->beginBatch();
+	for( vector< mesh* >::iterator i = meshes.begin(); i != meshes.end(); i++ ) {
+		(*i)->optimize( weldDistance, report );
+
+		ObserverMessage obs( ObserverMessage::UPDATE_OBJECT, *i );
+		parent->getModel()->notifyObservers( &obs );
+	}
+	parent->getModel()->commitBatch();
+
+	string drawInfo;
+	if( report.corners[0] > 0 ) {
+		drawInfo = TextUtils::format( "\nDrawinfo corners: %u -> %u\n"
+									  "Drawinfo ACMR: %.3f -> %.3f (%u triangles)",
+									  report.corners[0], report.corners[1],
+									  report.getDrawInfoACMR( 0 ), report.getDrawInfoACMR( 1 ), report.drawInfoTriangles );
+	}
+
+	fl_message( "Meshes: %u\n"
+				"Vertices: %u -> %u\n"
+				"Normals: %u -> %u\n"
+				"Texcoords: %u -> %u\n"
+				"Faces: %u (%u dropped for bad indices)\n"
+				"ACMR: %.3f -> %.3f (%u triangles, %u-vertex cache)%s",
+				(unsigned int)meshes.size(),
+				report.vertices[0], report.vertices[1],
+				report.normals[0], report.normals[1],
+				report.texcoords[0], report.texcoords[1],
+				report.faces - report.droppedFaces, report.droppedFaces,
+				report.getFaceACMR( 0 ), report.getFaceACMR( 1 ), report.faceTriangles,
+				MeshOptimizer::CACHE_SIZE, drawInfo.c_str() );
+}
+
+void MenuBar::generateLODsCallback_real(Fl_Widget* w) {
+	value(0);
+
+	vector< mesh* > meshes;
+	bool replacing = false;
+	Model::objRefList selection = parent->getModel()->_getSelection();
+	for( Model::objRefList::iterator i = selection.begin(); i != selection.end(); i++ ) {
+		mesh* m = dynamic_cast< mesh* >( i->get() );
+		if( m != NULL ) {
+			meshes.push_back( m );
+			replacing = replacing || m->hasDrawInfo();
+		}
+	}
+
+	if( meshes.size() == 0 ) {
+		fl_alert( "Select the meshes to make levels of detail for." );
+		return;
+	}
+
+	const char* answer = fl_input( "Levels of detail (including the full mesh):", "4" );
+	if( answer == NULL )
+		return;
+
+	int levels = atoi( answer );
+	if( levels < 2 ) {
+		fl_alert( "There must be at least 2 levels of detail." );
+		return;
+	}
+
+	if( replacing && fl_choice( "Some of the meshes already have a drawinfo.  Replace it?", "Cancel", "Replace", NULL ) != 1 )
+		return;
+
+	string summary;
+	unsigned int skipped = 0;
+	vector< MeshSimplifier::Level > made;
+	parent->getModel()->beginBatch();
+	for( vector< mesh* >::iterator i = meshes.begin(); i != meshes.end(); i++ ) {
+		if( !(*i)->generateLODs( levels, made ) ) {
+			skipped++;
+			continue;
+		}
+
+		string name = (*i)->getName();
+		summary += ( name.length() > 0 ? name : string( "mesh" ) ) + ":\n";
+		for( unsigned int l = 0; l < made.size(); l++ )
+			summary += TextUtils::format( "    %u triangles from %g per pixel\n", made[l].triangles, made[l].lengthPerPixel );
+
+		ObserverMessage obs( ObserverMessage::UPDATE_OBJECT, *i );
+		parent->getModel()->notifyObservers( &obs );
+	}
+	parent->getModel()->commitBatch();
+
+	if( skipped > 0 )
+		summary += TextUtils::format( "Skipped %u mesh(es) with nothing to draw, or faces without a material.", skipped );
+
+	fl_message( "%s", summary.c_str() );
+}
+
 bz2object* MenuBar::makeObject( const char* objectName ) {
 	// make a new box using the Model's object registry
 	DataEntry* newBox = this->parent->getModel()->_buildObject( objectName );
@@ -11,6 +11,7 @@
  */
 
 #include "dialogs/SphereConfigurationDialog.h"
+#include "model/Model.h"
 
 // constructor
 SphereConfigurationDialog::SphereConfigurationDialog( sphere* _theSphere ) :
@@ -58,6 +59,9 @@ void SphereConfigurationDialog::OKCallback_real( Fl_Widget* w ) {
 	theSphere->setFlatshading( flatShadingButton->value() == 1 ? true : false );
 	theSphere->setTexsize( Point2D( texsizeXField->value(), texsizeYField->value() ) );
 	theSphere->setHemisphere( hemisphereButton->value() == 1 ? true : false );
+
+	// its shape may have changed, so the View has to find its new bounds
+	Model::updateObject( theSphere );
 	
 	// don't delete this dialog box just yet...just hide it
 	hide();
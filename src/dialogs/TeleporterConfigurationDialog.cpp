@@ -11,6 +11,7 @@
  */
 
 #include "dialogs/TeleporterConfigurationDialog.h"
+#include "model/Model.h"
 
 // constructor
 TeleporterConfigurationDialog::TeleporterConfigurationDialog( teleporter* _theTele ) :
@@ -42,6 +43,9 @@ void TeleporterConfigurationDialog::OKCallback_real( Fl_Widget* w ) {
 	// call cone-specific setters from the UI
 	theTele->setTexsize( texsizeField->value() );
 	theTele->setBorder( borderField->value() );
+
+	// its shape may have changed, so the View has to find its new bounds
+	Model::updateObject( theTele );
 	
 	// don't delete this dialog box just yet...just hide it
 	hide();
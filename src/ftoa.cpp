@@ -0,0 +1,257 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+#include "ftoa.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include <string.h>
+
+typedef unsigned int uint32;
+typedef unsigned long long uint64;
+
+// 10^-53 to 10^53, enough to scale any float (subnormals included) to 9 digits.  Only 10^0 to
+// 10^22 are exact; the rest are off by at most one rounding, which the checks below absorb.
+#define POWER_OFFSET 53
+static const double tenPowers[ 2 * POWER_OFFSET + 1 ] = {
+	1e-53, 1e-52, 1e-51, 1e-50, 1e-49, 1e-48, 1e-47, 1e-46, 1e-45, 1e-44, 1e-43, 1e-42,
+	1e-41, 1e-40, 1e-39, 1e-38, 1e-37, 1e-36, 1e-35, 1e-34, 1e-33, 1e-32, 1e-31, 1e-30,
+	1e-29, 1e-28, 1e-27, 1e-26, 1e-25, 1e-24, 1e-23, 1e-22, 1e-21, 1e-20, 1e-19, 1e-18,
+	1e-17, 1e-16, 1e-15, 1e-14, 1e-13, 1e-12, 1e-11, 1e-10, 1e-9, 1e-8, 1e-7, 1e-6,
+	1e-5, 1e-4, 1e-3, 1e-2, 1e-1, 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6,
+	1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18,
+	1e19, 1e20, 1e21, 1e22, 1e23, 1e24, 1e25, 1e26, 1e27, 1e28, 1e29, 1e30,
+	1e31, 1e32, 1e33, 1e34, 1e35, 1e36, 1e37, 1e38, 1e39, 1e40, 1e41, 1e42,
+	1e43, 1e44, 1e45, 1e46, 1e47, 1e48, 1e49, 1e50, 1e51, 1e52, 1e53
+};
+
+// a fixed-size unsigned integer, least significant limb first.  The largest value compare()
+// builds is a 30-bit mantissa times 5^53 shifted by about 210 bits, so 12 limbs are plenty.
+#define BIG_LIMBS 12
+
+struct BigInt {
+	uint32 limbs[ BIG_LIMBS ];
+
+	BigInt( uint64 value ) {
+		memset( limbs, 0, sizeof( limbs ) );
+		limbs[0] = (uint32)value;
+		limbs[1] = (uint32)( value >> 32 );
+	}
+
+	void multiply( uint32 factor ) {
+		uint64 carry = 0;
+		for( int i = 0; i < BIG_LIMBS; i++ ) {
+			uint64 product = (uint64)limbs[i] * factor + carry;
+			limbs[i] = (uint32)product;
+			carry = product >> 32;
+		}
+	}
+
+	// *= 5^power
+	void multiplyPowerOfFive( int power ) {
+		// 5^13 is the largest power of five that fits in a limb
+		for( ; power >= 13; power -= 13 )
+			multiply( 1220703125u );
+		uint32 factor = 1;
+		for( ; power > 0; power-- )
+			factor *= 5;
+		multiply( factor );
+	}
+
+	// *= 2^bits
+	void shiftLeft( int bits ) {
+		int whole = bits / 32;
+		int part = bits % 32;
+		for( int i = BIG_LIMBS - 1; i >= 0; i-- ) {
+			uint64 value = ( i - whole >= 0 ? limbs[ i - whole ] : 0 );
+			uint64 below = ( i - whole - 1 >= 0 ? limbs[ i - whole - 1 ] : 0 );
+			limbs[i] = (uint32)( ( ( value << 32 ) | below ) >> ( 32 - part ) );
+		}
+	}
+
+	int compare( const BigInt& other ) const {
+		for( int i = BIG_LIMBS - 1; i >= 0; i-- ) {
+			if( limbs[i] != other.limbs[i] )
+				return ( limbs[i] < other.limbs[i] ? -1 : 1 );
+		}
+		return 0;
+	}
+};
+
+// compare m * 10^q against n * 2^t exactly.  10^q is split into 5^q * 2^q so that only the
+// powers of five have to be multiplied out.
+static int compare( uint64 m, int q, uint64 n, int t ) {
+	BigInt left( m ), right( n );
+
+	if( q > 0 )
+		left.multiplyPowerOfFive( q );
+	if( q < 0 )
+		right.multiplyPowerOfFive( -q );
+	if( q > t )
+		left.shiftLeft( q - t );
+	if( q < t )
+		right.shiftLeft( t - q );
+
+	return left.compare( right );
+}
+
+// write m * 10^q in plain decimal notation
+static size_t writeDecimal( char* buffer, bool negative, uint64 m, int q ) {
+	// drop trailing zeros
+	while( m != 0 && m % 10 == 0 ) {
+		m /= 10;
+		q++;
+	}
+
+	char digits[24];
+	int count = 0;
+	do {
+		digits[ count++ ] = (char)( '0' + m % 10 );
+		m /= 10;
+	} while( m != 0 );
+
+	char* c = buffer;
+	if( negative )
+		*c++ = '-';
+
+	// number of digits in front of the decimal point
+	int whole = count + q;
+
+	if( whole <= 0 ) {
+		*c++ = '0';
+		*c++ = '.';
+		for( int i = 0; i < -whole; i++ )
+			*c++ = '0';
+		for( int i = count - 1; i >= 0; i-- )
+			*c++ = digits[i];
+	}
+	else {
+		for( int i = count - 1; i >= 0; i-- ) {
+			if( count - 1 - i == whole )
+				*c++ = '.';
+			*c++ = digits[i];
+		}
+		for( int i = 0; i < q; i++ )
+			*c++ = '0';
+	}
+
+	*c = 0;
+	return c - buffer;
+}
+
+size_t formatFloat( char* buffer, float f ) {
+	// not a number, or infinite
+	if( f != f || f > FLT_MAX || f < -FLT_MAX ) {
+		sprintf( buffer, "%f", f );
+		return strlen( buffer );
+	}
+
+	if( f == 0.0f ) {
+		buffer[0] = '0';
+		buffer[1] = 0;
+		return 1;
+	}
+
+	bool negative = ( f < 0.0f );
+	float a = ( negative ? -f : f );
+
+	// a = mantissa * 2^exponent exactly, with a 24-bit mantissa (fewer bits for subnormals,
+	// which all share the smallest exponent)
+	int exponent;
+	frexp( (double)a, &exponent );
+	exponent -= 24;
+	if( exponent < FLT_MIN_EXP - 24 )
+		exponent = FLT_MIN_EXP - 24;
+	uint64 mantissa = (uint64)ldexp( (double)a, -exponent );
+
+	// any decimal strictly between these (or on them, when the mantissa is even) reads back as a:
+	// low = lowN * 2^lowT, high = highN * 2^highT
+	uint64 highN = 2 * mantissa + 1;
+	int highT = exponent - 1;
+	uint64 lowN = 2 * mantissa - 1;
+	int lowT = exponent - 1;
+	bool closerBelow = ( mantissa == ( 1ULL << 23 ) && exponent > FLT_MIN_EXP - 24 );
+	if( closerBelow ) {
+		// the next float down has a smaller exponent, so it's closer
+		lowN = 4 * mantissa - 1;
+		lowT = exponent - 2;
+	}
+	bool even = ( mantissa % 2 == 0 );
+
+	int decimalExponent = (int)floor( log10( (double)a ) );
+
+	// try 1, 2, 3... significant digits; 9 always identify a float
+	for( int digits = 1; digits <= 9; digits++ ) {
+		int scale = digits - 1 - decimalExponent;
+		if( scale > POWER_OFFSET || scale < -POWER_OFFSET )
+			break;
+
+		double scaled = (double)a * tenPowers[ scale + POWER_OFFSET ];
+		uint64 nearest = (uint64)floor( scaled + 0.5 );
+
+		// distance from a to the edges of its interval, in units of the last digit
+		double highRoom = scaled / (double)mantissa / 2.0;
+		double lowRoom = ( closerBelow ? highRoom / 2.0 : highRoom );
+
+		// the doubles are good enough to place the nearest candidate unless it sits right on an
+		// edge.  While the interval is narrower than one digit, no other candidate can be in it.
+		double slack = scaled * 1e-12;
+		if( nearest != 0 ) {
+			double offset = scaled - (double)nearest;
+			double room = ( offset > 0.0 ? lowRoom - offset : highRoom + offset );
+			if( room > slack )
+				return writeDecimal( buffer, negative, nearest, -scale );
+			if( room < -slack && highRoom + slack < 0.5 )
+				continue;
+		}
+
+		// too close to call.  The scaled value was rounded, so the right candidate might be a neighbor.
+		uint64 candidates[3] = { nearest, nearest - 1, nearest + 1 };
+		for( int i = 0; i < 3; i++ ) {
+			uint64 m = candidates[i];
+			if( m == 0 )
+				continue;
+
+			int low = compare( m, -scale, lowN, lowT );
+			int high = compare( m, -scale, highN, highT );
+			if( ( low > 0 || ( low == 0 && even ) ) && ( high < 0 || ( high == 0 && even ) ) )
+				return writeDecimal( buffer, negative, m, -scale );
+		}
+	}
+
+	// not reached
+	sprintf( buffer, "%.9g", f );
+	return strlen( buffer );
+}
+
+size_t formatInt( char* buffer, int i ) {
+	char digits[16];
+	int count = 0;
+
+	// work with the magnitude as unsigned so INT_MIN survives
+	unsigned int u = ( i < 0 ? 0u - (unsigned int)i : (unsigned int)i );
+	do {
+		digits[ count++ ] = (char)( '0' + u % 10 );
+		u /= 10;
+	} while( u != 0 );
+
+	char* c = buffer;
+	if( i < 0 )
+		*c++ = '-';
+	while( count > 0 )
+		*c++ = digits[ --count ];
+
+	*c = 0;
+	return c - buffer;
+}
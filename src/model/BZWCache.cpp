@@ -0,0 +1,684 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "model/BZWCache.h"
+
+#include "model/BZWWriter.h"
+#include "model/Model.h"
+#include "TextUtils.h"
+
+#include "objects/bz2object.h"
+#include "objects/box.h"
+#include "objects/define.h"
+#include "objects/dynamicColor.h"
+#include "objects/info.h"
+#include "objects/link.h"
+#include "objects/material.h"
+#include "objects/options.h"
+#include "objects/physics.h"
+#include "objects/pyramid.h"
+#include "objects/texturematrix.h"
+#include "objects/waterLevel.h"
+#include "objects/world.h"
+
+#include <string.h>
+#include <map>
+
+using namespace std;
+
+typedef unsigned int uint32;
+typedef unsigned long long uint64;
+
+// bump this whenever the layout below, or the text Model::toString() writes, changes
+#define CACHE_VERSION 2
+
+// written as-is, so a cache from a machine with the other byte order won't match
+#define CACHE_BYTE_ORDER 0x01020304
+
+// what an object record holds
+enum {
+	OBJECT_TEXT = 0,	// the object is in the text
+	OBJECT_BOX,
+	OBJECT_PYRAMID,
+	OBJECT_TYPES
+};
+
+// object flags
+#define OBJECT_DRIVETHROUGH		0x01
+#define OBJECT_SHOOTTHROUGH		0x02
+#define OBJECT_FLIPZ			0x04
+
+// face flags
+#define FACE_DRIVETHROUGH		0x01
+#define FACE_SHOOTTHROUGH		0x02
+#define FACE_RICOCHET			0x04
+
+// what a reference points to
+enum {
+	REFERENCE_MATERIAL = 0,
+	REFERENCE_PHYDRV,
+	REFERENCE_TYPES
+};
+
+// the file starts with this, and the tables follow in the order of their counts below.  Every
+// record is a multiple of 4 bytes, so the tables stay aligned inside the mapping.
+struct BZWCache::Header {
+	char magic[4];				// "BZWC"
+	uint32 version;
+	uint32 byteOrder;
+	uint32 objectCount;
+	uint64 sourceHash;
+	uint64 sourceLength;
+	uint64 contentHash;			// of everything after the header
+	uint32 transformCount;
+	uint32 slotCount;
+	uint32 faceCount;
+	uint32 referenceCount;
+	uint32 stringCount;
+	uint32 padding;
+	uint64 stringDataLength;
+	uint64 textLength;
+};
+
+// one per object in the Model, in order
+struct BZWCache::Object {
+	uint32 type;
+	uint32 name;				// string
+	float position[3];
+	float rotation;
+	float size[3];
+	uint32 flags;
+	uint32 firstTransform;
+	uint32 transformCount;
+	uint32 firstSlot;
+	uint32 slotCount;
+	uint32 firstFace;			// box::FaceCount of them (boxes only)
+};
+
+struct BZWCache::Transform {
+	uint32 type;				// TransformType
+	float data[4];
+};
+
+// a physics driver or material in one of an object's slots
+struct BZWCache::Slot {
+	uint32 slot;				// string
+	uint32 reference;
+};
+
+struct BZWCache::Face {
+	float texsize[2];
+	float texoffset[2];
+	uint32 flags;
+};
+
+// a material or physics driver, by name
+struct BZWCache::Reference {
+	uint32 type;
+	uint32 name;				// string
+};
+
+// a run of the string data
+struct BZWCache::String {
+	uint32 offset;
+	uint32 length;
+};
+
+struct BZWCache::Tables {
+	vector< Object > objects;
+	vector< Transform > transforms;
+	vector< Slot > slots;
+	vector< Face > faces;
+	vector< Reference > references;
+	vector< String > strings;
+	string stringData;
+
+	// what has been added so far, and where
+	map< string, uint32 > stringIndex;
+	map< DataEntry*, uint32 > referenceIndex;
+	vector< DataEntry* > referenced;
+
+	uint32 addString( const string& str ) {
+		map< string, uint32 >::iterator i = stringIndex.find( str );
+		if( i != stringIndex.end() )
+			return i->second;
+
+		String entry;
+		entry.offset = (uint32)stringData.size();
+		entry.length = (uint32)str.size();
+		stringData += str;
+
+		strings.push_back( entry );
+		stringIndex[ str ] = (uint32)( strings.size() - 1 );
+		return (uint32)( strings.size() - 1 );
+	}
+
+	uint32 addReference( DataEntry* entry, uint32 type, const string& name ) {
+		map< DataEntry*, uint32 >::iterator i = referenceIndex.find( entry );
+		if( i != referenceIndex.end() )
+			return i->second;
+
+		Reference ref;
+		ref.type = type;
+		ref.name = addString( name );
+
+		references.push_back( ref );
+		referenced.push_back( entry );
+		referenceIndex[ entry ] = (uint32)( references.size() - 1 );
+		return (uint32)( references.size() - 1 );
+	}
+};
+
+// append a table's records to the file contents
+template< class T > static void appendTable( string& out, const vector< T >& table ) {
+	if( table.size() > 0 )
+		out.append( (const char*)&table[0], table.size() * sizeof( T ) );
+}
+
+BZWCache::BZWCache() {
+	objects = NULL;
+	objectCount = 0;
+	transforms = NULL;
+	transformCount = 0;
+	slots = NULL;
+	slotCount = 0;
+	faces = NULL;
+	faceCount = 0;
+	references = NULL;
+	referenceCount = 0;
+	strings = NULL;
+	stringCount = 0;
+	stringData = NULL;
+	stringDataLength = 0;
+	text = NULL;
+	textLength = 0;
+}
+
+string BZWCache::fileNameFor( const char* worldFile ) {
+	// world.bzw -> world.bzwc
+	return string( worldFile ) + "c";
+}
+
+bool BZWCache::encode( bz2object* obj, Tables& tables ) {
+	Object record;
+	memset( &record, 0, sizeof( record ) );
+	record.type = OBJECT_TEXT;
+
+	box* boxObj = NULL;
+	pyramid* pyramidObj = NULL;
+	uint32 type = OBJECT_TEXT;
+
+	if( obj->getHeader() == "box" && ( boxObj = dynamic_cast< box* >( obj ) ) != NULL )
+		type = OBJECT_BOX;
+	else if( obj->getHeader() == "pyramid" && ( pyramidObj = dynamic_cast< pyramid* >( obj ) ) != NULL )
+		type = OBJECT_PYRAMID;
+
+	// lines the object didn't understand only survive in its text
+	if( type == OBJECT_TEXT || obj->getText().size() > 0 ) {
+		tables.objects.push_back( record );
+		return false;
+	}
+
+	// the physics drivers and materials, which have to be ones the Model can find by name again
+	// (materials set right in the object are written out in full, so those stay as text)
+	vector< pair< string, physics* > > phydrvs;
+	vector< pair< string, material* > > materials;
+
+	for( map< string, bz2object::PhysicsSlot >::iterator i = obj->physicsSlots.begin(); i != obj->physicsSlots.end(); i++ ) {
+		physics* phydrv = i->second.phydrv.get();
+		if( phydrv == NULL )
+			continue;
+
+		if( Model::command( MODEL_GET, "phydrv", phydrv->getName() ) != phydrv ) {
+			tables.objects.push_back( record );
+			return false;
+		}
+		phydrvs.push_back( make_pair( i->first, phydrv ) );
+	}
+
+	for( map< string, bz2object::MaterialSlot >::iterator i = obj->materialSlots.begin(); i != obj->materialSlots.end(); i++ ) {
+		for( vector< material* >::iterator j = i->second.materials.begin(); j != i->second.materials.end(); j++ ) {
+			if( *j == NULL )
+				continue;
+
+			if( (*j)->getMatType() != material::MAT_REF || Model::command( MODEL_GET, "material", (*j)->getName() ) != *j ) {
+				tables.objects.push_back( record );
+				return false;
+			}
+			materials.push_back( make_pair( i->first, *j ) );
+		}
+	}
+
+	record.type = type;
+	record.name = tables.addString( obj->getName() );
+
+	osg::Vec3 position = obj->orientation->getPosition();
+	osg::Vec3 size = obj->getSize();
+	for( int i = 0; i < 3; i++ ) {
+		record.position[i] = position[i];
+		record.size[i] = size[i];
+	}
+	record.rotation = obj->orientation->getRotation().z();
+
+	if( obj->drivethrough )
+		record.flags |= OBJECT_DRIVETHROUGH;
+	if( obj->shootthrough )
+		record.flags |= OBJECT_SHOOTTHROUGH;
+	if( pyramidObj != NULL && pyramidObj->getFlipz() )
+		record.flags |= OBJECT_FLIPZ;
+
+	vector< TransformData > data = obj->transformations->getData();
+	record.firstTransform = (uint32)tables.transforms.size();
+	record.transformCount = (uint32)data.size();
+	for( vector< TransformData >::iterator i = data.begin(); i != data.end(); i++ ) {
+		Transform transform;
+		transform.type = (uint32)i->type;
+		for( int j = 0; j < 4; j++ )
+			transform.data[j] = i->data[j];
+		tables.transforms.push_back( transform );
+	}
+
+	// physics drivers first, then materials, each in slot order (the order they're written out in)
+	record.firstSlot = (uint32)tables.slots.size();
+	record.slotCount = (uint32)( phydrvs.size() + materials.size() );
+	for( vector< pair< string, physics* > >::iterator i = phydrvs.begin(); i != phydrvs.end(); i++ ) {
+		Slot slot;
+		slot.slot = tables.addString( i->first );
+		slot.reference = tables.addReference( i->second, REFERENCE_PHYDRV, i->second->getName() );
+		tables.slots.push_back( slot );
+	}
+	for( vector< pair< string, material* > >::iterator i = materials.begin(); i != materials.end(); i++ ) {
+		Slot slot;
+		slot.slot = tables.addString( i->first );
+		slot.reference = tables.addReference( i->second, REFERENCE_MATERIAL, i->second->getName() );
+		tables.slots.push_back( slot );
+	}
+
+	if( boxObj != NULL ) {
+		record.firstFace = (uint32)tables.faces.size();
+		for( int i = 0; i < box::FaceCount; i++ ) {
+			Face face;
+			Point2D texsize = boxObj->getTexsize( i );
+			Point2D texoffset = boxObj->getTexoffset( i );
+			face.texsize[0] = texsize.x();
+			face.texsize[1] = texsize.y();
+			face.texoffset[0] = texoffset.x();
+			face.texoffset[1] = texoffset.y();
+			face.flags = 0;
+			if( boxObj->getDrivethrough( i ) )
+				face.flags |= FACE_DRIVETHROUGH;
+			if( boxObj->getShootthrough( i ) )
+				face.flags |= FACE_SHOOTTHROUGH;
+			if( boxObj->getRicochet( i ) )
+				face.flags |= FACE_RICOCHET;
+			tables.faces.push_back( face );
+		}
+	}
+
+	tables.objects.push_back( record );
+	return true;
+}
+
+bool BZWCache::write( const char* filename, unsigned long long sourceHash, size_t sourceLength ) {
+	Tables tables;
+
+	Model::objRefList& objs = Model::getObjects();
+	for( Model::objRefList::iterator i = objs.begin(); i != objs.end(); i++ )
+		encode( i->get(), tables );
+
+	// check each record by decoding it into a spare object of its type; any that doesn't come
+	// back out as the same text is kept as text instead
+	BZWCache check;
+	check.objects = tables.objects.empty() ? NULL : &tables.objects[0];
+	check.objectCount = tables.objects.size();
+	check.transforms = tables.transforms.empty() ? NULL : &tables.transforms[0];
+	check.transformCount = tables.transforms.size();
+	check.slots = tables.slots.empty() ? NULL : &tables.slots[0];
+	check.slotCount = tables.slots.size();
+	check.faces = tables.faces.empty() ? NULL : &tables.faces[0];
+	check.faceCount = tables.faces.size();
+	check.references = tables.references.empty() ? NULL : &tables.references[0];
+	check.referenceCount = tables.references.size();
+	check.strings = tables.strings.empty() ? NULL : &tables.strings[0];
+	check.stringCount = tables.strings.size();
+	check.stringData = tables.stringData.data();
+	check.stringDataLength = tables.stringData.size();
+	check.resolved = tables.referenced;
+
+	osg::ref_ptr< bz2object > spare[ OBJECT_TYPES ];
+	for( size_t i = 0; i < tables.objects.size(); i++ ) {
+		Object& record = tables.objects[i];
+		if( record.type == OBJECT_TEXT )
+			continue;
+
+		if( !spare[ record.type ].valid() )
+			spare[ record.type ] = (bz2object*)Model::buildObject( record.type == OBJECT_BOX ? "box" : "pyramid" );
+
+		bz2object* obj = spare[ record.type ].get();
+		if( obj == NULL || !check.decode( i, obj ) || obj->toString() != objs[i]->toString() )
+			record.type = OBJECT_TEXT;
+	}
+
+	// everything else goes in as text, in the order Model::_write() puts it (so everything an
+	// object refers to by name comes before it, and links come after the teleporters)
+	string worldText;
+
+	if( Model::getInfoData() != NULL )
+		worldText += Model::getInfoData()->toString() + "\n";
+	if( Model::getWorldData() != NULL )
+		worldText += Model::getWorldData()->toString() + "\n";
+	if( Model::getOptionsData() != NULL )
+		worldText += Model::getOptionsData()->toString() + "\n";
+	if( Model::getWaterLevelData() != NULL && Model::getWaterLevelData()->getHeight() > 0.0 )
+		worldText += Model::getWaterLevelData()->toString() + "\n";
+
+	map< string, osg::ref_ptr< physics > >& phydrvs = Model::getPhysicsDrivers();
+	for( map< string, osg::ref_ptr< physics > >::iterator i = phydrvs.begin(); i != phydrvs.end(); i++ )
+		worldText += i->second->toString() + "\n";
+
+	map< string, dynamicColor* >& dynamicColors = Model::getDynamicColors();
+	for( map< string, dynamicColor* >::iterator i = dynamicColors.begin(); i != dynamicColors.end(); i++ )
+		worldText += i->second->toString() + "\n";
+
+	map< string, texturematrix* >& textureMatrices = Model::getTextureMatrices();
+	for( map< string, texturematrix* >::iterator i = textureMatrices.begin(); i != textureMatrices.end(); i++ )
+		worldText += i->second->toString() + "\n";
+
+	map< string, osg::ref_ptr< material > >& materials = Model::getMaterials();
+	for( map< string, osg::ref_ptr< material > >::iterator i = materials.begin(); i != materials.end(); i++ )
+		worldText += i->second->toString() + "\n";
+
+	map< string, define* >& groups = Model::getGroups();
+	for( map< string, define* >::iterator i = groups.begin(); i != groups.end(); i++ )
+		worldText += i->second->toString() + "\n";
+
+	for( size_t i = 0; i < tables.objects.size(); i++ ) {
+		if( tables.objects[i].type == OBJECT_TEXT )
+			worldText += objs[i]->toString() + "\n";
+	}
+
+	map< string, osg::ref_ptr< Tlink > >& links = Model::getTeleporterLinks();
+	for( map< string, osg::ref_ptr< Tlink > >::iterator i = links.begin(); i != links.end(); i++ )
+		worldText += i->second->toString() + "\n";
+
+	// lay out the file
+	string contents;
+	appendTable( contents, tables.objects );
+	appendTable( contents, tables.transforms );
+	appendTable( contents, tables.slots );
+	appendTable( contents, tables.faces );
+	appendTable( contents, tables.references );
+	appendTable( contents, tables.strings );
+	contents += tables.stringData;
+	contents += worldText;
+
+	Header header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, "BZWC", 4 );
+	header.version = CACHE_VERSION;
+	header.byteOrder = CACHE_BYTE_ORDER;
+	header.objectCount = (uint32)tables.objects.size();
+	header.sourceHash = sourceHash;
+	header.sourceLength = sourceLength;
+	header.contentHash = TextUtils::hash( contents.data(), contents.data() + contents.size() );
+	header.transformCount = (uint32)tables.transforms.size();
+	header.slotCount = (uint32)tables.slots.size();
+	header.faceCount = (uint32)tables.faces.size();
+	header.referenceCount = (uint32)tables.references.size();
+	header.stringCount = (uint32)tables.strings.size();
+	header.stringDataLength = tables.stringData.size();
+	header.textLength = worldText.size();
+
+	// write it atomically, so a crash never leaves a half-written cache behind
+	BZWWriter out;
+	if( !out.open( filename ) )
+		return false;
+
+	out.write( (const char*)&header, sizeof( header ) );
+	out.write( contents );
+
+	return out.close();
+}
+
+bool BZWCache::open( const char* filename, unsigned long long sourceHash, size_t sourceLength ) {
+	close();
+
+	if( !file.open( filename ) )
+		return false;
+
+	const char* data = file.begin();
+	uint64 size = file.size();
+
+	if( size < sizeof( Header ) ) {
+		close();
+		return false;
+	}
+
+	const Header* header = (const Header*)data;
+	if( memcmp( header->magic, "BZWC", 4 ) != 0 || header->version != CACHE_VERSION || header->byteOrder != CACHE_BYTE_ORDER ||
+		header->sourceHash != sourceHash || header->sourceLength != sourceLength ) {
+		close();
+		return false;
+	}
+
+	// the pieces have to add up to the whole file (the counts are 32 bits, so none of this overflows)
+	uint64 tablesLength = (uint64)header->objectCount * sizeof( Object ) +
+						  (uint64)header->transformCount * sizeof( Transform ) +
+						  (uint64)header->slotCount * sizeof( Slot ) +
+						  (uint64)header->faceCount * sizeof( Face ) +
+						  (uint64)header->referenceCount * sizeof( Reference ) +
+						  (uint64)header->stringCount * sizeof( String );
+	if( tablesLength > size || header->stringDataLength > size || header->textLength > size ||
+		sizeof( Header ) + tablesLength + header->stringDataLength + header->textLength != size ) {
+		close();
+		return false;
+	}
+
+	// and they have to be what was written
+	if( TextUtils::hash( data + sizeof( Header ), file.end() ) != header->contentHash ) {
+		close();
+		return false;
+	}
+
+	const char* next = data + sizeof( Header );
+
+	objects = (const Object*)next;
+	objectCount = header->objectCount;
+	next += objectCount * sizeof( Object );
+
+	transforms = (const Transform*)next;
+	transformCount = header->transformCount;
+	next += transformCount * sizeof( Transform );
+
+	slots = (const Slot*)next;
+	slotCount = header->slotCount;
+	next += slotCount * sizeof( Slot );
+
+	faces = (const Face*)next;
+	faceCount = header->faceCount;
+	next += faceCount * sizeof( Face );
+
+	references = (const Reference*)next;
+	referenceCount = header->referenceCount;
+	next += referenceCount * sizeof( Reference );
+
+	strings = (const String*)next;
+	stringCount = header->stringCount;
+	next += stringCount * sizeof( String );
+
+	stringData = next;
+	stringDataLength = (size_t)header->stringDataLength;
+	next += stringDataLength;
+
+	text = next;
+	textLength = (size_t)header->textLength;
+
+	// make sure everything the records point at is inside the file
+	bool valid = true;
+
+	for( size_t i = 0; i < stringCount && valid; i++ )
+		valid = (uint64)strings[i].offset + strings[i].length <= stringDataLength;
+
+	for( size_t i = 0; i < referenceCount && valid; i++ )
+		valid = references[i].type < REFERENCE_TYPES && references[i].name < stringCount;
+
+	for( size_t i = 0; i < slotCount && valid; i++ )
+		valid = slots[i].slot < stringCount && slots[i].reference < referenceCount;
+
+	for( size_t i = 0; i < transformCount && valid; i++ )
+		valid = transforms[i].type <= SpinTransform;
+
+	for( size_t i = 0; i < objectCount && valid; i++ ) {
+		const Object& record = objects[i];
+		if( record.type == OBJECT_TEXT )
+			continue;
+
+		valid = record.type < OBJECT_TYPES && record.name < stringCount &&
+				(uint64)record.firstTransform + record.transformCount <= transformCount &&
+				(uint64)record.firstSlot + record.slotCount <= slotCount &&
+				( record.type != OBJECT_BOX || (uint64)record.firstFace + box::FaceCount <= faceCount );
+	}
+
+	if( !valid ) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void BZWCache::close() {
+	file.close();
+
+	objects = NULL;
+	objectCount = 0;
+	transforms = NULL;
+	transformCount = 0;
+	slots = NULL;
+	slotCount = 0;
+	faces = NULL;
+	faceCount = 0;
+	references = NULL;
+	referenceCount = 0;
+	strings = NULL;
+	stringCount = 0;
+	stringData = NULL;
+	stringDataLength = 0;
+	text = NULL;
+	textLength = 0;
+	resolved.clear();
+}
+
+bool BZWCache::isTextObject( size_t index ) {
+	return objects[ index ].type == OBJECT_TEXT;
+}
+
+string BZWCache::getString( unsigned int index ) {
+	return string( stringData + strings[ index ].offset, strings[ index ].length );
+}
+
+bool BZWCache::resolveReferences() {
+	resolved.assign( referenceCount, (DataEntry*)NULL );
+
+	for( size_t i = 0; i < referenceCount; i++ ) {
+		DataEntry* entry = Model::command( MODEL_GET, references[i].type == REFERENCE_PHYDRV ? "phydrv" : "material", getString( references[i].name ) );
+		if( entry == NULL )
+			return false;
+
+		resolved[i] = entry;
+	}
+
+	return true;
+}
+
+osg::ref_ptr< bz2object > BZWCache::buildObject( size_t index ) {
+	const Object& record = objects[ index ];
+	if( record.type == OBJECT_TEXT || resolved.size() != referenceCount )
+		return NULL;
+
+	osg::ref_ptr< bz2object > obj = (bz2object*)Model::buildObject( record.type == OBJECT_BOX ? "box" : "pyramid" );
+	if( !obj.valid() || !decode( index, obj.get() ) )
+		return NULL;
+
+	return obj;
+}
+
+// this sets the same fields parse() would, so the object is finalized the same way afterwards
+bool BZWCache::decode( size_t index, bz2object* obj ) {
+	const Object& record = objects[ index ];
+
+	obj->osg::Object::setName( getString( record.name ) );
+	obj->orientation->setPosition( osg::Vec3( record.position[0], record.position[1], record.position[2] ) );
+	obj->orientation->setRotationZ( record.rotation );
+	obj->bz2object::setSize( osg::Vec3( record.size[0], record.size[1], record.size[2] ) );
+	obj->drivethrough = ( record.flags & OBJECT_DRIVETHROUGH ) != 0;
+	obj->shootthrough = ( record.flags & OBJECT_SHOOTTHROUGH ) != 0;
+
+	vector< TransformData > data( record.transformCount );
+	for( uint32 i = 0; i < record.transformCount; i++ ) {
+		const Transform& transform = transforms[ record.firstTransform + i ];
+		data[i].type = (TransformType)transform.type;
+		data[i].data.set( transform.data[0], transform.data[1], transform.data[2], transform.data[3] );
+	}
+	obj->transformations->setData( data );
+
+	// start from empty slots, so the same object can be decoded into again
+	for( map< string, bz2object::PhysicsSlot >::iterator i = obj->physicsSlots.begin(); i != obj->physicsSlots.end(); i++ )
+		i->second.phydrv = NULL;
+	for( map< string, bz2object::MaterialSlot >::iterator i = obj->materialSlots.begin(); i != obj->materialSlots.end(); i++ )
+		i->second.materials.clear();
+
+	for( uint32 i = 0; i < record.slotCount; i++ ) {
+		const Slot& slot = slots[ record.firstSlot + i ];
+		string slotName = getString( slot.slot );
+
+		if( references[ slot.reference ].type == REFERENCE_PHYDRV ) {
+			map< string, bz2object::PhysicsSlot >::iterator s = obj->physicsSlots.find( slotName );
+			if( s == obj->physicsSlots.end() )
+				return false;
+
+			s->second.phydrv = (physics*)resolved[ slot.reference ];
+		}
+		else {
+			map< string, bz2object::MaterialSlot >::iterator s = obj->materialSlots.find( slotName );
+			if( s == obj->materialSlots.end() )
+				return false;
+
+			s->second.materials.push_back( (material*)resolved[ slot.reference ] );
+		}
+	}
+
+	if( record.type == OBJECT_BOX ) {
+		box* boxObj = dynamic_cast< box* >( obj );
+		if( boxObj == NULL )
+			return false;
+
+		for( int i = 0; i < box::FaceCount; i++ ) {
+			const Face& face = faces[ record.firstFace + i ];
+			boxObj->setTexsize( i, Point2D( face.texsize[0], face.texsize[1] ) );
+			boxObj->setTexoffset( i, Point2D( face.texoffset[0], face.texoffset[1] ) );
+			boxObj->setDrivethrough( i, ( face.flags & FACE_DRIVETHROUGH ) != 0 );
+			boxObj->setShootthrough( i, ( face.flags & FACE_SHOOTTHROUGH ) != 0 );
+			boxObj->setRicochet( i, ( face.flags & FACE_RICOCHET ) != 0 );
+		}
+	}
+	else if( record.type == OBJECT_PYRAMID ) {
+		pyramid* pyramidObj = dynamic_cast< pyramid* >( obj );
+		if( pyramidObj == NULL )
+			return false;
+
+		// the geometry is turned over in finalize()
+		pyramidObj->flipz = ( record.flags & OBJECT_FLIPZ ) != 0;
+	}
+
+	return true;
+}
@@ -0,0 +1,230 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+#include "model/BZWLoader.h"
+#include "model/BZWCache.h"
+#include "model/BZWParser.h"
+#include "TextUtils.h"
+
+#include "objects/bz2object.h"
+#include "objects/world.h"
+
+#include <osg/Timer>
+#include <OpenThreads/Thread>
+
+using namespace std;
+
+// objects per batch:  enough to keep a worker busy for a while, few enough to show up promptly
+#define BATCH_SIZE 256
+
+BZWLoader::BZWLoader( Model* _model ) {
+	model = _model;
+	nextSection = 0;
+	nextBatch = nextAdd = 0;
+	outstanding = 0;
+	cancelled = false;
+	done = false;
+	success = false;
+	loaded = 0;
+}
+
+BZWLoader::~BZWLoader() {
+	if( !done )
+		cancel();
+}
+
+bool BZWLoader::start( const char* _filename ) {
+	filename = _filename;
+
+	if( !file.open( _filename ) ) {
+		printf("BZWLoader::start(): Error! Could not open %s\n", _filename);
+		done = true;
+		return false;
+	}
+
+	// a world with an up-to-date cache next to it is rebuilt from that in one go
+	if( BZWParser::getUseCache() ) {
+		BZWCache cache;
+		if( cache.open( BZWCache::fileNameFor( _filename ).c_str(), TextUtils::hash( file.begin(), file.end() ), file.size() ) &&
+			model->_build( cache ) ) {
+			loaded = model->_getObjects().size();
+			success = true;
+			done = true;
+			file.close();
+			return true;
+		}
+	}
+
+	model->_splitSections( file.begin(), file.end(), sections );
+
+	model->_beginBuild( sections, objectSections, linkSections );
+
+	return true;
+}
+
+void BZWLoader::Batch::run() {
+	if( !loader->cancelled ) {
+		for( vector< Model::ParseJob >::iterator i = jobs.begin(); i != jobs.end(); i++ )
+			Model::parseJob( *i );
+	}
+
+	loader->parsed.push( this );
+}
+
+bool BZWLoader::step( double seconds ) {
+	if( done )
+		return false;
+
+	osg::Timer* timer = osg::Timer::instance();
+	osg::Timer_t startTime = timer->tick();
+
+	// keep a couple of batches per worker out, so none of them runs dry between steps
+	unsigned int maxOutstanding = 2 * WorkerPool::getSharedPool()->getThreadCount() + 1;
+
+	while( timer->delta_s( startTime, timer->tick() ) < seconds ) {
+		// sort out what the workers have finished
+		for( Batch* batch = parsed.takeAll(); batch != NULL; ) {
+			Batch* next = batch->next;
+			waiting[ batch->index ] = batch;
+			batch = next;
+		}
+
+		// add the next batch in file order, if it's in
+		map< unsigned int, Batch* >::iterator w = waiting.find( nextAdd );
+		if( w != waiting.end() ) {
+			Batch* batch = w->second;
+			waiting.erase( w );
+			nextAdd++;
+			outstanding--;
+
+			add( batch );
+			continue;
+		}
+
+		// send out more work
+		if( nextSection < objectSections.size() && outstanding < maxOutstanding ) {
+			dispatch();
+			continue;
+		}
+
+		// all done?
+		if( nextSection == objectSections.size() && outstanding == 0 ) {
+			finish();
+			return false;
+		}
+
+		// waiting on the workers; let the main thread get on with other things in the meantime
+		break;
+	}
+
+	return true;
+}
+
+void BZWLoader::dispatch() {
+	Batch* batch = new Batch();
+	batch->loader = this;
+	batch->index = nextBatch++;
+	batch->next = NULL;
+
+	size_t count = objectSections.size() - nextSection;
+	if( count > BATCH_SIZE )
+		count = BATCH_SIZE;
+
+	batch->jobs.resize( count );
+	for( size_t i = 0; i < count; i++ )
+		model->_buildJob( *objectSections[ nextSection++ ], batch->jobs[i] );
+
+	outstanding++;
+	WorkerPool::getSharedPool()->add( batch );
+}
+
+void BZWLoader::add( Batch* batch ) {
+	Model::objRefList built;
+	built.reserve( batch->jobs.size() );
+
+	for( vector< Model::ParseJob >::iterator i = batch->jobs.begin(); i != batch->jobs.end(); i++ ) {
+		if( model->_finishJob( *i ) )
+			built.push_back( i->object );
+	}
+
+	model->_addObjects( built );
+	loaded += batch->jobs.size();
+
+	delete batch;
+}
+
+void BZWLoader::finish() {
+	success = model->_endBuild( linkSections );
+	done = true;
+
+	// cache a world that loaded cleanly, so it opens faster next time
+	if( success && BZWParser::getUseCache() )
+		BZWCache::write( BZWCache::fileNameFor( filename.c_str() ).c_str(), TextUtils::hash( file.begin(), file.end() ), file.size() );
+
+	sections.clear();
+	objectSections.clear();
+	linkSections.clear();
+	file.close();
+}
+
+void BZWLoader::cancel() {
+	if( done )
+		return;
+
+	cancelled = true;
+	drain();
+
+	done = true;
+	success = false;
+
+	sections.clear();
+	objectSections.clear();
+	linkSections.clear();
+	file.close();
+
+	// start over with an empty world
+	model->_newWorld();
+	ObserverMessage obs( ObserverMessage::UPDATE_WORLD, model->_getWorldData() );
+	model->notifyObservers( &obs );
+}
+
+void BZWLoader::drain() {
+	// every batch that went out comes back through the queue exactly once, so wait for this
+	// loader's own and leave whatever else is on the pool alone.  The workers skip the parsing
+	// once the load is cancelled, so this doesn't take long.
+	while( true ) {
+		for( Batch* batch = parsed.takeAll(); batch != NULL; ) {
+			Batch* next = batch->next;
+			waiting[ batch->index ] = batch;
+			batch = next;
+		}
+
+		if( waiting.size() >= outstanding )
+			break;
+
+		OpenThreads::Thread::YieldCurrentThread();
+	}
+
+	for( map< unsigned int, Batch* >::iterator i = waiting.begin(); i != waiting.end(); i++ )
+		delete i->second;
+	waiting.clear();
+
+	outstanding = 0;
+}
+
+float BZWLoader::getProgress() {
+	if( done || objectSections.size() == 0 )
+		return 1.0f;
+
+	return (float)loaded / (float)objectSections.size();
+}
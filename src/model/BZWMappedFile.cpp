@@ -0,0 +1,170 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "model/BZWMappedFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#else
+  #include <sys/types.h>
+  #include <sys/stat.h>
+  #include <sys/mman.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+BZWMappedFile::BZWMappedFile() {
+	data = NULL;
+	length = 0;
+	isEmpty = false;
+	buffer = NULL;
+
+#ifdef _WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = NULL;
+#endif
+}
+
+BZWMappedFile::~BZWMappedFile() {
+	close();
+}
+
+// read the whole file into a heap buffer (used when the file can't be mapped)
+static char* readWholeFile( const char* filename, size_t& length ) {
+	FILE* fp = fopen( filename, "rb" );
+	if( fp == NULL )
+		return NULL;
+
+	fseek( fp, 0, SEEK_END );
+	long size = ftell( fp );
+	fseek( fp, 0, SEEK_SET );
+
+	if( size < 0 ) {
+		fclose( fp );
+		return NULL;
+	}
+
+	char* ret = (char*)malloc( size > 0 ? size : 1 );
+	if( ret == NULL ) {
+		fclose( fp );
+		return NULL;
+	}
+
+	length = fread( ret, 1, size, fp );
+	fclose( fp );
+
+	return ret;
+}
+
+bool BZWMappedFile::open( const char* filename ) {
+	close();
+
+	if( filename == NULL )
+		return false;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if( file == INVALID_HANDLE_VALUE )
+		return false;
+
+	DWORD sizeHigh = 0;
+	DWORD sizeLow = GetFileSize( file, &sizeHigh );
+	size_t size = (size_t)sizeLow;
+
+	if( size == 0 && sizeHigh == 0 ) {
+		CloseHandle( file );
+		isEmpty = true;
+		return true;
+	}
+
+	HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	if( mapping != NULL ) {
+		const char* view = (const char*)MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+		if( view != NULL ) {
+			fileHandle = file;
+			mappingHandle = mapping;
+			data = view;
+			length = size;
+			return true;
+		}
+		CloseHandle( mapping );
+	}
+	CloseHandle( file );
+#else
+	int fd = ::open( filename, O_RDONLY );
+	if( fd < 0 )
+		return false;
+
+	struct stat st;
+	if( fstat( fd, &st ) != 0 ) {
+		::close( fd );
+		return false;
+	}
+
+	if( st.st_size == 0 ) {
+		::close( fd );
+		isEmpty = true;
+		return true;
+	}
+
+	void* view = mmap( NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+	// the mapping keeps its own reference to the file
+	::close( fd );
+
+	if( view != MAP_FAILED ) {
+#ifdef MADV_SEQUENTIAL
+		madvise( view, (size_t)st.st_size, MADV_SEQUENTIAL );
+#endif
+		data = (const char*)view;
+		length = (size_t)st.st_size;
+		return true;
+	}
+#endif
+
+	// mapping failed; fall back to reading the file into memory
+	printf("BZWMappedFile::open(): Warning! Could not map %s; reading it instead\n", filename);
+	buffer = readWholeFile( filename, length );
+	if( buffer == NULL ) {
+		length = 0;
+		return false;
+	}
+
+	data = buffer;
+	return true;
+}
+
+void BZWMappedFile::close() {
+	if( buffer != NULL ) {
+		free( buffer );
+	}
+	else if( data != NULL ) {
+#ifdef _WIN32
+		UnmapViewOfFile( data );
+		CloseHandle( (HANDLE)mappingHandle );
+		CloseHandle( (HANDLE)fileHandle );
+		mappingHandle = NULL;
+		fileHandle = INVALID_HANDLE_VALUE;
+#else
+		munmap( (void*)data, length );
+#endif
+	}
+
+	data = NULL;
+	buffer = NULL;
+	length = 0;
+	isEmpty = false;
+}
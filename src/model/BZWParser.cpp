@@ -12,8 +12,12 @@
 
 #include "model/BZWParser.h"
 #include "model/Model.h"
+#include "model/BZWMappedFile.h"
+#include "model/BZWCache.h"
+#include "TextUtils.h"
 
 Model* BZWParser::_modelRef = NULL;
+bool BZWParser::_useCache = true;
 
 /**
  * Helper method:  eliminate the whitespace on the ends of the line
@@ -878,25 +882,38 @@ const vector<string> BZWParser::findSections(const char* _header, vector<string>
 
 /**
  * The top-level file loader.
- * Loads a .bzw file and returns a vector of strings, where each string contains an object's chunk of BZW text.
- * This is almost identical to BZWParser::getSections(); the only differences are file I/O-related.
- * The excuse for code duplication here is that this code executes MUCH faster than code that just loads
- * the entire file into RAM and calls BZWParser::getSections() to parse it.
+ * Maps a .bzw file into memory and hands it to the Model, which tokenizes it in place.
+ * If there is an up-to-date cache of the world next to it, that is loaded instead;
+ * otherwise one is written once the world has loaded cleanly.
  */
 
 bool BZWParser::loadFile(const char* filename) {
 	if( _modelRef == NULL )
 		return false;
 
-	ifstream fileInput(filename);
+	BZWMappedFile file;
 
 	// if its not open, its not there
-	if(!fileInput.is_open()) {
+	if(!file.open(filename)) {
 		printf("BZWParser::loadFile(): Error! Could not open input stream\n");
 		return false;
 	}
 
-	return Model::build( fileInput );
+	if( !_useCache )
+		return Model::build( file.begin(), file.size() );
+
+	string cacheName = BZWCache::fileNameFor( filename );
+	unsigned long long hash = TextUtils::hash( file.begin(), file.end() );
+
+	BZWCache cache;
+	if( cache.open( cacheName.c_str(), hash, file.size() ) && Model::build( cache ) )
+		return true;
+
+	if( !Model::build( file.begin(), file.size() ) )
+		return false;
+
+	BZWCache::write( cacheName.c_str(), hash, file.size() );
+	return true;
 }
 
 vector<int> BZWParser::getIntList( const char* line ) {
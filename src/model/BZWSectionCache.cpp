@@ -0,0 +1,110 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+#include "model/BZWSectionCache.h"
+
+#include "model/ObserverMessage.h"
+#include "model/ObserverChangeSet.h"
+#include "model/Model.h"
+#include "model/BZWWriter.h"
+#include "objects/bz2object.h"
+#include "DataEntry.h"
+
+BZWSectionCache::BZWSectionCache() {
+	reuse = false;
+	generation = 0;
+	reused = written = 0;
+}
+
+void BZWSectionCache::update( Observable* obs, void* data ) {
+	// a NULL message is only a request to refresh
+	if( data == NULL )
+		return;
+
+	ObserverMessage* message = (ObserverMessage*)data;
+
+	switch( message->type ) {
+		case ObserverMessage::CHANGE_SET: {
+			ObserverChangeSet* changes = (ObserverChangeSet*)message->data;
+			std::vector< void* >::iterator i;
+			for( i = changes->added.begin(); i != changes->added.end(); i++ )
+				sections.erase( (bz2object*)(*i) );
+			for( i = changes->removed.begin(); i != changes->removed.end(); i++ )
+				sections.erase( (bz2object*)(*i) );
+			for( i = changes->updated.begin(); i != changes->updated.end(); i++ )
+				((bz2object*)(*i))->setChanged( true );
+			break;
+		}
+
+		// these carry a bz2object, which has to be converted to its DataEntry part
+		case ObserverMessage::ADD_OBJECT:
+		case ObserverMessage::REMOVE_OBJECT:
+			sections.erase( (bz2object*)message->data );
+			break;
+
+		case ObserverMessage::UPDATE_OBJECT: {
+			bz2object* obj = (bz2object*)message->data;
+			if( obj != NULL )
+				obj->setChanged( true );
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+void BZWSectionCache::begin( const std::string& _dependencies ) {
+	reuse = ( _dependencies == dependencies );
+	dependencies = _dependencies;
+	generation++;
+
+	reused = written = 0;
+}
+
+void BZWSectionCache::write( DataEntry* entry, BZWWriter& out ) {
+	if( entry == NULL )
+		return;
+
+	std::map< DataEntry*, Section >::iterator i = sections.find( entry );
+	if( reuse && i != sections.end() && i->second.generation == generation - 1 && !entry->isChanged() ) {
+		out.write( i->second.text );
+		i->second.generation = generation;
+		reused++;
+		return;
+	}
+
+	Section& section = sections[ entry ];
+	section.text = entry->toString();
+	section.generation = generation;
+	out.write( section.text );
+
+	entry->setChanged( false );
+	written++;
+}
+
+void BZWSectionCache::end() {
+	std::map< DataEntry*, Section >::iterator i = sections.begin();
+	while( i != sections.end() ) {
+		if( i->second.generation != generation )
+			sections.erase( i++ );
+		else
+			i++;
+	}
+}
+
+void BZWSectionCache::clear() {
+	sections.clear();
+	dependencies.clear();
+	reuse = false;
+}
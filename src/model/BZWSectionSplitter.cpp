@@ -0,0 +1,109 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "model/BZWSectionSplitter.h"
+#include "model/BZWParser.h"
+
+using namespace std;
+
+// look up the terminator and subobjects of a header once, and remember them
+const BZWSectionSplitter::Scope* BZWSectionSplitter::scopeOf( const string& header ) {
+	map< string, Scope >::iterator itr = scopes.find( header );
+	if( itr != scopes.end() )
+		return &itr->second;
+
+	Scope& scope = scopes[ header ];
+	scope.terminator = TextUtils::tolower( BZWParser::terminatorOf( header.c_str() ) );
+
+	// the hierarchy is of the form <header:<sub1><sub2>...<subN>>
+	string hierarchy = BZWParser::hierarchyOf( header.c_str() );
+	string::size_type start = hierarchy.find( ":", 0 );
+	while( start != string::npos ) {
+		start = hierarchy.find( "<", start );
+		if( start == string::npos )
+			break;
+
+		string::size_type end = hierarchy.find( ">", start + 1 );
+		if( end == string::npos )
+			break;
+
+		scope.subobjects.push_back( TextUtils::tolower( hierarchy.substr( start + 1, end - (start + 1) ) ) );
+		start = end;
+	}
+
+	return &scope;
+}
+
+const BZWSectionSplitter::Scope* BZWSectionSplitter::subobjectOf( const Scope* scope, const BZWLine& line ) {
+	for( vector< string >::const_iterator i = scope->subobjects.begin(); i != scope->subobjects.end(); i++ ) {
+		if( line.keyIs( i->c_str() ) )
+			return scopeOf( *i );
+	}
+
+	return NULL;
+}
+
+void BZWSectionSplitter::split( const char* begin, const char* end, vector< BZWSection >& sections ) {
+	BZWLineReader reader( begin, end );
+	BZWLine line;
+
+	// scopes we are currently inside of (innermost last)
+	vector< const Scope* > stack;
+	BZWSection section;
+
+	while( reader.next( line ) ) {
+		if( line.empty() )
+			continue;
+
+		if( stack.size() == 0 ) {
+			// look for a header
+			section.header = line.key();
+			section.begin = line.begin;
+			section.line = line.number;
+			section.terminated = true;
+
+			if( headers.count( section.header ) == 0 ) {
+				// not an object; let the caller complain about it
+				section.end = line.end;
+				sections.push_back( section );
+				continue;
+			}
+
+			stack.push_back( scopeOf( section.header ) );
+			continue;
+		}
+
+		// see if a subobject starts here
+		const Scope* sub = subobjectOf( stack.back(), line );
+		if( sub != NULL ) {
+			stack.push_back( sub );
+			continue;
+		}
+
+		// see if the current scope ends here
+		if( line.keyIs( stack.back()->terminator.c_str() ) ) {
+			stack.pop_back();
+
+			if( stack.size() == 0 ) {
+				section.end = line.end;
+				sections.push_back( section );
+			}
+		}
+	}
+
+	// the file ended inside an object
+	if( stack.size() > 0 ) {
+		section.end = end;
+		section.terminated = false;
+		sections.push_back( section );
+	}
+}
@@ -0,0 +1,177 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+#include "model/BZWWriter.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#endif
+
+// how much text to collect before handing it to the target
+#define BZWWRITER_BUFFER_SIZE 65536
+
+BZWWriter::BZWWriter() {
+	init();
+}
+
+BZWWriter::BZWWriter( FILE* stream ) {
+	init();
+	file = stream;
+	if( file == NULL )
+		failed = true;
+}
+
+BZWWriter::BZWWriter( std::string& str ) {
+	init();
+	memory = &str;
+}
+
+BZWWriter::~BZWWriter() {
+	// an atomic file that was never closed is unfinished
+	if( ownsFile && tempPath.size() > 0 )
+		abort();
+	else
+		close();
+
+	free( buffer );
+}
+
+void BZWWriter::init() {
+	file = NULL;
+	memory = NULL;
+	ownsFile = false;
+	buffer = (char*)malloc( BZWWRITER_BUFFER_SIZE );
+	used = 0;
+	bytesWritten = 0;
+	failed = ( buffer == NULL );
+}
+
+bool BZWWriter::open( const char* filename, bool atomic ) {
+	close();
+
+	if( filename == NULL || buffer == NULL )
+		return false;
+
+	path = filename;
+	tempPath = ( atomic ? path + ".tmp" : "" );
+	bytesWritten = 0;
+	failed = false;
+
+	file = fopen( ( atomic ? tempPath : path ).c_str(), "wb" );
+	if( file == NULL ) {
+		failed = true;
+		tempPath = "";
+		return false;
+	}
+
+	ownsFile = true;
+	return true;
+}
+
+bool BZWWriter::flush() {
+	if( used == 0 )
+		return !failed;
+
+	if( memory != NULL )
+		memory->append( buffer, used );
+	else if( file != NULL ) {
+		if( fwrite( buffer, 1, used, file ) != used )
+			failed = true;
+	}
+	else
+		failed = true;
+
+	used = 0;
+	return !failed;
+}
+
+void BZWWriter::write( const char* text, size_t length ) {
+	if( failed )
+		return;
+
+	bytesWritten += length;
+
+	// big blocks go straight through
+	if( length >= BZWWRITER_BUFFER_SIZE ) {
+		flush();
+		if( memory != NULL )
+			memory->append( text, length );
+		else if( file == NULL || fwrite( text, 1, length, file ) != length )
+			failed = true;
+		return;
+	}
+
+	if( used + length > BZWWRITER_BUFFER_SIZE )
+		flush();
+
+	memcpy( buffer + used, text, length );
+	used += length;
+}
+
+void BZWWriter::write( const char* text ) {
+	if( text != NULL )
+		write( text, strlen( text ) );
+}
+
+bool BZWWriter::close() {
+	flush();
+
+	if( file != NULL ) {
+		if( fflush( file ) != 0 )
+			failed = true;
+
+		if( ownsFile && fclose( file ) != 0 )
+			failed = true;
+	}
+
+	bool ok = !failed;
+
+	if( ownsFile && tempPath.size() > 0 ) {
+		if( ok ) {
+			// replace the real file with the finished one
+#ifdef _WIN32
+			ok = ( MoveFileExA( tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != 0 );
+#else
+			ok = ( rename( tempPath.c_str(), path.c_str() ) == 0 );
+#endif
+		}
+
+		if( !ok )
+			remove( tempPath.c_str() );
+	}
+
+	file = NULL;
+	ownsFile = false;
+	tempPath = "";
+
+	return ok;
+}
+
+void BZWWriter::abort() {
+	used = 0;
+
+	if( ownsFile && file != NULL )
+		fclose( file );
+
+	if( ownsFile && tempPath.size() > 0 )
+		remove( tempPath.c_str() );
+
+	file = NULL;
+	ownsFile = false;
+	tempPath = "";
+	failed = true;
+}
@@ -14,6 +14,12 @@
 #include "windows/View.h"
 
 #include "model/BZWParser.h"
+#include "model/BZWLineReader.h"
+#include "model/BZWSectionSplitter.h"
+#include "model/BZWWriter.h"
+#include "model/BZWCache.h"
+
+#include "WorkerPool.h"
 
 #include "DataEntry.h"
 
@@ -43,6 +49,9 @@
 #include "objects/bz2object.h"
 #include <FL/Fl_Progress.H>
 
+#include <sstream>
+#include <algorithm>
+
 using namespace std;
 
 Model* Model::modRef;
@@ -75,6 +84,11 @@ Model::Model() : Observable()
 
 	this->unusedData = vector<string>();
 
+	this->parallelBuild = false;
+	this->staleSelections = 0;
+
+	// keep the save cache in step with added and removed objects
+	addObserver( &sectionCache );
 }
 
 // constructor that takes information about which objects to support
@@ -105,6 +119,12 @@ Model::Model(const char* _supportedObjects, const char* _objectHierarchy, const
 	this->objectTerminators = _objectTerminators;
 
 	this->unusedData = vector<string>();
+
+	this->parallelBuild = false;
+	this->staleSelections = 0;
+
+	// keep the save cache in step with added and removed objects
+	addObserver( &sectionCache );
 }
 
 
@@ -162,74 +182,164 @@ DataEntry* Model::_command(const string& _command, const string& object, const s
 
 		// handle dynamicColor
 		if( object == "dynamicColor" ) {
-			return ( this->dynamicColors.count( name ) > 0 ? this->dynamicColors[name] : NULL );
+			map< string, dynamicColor* >::iterator i = this->dynamicColors.find( name );
+			return ( i != this->dynamicColors.end() ? i->second : NULL );
 		}
 
 		// handle texturematrices
 		else if( object == "texturematrix" ) {
-			return ( this->textureMatrices.count( name ) > 0 ? this->textureMatrices[name] : NULL );
+			map< string, texturematrix* >::iterator i = this->textureMatrices.find( name );
+			return ( i != this->textureMatrices.end() ? i->second : NULL );
 		}
 
 		// handle physics drivers
 		else if( object == "phydrv" ) {
-			return ( this->phys.count( name ) > 0 ? this->phys[name].get() : NULL );
+			map< string, osg::ref_ptr< physics > >::iterator i = this->phys.find( name );
+			return ( i != this->phys.end() ? i->second.get() : NULL );
 		}
 
 		// handle materials
 		else if( object == "material" ) {
 			// materials can also be reference by name or index
 			// look for match by name
-			DataEntry* obj = (this->materials.count( name ) > 0 ? this->materials[name].get() : NULL );
-			// if no name match, then convert name to a number and try to get material by index
-			if(obj == NULL){
-				int index = atoi( name.c_str() );
-				//printf("material index = %i\n material size: %i\n ", index, materials.size());
-				int c = 0;
-				for ( map<string, osg::ref_ptr< material > >::const_iterator it = materials.begin(); it != materials.end(); it++, c++ ) {
-					if(c == index){
-						//printf("found: %i key = %s\n", c, it->first.c_str());
-						obj = it->second.get();
-						break;
-					}
-				}
-			}
-			
-			return obj;
+			map< string, osg::ref_ptr< material > >::iterator i = this->materials.find( name );
+			if( i != this->materials.end() )
+				return i->second.get();
+
+			// if no name match, see if the name is an index
+			if( name.size() == 0 || name.find_first_not_of( "0123456789" ) != string::npos )
+				return NULL;
+
+			unsigned int index = (unsigned int)atoi( name.c_str() );
+			return ( index < this->materialIndex.size() ? this->materialIndex[ index ] : NULL );
 		}
 
 		// handle teleporter links
 		else if( object == "link" ) {
-			return (this->links.count( name ) > 0 ? this->links[name].get() : NULL );
+			map< string, osg::ref_ptr< Tlink > >::iterator i = this->links.find( name );
+			return ( i != this->links.end() ? i->second.get() : NULL );
 		}
 
 		// handle definitions
 		else if( object == "define" ) {
-			return (this->groups.count( name ) > 0 ? this->groups[name] : NULL );
+			map< string, define* >::iterator i = this->groups.find( name );
+			return ( i != this->groups.end() ? i->second : NULL );
 		}
 
 		// handle all other objects
 		else {
-			for( objRefList::iterator i = this->objects.begin(); i != this->objects.end(); i++) {
-				if( (*i)->getName() == name )
-					return i->get();
-			}
+			NameIndex::iterator i = this->objectNames.find( nameKey( object, name ) );
+			if( i != this->objectNames.end() )
+				return i->second.front();
 		}
 	}
 
 	return NULL;
 }
 
-// the static build method
+// modal progress window shown while a world is being built
+class BuildProgress {
+
+public:
+	BuildProgress( size_t length ) {
+		filelength = (int)length;
+
+		//setup progress bar window
+		progressWin = new Fl_Window(320,90, "Loading BZW File");
+		progressWin->begin();                         // add progress bar to it..
+		pbox = new Fl_Box(FL_FLAT_BOX,10,20,300,30,"...");
+		pbox->align(FL_ALIGN_LEFT | FL_ALIGN_TOP| FL_ALIGN_INSIDE| FL_ALIGN_CLIP | FL_ALIGN_WRAP);
+		pbox->labelfont(FL_BOLD);
+		pbox->labelsize(12);
+		progress = new Fl_Progress(10,50,300,30);
+		progress->minimum(0);               // set progress bar attribs..
+		progress->maximum(filelength);
+		progressWin->end();                           // end of adding to window
+
+		//show progress
+		progress->value(0);
+		progressWin->set_modal();
+		progressWin->show();
+	}
+
+	~BuildProgress() {
+		//cleanup progress bar window
+		progress->value(filelength);
+		progress->label( "100%" );
+		Fl::wait(0.22);
+		progressWin->hide();
+		delete(progress);
+		delete(progressWin);
+	}
+
+	// report how far into the file we are, and what was last processed
+	void update( size_t amountParsed, const string& lastObj ) {
+		progress->value( (float)amountParsed );
+		float percentage = ((float)amountParsed/(float)filelength)*100;
+		progressLabel = itoa((int)percentage) + "%";
+		progress->label( progressLabel.c_str() );
+		progressText = "Processed: " + lastObj;
+		pbox->label(progressText.c_str());
+		Fl::check();
+	}
+
+private:
+	Fl_Window* progressWin;
+	Fl_Box* pbox;
+	Fl_Progress* progress;
+	int filelength;
+
+	// the labels only keep pointers to these
+	string progressLabel;
+	string progressText;
+};
+
+// the static build methods
 bool Model::build( std::istream& data ) { return modRef->_build(data); }
+bool Model::build( const char* data, size_t length ) { return modRef->_build(data, length); }
+bool Model::build( BZWCache& cache ) { return modRef->_build(cache); }
 
+// build from a stream by reading it into memory in one go
 bool Model::_build( std::istream& data ) {
+	string text;
+
+	data.seekg (0, ios::end);
+	streamoff filelength = data.tellg();
+	data.seekg (0, ios::beg);
+
+	if( filelength > 0 ) {
+		text.resize( (size_t)filelength );
+		data.read( &text[0], filelength );
+		text.resize( (size_t)data.gcount() );
+	}
+	else {
+		// not seekable (i.e. a pipe), so just drain it
+		data.clear();
+		ostringstream buffer;
+		buffer << data.rdbuf();
+		text = buffer.str();
+	}
+
+	return _build( text.data(), text.size() );
+}
+
+// build from a buffer of BZW text (usually a memory mapped file)
+bool Model::_build( const char* data, size_t length ) {
+	if( parallelBuild )
+		return _buildParallel( data, length );
+
+	return _buildSerial( data, length );
+}
+
+// build one line at a time on this thread
+// lines are tokenized in place; only the lines that are handed to an object's parse() are copied
+bool Model::_buildSerial( const char* data, size_t length ) {
 	//clear errors
 	errors = "";
 	int oc = 0;
 	_newWorld();
 
 	string buff, header;
-	int lineCount = 0;
 
 	world* worldObj = NULL;
 	waterLevel* waterLevelObj = NULL;
@@ -243,43 +353,23 @@ bool Model::_build( std::istream& data ) {
 	texturematrix* texmatObj = NULL;
 	bz2object* object = NULL;
 	
-	// get length of file:
-	data.seekg (0, ios::end);
-	int filelength = data.tellg();
-	data.seekg (0, ios::beg);
-	int amountParsed = 0;
 	string lastObj;
-	//setup progress bar window
-	Fl_Window* progressWin = new Fl_Window(320,90, "Loading BZW File");
-	progressWin->begin();                         // add progress bar to it..
-	Fl_Box* pbox = new Fl_Box(FL_FLAT_BOX,10,20,300,30,"...");
-	pbox->align(FL_ALIGN_LEFT | FL_ALIGN_TOP| FL_ALIGN_INSIDE| FL_ALIGN_CLIP | FL_ALIGN_WRAP);
-	pbox->labelfont(FL_BOLD);
-	pbox->labelsize(12);
-    Fl_Progress* progress = new Fl_Progress(10,50,300,30);
-    progress->minimum(0);               // set progress bar attribs..
-    progress->maximum(filelength);
-    progressWin->end();                           // end of adding to window
-	
-	//show progress
-	progress->value(0);
-	progressWin->set_modal();
-	progressWin->show();
-
-	while(!data.eof()) {
-		// read in lines until we find a key
-		getline( data, buff );
-		amountParsed +=	buff.length();
-		lineCount++;
-		buff = BZWParser::cutWhiteSpace( buff );
-		header = BZWParser::key( buff.c_str() );
+	BuildProgress progress( length );
 
-		try {
-			if ( header == "" )
-				continue; // if the line is blank move to the next one
+	BZWLineReader reader( data, data + length );
+	BZWLine line;
 
+	while( reader.next( line ) ) {
+		// skip blank lines (and lines that were all comment)
+		if ( line.empty() )
+			continue;
+
+		// hand the line to the parse() methods through a reused string
+		line.assignTo( buff );
+
+		try {
 			// first check if we are currently parsing an object
-			else if ( worldObj ) {
+			if ( worldObj ) {
 				if ( !worldObj->parse( buff ) ) {
 					worldObj->finalize();
 					this->worldData = worldObj;
@@ -318,7 +408,7 @@ bool Model::_build( std::istream& data ) {
 			else if ( materialObj ) {
 				if ( !materialObj->parse( buff ) ) {
 					materialObj->finalize();
-					this->materials[ materialObj->getName() ] = materialObj;
+					_addMaterial( materialObj );
 					materialObj = NULL;
 				}
 			}
@@ -366,78 +456,75 @@ bool Model::_build( std::istream& data ) {
 			}
 
 			// find what object to parse based on its header
-			else if( header == "world" ) {
-				lastObj = header;
-				worldObj = (world*)this->cmap["world"]();
-			}
-			else if( header == "waterlevel" ) {
-				lastObj = header;
-				waterLevelObj = (waterLevel*)this->cmap["waterLevel"]();
-			}
-			else if( header == "options" ) {
-				lastObj = header;
-				optionsObj = (options*)this->cmap["options"]();
-			}
-			else if( header == "info" ) {
-				lastObj = header;
-				infoObj = (info*)this->cmap["info"]();
-			}
-			else if( header == "material" ) {
-				lastObj = header;
-				materialObj = (material*)this->cmap["material"]();
-			}
-			else if( header == "physics" ) {
-				lastObj = header;
-				physicsObj = (physics*)this->cmap["physics"]();
-			}
-			else if( header == "dynamiccolor" ) {
-				lastObj = header;
-				dyncolObj = (dynamicColor*)this->cmap["dynamicColor"]();
-			}
-			else if( header == "define" ) {
-				lastObj = header;
-				defineObj = (define*)this->cmap["define"]();
-				defineObj->parse(buff);
-			}
-			else if( header == "link" ) {
-				lastObj = header;
-				linkObj = (Tlink*)this->cmap["link"]();
-			}
-			else if( header == "texturematrix" ) {
-				lastObj = header;
-				texmatObj = (texturematrix*)this->cmap["texturematrix"]();
-			}
 			else {
-				if( this->cmap.count(header) > 0 ) {
+				header = line.key();
+
+				if( header == "world" ) {
+					lastObj = header;
+					worldObj = (world*)this->cmap["world"]();
+				}
+				else if( header == "waterlevel" ) {
+					lastObj = header;
+					waterLevelObj = (waterLevel*)this->cmap["waterLevel"]();
+				}
+				else if( header == "options" ) {
 					lastObj = header;
-					object = (bz2object*)cmap[header]();
-					object->parse( buff );
+					optionsObj = (options*)this->cmap["options"]();
+				}
+				else if( header == "info" ) {
+					lastObj = header;
+					infoObj = (info*)this->cmap["info"]();
+				}
+				else if( header == "material" ) {
+					lastObj = header;
+					materialObj = (material*)this->cmap["material"]();
+				}
+				else if( header == "physics" ) {
+					lastObj = header;
+					physicsObj = (physics*)this->cmap["physics"]();
+				}
+				else if( header == "dynamiccolor" ) {
+					lastObj = header;
+					dyncolObj = (dynamicColor*)this->cmap["dynamicColor"]();
+				}
+				else if( header == "define" ) {
+					lastObj = header;
+					defineObj = (define*)this->cmap["define"]();
+					defineObj->parse(buff);
+				}
+				else if( header == "link" ) {
+					lastObj = header;
+					linkObj = (Tlink*)this->cmap["link"]();
+				}
+				else if( header == "texturematrix" ) {
+					lastObj = header;
+					texmatObj = (texturematrix*)this->cmap["texturematrix"]();
 				}
 				else {
-					BZWReadError err = BZWReadError(NULL,"Model::build(): Skipping undefined object \"" + buff + "\"", lineCount);
-					appendError(err);
-					//printf("Model::build(): Skipping undefined object \"%s\"\n", buff.c_str());
-					//this->unusedData.push_back( buff );
+					if( this->cmap.count(header) > 0 ) {
+						lastObj = header;
+						object = (bz2object*)cmap[header]();
+						object->parse( buff );
+					}
+					else {
+						BZWReadError err = BZWReadError(NULL,"Model::build(): Skipping undefined object \"" + buff + "\"", line.number);
+						appendError(err);
+						//printf("Model::build(): Skipping undefined object \"%s\"\n", buff.c_str());
+						//this->unusedData.push_back( buff );
+					}
 				}
 			}
 		}
 		catch ( BZWReadError err ) { // catch any read errors
-			err.line = lineCount;
+			err.line = line.number;
 			appendError(err);
 		}
 		// update progress bar
-		if(header == "end"){ //limit how often progress is updated
+		if( line.keyIs( "end" ) ){ //limit how often progress is updated
 			oc++;
 			if(oc == 10){// limit to every 10 objects
 				oc = 0;
-				progress->value(amountParsed);
-				float percentage = ((float)amountParsed/(float)filelength)*100;
-				printf("%f\n", percentage);
-				string progressLabel = itoa((int)percentage) + "%";
-				progress->label( progressLabel.c_str() );
-				string progressText = "Processed: " + lastObj;
-				pbox->label(progressText.c_str());
-				Fl::check();
+				progress.update( line.offset, lastObj );
 			}
 		}
 	}
@@ -446,14 +533,6 @@ bool Model::_build( std::istream& data ) {
 	if (!worldData)
 		worldData = new world();
 	
-	//cleanup progress bar window
-	progress->value(filelength);
-	progress->label( "100%" );
-	Fl::wait(0.22);
-	progressWin->hide();
-	delete(progress);
-	delete(progressWin);
-	
 	// return false to report errors
 	if(errors.length() > 0)
 		return false;
@@ -461,6 +540,335 @@ bool Model::_build( std::istream& data ) {
 	return true;
 }
 
+// parse a section into an object, one line at a time
+// (this runs on the worker threads for ParseJobs, so it may only touch the object and the job)
+static bool parseSection( BZWSection& section, DataEntry* obj, bool skipHeader, vector< BZWReadError >& errors ) {
+	BZWLineReader reader( section.begin, section.end );
+	BZWLine line;
+	string buff;
+	bool first = true;
+
+	while( reader.next( line ) ) {
+		if( line.empty() )
+			continue;
+
+		if( first ) {
+			first = false;
+			if( skipHeader )
+				continue;
+		}
+
+		line.assignTo( buff );
+
+		try {
+			if( !obj->parse( buff ) )
+				return true;
+		}
+		catch ( BZWReadError err ) {
+			err.line = section.line + line.number - 1;
+			errors.push_back( err );
+		}
+	}
+
+	return false;
+}
+
+// parse a job's section into its object
+void Model::parseJob( ParseJob& job ) {
+	job.complete = parseSection( *job.section, job.object.get(), false, job.errors );
+}
+
+// parses a range of jobs on the worker pool
+class ParseJobRange : public WorkerRange {
+
+public:
+	ParseJobRange( vector< Model::ParseJob >& _jobs ) : jobs( _jobs ) { }
+
+	virtual void run( unsigned int begin, unsigned int end ) {
+		for( unsigned int i = begin; i < end; i++ )
+			Model::parseJob( jobs[i] );
+	}
+
+private:
+	vector< Model::ParseJob >& jobs;
+};
+
+// build in two phases:  first find where each object starts and ends, then parse the objects in parallel.
+bool Model::_buildParallel( const char* data, size_t length ) {
+	vector< BZWSection > sections;
+	_splitSections( data, data + length, sections );
+
+	return _buildSections( sections, length );
+}
+
+// build from a world cache:  the parts of the world that were kept as text are built as usual, and the
+// rest of the objects are rebuilt from their records and finalized in place, in the Model's order.
+bool Model::_build( BZWCache& cache ) {
+	vector< BZWSection > sections;
+	_splitSections( cache.getText(), cache.getText() + cache.getTextLength(), sections );
+
+	vector< BZWSection* > objectSections;
+	vector< BZWSection* > linkSections;
+	_beginBuild( sections, objectSections, linkSections );
+
+	// the objects in the text have to line up with the records that say they're there
+	size_t textObjects = 0;
+	for( size_t i = 0; i < cache.getObjectCount(); i++ ) {
+		if( cache.isTextObject( i ) )
+			textObjects++;
+	}
+
+	if( textObjects != objectSections.size() || !cache.resolveReferences() ) {
+		appendError( BZWReadError( NULL, "Model::build(): The world cache doesn't match the world" ) );
+		return false;
+	}
+
+	vector< ParseJob > jobs( objectSections.size() );
+	for( unsigned int i = 0; i < objectSections.size(); i++ )
+		_buildJob( *objectSections[i], jobs[i] );
+
+	ParseJobRange range( jobs );
+	if( parallelBuild )
+		WorkerPool::getSharedPool()->runRange( &range, jobs.size(), 64 );
+	else
+		range.run( 0, jobs.size() );
+
+	objRefList built;
+	built.reserve( cache.getObjectCount() );
+
+	vector< ParseJob >::iterator job = jobs.begin();
+	for( size_t i = 0; i < cache.getObjectCount(); i++ ) {
+		if( cache.isTextObject( i ) ) {
+			if( _finishJob( *job ) )
+				built.push_back( job->object );
+			job++;
+			continue;
+		}
+
+		osg::ref_ptr< bz2object > obj = cache.buildObject( i );
+		if( !obj.valid() ) {
+			appendError( BZWReadError( NULL, "Model::build(): The world cache has an object that can't be rebuilt" ) );
+			return false;
+		}
+
+		try {
+			obj->finalize();
+		}
+		catch ( BZWReadError err ) {
+			appendError( err );
+			return false;
+		}
+
+		built.push_back( obj );
+	}
+	_addObjects( built );
+
+	return _endBuild( linkSections );
+}
+
+// split BZW text into its top-level sections
+void Model::splitSections( const char* begin, const char* end, vector< BZWSection >& sections ) { modRef->_splitSections( begin, end, sections ); }
+void Model::_splitSections( const char* begin, const char* end, vector< BZWSection >& sections ) {
+	BZWSectionSplitter splitter;
+	const char* globals[] = { "world", "waterlevel", "options", "info", "material", "physics", "dynamiccolor", "define", "link", "texturematrix", NULL };
+	for( int i = 0; globals[i] != NULL; i++ )
+		splitter.addHeader( globals[i] );
+	for( map< string, DataEntry* (*)() >::iterator i = cmap.begin(); i != cmap.end(); i++ )
+		splitter.addHeader( i->first );
+
+	splitter.split( begin, end, sections );
+}
+
+// build from sections that have already been split out of the text.
+// The objects are constructed here (their constructors touch SceneBuilder's caches), parsed on the worker
+// pool, and then finalized and added in file order.  Only the parsing is parallel:  finalize() builds the
+// geometry, materials and textures, which share SceneBuilder's and material's caches.
+bool Model::_buildSections( vector< BZWSection >& sections, size_t length ) {
+	BuildProgress progress( length );
+
+	vector< BZWSection* > objectSections;
+	vector< BZWSection* > linkSections;
+	_beginBuild( sections, objectSections, linkSections );
+
+	progress.update( length / 4, "definitions" );
+
+	vector< ParseJob > jobs( objectSections.size() );
+	for( unsigned int i = 0; i < objectSections.size(); i++ )
+		_buildJob( *objectSections[i], jobs[i] );
+
+	// parse the objects on the worker pool
+	ParseJobRange range( jobs );
+	if( parallelBuild )
+		WorkerPool::getSharedPool()->runRange( &range, jobs.size(), 64 );
+	else
+		range.run( 0, jobs.size() );
+
+	progress.update( length * 3 / 4, "objects" );
+
+	// final pass, on this thread:  finalize the objects in file order, and add them all at once
+	objRefList built;
+	for( vector< ParseJob >::iterator j = jobs.begin(); j != jobs.end(); j++ ) {
+		if( _finishJob( *j ) )
+			built.push_back( j->object );
+	}
+	_addObjects( built );
+
+	return _endBuild( linkSections );
+}
+
+// start building a world from its sections:  clear the world, then build everything objects refer to by
+// name (materials, physics drivers, texture matrices, dynamic colors, definitions) in file order.  The
+// sections of the remaining objects, and of the links (which resolve the teleporters they connect by name,
+// so they have to come last), are handed back.
+void Model::_beginBuild( vector< BZWSection >& sections, vector< BZWSection* >& objectSections, vector< BZWSection* >& linkSections ) {
+	//clear errors
+	errors = "";
+	_newWorld();
+
+	for( vector< BZWSection >::iterator s = sections.begin(); s != sections.end(); s++ ) {
+		const string& header = s->header;
+		vector< BZWReadError > sectionErrors;
+
+		if( header == "link" ) {
+			linkSections.push_back( &(*s) );
+			continue;
+		}
+
+		if( header == "world" || header == "waterlevel" || header == "options" || header == "info" ||
+			header == "material" || header == "physics" || header == "dynamiccolor" || header == "define" ||
+			header == "texturematrix" ) {
+			string name = ( header == "waterlevel" ? "waterLevel" : ( header == "dynamiccolor" ? "dynamicColor" : header ) );
+			DataEntry* obj = cmap[ name ]();
+
+			// only define wants its header line
+			bool complete = parseSection( *s, obj, header != "define", sectionErrors );
+
+			for( vector< BZWReadError >::iterator e = sectionErrors.begin(); e != sectionErrors.end(); e++ )
+				appendError( *e );
+
+			if( !complete ) {
+				appendError( BZWReadError( obj, "Model::build(): Missing terminator", s->line ) );
+				continue;
+			}
+
+			try {
+				obj->finalize();
+			}
+			catch ( BZWReadError err ) {
+				err.line = s->line;
+				appendError( err );
+			}
+
+			if( header == "world" ) {
+				this->worldData = (world*)obj;
+				ObserverMessage obs( ObserverMessage::UPDATE_WORLD, worldData );
+				this->notifyObservers( &obs );
+			}
+			else if( header == "waterlevel" ) {
+				this->waterLevelData = (waterLevel*)obj;
+				ObserverMessage obs( ObserverMessage::UPDATE_WORLD, worldData );
+				this->notifyObservers( &obs );
+			}
+			else if( header == "options" )
+				this->optionsData = (options*)obj;
+			else if( header == "info" )
+				this->infoData = (info*)obj;
+			else if( header == "material" )
+				_addMaterial( (material*)obj );
+			else if( header == "physics" )
+				this->phys[ ((physics*)obj)->getName() ] = (physics*)obj;
+			else if( header == "dynamiccolor" )
+				this->dynamicColors[ ((dynamicColor*)obj)->getName() ] = (dynamicColor*)obj;
+			else if( header == "define" )
+				this->groups[ ((define*)obj)->getName() ] = (define*)obj;
+			else if( header == "texturematrix" )
+				this->textureMatrices[ ((texturematrix*)obj)->getName() ] = (texturematrix*)obj;
+
+			continue;
+		}
+
+		if( this->cmap.count( header ) == 0 ) {
+			string line( s->begin, s->end );
+			appendError( BZWReadError( NULL, "Model::build(): Skipping undefined object \"" + line + "\"", s->line ) );
+			continue;
+		}
+
+		objectSections.push_back( &(*s) );
+	}
+}
+
+// construct the object for a section (this has to happen on the main thread)
+void Model::_buildJob( BZWSection& section, ParseJob& job ) {
+	job.section = &section;
+	job.object = (bz2object*)cmap[ section.header ]();
+	job.complete = false;
+	job.errors.clear();
+}
+
+// report a parsed job's errors and finalize its object; returns true if the object can be added
+bool Model::_finishJob( ParseJob& job ) {
+	for( vector< BZWReadError >::iterator e = job.errors.begin(); e != job.errors.end(); e++ )
+		appendError( *e );
+
+	if( !job.complete ) {
+		appendError( BZWReadError( job.object.get(), "Model::build(): Missing terminator", job.section->line ) );
+		return false;
+	}
+
+	try {
+		job.object->finalize();
+	}
+	catch ( BZWReadError err ) {
+		err.line = job.section->line;
+		appendError( err );
+		return false;
+	}
+
+	return true;
+}
+
+// finish a build once all of the objects are in:  build the links, and make sure there is a world.
+// Returns false if there were any errors.
+bool Model::_endBuild( vector< BZWSection* >& linkSections ) {
+	// links need the teleporters to be in the model
+	for( vector< BZWSection* >::iterator s = linkSections.begin(); s != linkSections.end(); s++ ) {
+		vector< BZWReadError > sectionErrors;
+		osg::ref_ptr< Tlink > linkObj = (Tlink*)this->cmap["link"]();
+
+		bool complete = parseSection( **s, linkObj.get(), true, sectionErrors );
+		for( vector< BZWReadError >::iterator e = sectionErrors.begin(); e != sectionErrors.end(); e++ )
+			appendError( *e );
+
+		if( !complete ) {
+			appendError( BZWReadError( linkObj.get(), "Model::build(): Missing terminator", (*s)->line ) );
+			continue;
+		}
+
+		try {
+			linkObj->finalize();
+			this->links[ linkObj->getName() ] = linkObj;
+		}
+		catch ( BZWReadError err ) {
+			err.line = (*s)->line;
+			appendError( err );
+		}
+	}
+
+	// need a world so if we didn't find one make a default one
+	if (!worldData)
+		worldData = new world();
+
+	// return false to report errors
+	if(errors.length() > 0)
+		return false;
+
+	return true;
+}
+
+// use the worker pool when building
+void Model::setParallelBuild( bool value ) { modRef->parallelBuild = value; }
+bool Model::getParallelBuild() { return modRef->parallelBuild; }
+
 // BZWB-specific API
 world* Model::getWorldData() { return modRef->_getWorldData(); }
 options* Model::getOptionsData() { return modRef->_getOptionsData(); }
@@ -669,79 +1077,99 @@ string& Model::_toString() {
 	static string ret = "";
 	ret.clear();
 
-	string worldDataString = (this->worldData != NULL ? this->worldData->toString() : "\n");
-	string optionsDataString = (this->optionsData != NULL ? this->optionsData->toString() : "\n");
-	string waterLevelString = (this->waterLevelData != NULL && this->waterLevelData->getHeight() > 0.0 ? this->waterLevelData->toString() : "\n");
-	string infoString = (this->infoData != NULL ? this->infoData->toString() : "\n");
+	BZWWriter out( ret );
+	_write( out );
+	out.close();
+
+	return ret;
+}
+
+bool Model::write( BZWWriter& out ) { return modRef->_write( out ); }
+
+bool Model::_write( BZWWriter& out ) {
+	// everything goes straight to the writer; objects that haven't changed since the last
+	// write come out of the section cache instead of being serialized again
+	sectionCache.begin( _sectionDependencies() );
 
 	// global data
-	ret += "\n#--Info------------------------------------------\n\n" + infoString;
-	ret += "\n#--World-----------------------------------------\n\n" + worldDataString;
-	ret += "\n#--Options---------------------------------------\n\n" + optionsDataString;
-	ret += "\n#--Water Level-----------------------------------\n\n" + waterLevelString;
+	out << "\n#--Info------------------------------------------\n\n";
+	out << ( this->infoData != NULL ? this->infoData->toString() : "\n" );
+	out << "\n#--World-----------------------------------------\n\n";
+	out << ( this->worldData != NULL ? this->worldData->toString() : "\n" );
+	out << "\n#--Options---------------------------------------\n\n";
+	out << ( this->optionsData != NULL ? this->optionsData->toString() : "\n" );
+	out << "\n#--Water Level-----------------------------------\n\n";
+	out << ( this->waterLevelData != NULL && this->waterLevelData->getHeight() > 0.0 ? this->waterLevelData->toString() : "\n" );
 
 	// physics drivers
-	ret += "\n#--Physics Drivers-------------------------------\n\n";
-	if(this->phys.size() > 0) {
-		for(map< string, osg::ref_ptr< physics > >::iterator i = this->phys.begin(); i != this->phys.end(); i++) {
-			ret += i->second->toString() + "\n";
-		}
+	out << "\n#--Physics Drivers-------------------------------\n\n";
+	for(map< string, osg::ref_ptr< physics > >::iterator i = this->phys.begin(); i != this->phys.end(); i++) {
+		out << i->second->toString() << "\n";
 	}
 
 	// dynamic colors
-	ret += "\n#--Dynamic Colors--------------------------------\n\n";
-	if(this->dynamicColors.size() > 0) {
-		for(map< string, dynamicColor* >::iterator i = this->dynamicColors.begin(); i != this->dynamicColors.end(); i++) {
-			ret += i->second->toString() + "\n";
-		}
+	out << "\n#--Dynamic Colors--------------------------------\n\n";
+	for(map< string, dynamicColor* >::iterator i = this->dynamicColors.begin(); i != this->dynamicColors.end(); i++) {
+		out << i->second->toString() << "\n";
 	}
 
 	// texture matrices
-	ret += "\n#--Texture Matrices------------------------------\n\n";
-	if(this->textureMatrices.size() > 0) {
-		for(map< string, texturematrix* >::iterator i = this->textureMatrices.begin(); i != this->textureMatrices.end(); i++) {
-			ret += i->second->toString() + "\n";
-		}
+	out << "\n#--Texture Matrices------------------------------\n\n";
+	for(map< string, texturematrix* >::iterator i = this->textureMatrices.begin(); i != this->textureMatrices.end(); i++) {
+		out << i->second->toString() << "\n";
 	}
 
 	// materials
-	ret += "\n#--Materials-------------------------------------\n\n";
-	if(this->materials.size() > 0) {
-		for(map< string, osg::ref_ptr< material > >::iterator i = this->materials.begin(); i != this->materials.end(); i++) {
-			ret += i->second->toString() + "\n";
-		}
+	out << "\n#--Materials-------------------------------------\n\n";
+	for(map< string, osg::ref_ptr< material > >::iterator i = this->materials.begin(); i != this->materials.end(); i++) {
+		out << i->second->toString() << "\n";
 	}
 
 	// group defintions
-	ret += "\n#--Group Definitions-----------------------------\n\n";
-	if(this->groups.size() > 0) {
-		for(map< string, define* >::iterator i = this->groups.begin(); i != this->groups.end(); i++) {
-			ret += i->second->toString() + "\n";
-		}
+	out << "\n#--Group Definitions-----------------------------\n\n";
+	for(map< string, define* >::iterator i = this->groups.begin(); i != this->groups.end(); i++) {
+		out << i->second->toString() << "\n";
 	}
 
-	// all other objects
-	ret += "\n#--Objects---------------------------------------\n\n";
-	if(this->objects.size() > 0) {
-		for(objRefList::iterator i = this->objects.begin(); i != this->objects.end(); i++) {
-			ret += (*i)->toString() + "\n";
-		}
+	// all other objects; only these are cached, since only they track their own changes
+	out << "\n#--Objects---------------------------------------\n\n";
+	for(objRefList::iterator i = this->objects.begin(); i != this->objects.end(); i++) {
+		sectionCache.write( i->get(), out );
+		out << "\n";
 	}
 
 	// links
-	ret += "\n#--Teleporter Links------------------------------\n\n";
-	if(this->links.size() > 0) {
-		for(map< string, osg::ref_ptr< Tlink > >::iterator i = this->links.begin(); i != this->links.end(); i++) {
-			ret += i->second->toString() + "\n";
-		}
+	out << "\n#--Teleporter Links------------------------------\n\n";
+	for(map< string, osg::ref_ptr< Tlink > >::iterator i = this->links.begin(); i != this->links.end(); i++) {
+		out << i->second->toString() << "\n";
 	}
 
 	// unused dats
-	ret += "\n#--Unused Data-----------------------------------\n\n";
-	if(this->unusedData.size() > 0) {
-		for(vector<string>::iterator i = this->unusedData.begin(); i != this->unusedData.end(); i++) {
-			ret += (*i) + "\n";
-		}
+	out << "\n#--Unused Data-----------------------------------\n\n";
+	for(vector<string>::iterator i = this->unusedData.begin(); i != this->unusedData.end(); i++) {
+		out << (*i) << "\n";
+	}
+
+	sectionCache.end();
+
+	return out.good();
+}
+
+// objects write out the names of their materials, physics drivers and group definitions,
+// so if any of those are renamed, added or removed the cached object text is stale
+string Model::_sectionDependencies() {
+	string ret;
+
+	for(map< string, osg::ref_ptr< material > >::iterator i = this->materials.begin(); i != this->materials.end(); i++) {
+		ret += i->first + " " + i->second->getName() + "\n";
+	}
+	ret += "\n";
+	for(map< string, osg::ref_ptr< physics > >::iterator i = this->phys.begin(); i != this->phys.end(); i++) {
+		ret += i->first + " " + i->second->getName() + "\n";
+	}
+	ret += "\n";
+	for(map< string, define* >::iterator i = this->groups.begin(); i != this->groups.end(); i++) {
+		ret += i->first + " " + i->second->getName() + "\n";
 	}
 
 	return ret;
@@ -756,8 +1184,12 @@ map< string, osg::ref_ptr< physics > >& 		Model::getPhysicsDrivers() 	{ return m
 map< string, osg::ref_ptr< Tlink > >&		 	Model::getTeleporterLinks() { return modRef->_getTeleporterLinks(); }
 map< string, define* >&			Model::getGroups() 			{ return modRef->_getGroups(); }
 void					Model::addObject( bz2object* obj ) { modRef->_addObject( obj ); }
+void					Model::addObjects( objRefList& objs ) { modRef->_addObjects( objs ); }
+void					Model::addMaterial( material* mat ) { modRef->_addMaterial( mat ); }
 void					Model::removeObject( bz2object* obj ) { modRef->_removeObject( obj ); }
+void					Model::updateObject( bz2object* obj ) { modRef->_updateObject( obj ); }
 void					Model::setSelected( bz2object* obj ) { modRef->_setSelected( obj ); }
+void					Model::setSelected( const vector< bz2object* >& objs ) { modRef->_setSelected( objs ); }
 void					Model::setUnselected( bz2object* obj ) { modRef->_setUnselected( obj ); }
 void					Model::selectAll() { modRef->_selectAll(); }
 void					Model::unselectAll() { modRef->_unselectAll(); }
@@ -770,11 +1202,27 @@ void Model::_addObject( bz2object* obj ) {
 
 	this->objects.push_back( obj );
 
+	// index it by type and name (lookups find the first object added with them, as a search would)
+	this->objectNames[ nameKey( obj->getHeader(), obj->getName() ) ].push_back( obj );
+
 	// tell all observers
 	ObserverMessage obs( ObserverMessage::ADD_OBJECT, obj );
 	this->notifyObservers( &obs );
 }
 
+// add a batch of objects to the Model, with one notification for all of them
+void Model::_addObjects( objRefList& objs ) {
+	if( objs.size() == 0 )
+		return;
+
+	this->objects.reserve( this->objects.size() + objs.size() );
+
+	this->beginBatch();
+	for( objRefList::iterator i = objs.begin(); i != objs.end(); i++ )
+		this->_addObject( i->get() );
+	this->commitBatch();
+}
+
 // remove an object by instance
 void Model::_removeObject( bz2object* obj ) {
 	if(objects.size() <= 0)
@@ -786,6 +1234,16 @@ void Model::_removeObject( bz2object* obj ) {
 
 			ObserverMessage obs( ObserverMessage::REMOVE_OBJECT, obj );
 			this->notifyObservers( &obs );
+
+			// objects outside the Model can't be selected
+			if( obj->isSelected() ) {
+				obj->setSelected( false );
+				this->staleSelections++;
+			}
+
+			this->_unindexObject( obj, obj->getName() );
+
+			// this may drop the last reference to obj, so it comes last
 			objects.erase( itr );
 
 			break;
@@ -793,6 +1251,55 @@ void Model::_removeObject( bz2object* obj ) {
 	}
 }
 
+// tell the observers an object was edited from outside the Model (i.e. moved by a dialog),
+// so the View can update its bounds and the next save writes it out fresh
+void Model::_updateObject( bz2object* obj ) {
+	if( obj == NULL )
+		return;
+
+	obj->setChanged( true );
+
+	ObserverMessage obs( ObserverMessage::UPDATE_OBJECT, obj );
+	this->notifyObservers( &obs );
+}
+
+bool Model::_unindexObject( bz2object* obj, const string& name ) {
+	NameIndex::iterator i = this->objectNames.find( nameKey( obj->getHeader(), name ) );
+	if( i == this->objectNames.end() )
+		return false;
+
+	vector< bz2object* >::iterator j = find( i->second.begin(), i->second.end(), obj );
+	if( j == i->second.end() )
+		return false;
+
+	i->second.erase( j );
+	if( i->second.empty() )
+		this->objectNames.erase( i );
+	return true;
+}
+
+// add a material (replacing any other material with the same name)
+void Model::_addMaterial( material* mat ) {
+	if( mat == NULL )
+		return;
+
+	map< string, osg::ref_ptr< material > >::iterator i = materials.find( mat->getName() );
+	if( i != materials.end() ) {
+		// the replacement takes over the old material's index
+		for( vector< material* >::iterator j = materialIndex.begin(); j != materialIndex.end(); j++ ) {
+			if( *j == i->second.get() ) {
+				*j = mat;
+				break;
+			}
+		}
+		i->second = mat;
+	}
+	else {
+		materials[ mat->getName() ] = mat;
+		materialIndex.push_back( mat );
+	}
+}
+
 void Model::_removeMaterial( material* mat ) {
 	if (materials.size() <= 0)
 		return;
@@ -814,6 +1321,13 @@ void Model::_removeMaterial( material* mat ) {
 				}
 			}
 
+			for ( vector< material* >::iterator j = materialIndex.begin(); j != materialIndex.end(); j++ ) {
+				if ( *j == mat ) {
+					materialIndex.erase( j );
+					break;
+				}
+			}
+
 			materials.erase( i );
 			break;
 		}
@@ -912,15 +1426,10 @@ void Model::_removeGroup( define* def ) {
 
 // set an object as selected and update it
 void Model::_setSelected( bz2object* obj ) {
-	if( selectedObjects.size() < 0 )
+	// the object's own flag says whether it's in the selection
+	if( obj == NULL || obj->isSelected() )
 		return;
 
-	for(objRefList::iterator i = this->selectedObjects.begin(); i != this->selectedObjects.end(); i++) {
-		if( *i == obj ) {
-			return;		// this object is already selected.
-		}
-	}
-
 	obj->setSelected( true );
 	obj->setChanged( true );
 
@@ -932,18 +1441,26 @@ void Model::_setSelected( bz2object* obj ) {
 	this->notifyObservers( &obs_msg );
 }
 
+// select a group of objects, with one notification for all of them
+void Model::_setSelected( const vector< bz2object* >& objs ) {
+	this->beginBatch();
+
+	for( vector< bz2object* >::const_iterator i = objs.begin(); i != objs.end(); i++ )
+		this->_setSelected( *i );
+
+	this->commitBatch();
+}
+
 // set an object as unselected and update it
 void Model::_setUnselected( bz2object* obj ) {
-	if( this->selectedObjects.size() < 0)
+	if( obj == NULL )
 		return;
 
-	for(objRefList::iterator i = this->selectedObjects.begin(); i != this->selectedObjects.end(); i++) {
-		if( *i == obj ) {
-			obj->setSelected( false );
-			obj->setChanged( true );
-			this->selectedObjects.erase(i);
-			break;
-		}
+	// leave it in selectedObjects; _getSelection() sweeps it out
+	if( obj->isSelected() ) {
+		obj->setSelected( false );
+		obj->setChanged( true );
+		this->staleSelections++;
 	}
 
 	// tell the view to mark this object as unselected
@@ -954,29 +1471,32 @@ void Model::_setUnselected( bz2object* obj ) {
 
 // determine whether or not an object is selected
 bool Model::_isSelected( bz2object* obj ) {
-	if( this->selectedObjects.size() < 0)
-		return false;
-
 	if(obj == NULL)
 		return false;
 
-	for(objRefList::iterator i = this->selectedObjects.begin(); i != this->selectedObjects.end(); i++) {
-		if( *i == obj ) {
-			return true;
-		}
-	}
-
-	return false;
+	return obj->isSelected();
 }
 
 // select all objects
 void Model::_selectAll() {
-	unselectAll();
+	this->beginBatch();
+
+	for ( Model::objRefList::iterator i = objects.begin(); i != objects.end(); i++ ) {
+		if( (*i)->isSelected() )
+			continue;
+
+		(*i)->setSelected( true );
+		(*i)->setChanged( true );
 
-	Model::objRefList objs = Model::getObjects();
-	for ( Model::objRefList::iterator i = objs.begin(); i != objs.end(); i++ ) {
-		setSelected( (*i).get() );
+		ObserverMessage obs_msg( ObserverMessage::UPDATE_OBJECT, i->get() );
+		this->notifyObservers( &obs_msg );
 	}
+
+	// everything is selected, in Model order
+	this->selectedObjects = this->objects;
+	this->staleSelections = 0;
+
+	this->commitBatch();
 }
 
 // unselect all objects
@@ -984,7 +1504,12 @@ void Model::_unselectAll() {
 	if( this->selectedObjects.size() <= 0)
 		return;
 
+	this->beginBatch();
+
 	for(objRefList::iterator i = this->selectedObjects.begin(); i != this->selectedObjects.end(); i++) {
+		if( !(*i)->isSelected() )
+			continue;
+
 		(*i)->setSelected( false );
 		(*i)->setChanged( true );
 		// tell the view to mark this object as unselected
@@ -993,8 +1518,60 @@ void Model::_unselectAll() {
 	}
 
 	selectedObjects.clear();
+	this->staleSelections = 0;
 	this->notifyObservers( NULL );
 
+	this->commitBatch();
+}
+
+// select everything that isn't selected, and unselect everything that is
+void Model::invertSelection() { modRef->_invertSelection(); }
+void Model::_invertSelection() {
+	this->beginBatch();
+
+	objRefList inverted;
+	inverted.reserve( this->objects.size() );
+
+	for( objRefList::iterator i = this->objects.begin(); i != this->objects.end(); i++ ) {
+		bool selected = !(*i)->isSelected();
+		(*i)->setSelected( selected );
+		(*i)->setChanged( true );
+		if( selected )
+			inverted.push_back( *i );
+
+		ObserverMessage obs_msg( ObserverMessage::UPDATE_OBJECT, i->get() );
+		this->notifyObservers( &obs_msg );
+	}
+
+	this->selectedObjects.swap( inverted );
+	this->staleSelections = 0;
+
+	this->commitBatch();
+}
+
+// drop unselected objects from selectedObjects.  An object that was unselected and then
+// selected again is in there twice; the later entry is the one kept.
+void Model::_sweepSelection() {
+	if( this->staleSelections == 0 )
+		return;
+
+	objRefList kept;
+	kept.reserve( this->selectedObjects.size() );
+
+	// clearing the flag on the way marks an object as seen
+	for( objRefList::reverse_iterator i = this->selectedObjects.rbegin(); i != this->selectedObjects.rend(); i++ ) {
+		if( (*i)->isSelected() ) {
+			(*i)->setSelected( false );
+			kept.push_back( *i );
+		}
+	}
+
+	for( objRefList::iterator i = kept.begin(); i != kept.end(); i++ )
+		(*i)->setSelected( true );
+
+	reverse( kept.begin(), kept.end() );
+	this->selectedObjects.swap( kept );
+	this->staleSelections = 0;
 }
 
 // get selection
@@ -1014,7 +1591,7 @@ DataEntry* Model::_buildObject( const char* header ) {
 // cut objects from the scene
 bool Model::cutSelection() { return modRef->_cutSelection(); }
 bool Model::_cutSelection() {
-	if( this->selectedObjects.size() <= 0)
+	if( this->_getSelection().size() <= 0)
 		return false;
 
 	this->objectBuffer.clear();
@@ -1023,12 +1600,15 @@ bool Model::_cutSelection() {
 	for( objRefList::iterator i = this->selectedObjects.begin(); i != this->selectedObjects.end(); i++) {
 		this->objectBuffer.push_back( *i );
 	}
+	this->beginBatch();
 	for( objRefList::iterator i = this->selectedObjects.begin(); i != this->selectedObjects.end(); i++) {
 		this->_removeObject( i->get() );
 	}
 
 	this->selectedObjects.clear();
+	this->staleSelections = 0;
 	this->notifyObservers( NULL );
+	this->commitBatch();
 
 	return true;
 }
@@ -1036,7 +1616,7 @@ bool Model::_cutSelection() {
 // copy objects from the scene
 bool Model::copySelection() { return modRef->_copySelection(); }
 bool Model::_copySelection() {
-	if( this->selectedObjects.size() <= 0)
+	if( this->_getSelection().size() <= 0)
 		return false;
 
 	this->objectBuffer.clear();
@@ -1055,6 +1635,7 @@ bool Model::_pasteSelection() {
 	if( this->objectBuffer.size() <= 0)
 		return false;
 
+	this->beginBatch();
 
 	this->_unselectAll();
 
@@ -1074,6 +1655,7 @@ bool Model::_pasteSelection() {
 	}
 
 	this->notifyObservers(NULL);
+	this->commitBatch();
 
 	return true;
 }
@@ -1081,22 +1663,22 @@ bool Model::_pasteSelection() {
 // delete a selection
 bool Model::deleteSelection() { return modRef->_deleteSelection(); }
 bool Model::_deleteSelection() {
-	if( this->selectedObjects.size() <= 0)
+	if( this->_getSelection().size() <= 0)
 		return false;
 
-	// remove objects from the scene WITHOUT first referencing it (i.e. this will ensure it gets deleted)
-	Model::objRefList::iterator itr = this->selectedObjects.begin();
-	for(; itr != this->selectedObjects.end(); ) {
-		bz2object* obj = itr->get();
-		this->_removeObject( obj );
+	this->beginBatch();
 
-		this->selectedObjects.erase( itr );
-		itr = this->selectedObjects.begin();
+	// remove objects from the scene WITHOUT first referencing it (i.e. this will ensure it gets deleted
+	// once the selection is cleared and the View lets go of it at the end of the batch)
+	for( objRefList::iterator itr = this->selectedObjects.begin(); itr != this->selectedObjects.end(); itr++ ) {
+		this->_removeObject( itr->get() );
 	}
 
 	this->selectedObjects.clear();
+	this->staleSelections = 0;
 
 	this->notifyObservers(NULL);
+	this->commitBatch();
 
 	return true;
 }
@@ -1124,8 +1706,9 @@ void Model::_assignMaterial( const string& matref, bz2object* obj ) {
 	material* mat;
 
 	// do we have this material?
-	if( this->materials.count( matref ) > 0 )
-		mat = this->materials[matref].get();	// then load it from our mapping
+	map< string, osg::ref_ptr< material > >::iterator i = this->materials.find( matref );
+	if( i != this->materials.end() )
+		mat = i->second.get();	// then load it from our mapping
 	else
 		mat = this->defaultMaterial.get();	// otherwise, use the default material
 
@@ -1145,7 +1728,7 @@ void Model::_assignMaterial( material* matref, bz2object* obj ) {
 
 	// otherwise, make sure this material exists (if not, then add it)
 	if( this->materials.count( matref->getName() ) == 0 )
-		materials[ matref->getName() ] = matref;
+		_addMaterial( matref );
 
 	// give the material to the object (and it will update itself)
 	UpdateMessage msg( UpdateMessage::UPDATE_MATERIAL, matref );
@@ -1383,6 +1966,16 @@ bool Model::_renameTeleporterLink( std::string oldName, std::string newName ) {
 	return true;
 }
 
+// an object's name has changed; only objects in the Model are indexed, so the others are ignored
+void Model::renameObject( bz2object* obj, const std::string& oldName ) {
+	if( modRef != NULL )
+		modRef->_renameObject( obj, oldName );
+}
+void Model::_renameObject( bz2object* obj, const std::string& oldName ) {
+	if( this->_unindexObject( obj, oldName ) )
+		this->objectNames[ nameKey( obj->getHeader(), obj->getName() ) ].push_back( obj );
+}
+
 bool Model::renameGroup( std::string oldName, std::string newName ) { return modRef->_renameGroup( oldName, newName ); }
 bool Model::_renameGroup( std::string oldName, std::string newName ) {
 	// first check for conflicts and find the material
@@ -1506,6 +2099,7 @@ void Model::_ungroupObjects( group* g ) {
 void Model::clear() {
 	// clear materials
 	this->materials.clear();
+	this->materialIndex.clear();
 
 	// clear physics drivers
 	this->phys.clear();
@@ -1527,14 +2121,19 @@ void Model::clear() {
 	}
 	this->textureMatrices.clear();
 
-	// clear out the previous objects
+	// clear out the previous objects (in one batch, so the View rebuilds the scene once)
+	this->beginBatch();
 	this->_unselectAll();
 	for (objRefList::iterator i = objects.begin(); i != objects.end(); i++ ) {
 		ObserverMessage obs( ObserverMessage::REMOVE_OBJECT, i->get() );
 		notifyObservers( &obs );
 	}
-	this->objects.clear();
 	this->notifyObservers( NULL );
+	this->commitBatch();
+
+	this->objects.clear();
+	this->objectNames.clear();
+	this->sectionCache.clear();
 
 	if (worldData != NULL)
 		delete worldData;
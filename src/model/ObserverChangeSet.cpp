@@ -0,0 +1,101 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+
+#include "model/ObserverChangeSet.h"
+
+using namespace std;
+
+void ObserverChangeSet::add( ObserverMessage* message ) {
+	count++;
+
+	// a plain refresh; delivering the set covers it
+	if( message == NULL )
+		return;
+
+	void* data = message->data;
+
+	switch( message->type ) {
+		case ObserverMessage::ADD_OBJECT:
+			// removed and then put back, so it never left; it may have changed in between though
+			if( removedSet.erase( data ) > 0 ) {
+				if( updatedSet.insert( data ).second )
+					updated.push_back( data );
+			}
+			else if( addedSet.insert( data ).second )
+				added.push_back( data );
+			break;
+
+		case ObserverMessage::REMOVE_OBJECT:
+			updatedSet.erase( data );
+
+			// added in this batch, so the observers never need to hear of it
+			if( addedSet.erase( data ) == 0 && removedSet.insert( data ).second )
+				removed.push_back( data );
+			break;
+
+		case ObserverMessage::UPDATE_OBJECT:
+			if( removedSet.count( data ) == 0 && updatedSet.insert( data ).second )
+				updated.push_back( data );
+			break;
+
+		case ObserverMessage::UPDATE_WORLD:
+			worldChanged = true;
+			world = data;
+			break;
+
+		case ObserverMessage::UPDATE_WATERLEVEL:
+			waterLevelChanged = true;
+			waterLevel = data;
+			break;
+
+		default:
+			break;
+	}
+}
+
+// drop whatever a later message cancelled out from the lists
+static void filter( vector< void* >& list, set< void* >& members ) {
+	vector< void* > kept;
+	kept.reserve( members.size() );
+
+	for( vector< void* >::iterator i = list.begin(); i != list.end(); i++ ) {
+		// erasing as we go also drops any second copy
+		if( members.erase( *i ) > 0 )
+			kept.push_back( *i );
+	}
+
+	list.swap( kept );
+}
+
+// (this empties the sets, so it can only be done once)
+void ObserverChangeSet::finish() {
+	filter( added, addedSet );
+	filter( removed, removedSet );
+	filter( updated, updatedSet );
+}
+
+void ObserverChangeSet::clear() {
+	added.clear();
+	removed.clear();
+	updated.clear();
+	addedSet.clear();
+	removedSet.clear();
+	updatedSet.clear();
+
+	worldChanged = false;
+	world = NULL;
+	waterLevelChanged = false;
+	waterLevel = NULL;
+
+	count = 0;
+}
@@ -19,13 +19,102 @@
 #include <osg/StateSet>
 #include <osg/Group>
 #include <osgDB/ReadFile>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
 
 #include <cmath>
+#include <map>
 
 using namespace std;
 
+// the unit meshes, and the texture corners of each of their sides' vertex arrays.  Every
+// object shares them, so they're built under a lock in case objects are built off the main thread.
+static OpenThreads::Mutex unitMeshMutex;
+static osg::ref_ptr< osg::Group > unitBox;
+static osg::ref_ptr< osg::Group > unitPyramid[2];
+static map< const osg::Array*, osg::ref_ptr< osg::Vec2Array > > unitCorners;
+
+static osg::Vec2Array* makeCorners( const osg::Vec2* corners, int count ) {
+	osg::Vec2Array* array = new osg::Vec2Array();
+	for( int i = 0; i < count; i++ )
+		array->push_back( corners[i] );
+	return array;
+}
+
+void Primitives::buildUnitMeshes() {
+	if( unitBox.valid() )
+		return;
+
+	// these match the order rebuildBoxUV() and rebuildPyramidUV() write the coordinates in
+	static const osg::Vec2 boxSide[4] = { osg::Vec2( 1, 0 ), osg::Vec2( 1, 1 ), osg::Vec2( 0, 1 ), osg::Vec2( 0, 0 ) };
+	static const osg::Vec2 boxCap[4] = { osg::Vec2( 0, 1 ), osg::Vec2( 0, 0 ), osg::Vec2( 1, 0 ), osg::Vec2( 1, 1 ) };
+	static const osg::Vec2 pyramidSide[3] = { osg::Vec2( 0, 0 ), osg::Vec2( 1, 0 ), osg::Vec2( 0.5, 1 ) };
+	static const osg::Vec2 pyramidBottom[4] = { osg::Vec2( 1, 1 ), osg::Vec2( 0, 1 ), osg::Vec2( 0, 0 ), osg::Vec2( 1, 0 ) };
+
+	osg::ref_ptr< osg::Vec2Array > sideCorners = makeCorners( boxSide, 4 );
+	osg::ref_ptr< osg::Vec2Array > capCorners = makeCorners( boxCap, 4 );
+	osg::ref_ptr< osg::Group > box = buildBoxMesh( osg::Vec3( 1, 1, 1 ) );
+	for( unsigned int i = 0; i < 6; i++ ) {
+		osg::Geometry* geometry = ((osg::Geode*)box->getChild( i ))->getDrawable( 0 )->asGeometry();
+		unitCorners[ geometry->getVertexArray() ] = ( i < 4 ? sideCorners : capCorners );
+	}
+
+	osg::ref_ptr< osg::Vec2Array > triangleCorners = makeCorners( pyramidSide, 3 );
+	osg::ref_ptr< osg::Vec2Array > bottomCorners = makeCorners( pyramidBottom, 4 );
+	for( int flipz = 0; flipz < 2; flipz++ ) {
+		unitPyramid[ flipz ] = buildPyramidMesh( osg::Vec3( 1, 1, 1 ), flipz != 0 );
+		for( unsigned int i = 0; i < 5; i++ ) {
+			osg::Geometry* geometry = ((osg::Geode*)unitPyramid[ flipz ]->getChild( i ))->getDrawable( 0 )->asGeometry();
+			unitCorners[ geometry->getVertexArray() ] = ( i < 4 ? triangleCorners : bottomCorners );
+		}
+	}
+
+	// set last, since it says the rest is ready
+	unitBox = box;
+}
+
+osg::Group* Primitives::shareUnitMesh( osg::Group* mesh ) {
+	osg::Group* group = new osg::Group();
+	for( unsigned int i = 0; i < mesh->getNumChildren(); i++ ) {
+		osg::Geometry* geometry = ((osg::Geode*)mesh->getChild( i ))->getDrawable( 0 )->asGeometry();
+
+		// a shallow copy shares the arrays and primitive sets
+		osg::Geode* geode = new osg::Geode();
+		geode->addDrawable( new osg::Geometry( *geometry, osg::CopyOp::SHALLOW_COPY ) );
+		group->addChild( geode );
+	}
+	return group;
+}
+
+osg::Vec2Array* Primitives::getUnitCorners( const osg::Array* vertices ) {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( unitMeshMutex );
+
+	map< const osg::Array*, osg::ref_ptr< osg::Vec2Array > >::iterator i = unitCorners.find( vertices );
+	return ( i != unitCorners.end() ? i->second.get() : NULL );
+}
+
 // build a pyramid
 osg::Node* Primitives::buildPyramid( osg::Vec3 size, bool flipz ) {
+	osg::Group* pyramid;
+	if( size == osg::Vec3( 1, 1, 1 ) ) {
+		{
+			OpenThreads::ScopedLock< OpenThreads::Mutex > lock( unitMeshMutex );
+			buildUnitMeshes();
+			pyramid = shareUnitMesh( unitPyramid[ flipz ? 1 : 0 ].get() );
+		}
+		rebuildPyramidUV( pyramid, size );
+	}
+	else
+		pyramid = buildPyramidMesh( size, flipz );
+
+	// assign the texture
+	for( unsigned int i = 0; i < pyramid->getNumChildren(); i++ )
+		SceneBuilder::assignTexture( "pyrwall", pyramid->getChild( i ), osg::StateAttribute::ON );
+
+	return pyramid;
+}
+
+osg::Group* Primitives::buildPyramidMesh( osg::Vec3 size, bool flipz ) {
 	osg::Group* pyramid = new osg::Group();
 	osg::Geode* sides[5];
 	osg::Geometry* geometry[5];
@@ -117,10 +206,6 @@ osg::Node* Primitives::buildPyramid( osg::Vec3 size, bool flipz ) {
 		geometry[i]->addPrimitiveSet( side );
 	geometry[4]->addPrimitiveSet( bottom );
 
-	// assign the texture
-	for (int i = 0; i < 5; i++)
-		SceneBuilder::assignTexture( "pyrwall", sides[i], osg::StateAttribute::ON );
-
 	return pyramid;
 }
 
@@ -324,6 +409,16 @@ void Primitives::rebuildBoxUV(osg::Group* box, osg::Vec3 size,
 }
 
 osg::Group* Primitives::buildUntexturedBox( osg::Vec3 size ) {
+	if( size == osg::Vec3( 1, 1, 1 ) ) {
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( unitMeshMutex );
+		buildUnitMeshes();
+		return shareUnitMesh( unitBox.get() );
+	}
+
+	return buildBoxMesh( size );
+}
+
+osg::Group* Primitives::buildBoxMesh( osg::Vec3 size ) {
 	osg::Group* group = new osg::Group();
 	// separate geometry nodes are needed so that each side
 	// can have a separate material
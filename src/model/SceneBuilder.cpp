@@ -10,26 +10,30 @@
  * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
  */
 
-#include <curl/curl.h>
-#include <curl/types.h>
-#include <curl/easy.h>
-
-#ifdef _WIN32
-	#include <direct.h>
-#else
-	#include <sys/stat.h>
-#endif
 #include <iostream>
 
 #include "model/SceneBuilder.h"
 #include "windows/View.h"
 #include "model/Primitives.h"
+#include "model/TextureLoader.h"
+#include "objects/material.h"
 #include "OSFile.h"
 
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ReentrantMutex>
+#include <OpenThreads/ScopedLock>
+
 int SceneBuilder::nameCount;
 
+// guards nameCount
+static OpenThreads::Mutex nameMutex;
+
 std::map< std::string, osg::ref_ptr< osg::StateSet > > SceneBuilder::stateCache;
 
+// guards stateCache, so objects (and so their textures) can be built off the main thread.
+// It's reentrant since assignTexture() calls buildTexture2D().
+static OpenThreads::ReentrantMutex stateMutex;
+
 // constructor
 bool SceneBuilder::init() {
 	nameCount = 0;
@@ -42,6 +46,28 @@ bool SceneBuilder::shutdown() {
 	return true;
 }
 
+// indicate that this is a node
+string SceneBuilder::nameNode( const char* str ) {
+	int count;
+	{
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( nameMutex );
+		count = ++nameCount;
+	}
+
+	return itoa( count ) + "|" + str + SCENEBUILDER_TAIL_NODE;
+}
+
+// make a unique name
+string SceneBuilder::makeUniqueName( const char* name ) {
+	int count;
+	{
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( nameMutex );
+		count = nameCount++;
+	}
+
+	return string(name) + "_" + string(itoa(count));
+}
+
 /**
  * Object builder.
  * This method builds and returns a node loaded from nodeFile
@@ -123,153 +149,37 @@ osg::Geode* SceneBuilder::buildGeode( const char* _nodeName, osg::Geometry* geom
 	return geode;
 }
 
-// used by curl function in SceneBuilder::buildTexture2D
-size_t write_curl_data(void *ptr, size_t size, size_t nmemb, FILE *stream) {
-    size_t written;
-    written = fwrite(ptr, size, nmemb, stream);
-    return written;
-}
-
-
 /**
- * Build a Texture2D from a file; return NULL if not found
- */	
+ * Build a Texture2D from a file.  The image is loaded in the background (see TextureLoader);
+ * until it comes in, the texture shows a placeholder.
+ */
 
 osg::Texture2D* SceneBuilder::buildTexture2D( const char* filename ) {
-	
+	OpenThreads::ScopedLock< OpenThreads::ReentrantMutex > lock( stateMutex );
+
 	// if cached, return the texture
 	if ( stateCache.count( string( filename ) ) > 0 ) {
 		osg::StateAttribute* sa = stateCache[ filename ].get()->getTextureAttribute(0, osg::StateAttribute::TEXTURE);
 		return dynamic_cast<osg::Texture2D*>(sa);
 	}
-	
-	
-	string searchPath(FindShareFile("textures/"));
-	string temp_name( filename );	
-
-	//---- download and cache remote texture
-	// see if filename starts with "http://"
-	string protocol("http://");
-	if( temp_name.compare(0, protocol.length(), TextUtils::tolower(protocol), 0, protocol.length()) == 0 ){
-		// swap "http://" for "bzwb_cache/" in filename to fix the path
-		temp_name = "bzwb_cache/" + temp_name.substr(protocol.length(),temp_name.length()-protocol.length());
-		//strip off .png from end if it exists since it is added below
-		string last4 = TextUtils::tolower(temp_name.substr(temp_name.length()-4,4));
-		if( last4.compare(".png") == 0 ){
-			temp_name = temp_name.substr(0,temp_name.length()-4);
-		}
-		// check for texture in bzwb_cache
-		// FIXME: should compare modification dates of the file in cache and the one online, not just if it exists locally 
-		FILE * cFile;
-		cFile = fopen ( ( searchPath + temp_name + ".png" ).c_str(), "r");
-		if( cFile!=NULL ) {
-			// file exists in http_cache, then close it cause we don't need it.
-			printf ( "Using Cached Texture: %s\n", ( searchPath + temp_name + ".png" ).c_str() );
-			fclose ( cFile );
-		}else{
-			// file does not exist in http_cache:
-			// get texture's parent directory path and create directories
-			string pDirPath = string("");
-			std::vector<std::string> tks = TextUtils::tokenize( string( searchPath + temp_name ), "/", 20, false);
-			for ( std::vector<std::string>::iterator i = tks.begin() ; i < tks.end()-1 ; i++ ){
-				if(i < tks.end()-2)
-					pDirPath += (*i) + "/";
-				else
-					pDirPath += (*i) ;
-				// create directories as we go
-				#ifdef _WIN32
-					_mkdir( pDirPath.c_str() );
-				#else
-					mkdir( pDirPath.c_str(), 0777 );
-				#endif
-			}
-			//printf(  "parent directory path: %s\n", pDirPath.c_str() );
-			
-			// download the texture into http_cache
-			printf ( "Downloading Texture: %s\n", ( searchPath + temp_name + ".png" ).c_str() );
-			CURL *curl;
-			FILE *fp;
-			CURLcode res;
-			long len = 0;
-			curl = curl_easy_init();
-			if( curl ) {
-				fp = fopen( ( searchPath + temp_name + ".png" ).c_str(), "wb" );
-				if( fp != NULL ){
-					curl_easy_setopt( curl, CURLOPT_URL, filename );
-					curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, write_curl_data );
-					curl_easy_setopt( curl, CURLOPT_WRITEDATA, fp );
-					res = curl_easy_perform( curl );
-					curl_easy_cleanup( curl );
-					len = ftell(fp);
-					fclose( fp );
-					if(res != 0){
-						printf ( "Error Downloading: %s, %li\n", curl_easy_strerror(res), len );
-						//remove cached file
-						std::remove( ( searchPath + temp_name + ".png" ).c_str() );
-						//use error downloading texture
-						temp_name = "../UI/error_downloading";
-					}
-				}else{
-					printf( "Unable to open/create texture file: %s\n", ( searchPath + temp_name + ".png" ).c_str() );
-				}
-			}
-		}		
-	}
-	//---- end download and cache remote texture
-	
-	//strip .png extension - this is done again here for local textures entered with a .png extension
-	string last4 = temp_name.substr(temp_name.length()-4,4);
-	if( last4.compare(".png") == 0 ){
-		temp_name = temp_name.substr(0,temp_name.length()-4);
-	}
-
-	if( temp_name.c_str() != NULL ) {
-		osg::Texture2D* texture = NULL;
-		
-		//see if texture file exists and use a default "missing texture" if it doesn't
-		FILE * cFile;
-		cFile = fopen ( (searchPath + temp_name + ".png").c_str() ,"r");
-		if (cFile!=NULL) {
-			// file exists in http_cache, then close it cause we don't need it.
-			fclose (cFile);
-		}else{
-			printf("Can not find texture: %s\n", (searchPath + temp_name + ".png").c_str() );
-			temp_name = "../UI/not_found";
-		}
-
-		osg::Image* image = osgDB::readImageFile( (searchPath + temp_name + ".png").c_str() );
-
-		if( image != NULL ) {	// only build the texture if the image exists!
-
-			texture = new osg::Texture2D();
-
-			// don't allow OSG to optimize the texture (otherwise it may disappear)
-			texture->setDataVariance( osg::Object::DYNAMIC );
-
-			// set the texture's image
-			texture->setImage( image );
 
-			// turn on GL_REPEAT texture wrapping
-			texture->setWrap( osg::Texture::WRAP_R, osg::Texture::REPEAT );
-			texture->setWrap( osg::Texture::WRAP_S, osg::Texture::REPEAT );
-			texture->setWrap( osg::Texture::WRAP_T, osg::Texture::REPEAT );
-		}
-		
-		if (texture != NULL) {
-			// save in state cache
-			osg::StateSet* texStateSet = new osg::StateSet();
-			texStateSet->setTextureAttributeAndModes( 0, texture, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE );
-			stateCache[ filename ] = texStateSet;
-		}
+	osg::Texture2D* texture = TextureLoader::getSharedLoader()->load( filename );
 
-		return texture;
+	if (texture != NULL) {
+		// save in state cache
+		osg::StateSet* texStateSet = new osg::StateSet();
+		texStateSet->setTextureAttributeAndModes( 0, texture, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE );
+		stateCache[ filename ] = texStateSet;
 	}
-	return NULL;
+
+	return texture;
 }
 
 // assign a texture to a Node
 void SceneBuilder::assignTexture( const char* _textureName, osg::Node* node, unsigned int mode ) {
 	if(_textureName != NULL) {
+		OpenThreads::ScopedLock< OpenThreads::ReentrantMutex > lock( stateMutex );
+
 		// if the stateset is already in the cache, assign it
 		if ( stateCache.count( string( _textureName ) ) > 0 ) {
 			node->setStateSet( stateCache[ _textureName ].get() );
@@ -422,10 +332,17 @@ void SceneBuilder::markUnselected( osg::Node* theNode ) {
 // mark the object selected without destroying its state set
 void SceneBuilder::markSelectedAndPreserveStateSet( bz2object* theNode ) {
 
+	// already marked; saving the highlighted copy would lose the real StateSet
+	if( theNode->savedStateSet.valid() )
+		return;
+
 	osg::StateSet* currStateSet = theNode->getOrCreateStateSet();
 	osg::Material* currMaterial = (osg::Material*)currStateSet->getAttribute( osg::StateAttribute::MATERIAL );
 	if( currStateSet != NULL ) {
-		theNode->savedStateSet = new osg::StateSet( *currStateSet );
+		// the static batch may still be drawing with the node's StateSet (on the draw
+		// thread), so it's put aside as it is, and the highlight goes on a copy
+		theNode->savedStateSet = currStateSet;
+		theNode->setStateSet( new osg::StateSet( *currStateSet ) );
 	}
 
 	SceneBuilder::assignMaterial(  osg::Vec4( 0.0, 1.0, 0.0, 1.0 ),
@@ -442,14 +359,12 @@ void SceneBuilder::markSelectedAndPreserveStateSet( bz2object* theNode ) {
 // mark a node as unselected by restoring it's state set if applicable
 void SceneBuilder::markUnselectedAndRestoreStateSet( bz2object* theNode ) {
 
+	// only a node that was marked selected has anything to restore
 	osg::StateSet* stateSet = theNode->savedStateSet.get();
-	osg::Material* mat = (osg::Material*)stateSet->getAttribute( osg::StateAttribute::MATERIAL );
 	if( stateSet != NULL ) {
 		theNode->setStateSet( stateSet );
+		theNode->savedStateSet = NULL;
 	}
-
-	else
-		SceneBuilder::markUnselected( theNode );
 }
 
 bz2object* SceneBuilder::cloneBZObject( bz2object* obj ) {
@@ -476,5 +391,19 @@ bz2object* SceneBuilder::cloneBZObject( bz2object* obj ) {
 }
 
 void SceneBuilder::clearStateCache() {
-	SceneBuilder::stateCache.clear();
+	{
+		OpenThreads::ScopedLock< OpenThreads::ReentrantMutex > lock( stateMutex );
+		SceneBuilder::stateCache.clear();
+	}
+
+	// the shared final materials hold on to the old textures
+	material::clearFinalMaterials();
+
+	// and so does the loader, which would otherwise hand them out again without rereading them
+	TextureLoader::getSharedLoader()->clear();
+}
+
+unsigned int SceneBuilder::getStateCacheSize() {
+	OpenThreads::ScopedLock< OpenThreads::ReentrantMutex > lock( stateMutex );
+	return stateCache.size();
 }
@@ -0,0 +1,532 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef _WIN32
+	#include <direct.h>
+#else
+	#include <sys/stat.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "model/TextureCache.h"
+#include "model/BZWMappedFile.h"
+#include "model/BZWWriter.h"
+#include "TextUtils.h"
+
+#include <OpenThreads/ScopedLock>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+typedef unsigned int uint32;
+typedef unsigned long long uint64;
+
+const unsigned long long TextureCache::DEFAULT_BUDGET = 256ULL * 1024 * 1024;
+
+// the first line of the index; bump the number whenever its layout changes
+#define INDEX_HEADER "bzwb texture cache 1"
+
+// bump this whenever the layout of a decoded image changes
+#define IMAGE_VERSION 1
+
+// written as-is, so an image from a machine with the other byte order won't match
+#define IMAGE_BYTE_ORDER 0x01020304
+
+// a decoded image starts with this, followed by the offset of each mipmap level
+// (the first is always 0), and then the pixels of every level
+struct ImageHeader {
+	char magic[4];				// "BZTX"
+	uint32 version;
+	uint32 byteOrder;
+	uint32 width;
+	uint32 height;
+	uint32 internalFormat;
+	uint32 pixelFormat;
+	uint32 dataType;
+	uint32 packing;
+	uint32 levels;
+	uint64 dataSize;
+};
+
+static bool exists( const string& path ) {
+	FILE* file = fopen( path.c_str(), "rb" );
+	if( file == NULL )
+		return false;
+
+	fclose( file );
+	return true;
+}
+
+// make the directories leading up to a file (or, with a trailing slash, a directory)
+static void makeDirectories( const string& path ) {
+	for( string::size_type slash = path.find( '/', 1 ); slash != string::npos; slash = path.find( '/', slash + 1 ) ) {
+		#ifdef _WIN32
+			_mkdir( path.substr( 0, slash ).c_str() );
+		#else
+			mkdir( path.substr( 0, slash ).c_str(), 0777 );
+		#endif
+	}
+}
+
+TextureCache::TextureCache( const string& _directory, unsigned long long _budget ) {
+	directory = _directory;
+	if( directory.length() > 0 && directory[ directory.length() - 1 ] != '/' )
+		directory += '/';
+
+	budget = _budget;
+	dirty = false;
+	imagesRead = 0;
+	imagesStored = 0;
+
+	load();
+}
+
+TextureCache::~TextureCache() {
+	save();
+}
+
+unsigned long long TextureCache::now() {
+	return (unsigned long long)time( NULL );
+}
+
+string TextureCache::getContentPath( const string& hash ) {
+	return directory + hash + ".png";
+}
+
+string TextureCache::getImagePath( const string& hash ) {
+	return directory + hash + ".bzt";
+}
+
+// the index has a line for each URL:  the URL, the hash, the size, when it was last used,
+// the ETag and the Last-Modified date, separated by tabs
+void TextureCache::load() {
+	BZWMappedFile file;
+	if( !file.open( ( directory + "index" ).c_str() ) )
+		return;
+
+	string text( file.begin(), file.end() );
+	file.close();
+
+	string::size_type start = 0;
+	bool first = true;
+	while( start < text.length() ) {
+		string::size_type end = text.find( '\n', start );
+		if( end == string::npos )
+			end = text.length();
+		string line = text.substr( start, end - start );
+		start = end + 1;
+
+		// an index from some other version is thrown out whole
+		if( first ) {
+			if( line != INDEX_HEADER )
+				return;
+			first = false;
+			continue;
+		}
+
+		vector< string > fields;
+		string::size_type fieldStart = 0;
+		while( true ) {
+			string::size_type tab = line.find( '\t', fieldStart );
+			fields.push_back( line.substr( fieldStart, tab == string::npos ? string::npos : tab - fieldStart ) );
+			if( tab == string::npos )
+				break;
+			fieldStart = tab + 1;
+		}
+		if( fields.size() != 6 || fields[0].length() == 0 || fields[1].length() == 0 )
+			continue;
+
+		// forget anything whose contents went missing
+		if( !exists( getContentPath( fields[1] ) ) ) {
+			dirty = true;
+			continue;
+		}
+
+		Entry& entry = entries[ fields[0] ];
+		entry.hash = fields[1];
+		entry.size = strtoull( fields[2].c_str(), NULL, 10 );
+		entry.lastUsed = strtoull( fields[3].c_str(), NULL, 10 );
+		entry.etag = fields[4];
+		entry.lastModified = fields[5];
+	}
+}
+
+bool TextureCache::save() {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+
+	if( !dirty )
+		return true;
+
+	makeDirectories( directory );
+
+	BZWWriter out;
+	if( !out.open( ( directory + "index" ).c_str() ) )
+		return false;
+
+	out << INDEX_HEADER "\n";
+	char number[ 32 ];
+	for( map< string, Entry >::iterator i = entries.begin(); i != entries.end(); i++ ) {
+		out << i->first << "\t" << i->second.hash << "\t";
+		snprintf( number, sizeof( number ), "%llu\t", i->second.size );
+		out << number;
+		snprintf( number, sizeof( number ), "%llu\t", i->second.lastUsed );
+		out << number;
+		out << i->second.etag << "\t" << i->second.lastModified << "\n";
+	}
+
+	if( !out.close() )
+		return false;
+
+	dirty = false;
+	return true;
+}
+
+bool TextureCache::lookup( const string& url, Entry& entry ) {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+
+	map< string, Entry >::iterator i = entries.find( url );
+	if( i == entries.end() )
+		return false;
+
+	i->second.lastUsed = now();
+	dirty = true;
+
+	entry = i->second;
+	return true;
+}
+
+string TextureCache::store( const string& url, const string& contents, const string& etag, const string& lastModified ) {
+	char hex[ 17 ];
+	snprintf( hex, sizeof( hex ), "%016llx", TextUtils::hash( contents.data(), contents.data() + contents.size() ) );
+	string hash( hex );
+	string path = getContentPath( hash );
+
+	// the same contents only have to be written once
+	bool write;
+	{
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+		write = writing.insert( hash ).second;
+	}
+	if( write ) {
+		bool ok = true;
+		if( !exists( path ) ) {
+			makeDirectories( directory );
+
+			BZWWriter out;
+			ok = out.open( path.c_str() );
+			if( ok ) {
+				out.write( contents );
+				ok = out.close();
+			}
+		}
+
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+		writing.erase( hash );
+		if( !ok )
+			return "";
+	}
+
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+
+	// other URLs with the same contents already count their size
+	uint64 size = contents.size();
+	for( map< string, Entry >::iterator i = entries.begin(); i != entries.end(); i++ ) {
+		if( i->second.hash == hash && i->first != url ) {
+			size = i->second.size;
+			break;
+		}
+	}
+
+	Entry& entry = entries[ url ];
+	string oldHash = entry.hash;
+
+	entry.hash = hash;
+	entry.size = size;
+	entry.etag = etag;
+	entry.lastModified = lastModified;
+	entry.lastUsed = now();
+	dirty = true;
+
+	// drop the old contents if this URL was the last one using them
+	if( oldHash.length() > 0 && oldHash != hash ) {
+		bool used = false;
+		for( map< string, Entry >::iterator i = entries.begin(); i != entries.end() && !used; i++ )
+			used = ( i->second.hash == oldHash );
+		if( !used )
+			removeContents( oldHash );
+	}
+
+	evict( hash );
+
+	return hash;
+}
+
+osg::Image* TextureCache::readImage( const string& hash ) {
+	BZWMappedFile file;
+	if( !file.open( getImagePath( hash ).c_str() ) )
+		return NULL;
+
+	const char* data = file.begin();
+	uint64 size = file.size();
+	if( size < sizeof( ImageHeader ) )
+		return NULL;
+
+	const ImageHeader* header = (const ImageHeader*)data;
+	if( memcmp( header->magic, "BZTX", 4 ) != 0 || header->version != IMAGE_VERSION || header->byteOrder != IMAGE_BYTE_ORDER ||
+		header->levels == 0 || header->levels > 32 )
+		return NULL;
+
+	// the pieces have to add up to the whole file
+	uint64 offsetsLength = (uint64)header->levels * sizeof( uint32 );
+	if( header->dataSize > size || sizeof( ImageHeader ) + offsetsLength + header->dataSize != size )
+		return NULL;
+
+	const uint32* offsets = (const uint32*)( data + sizeof( ImageHeader ) );
+	osg::Image::MipmapDataType mipmaps;
+	for( uint32 level = 1; level < header->levels; level++ ) {
+		if( offsets[ level ] >= header->dataSize )
+			return NULL;
+		mipmaps.push_back( offsets[ level ] );
+	}
+
+	unsigned char* pixels = new unsigned char[ (size_t)header->dataSize ];
+	memcpy( pixels, data + sizeof( ImageHeader ) + offsetsLength, (size_t)header->dataSize );
+
+	osg::Image* image = new osg::Image();
+	image->setImage( header->width, header->height, 1, header->internalFormat, header->pixelFormat, header->dataType,
+					 pixels, osg::Image::USE_NEW_DELETE, header->packing );
+	if( mipmaps.size() > 0 )
+		image->setMipmapLevels( mipmaps );
+
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+	imagesRead++;
+
+	// using the image counts as using its URLs
+	for( map< string, Entry >::iterator i = entries.begin(); i != entries.end(); i++ ) {
+		if( i->second.hash == hash )
+			i->second.lastUsed = now();
+	}
+	dirty = true;
+
+	return image;
+}
+
+osg::Image* TextureCache::storeImage( const string& hash, osg::Image* image ) {
+	if( image == NULL || image->data() == NULL || image->r() != 1 )
+		return image;
+
+	osg::Image* mipmapped = buildMipmaps( image );
+	if( mipmapped != NULL )
+		image = mipmapped;
+
+	bool write;
+	{
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+		write = writing.insert( hash + ".bzt" ).second;
+	}
+	if( !write )
+		return image;
+
+	// another thread may have stored it already
+	if( exists( getImagePath( hash ) ) ) {
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+		writing.erase( hash + ".bzt" );
+		return image;
+	}
+
+	ImageHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, "BZTX", 4 );
+	header.version = IMAGE_VERSION;
+	header.byteOrder = IMAGE_BYTE_ORDER;
+	header.width = image->s();
+	header.height = image->t();
+	header.internalFormat = image->getInternalTextureFormat();
+	header.pixelFormat = image->getPixelFormat();
+	header.dataType = image->getDataType();
+	header.packing = image->getPacking();
+	header.levels = image->getNumMipmapLevels();
+	header.dataSize = image->getTotalSizeInBytesIncludingMipmaps();
+
+	vector< uint32 > offsets;
+	for( unsigned int level = 0; level < header.levels; level++ )
+		offsets.push_back( image->getMipmapOffset( level ) );
+
+	BZWWriter out;
+	bool ok = out.open( getImagePath( hash ).c_str() );
+	if( ok ) {
+		out.write( (const char*)&header, sizeof( header ) );
+		out.write( (const char*)&offsets[0], offsets.size() * sizeof( uint32 ) );
+		out.write( (const char*)image->data(), (size_t)header.dataSize );
+		ok = out.close();
+	}
+
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+	writing.erase( hash + ".bzt" );
+	if( ok ) {
+		imagesStored++;
+
+		uint64 bytes = sizeof( header ) + offsets.size() * sizeof( uint32 ) + header.dataSize;
+		for( map< string, Entry >::iterator i = entries.begin(); i != entries.end(); i++ ) {
+			if( i->second.hash == hash )
+				i->second.size += bytes;
+		}
+		dirty = true;
+
+		evict( hash );
+	}
+
+	return image;
+}
+
+unsigned long long TextureCache::getSize() {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+
+	map< string, uint64 > sizes;
+	for( map< string, Entry >::iterator i = entries.begin(); i != entries.end(); i++ )
+		sizes[ i->second.hash ] = i->second.size;
+
+	uint64 total = 0;
+	for( map< string, uint64 >::iterator i = sizes.begin(); i != sizes.end(); i++ )
+		total += i->second;
+
+	return total;
+}
+
+void TextureCache::setBudget( unsigned long long size ) {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+
+	budget = size;
+	evict( "" );
+}
+
+void TextureCache::evict( const string& keep ) {
+	// the size of each of the contents, and when any of its URLs was last used
+	map< string, pair< uint64, uint64 > > contents;
+	uint64 total = 0;
+	for( map< string, Entry >::iterator i = entries.begin(); i != entries.end(); i++ ) {
+		map< string, pair< uint64, uint64 > >::iterator c = contents.find( i->second.hash );
+		if( c == contents.end() ) {
+			contents[ i->second.hash ] = make_pair( i->second.lastUsed, i->second.size );
+			total += i->second.size;
+		}
+		else if( i->second.lastUsed > c->second.first ) {
+			c->second.first = i->second.lastUsed;
+		}
+	}
+
+	if( total <= budget )
+		return;
+
+	// oldest first
+	vector< pair< uint64, string > > order;
+	for( map< string, pair< uint64, uint64 > >::iterator c = contents.begin(); c != contents.end(); c++ )
+		order.push_back( make_pair( c->second.first, c->first ) );
+	sort( order.begin(), order.end() );
+
+	for( vector< pair< uint64, string > >::iterator o = order.begin(); o != order.end() && total > budget; o++ ) {
+		if( o->second == keep )
+			continue;
+
+		total -= contents[ o->second ].second;
+		removeContents( o->second );
+
+		for( map< string, Entry >::iterator i = entries.begin(); i != entries.end(); ) {
+			if( i->second.hash == o->second )
+				entries.erase( i++ );
+			else
+				i++;
+		}
+	}
+
+	dirty = true;
+}
+
+void TextureCache::removeContents( const string& hash ) {
+	remove( getContentPath( hash ).c_str() );
+	remove( getImagePath( hash ).c_str() );
+}
+
+void TextureCache::clear() {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+
+	for( map< string, Entry >::iterator i = entries.begin(); i != entries.end(); i++ )
+		removeContents( i->second.hash );
+	entries.clear();
+
+	remove( ( directory + "index" ).c_str() );
+	dirty = false;
+}
+
+// halve each level with a 2x2 box filter, down to 1x1
+osg::Image* TextureCache::buildMipmaps( osg::Image* image ) {
+	if( image == NULL || image->data() == NULL || image->isMipmap() || image->isCompressed() ||
+		image->getDataType() != GL_UNSIGNED_BYTE || image->r() != 1 )
+		return NULL;
+
+	unsigned int components = osg::Image::computeNumComponents( image->getPixelFormat() );
+	unsigned int width = image->s(), height = image->t();
+	if( components < 1 || components > 4 || width == 0 || height == 0 ||
+		image->getRowSizeInBytes() != width * components )
+		return NULL;
+
+	// where each level starts
+	osg::Image::MipmapDataType mipmaps;
+	unsigned int total = width * height * components;
+	for( unsigned int w = width, h = height; w > 1 || h > 1; ) {
+		w = osg::maximum( w / 2, 1u );
+		h = osg::maximum( h / 2, 1u );
+		mipmaps.push_back( total );
+		total += w * h * components;
+	}
+
+	unsigned char* pixels = new unsigned char[ total ];
+	memcpy( pixels, image->data(), width * height * components );
+
+	const unsigned char* source = pixels;
+	unsigned int w = width, h = height;
+	for( unsigned int level = 0; level < mipmaps.size(); level++ ) {
+		unsigned int w2 = osg::maximum( w / 2, 1u );
+		unsigned int h2 = osg::maximum( h / 2, 1u );
+		unsigned char* target = pixels + mipmaps[ level ];
+
+		for( unsigned int y = 0; y < h2; y++ ) {
+			const unsigned char* row0 = source + ( 2 * y ) * w * components;
+			const unsigned char* row1 = source + osg::minimum( 2 * y + 1, h - 1 ) * w * components;
+			for( unsigned int x = 0; x < w2; x++ ) {
+				unsigned int x0 = 2 * x * components;
+				unsigned int x1 = osg::minimum( 2 * x + 1, w - 1 ) * components;
+				for( unsigned int c = 0; c < components; c++ )
+					*target++ = (unsigned char)( ( row0[ x0 + c ] + row0[ x1 + c ] + row1[ x0 + c ] + row1[ x1 + c ] + 2 ) / 4 );
+			}
+		}
+
+		source = pixels + mipmaps[ level ];
+		w = w2;
+		h = h2;
+	}
+
+	osg::Image* mipmapped = new osg::Image();
+	mipmapped->setImage( width, height, 1, image->getInternalTextureFormat(), image->getPixelFormat(), GL_UNSIGNED_BYTE,
+						 pixels, osg::Image::USE_NEW_DELETE, 1 );
+	mipmapped->setMipmapLevels( mipmaps );
+	mipmapped->setOrigin( image->getOrigin() );
+	mipmapped->setFileName( image->getFileName() );
+
+	return mipmapped;
+}
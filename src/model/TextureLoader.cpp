@@ -0,0 +1,381 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <curl/curl.h>
+#include <curl/easy.h>
+
+#include <stdio.h>
+
+#include "model/TextureLoader.h"
+#include "TextUtils.h"
+#include "OSFile.h"
+
+#include <osgDB/ReadFile>
+
+#include <OpenThreads/ScopedLock>
+
+using namespace std;
+
+const int TextureLoader::DOWNLOAD_THREADS = 4;
+
+// used by curl to collect a download
+static size_t writeCurlData( void* ptr, size_t size, size_t nmemb, string* contents ) {
+	contents->append( (const char*)ptr, size * nmemb );
+	return size * nmemb;
+}
+
+// the response headers revalidation needs
+struct ResponseHeaders {
+	string etag;
+	string lastModified;
+};
+
+// used by curl to pass each response header line
+static size_t readCurlHeader( void* ptr, size_t size, size_t nmemb, ResponseHeaders* headers ) {
+	string line( (const char*)ptr, size * nmemb );
+
+	string::size_type colon = line.find( ':' );
+	if( colon != string::npos ) {
+		string field = TextUtils::tolower( line.substr( 0, colon ) );
+		string value = line.substr( colon + 1 );
+
+		string::size_type first = value.find_first_not_of( " \t\r\n" );
+		string::size_type last = value.find_last_not_of( " \t\r\n" );
+		value = ( first == string::npos ? string() : value.substr( first, last - first + 1 ) );
+
+		if( field == "etag" )
+			headers->etag = value;
+		else if( field == "last-modified" )
+			headers->lastModified = value;
+	}
+
+	return size * nmemb;
+}
+
+// guards the placeholder and the shared loader
+static OpenThreads::Mutex sharedMutex;
+
+TextureLoader::TextureLoader( const string& cacheDirectory ) {
+	downloadPool = NULL;
+	decodePool = NULL;
+	outstanding = 0;
+	cancelled = false;
+
+	cache = new TextureCache( cacheDirectory.length() > 0 ? cacheDirectory : string( FindShareFile( "textures/bzwb_cache/" ) ) );
+
+	// curl's global setup isn't thread-safe, so it can't be left to the first download
+	curl_global_init( CURL_GLOBAL_ALL );
+}
+
+TextureLoader::~TextureLoader() {
+	cancelled = true;
+
+	// the pools finish what they're running and drop the rest
+	delete downloadPool;
+	delete decodePool;
+
+	for( map< string, Request* >::iterator i = requests.begin(); i != requests.end(); i++ )
+		delete i->second;
+
+	delete cache;
+}
+
+TextureLoader* TextureLoader::getSharedLoader() {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( sharedMutex );
+
+	static TextureLoader* sharedLoader = NULL;
+	if( sharedLoader == NULL )
+		sharedLoader = new TextureLoader();
+
+	return sharedLoader;
+}
+
+// a small grey checkerboard
+osg::Image* TextureLoader::getPlaceholder() {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( sharedMutex );
+
+	static osg::ref_ptr< osg::Image > placeholder;
+	if( !placeholder.valid() ) {
+		placeholder = new osg::Image();
+		placeholder->allocateImage( 2, 2, 1, GL_RGBA, GL_UNSIGNED_BYTE );
+
+		unsigned char* data = placeholder->data();
+		for( int i = 0; i < 4; i++ ) {
+			unsigned char shade = ( ( i == 0 || i == 3 ) ? 160 : 112 );
+			data[ i * 4 + 0 ] = shade;
+			data[ i * 4 + 1 ] = shade;
+			data[ i * 4 + 2 ] = shade;
+			data[ i * 4 + 3 ] = 255;
+		}
+	}
+
+	return placeholder.get();
+}
+
+WorkerPool* TextureLoader::getDownloadPool() {
+	if( downloadPool == NULL )
+		downloadPool = new WorkerPool( DOWNLOAD_THREADS );
+	return downloadPool;
+}
+
+WorkerPool* TextureLoader::getDecodePool() {
+	if( decodePool == NULL )
+		decodePool = new WorkerPool();
+	return decodePool;
+}
+
+osg::Texture2D* TextureLoader::load( const string& name ) {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+
+	// everyone asking for the same name shares the one texture
+	map< string, Request* >::iterator i = requests.find( name );
+	if( i != requests.end() )
+		return i->second->texture.get();
+
+	Request* request = new Request();
+	request->loader = this;
+	request->name = name;
+	request->swapped = false;
+	request->next = NULL;
+	resolve( request );
+
+	osg::Texture2D* texture = new osg::Texture2D();
+
+	// don't allow OSG to optimize the texture (otherwise it may disappear)
+	texture->setDataVariance( osg::Object::DYNAMIC );
+
+	// show the placeholder until the real image is in
+	texture->setImage( getPlaceholder() );
+
+	// turn on GL_REPEAT texture wrapping
+	texture->setWrap( osg::Texture::WRAP_R, osg::Texture::REPEAT );
+	texture->setWrap( osg::Texture::WRAP_S, osg::Texture::REPEAT );
+	texture->setWrap( osg::Texture::WRAP_T, osg::Texture::REPEAT );
+
+	request->texture = texture;
+	requests[ name ] = request;
+	outstanding++;
+
+	// downloads go through their own pool, which bounds how many are open at once;
+	// the decode pool is started here either way, since downloads hand off to it
+	WorkerPool* decoders = getDecodePool();
+	if( !request->fetched )
+		getDownloadPool()->add( request );
+	else
+		decoders->add( request );
+
+	return texture;
+}
+
+// work out where a texture comes from
+void TextureLoader::resolve( Request* request ) {
+	string searchPath( FindShareFile( "textures/" ) );
+	string name = request->name;
+
+	request->uiPath = searchPath + "../UI/";
+	request->fetched = true;
+
+	// remote textures always go to the server, which says whether the cached copy is still good
+	string protocol( "http://" );
+	if( name.length() > protocol.length() && TextUtils::tolower( name.substr( 0, protocol.length() ) ) == protocol ) {
+		request->url = name;
+		request->fetched = false;
+		return;
+	}
+
+	// strip the .png extension, since it gets added back on
+	if( name.length() >= 4 && TextUtils::tolower( name.substr( name.length() - 4 ) ) == ".png" )
+		name = name.substr( 0, name.length() - 4 );
+
+	request->path = searchPath + name + ".png";
+}
+
+void TextureLoader::Request::run() {
+	if( loader->cancelled )
+		return;
+
+	if( !fetched ) {
+		TextureCache* cache = loader->cache;
+
+		TextureCache::Entry entry;
+		bool cached = cache->lookup( url, entry );
+
+		string contents, etag, lastModified;
+		FetchResult result = fetch( url, cached ? &entry : NULL, contents, etag, lastModified );
+
+		// a server that can't be reached still leaves the cached copy to fall back on
+		if( result == FETCH_OK )
+			hash = cache->store( url, contents, etag, lastModified );
+		else if( cached )
+			hash = entry.hash;
+
+		if( hash.length() > 0 )
+			path = cache->getContentPath( hash );
+		else
+			path = uiPath + "error_downloading.png";
+
+		// decode it on the other pool, so this slot is free for the next download
+		fetched = true;
+		loader->decodePool->add( this );
+		return;
+	}
+
+	// a cached download that was decoded before skips the decoder
+	if( hash.length() > 0 ) {
+		image = loader->cache->readImage( hash );
+		if( image.valid() ) {
+			loader->finished.push( this );
+			return;
+		}
+	}
+
+	// see if texture file exists and use a default "missing texture" if it doesn't
+	if( !exists( path ) ) {
+		printf( "Can not find texture: %s\n", path.c_str() );
+		path = uiPath + "not_found.png";
+		hash = "";
+	}
+
+	image = osgDB::readImageFile( path );
+
+	// next time, it comes straight from the cache
+	if( hash.length() > 0 && image.valid() )
+		image = loader->cache->storeImage( hash, image.get() );
+
+	loader->finished.push( this );
+}
+
+bool TextureLoader::update() {
+	Request* request = finished.takeAll();
+	if( request == NULL )
+		return false;
+
+	unsigned int count = 0;
+	while( request != NULL ) {
+		Request* next = request->next;
+		request->next = NULL;
+
+		// a texture whose file wouldn't load keeps the placeholder
+		if( request->image.valid() )
+			request->texture->setImage( request->image.get() );
+		request->image = NULL;
+		request->swapped = true;
+
+		count++;
+		request = next;
+	}
+
+	{
+		OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+		outstanding -= count;
+	}
+
+	// write the index out whenever a batch comes in, so it survives a crash
+	cache->save();
+
+	return true;
+}
+
+bool TextureLoader::isBusy() {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+	return outstanding > 0;
+}
+
+void TextureLoader::wait() {
+	// downloads hand off to the decode pool before they finish, so wait on them first
+	if( downloadPool != NULL )
+		downloadPool->wait();
+	if( decodePool != NULL )
+		decodePool->wait();
+
+	update();
+}
+
+void TextureLoader::clear() {
+	OpenThreads::ScopedLock< OpenThreads::Mutex > lock( mutex );
+
+	// the workers still hold the ones that haven't come back
+	map< string, Request* >::iterator i = requests.begin();
+	while( i != requests.end() ) {
+		if( i->second->swapped ) {
+			delete i->second;
+			requests.erase( i++ );
+		}
+		else
+			i++;
+	}
+}
+
+bool TextureLoader::exists( const string& path ) {
+	FILE* file = fopen( path.c_str(), "rb" );
+	if( file == NULL )
+		return false;
+
+	fclose( file );
+	return true;
+}
+
+TextureLoader::FetchResult TextureLoader::fetch( const string& url, const TextureCache::Entry* cached,
+												 string& contents, string& etag, string& lastModified ) {
+	CURL* curl = curl_easy_init();
+	if( curl == NULL )
+		return FETCH_FAILED;
+
+	ResponseHeaders headers;
+
+	curl_easy_setopt( curl, CURLOPT_URL, url.c_str() );
+	curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, writeCurlData );
+	curl_easy_setopt( curl, CURLOPT_WRITEDATA, &contents );
+	curl_easy_setopt( curl, CURLOPT_HEADERFUNCTION, readCurlHeader );
+	curl_easy_setopt( curl, CURLOPT_HEADERDATA, &headers );
+	curl_easy_setopt( curl, CURLOPT_FOLLOWLOCATION, 1L );
+	curl_easy_setopt( curl, CURLOPT_CONNECTTIMEOUT, 10L );
+
+	// signals don't mix with threads
+	curl_easy_setopt( curl, CURLOPT_NOSIGNAL, 1L );
+
+	// ask for the contents only if they changed
+	struct curl_slist* conditions = NULL;
+	if( cached != NULL ) {
+		if( cached->etag.length() > 0 )
+			conditions = curl_slist_append( conditions, ( "If-None-Match: " + cached->etag ).c_str() );
+		if( cached->lastModified.length() > 0 )
+			conditions = curl_slist_append( conditions, ( "If-Modified-Since: " + cached->lastModified ).c_str() );
+		curl_easy_setopt( curl, CURLOPT_HTTPHEADER, conditions );
+	}
+
+	CURLcode res = curl_easy_perform( curl );
+	long status = 0;
+	curl_easy_getinfo( curl, CURLINFO_RESPONSE_CODE, &status );
+
+	curl_easy_cleanup( curl );
+	curl_slist_free_all( conditions );
+
+	if( res != 0 ) {
+		printf( "Error Downloading: %s, %s\n", url.c_str(), curl_easy_strerror( res ) );
+		return FETCH_FAILED;
+	}
+
+	if( status == 304 && cached != NULL )
+		return FETCH_NOT_MODIFIED;
+
+	if( status < 200 || status >= 300 ) {
+		printf( "Error Downloading: %s, HTTP %li\n", url.c_str(), status );
+		return FETCH_FAILED;
+	}
+
+	printf( "Downloaded Texture: %s\n", url.c_str() );
+
+	etag = headers.etag;
+	lastModified = headers.lastModified;
+	return FETCH_OK;
+}
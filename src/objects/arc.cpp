@@ -141,6 +141,9 @@ bool arc::parse( std::string& line ) {
 	else if ( key == "ratio" ) {
 		ratio = atof( value.c_str() );
 	}
+	else if ( key == "size" ) {
+		realSize = Point3D( value.c_str() );
+	}
 	else {
 		return bz2object::parse( line );
 	}
@@ -191,6 +194,7 @@ int arc::render(void) {
 
 void arc::setSize( osg::Vec3 newSize ) {
 	realSize = newSize;
+	setChanged();
 	updateGeometry();
 }
 
@@ -64,6 +64,7 @@ bool base::parse( std::string& line ) {
 }
 
 void base::finalize() {
+	updateBaseUV( (osg::Group*)getThisNode(), getSize() );
 	setBaseColor( team );
 }
 
@@ -76,6 +76,15 @@ string bz2object::get(void)
   return toString();
 }
 
+void bz2object::setName( const std::string& name ) {
+	if( name == getName() )
+		return;
+
+	std::string oldName = getName();
+	Object::setName( name );
+	Model::renameObject( this, oldName );
+}
+
 // parse a single bzw line
 bool bz2object::parse( std::string& line ) {
 	string key = BZWParser::key( line.c_str() );
@@ -104,9 +113,9 @@ bool bz2object::parse( std::string& line ) {
 		return true;
 	}
 
-	// get the size
+	// get the size (only the scale; the subclasses rebuild their geometry for it in finalize())
 	else if ( key == "size" && isKey( "size" ) ) {
-		setSize( Point3D( value.c_str() ) );
+		bz2object::setSize( Point3D( value.c_str() ) );
 		return true;
 	}
 
@@ -238,7 +247,7 @@ bool bz2object::parse( std::string& line ) {
 	if ( key == "texture" ) {
 		material* mat = new material();
 		mat->setMatType(material::MAT_TEXTURE);
-		mat->setTexture( value.c_str() );
+		mat->addTexture( value.c_str() );	// the texture is loaded when the final material is computed
 		for ( map< string, MaterialSlot >::iterator i = materialSlots.begin(); i != materialSlots.end(); i++ ) {
 			//only apply to ALL slot
 			if (mat && i->first == "")
@@ -326,18 +335,25 @@ string bz2object::BZWLines( bz2object* obj )
 
 	// add position key/value to the string if supported
 	if(obj->isKey("position"))
-		if ( obj->getPosition() != osg::Vec3( 0, 0, 0 ) )
-			ret += "  position " + Point3D( obj->getPosition() ).toString();
+		if ( obj->getPosition() != osg::Vec3( 0, 0, 0 ) ) {
+			ret += "  position ";
+			Point3D( obj->getPosition() ).appendTo( ret );
+		}
 
 	// add rotation key/value to the string if supported
 	if(obj->isKey("rotation"))
-		if ( obj->orientation->getRotation().z() != 0.0f )
-			ret += "  rotation " + string( ftoa(obj->orientation->getRotation().z()) ) + "\n";
+		if ( obj->orientation->getRotation().z() != 0.0f ) {
+			ret += "  rotation ";
+			appendFloat( ret, obj->orientation->getRotation().z() );
+			ret += '\n';
+		}
 
 	// add size key/value to the string if supported
 	if(obj->isKey("size"))
-		if ( obj->getSize() != osg::Vec3( 0, 0, 0 ) )
-			ret += "  size " + Point3D( obj->getSize() ).toString();
+		if ( obj->getSize() != osg::Vec3( 0, 0, 0 ) ) {
+			ret += "  size ";
+			Point3D( obj->getSize() ).appendTo( ret );
+		}
 
 	// add obstacle key/value(s) to the string if supported
 	if(obj->isKey("passable") || obj->isKey("drivethrough") || obj->isKey("shootthrough") ){
@@ -402,6 +418,9 @@ string bz2object::BZWLines( bz2object* obj )
 // event handler
 int bz2object::update( UpdateMessage& message )
 {
+	// every message is an edit of some sort, so don't save the old text again
+	setChanged();
+
 	switch( message.type ) {
 		case UpdateMessage::SET_TRANSFORMATIONS: {		// update the transformation stack
 			if( !( isKey("spin") || isKey("shift") || isKey("shear") || isKey("scale") ) )
@@ -556,6 +575,9 @@ vector<string> bz2object::physicsSlotNames() {
 // recompute the material
 void bz2object::refreshMaterial()
 {
+	// the material list changed (or one of the materials did)
+	setChanged();
+
 	bool didAllSides = false;
 	osg::Texture2D* defaultTexture;
 	for ( map< string, MaterialSlot >::iterator i = materialSlots.begin(); i != materialSlots.end(); i++ ) {
@@ -564,11 +586,8 @@ void bz2object::refreshMaterial()
 		if(mat != NULL)
 			defaultTexture = dynamic_cast< osg::Texture2D* >((mat->getTextureAttribute( 0,  osg::StateAttribute::TEXTURE ) ));
 		if ( i->second.materials.size() > 0 ) {
-			mat = material::computeFinalMaterial( i->second.materials );
-			if(!((material*)mat)->getNoTextures() && ((material*)mat)->getCurrentTexture() == NULL && defaultTexture != NULL){
-				mat->setTextureMode( 0, GL_TEXTURE_2D, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE );
-				mat->setTextureAttribute( 0, defaultTexture );
-			}
+			// identical material lists share one final material (and so one StateSet)
+			mat = material::computeFinalMaterial( i->second.materials, defaultTexture );
 		}
 		if ( i->first == "" ){
 			//SceneBuilder::assignBZMaterial( mat, getThisNode() );
@@ -580,11 +599,7 @@ void bz2object::refreshMaterial()
 					if(dmat != NULL)
 						defaultTexture = dynamic_cast< osg::Texture2D* >((dmat->getTextureAttribute( 0,  osg::StateAttribute::TEXTURE ) ));
 					if ( i->second.materials.size() > 0 ) {
-						mat = material::computeFinalMaterial( i->second.materials );
-						if(!((material*)mat)->getNoTextures() && ((material*)mat)->getCurrentTexture() == NULL && defaultTexture != NULL){
-							mat->setTextureMode( 0, GL_TEXTURE_2D, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE );
-							mat->setTextureAttribute( 0, defaultTexture );
-						}
+						mat = material::computeFinalMaterial( i->second.materials, defaultTexture );
 					}
 					SceneBuilder::assignBZMaterial( mat, ii->second.node );
 				}
@@ -604,6 +619,7 @@ void bz2object::refreshMaterial()
 
 void bz2object::setMaterials( vector< material* >& _materials, std::string slot ) { 
 	this->materialSlots[ slot ].materials = _materials; 
+	setChanged();
 }
 
 void bz2object::snapTranslate( float size, osg::Vec3 position ) {
@@ -625,6 +641,7 @@ void bz2object::snapRotate( float size, float rotation ) {
 	tmp = osg::round( tmp );
 	tmp *= size;
 	orientation->setRotationZ( tmp );
+	setChanged();
 }
 
 // set the shade model based on the value of flatShading
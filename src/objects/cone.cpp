@@ -95,7 +95,7 @@ bool cone::parse( std::string& line ) {
 
 	// parse keys
 	if ( key == "flipz" ) {
-		setFlipz(true);
+		flipz = true;
 	}
 	else if ( key == "divisions" ) {
 		divisions = atof( value.c_str() );
@@ -17,8 +17,22 @@
 #include "objects/texturematrix.h"
 #include "objects/dynamicColor.h"
 
+#include "TextUtils.h"
+
+#include <algorithm>
+
 using namespace std;
 
+std::map< unsigned long long, std::vector< material::FinalMaterial > > material::finalMaterials;
+unsigned int material::finalMaterialCount = 0;
+unsigned int material::finalMaterialRequests = 0;
+unsigned int material::finalMaterialPruneAt = 256;
+
+// append the bytes of a value to a final material key
+template< class T > static void appendKey( string& key, const T& value ) {
+	key.append( (const char*)&value, sizeof( value ) );
+}
+
 // default constructor
 material::material() :
 	DataEntry("material", "<name><texture><addtexture><matref><notextures><notexcolor><notexalpha><texmat><dyncol><ambient><diffuse><color><specular><emission><shininess><resetmat><spheremap><noshadow><noculling><nosort><noradar><nolighting><groupalpha><occluder><alphathresh>"),
@@ -355,7 +369,7 @@ material& material::operator=(material const &rhs) {
 };
 
 // compute the final material from a list of materials
-material* material::computeFinalMaterial( vector< material* >& materialList ) {
+material* material::computeFinalMaterial( vector< material* >& materialList, osg::Texture2D* defaultTexture ) {
 	osg::Vec4 ambient = osg::Vec4( 0, 0, 0, 0),
 			  diffuse = osg::Vec4( 0, 0, 0, 0),
 			  specular = osg::Vec4( 0, 0, 0, 0),
@@ -409,6 +423,37 @@ material* material::computeFinalMaterial( vector< material* >& materialList ) {
 		}
 	}
 
+	// the default texture only shows if nothing else has one
+	if( foundTexture || notex )
+		defaultTexture = NULL;
+
+	// everything that goes into the material below, so identical ones can be shared
+	string key;
+	appendKey( key, ambient );
+	appendKey( key, diffuse );
+	appendKey( key, specular );
+	appendKey( key, emission );
+	appendKey( key, shiny );
+	appendKey( key, alphaThreshold );
+	appendKey( key, notex );
+	appendKey( key, nocull );
+	appendKey( key, defaultTexture );
+	key += tex;
+
+	finalMaterialRequests++;
+
+	// materials that were edited leave behind finals no object uses anymore
+	// (this has to happen before the lookup, while everything handed out is in use)
+	if( finalMaterialCount >= finalMaterialPruneAt )
+		pruneFinalMaterials();
+
+	unsigned long long hash = TextUtils::hash( key.data(), key.data() + key.size() );
+	vector< FinalMaterial >& bucket = finalMaterials[ hash ];
+	for( vector< FinalMaterial >::iterator i = bucket.begin(); i != bucket.end(); i++ ) {
+		if( i->key == key )
+			return i->mat.get();
+	}
+
 	// build the material
 	material* mat = new material();
 	mat->setNoTextures(notex);
@@ -438,9 +483,55 @@ material* material::computeFinalMaterial( vector< material* >& materialList ) {
 	if( foundTexture ) {
 		mat->setTexture( tex );
 	}
+	else if( defaultTexture != NULL ) {
+		mat->setTextureMode( 0, GL_TEXTURE_2D, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE );
+		mat->setTextureAttribute( 0, defaultTexture );
+	}
+
+	FinalMaterial final;
+	final.key = key;
+	final.mat = mat;
+	bucket.push_back( final );
+	finalMaterialCount++;
+
 	return mat;
 }
 
+void material::pruneFinalMaterials() {
+	for( map< unsigned long long, vector< FinalMaterial > >::iterator i = finalMaterials.begin(); i != finalMaterials.end(); ) {
+		vector< FinalMaterial >& bucket = i->second;
+		for( vector< FinalMaterial >::iterator j = bucket.begin(); j != bucket.end(); ) {
+			// only referenced from here
+			if( j->mat->referenceCount() <= 1 ) {
+				j = bucket.erase( j );
+				finalMaterialCount--;
+			}
+			else
+				j++;
+		}
+
+		if( bucket.size() == 0 )
+			finalMaterials.erase( i++ );
+		else
+			i++;
+	}
+
+	// prune again once the table has doubled
+	finalMaterialPruneAt = max( 256u, finalMaterialCount * 2 );
+}
+
+void material::getFinalMaterialStats( unsigned int& requested, unsigned int& distinct ) {
+	requested = finalMaterialRequests;
+	distinct = finalMaterialCount;
+}
+
+void material::clearFinalMaterials() {
+	finalMaterials.clear();
+	finalMaterialCount = 0;
+	finalMaterialRequests = 0;
+	finalMaterialPruneAt = 256;
+}
+
 // compute the final osg material
 void material::computeFinalMaterial() {
 	osg::Vec4 ambient = osg::Vec4( 1.0, 1.0, 1.0, 1.0),
@@ -12,25 +12,17 @@
 
 #include "objects/mesh.h"
 
-struct TriIndices {
-  int indices[3];
-};
-
-struct MeshVertex {
-	osg::Vec3 vertex;
-	osg::Vec3 normal;
-	osg::Vec2 texcoord;
-};
+#include "render/DrawInfoLOD.h"
+#include "render/Triangulator.h"
+#include "WorkerPool.h"
 
 // default constructor
 mesh::mesh(void) :
 	bz2object("mesh", "<name><position><size><rotation><vertex><normal><texcoord><inside><outside><shift><scale><shear><spin><phydrv><smoothbounce><noclusters><face><drawinfo><drivethrough><shootthrough><passable>") {
 
 	decorative = false;
-	faces = vector<MeshFace*>();
 	drawInfo = NULL;
 	currentDrawInfo = NULL;
-	currentFace = NULL;
 	currentMaterial = NULL;
 	noclusters = false;
 	phydrv = NULL;
@@ -91,18 +83,11 @@ bool mesh::parse( std::string& line ) {
 	else if ( key == "lod" ) {
 		lodOptions.push_back( value );
 	}
-	else if ( currentFace ) {
-		if ( !currentFace->parse( line ) ) {
-			faces.push_back(currentFace);
-			currentFace = NULL;
-		}
+	else if ( data.isParsingFace() ) {
+		data.parseFace( line, this );
 	}
 	else if ( key == "face" ) {
-		if (currentFace != NULL) {
-			printf("mesh::update(): Warning! Discarding incomplete mesh face.\n");
-			delete currentFace;
-		}
-		currentFace = new MeshFace( currentMaterial, phydrv, noclusters, smoothbounce, drivethrough, shootthrough );
+		data.beginFace( currentMaterial, phydrv, noclusters, smoothbounce, drivethrough, shootthrough );
 	}
 	else if ( key == "inside" ) {
 		insidePoints.push_back( Point3D( value.c_str() ) );
@@ -111,13 +96,13 @@ bool mesh::parse( std::string& line ) {
 		outsidePoints.push_back( Point3D( value.c_str() ) );
 	}
 	else if ( key == "vertex" ) {
-		vertices.push_back( Point3D( value.c_str() ) );
+		data.addVertex( Point3D( value.c_str() ) );
 	}
 	else if ( key == "normal" ) {
-		normals.push_back( Point3D( value.c_str() ) );
+		data.addNormal( Point3D( value.c_str() ) );
 	}
 	else if ( key == "texcoord" ) {
-		texCoords.push_back( Point2D( value.c_str() ) );
+		data.addTexcoord( Point2D( value.c_str() ) );
 	}
 	else if ( key == "phydrv" ) {
 		physics* phys = (physics*)Model::command( MODEL_GET, "phydrv", value.c_str() );
@@ -163,35 +148,58 @@ void mesh::finalize() {
 	updateGeometry();
 }
 
+void mesh::optimize( float weldDistance, MeshOptimizer::Report& report ) {
+	MeshOptimizer::Report meshReport;
+	MeshOptimizer optimizer( weldDistance );
+	optimizer.optimize( data, drawInfo, meshReport );
+	report.add( meshReport );
+
+	setChanged();
+	updateGeometry();
+}
+
+bool mesh::generateLODs( unsigned int levels, vector< MeshSimplifier::Level >& made ) {
+	MeshSimplifier simplifier;
+	DrawInfo* newDrawInfo = simplifier.buildDrawInfo( data, levels, made );
+	if( newDrawInfo == NULL )
+		return false;
+
+	delete drawInfo;
+	drawInfo = newDrawInfo;
+
+	setChanged();
+	updateGeometry();
+	return true;
+}
+
 // to string
 string mesh::toString(void) {
 	// string-ify the vertices, normals, texcoords, inside points, outside points, passibility and faces
 	string vertexString(""), normalString(""), texcoordString(""), insideString(""), outsideString(""),passabilityString(""), faceString("");
 
-	if(vertices.size() > 0) {
-		for(vector<Point3D>::iterator i = vertices.begin(); i != vertices.end(); i++) {
-			vertexString += "  vertex " + i->toString();
-		}
+	const vector<osg::Vec3>& vertices = data.getVertices();
+	for(vector<osg::Vec3>::const_iterator i = vertices.begin(); i != vertices.end(); i++) {
+		vertexString += "  vertex ";
+		Point3D( *i ).appendTo( vertexString );
 	}
 
-	if(normals.size() > 0) {
-		for(vector<Point3D>::iterator i = normals.begin(); i != normals.end(); i++) {
-			normalString += "  normal " + i->toString();
-		}
+	const vector<osg::Vec3>& normals = data.getNormals();
+	for(vector<osg::Vec3>::const_iterator i = normals.begin(); i != normals.end(); i++) {
+		normalString += "  normal ";
+		Point3D( *i ).appendTo( normalString );
 	}
 
-	if(texCoords.size() > 0) {
-		for(vector<Point2D>::iterator i = texCoords.begin(); i != texCoords.end(); i++) {
-			texcoordString += "  texcoord " + i->toString();
-		}
+	const vector<osg::Vec2>& texCoords = data.getTexcoords();
+	for(vector<osg::Vec2>::const_iterator i = texCoords.begin(); i != texCoords.end(); i++) {
+		texcoordString += "  texcoord ";
+		Point2D( *i ).appendTo( texcoordString );
 	}
 
 	// special instance:
 	// make sure to keep the order of faces and materials constant
-	if(faces.size() > 0) {
-		for(vector<MeshFace*>::iterator i = faces.begin(); i != faces.end(); i++) {
-			faceString += "  " + (*i)->toString();
-		}
+	for(unsigned int i = 0; i < data.getFaceCount(); i++) {
+		faceString += "  ";
+		data.getFace( i ).appendTo( faceString );
 	}
 
 	if(insidePoints.size() > 0) {
@@ -233,55 +241,81 @@ int mesh::render(void) {
 	return 0;
 }
 
+// make one vertex for each drawinfo corner
+template< class Vertices, class Normals, class Texcoords >
+static void copyCorners( const vector<Index3D>& corners, const Vertices& vs, const Normals& ns, const Texcoords& ts,
+						 osg::Vec3Array* verts, osg::ref_ptr< osg::Vec3Array >& norms, osg::ref_ptr< osg::Vec2Array >& tcoords ) {
+	bool hasNormals = ( ns.size() > 0 );
+	bool hasTexcoords = ( ts.size() > 0 );
+
+	verts->reserve( corners.size() );
+	if ( hasNormals ) {
+		norms = new osg::Vec3Array();
+		norms->reserve( corners.size() );
+	}
+	if ( hasTexcoords ) {
+		tcoords = new osg::Vec2Array();
+		tcoords->reserve( corners.size() );
+	}
+
+	for ( vector<Index3D>::const_iterator cc = corners.begin(); cc != corners.end(); cc++ ) {
+		verts->push_back( vs[cc->a] );
+		if ( hasNormals ) norms->push_back( ns[cc->b] );
+		if ( hasTexcoords ) tcoords->push_back( ts[cc->c] );
+	}
+}
+
 void mesh::updateGeometry() {
 	osg::Group* group = new osg::Group();
 
-	map< material*, osg::Geometry* > geomMap;
-	
 	bool hideDrawInfo = false;
 	// drawinfo replaces faces 
 	if(drawInfo && !hideDrawInfo){
-		//build drawInfo
-		osg::Geometry* geom = new osg::Geometry();
-		vector<Point3D> vs, ns;
-		vector<Point2D> ts;
-		vector<Index3D> corners = drawInfo->getCorners();
-		// drawInfo has vertices 
-			if(drawInfo->getVertices().size() > 0){
-				// use drawInfo defined vertices, normals and texcoords
-				vs = drawInfo->getVertices();
-				ns = drawInfo->getNormals();
-				ts = drawInfo->getTexcoords();
-			}else{ // drawInfo has no vertices
-				// use mesh's original vertices, normals and texcoords
-				vs = vertices;
-				ns = normals;
-				ts = texCoords;
-			}
-		bool hasNormals = (ns.size() > 0 ? true : false);
-		bool hasTexcoords = (ts.size() > 0 ? true : false);
-		geom->setVertexArray( new osg::Vec3Array() );
-		osg::Vec3Array* verts = (osg::Vec3Array*)geom->getVertexArray();
-		if(ns.size() > 0)
-			geom->setNormalArray( new osg::Vec3Array() );
-		osg::Vec3Array* norms = (osg::Vec3Array*)geom->getNormalArray();
-		if(ts.size() > 0)
-			geom->setTexCoordArray(0,  new osg::Vec2Array() );
-		osg::Vec2Array* tcoords = NULL;
-		if ( geom->getNumTexCoordArrays() > 0 )
-			tcoords = (osg::Vec2Array*)geom->getTexCoordArray( 0 );
-		
-		vector<LOD> lods = drawInfo->getLods();
-		for ( vector<LOD>::iterator i = lods.begin(); i != lods.end(); i++ ) {
-			// FIXME: need to know distance mesh is from camara to determine which LOD to show
-			float lpp = i->getLengthPerPixel();
-			// process Material Sets in LOD
-			vector<LOD::MaterialSet*> matSets = i->getMaterialSets();
+		// build the drawinfo's vertex arrays once, with one vertex per corner, and share
+		// them between every level of detail and material set
+		vector<Index3D>& corners = drawInfo->getCorners();
+		osg::ref_ptr< osg::Vec3Array > verts = new osg::Vec3Array();
+		osg::ref_ptr< osg::Vec3Array > norms;
+		osg::ref_ptr< osg::Vec2Array > tcoords;
+		if(drawInfo->getVertices().size() > 0){
+			// use drawInfo defined vertices, normals and texcoords
+			copyCorners( corners, drawInfo->getVertices(), drawInfo->getNormals(), drawInfo->getTexcoords(), verts, norms, tcoords );
+		}else{ // drawInfo has no vertices
+			// use mesh's original vertices, normals and texcoords
+			copyCorners( corners, data.getVertices(), data.getNormals(), data.getTexcoords(), verts, norms, tcoords );
+		}
+		bool hasNormals = norms.valid();
+		bool hasTexcoords = tcoords.valid();
+
+		// levels go from the most detailed (smallest lengthPerPixel) to the least
+		vector<LOD>& lods = drawInfo->getLods();
+		multimap< float, LOD* > levels;
+		for ( vector<LOD>::iterator i = lods.begin(); i != lods.end(); i++ )
+			levels.insert( make_pair( i->getLengthPerPixel(), &(*i) ) );
+
+		material* defaultMat = NULL;
+
+		DrawInfoLOD* lodNode = new DrawInfoLOD();
+		for ( multimap< float, LOD* >::iterator i = levels.begin(); i != levels.end(); i++ ) {
+			osg::Group* level = new osg::Group();
+
+			// process Material Sets in LOD, with one Geometry for each
+			vector<LOD::MaterialSet*>& matSets = i->second->getMaterialSets();
 			for ( vector<LOD::MaterialSet*>::iterator m = matSets.begin(); m != matSets.end(); m++ ) {
-					// get matref name
+				// get matref name
 				bool useDlist = false;
 				string matName = (*m)->matref;
 				material* mat = (material*)Model::command( MODEL_GET, "material", matName );
+
+				osg::ref_ptr< osg::Geometry > geom = new osg::Geometry();
+				geom->setVertexArray( verts.get() );
+				if ( hasNormals ) {
+					geom->setNormalArray( norms.get() );
+					geom->setNormalBinding( osg::Geometry::BIND_PER_VERTEX );
+				}
+				if ( hasTexcoords )
+					geom->setTexCoordArray( 0, tcoords.get() );
+
 				for ( vector<LODCommand>::iterator c = (*m)->commands.begin(); c != (*m)->commands.end(); c++ ) {
 					//create geometry
 					osg::DrawElementsUInt* drawElem = NULL;
@@ -308,346 +342,241 @@ void mesh::updateGeometry() {
 					} else if(c->getName().compare("polygon") == 0){
 						drawElem = new osg::DrawElementsUInt( osg::DrawElements::POLYGON, 0 );
 					}
-					if(drawElem){	
-					vector<int> indices = c->getArgs();
+					if(drawElem){
+						// the corners index the shared arrays directly
+						vector<int> indices = c->getArgs();
 						for ( vector<int>::iterator j = indices.begin(); j != indices.end(); j++ ) {
-							Index3D cc = corners[*j];
-							verts->push_back( vs[cc.a] );
-							if ( hasNormals ) norms->push_back( ns[cc.b] );
-							if ( hasTexcoords ) tcoords->push_back( ts[cc.c] );
-							drawElem->push_back( verts->size() - 1 );
+							if ( *j >= 0 && *j < (int)corners.size() )
+								drawElem->push_back( *j );
 						}
 						geom->addPrimitiveSet( drawElem );
-						if(!drawInfo->isDlist() && !useDlist)
-							geom->setUseDisplayList( false ); 
-						osg::Geode* geode = new osg::Geode();
-						geode->addDrawable( geom );
-						if(mat == NULL){
-							// set default material
-							mat = new material();
-							mat->setTexture("mesh");
-						}
-						SceneBuilder::assignBZMaterial(mat, geode);
-						group->addChild( geode );
 					} // end if drawElem
 				} // end commands
+
+				if ( geom->getNumPrimitiveSets() == 0 )
+					continue;
+				if(!drawInfo->isDlist() && !useDlist)
+					geom->setUseDisplayList( false );
+
+				osg::Geode* geode = new osg::Geode();
+				geode->addDrawable( geom.get() );
+				if(mat == NULL){
+					// set default material
+					if(defaultMat == NULL){
+						defaultMat = new material();
+						defaultMat->setTexture("mesh");
+					}
+					mat = defaultMat;
+				}
+				SceneBuilder::assignBZMaterial(mat, geode);
+				level->addChild( geode );
 			} // end matSets
-			//bail out after first lod - instead of drawing all lods
-			//break;
+
+			lodNode->addLevel( level, i->first );
 		}
+
+		group->addChild( lodNode );
 	}else{
-		//build faces
-	
+		buildFaces( group );
+	}
 	
-	for ( vector< MeshFace* >::iterator i = faces.begin(); i != faces.end(); i++ ) {
-		MeshFace* face = *i;
-		material* mat = face->getMaterial();
-		
-		osg::Geometry* geom;
-		if ( geomMap.count( mat ) > 0 ) {
-			geom = geomMap[ mat ];
-		}
-		else {
-			geom = new osg::Geometry();
-			geom->setVertexArray( new osg::Vec3Array() );
-			geomMap[ mat ] = geom;
-		}
+	setThisNode( group );
+}
+
+/*
+ * Face geometry
+ */
+
+// faces are triangulated on the worker pool this many at a time
+#define FACE_GRAIN 256
+
+// the faces that share a material, drawn as one Geometry
+struct MeshFaceSet {
+	material* mat;
+
+	// how many vertices its faces make, and whether any of them have normals or texcoords
+	unsigned int size;
+	bool hasNormals;
+	bool hasTexcoords;
+
+	osg::ref_ptr< osg::Vec3Array > vertices;
+	osg::ref_ptr< osg::Vec3Array > normals;
+	osg::ref_ptr< osg::Vec2Array > texcoords;
+};
 
-		// get the vertices for the current face
-		vector<int> vertIndices = face->getVertices();
-		vector<int> normalIndices = face->getNormals();
-		vector<int> texcoordIndices = face->getTexcoords();
-		bool hasNormals = false, hasTexcoords = false;
-
-		// get the arrays
-		osg::Vec3Array* verts = (osg::Vec3Array*)geom->getVertexArray();
-		osg::Vec3Array* norms = (osg::Vec3Array*)geom->getNormalArray();
-		osg::Vec2Array* tcoords = NULL;
-		if ( geom->getNumTexCoordArrays() > 0 )
-			tcoords = (osg::Vec2Array*)geom->getTexCoordArray( 0 );
-
-		// check if there are normals and texcoords and if there are the right amount
-		if ( normalIndices.size() > 0 ) {
-			if ( normalIndices.size() == vertIndices.size() ) {
-				hasNormals = true;
-
-				// if there isn't a normals array make one
-				if ( norms == NULL ) {
-					norms = new osg::Vec3Array();
-					geom->setNormalArray( norms );
+// where a face's triangles go
+struct MeshFaceSlot {
+	unsigned int set;
+
+	// the first of its vertices in the set's arrays, and how many there are
+	unsigned int offset;
+	unsigned int size;
+};
+
+// triangulates faces into the slots counted out for them
+class MeshFaceRange : public WorkerRange {
+
+public:
+	MeshFaceRange( vector< MeshFaceSlot >& _slots, vector< MeshFaceSet >& _sets, const MeshData& _data ) :
+		slots( _slots ), sets( _sets ), data( _data ) { }
+
+	virtual void run( unsigned int begin, unsigned int end ) {
+		// one for each chunk, so the threads don't share one
+		Triangulator triangulator;
+		vector<unsigned int> corners;
+
+		const osg::Vec3* vertices = ( data.getVertices().empty() ? NULL : &data.getVertices()[0] );
+		const osg::Vec3* normals = ( data.getNormals().empty() ? NULL : &data.getNormals()[0] );
+		const osg::Vec2* texCoords = ( data.getTexcoords().empty() ? NULL : &data.getTexcoords()[0] );
+
+		for ( unsigned int i = begin; i < end; i++ ) {
+			MeshFaceSlot& slot = slots[i];
+			if ( slot.size == 0 )
+				continue;
+
+			MeshFace face = data.getFace( i );
+			const int* vertIndices = face.getVertices();
+			const int* normalIndices = face.getNormals();
+			const int* texcoordIndices = face.getTexcoords();
+
+			corners.clear();
+			triangulator.triangulate( vertices, vertIndices, face.getCount(), corners );
+
+			MeshFaceSet& set = sets[ slot.set ];
+			osg::Vec3* verts = &(*set.vertices)[ slot.offset ];
+			osg::Vec3* norms = ( set.hasNormals ? &(*set.normals)[ slot.offset ] : NULL );
+			osg::Vec2* tcoords = ( set.hasTexcoords ? &(*set.texcoords)[ slot.offset ] : NULL );
+
+			for ( unsigned int j = 0; j < corners.size(); j++ )
+				verts[j] = vertices[ vertIndices[ corners[j] ] ];
+
+			// faces without normals or texcoords, in a set where others have them, get
+			// their flat normal and texcoord (0, 0)
+			if ( norms != NULL ) {
+				if ( normalIndices != NULL ) {
+					for ( unsigned int j = 0; j < corners.size(); j++ )
+						norms[j] = normals[ normalIndices[ corners[j] ] ];
+				}
+				else {
+					for ( unsigned int j = 0; j < corners.size(); j += 3 ) {
+						osg::Vec3 normal = ( verts[j + 1] - verts[j] ) ^ ( verts[j + 2] - verts[j] );
+						normal.normalize();
+						norms[j] = norms[j + 1] = norms[j + 2] = normal;
+					}
 				}
 			}
-			else
-				throw BZWReadError( this, "Number of normals doesn't match number of vertices." );
-		}
 
-		if ( texcoordIndices.size() > 0 ) {
-			if ( texcoordIndices.size() == vertIndices.size() ) {
-				hasTexcoords = true;
-				
-				// if there isn't a texcoords array make one
-				if ( tcoords == NULL ) {
-					tcoords = new osg::Vec2Array();
-					geom->setTexCoordArray( 0, tcoords );
-				}
+			if ( tcoords != NULL ) {
+				for ( unsigned int j = 0; j < corners.size(); j++ )
+					tcoords[j] = ( texcoordIndices != NULL ? texCoords[ texcoordIndices[ corners[j] ] ] : osg::Vec2( 0, 0 ) );
 			}
-			else
-				throw BZWReadError( this, "Number of textcoords doesn't match number of vertices." );
 		}
+	}
 
-		vector<MeshVertex> faceVertices;
-		vector<int>::iterator v = vertIndices.begin();
-		vector<int>::iterator n = normalIndices.begin();
-		vector<int>::iterator t = texcoordIndices.begin();
-		for ( ; v != vertIndices.end(); v++ ) {
-			MeshVertex vtx;
-			vtx.vertex = vertices[ *v ];
-			if ( hasNormals ) {
-				vtx.normal = normals[ *n ];
-				n++;
-			}
-			if ( hasTexcoords ) {
-				vtx.texcoord = texCoords[ *t ];
-				t++;
+private:
+	vector< MeshFaceSlot >& slots;
+	vector< MeshFaceSet >& sets;
+	const MeshData& data;
+};
+
+// does every index point into an array of a size?
+static bool indicesInRange( const int* indices, unsigned int count, unsigned int size ) {
+	if ( indices == NULL )
+		return true;
+	for ( unsigned int i = 0; i < count; i++ ) {
+		if ( indices[i] < 0 || indices[i] >= (int)size )
+			return false;
+	}
+	return true;
+}
+
+// build the faces in two passes:  first count how many vertices each face makes, and where they go
+// in its material's arrays, then triangulate the faces straight into those arrays, in parallel
+void mesh::buildFaces( osg::Group* group ) {
+	vector< MeshFaceSlot > slots( data.getFaceCount() );
+	vector< MeshFaceSet > sets;
+	map< material*, unsigned int > setIndex;
+
+	// faces in a row usually share a material
+	material* lastMat = NULL;
+	unsigned int lastSet = 0;
+
+	for ( unsigned int i = 0; i < slots.size(); i++ ) {
+		MeshFace face = data.getFace( i );
+		unsigned int count = face.getCount();
+
+		MeshFaceSlot& slot = slots[i];
+		slot.size = 0;
+		slot.offset = 0;
+
+		material* mat = face.getMaterial();
+		if ( sets.empty() || mat != lastMat ) {
+			map< material*, unsigned int >::iterator s = setIndex.find( mat );
+			if ( s == setIndex.end() ) {
+				MeshFaceSet set;
+				set.mat = mat;
+				set.size = 0;
+				set.hasNormals = false;
+				set.hasTexcoords = false;
+				s = setIndex.insert( make_pair( mat, (unsigned int)sets.size() ) ).first;
+				sets.push_back( set );
 			}
-			faceVertices.push_back( vtx );
+			lastMat = mat;
+			lastSet = s->second;
 		}
+		slot.set = lastSet;
+
+		// faces that can't be drawn are left out
+		if ( count < 3 ||
+			 !indicesInRange( face.getVertices(), count, data.getVertices().size() ) ||
+			 !indicesInRange( face.getNormals(), count, data.getNormals().size() ) ||
+			 !indicesInRange( face.getTexcoords(), count, data.getTexcoords().size() ) )
+			continue;
+
+		MeshFaceSet& set = sets[ slot.set ];
+		slot.offset = set.size;
+		slot.size = 3 * ( count - 2 );
+		set.size += slot.size;
+		set.hasNormals = set.hasNormals || face.getNormals() != NULL;
+		set.hasTexcoords = set.hasTexcoords || face.getTexcoords() != NULL;
+	}
 
-		// triangulate the face
-		vector<TriIndices> indices;
-		triangulateFace( faceVertices, indices );
-
-		// add the vertices to the face
-		osg::DrawElementsUInt* drawElem = new osg::DrawElementsUInt( osg::DrawElements::TRIANGLES, 0 );
-		for ( vector<TriIndices>::iterator j = indices.begin(); j != indices.end(); j++ ) {
-			verts->push_back( faceVertices[ (*j).indices[0] ].vertex );
-			if ( hasNormals ) norms->push_back( faceVertices[ (*j).indices[0] ].normal );
-			if ( hasTexcoords ) tcoords->push_back( faceVertices[ (*j).indices[0] ].texcoord );
-			drawElem->push_back( verts->size() - 1 );
-			verts->push_back( faceVertices[ (*j).indices[1] ].vertex );
-			if ( hasNormals ) norms->push_back( faceVertices[ (*j).indices[1] ].normal );
-			if ( hasTexcoords ) tcoords->push_back( faceVertices[ (*j).indices[1] ].texcoord );
-			drawElem->push_back( verts->size() - 1 );
-			verts->push_back( faceVertices[ (*j).indices[2] ].vertex );
-			if ( hasNormals ) norms->push_back( faceVertices[ (*j).indices[2] ].normal );
-			if ( hasTexcoords ) tcoords->push_back( faceVertices[ (*j).indices[2] ].texcoord );
-			drawElem->push_back( verts->size() - 1 );
-		}
-   
-		geom->addPrimitiveSet( drawElem );
+	for ( vector< MeshFaceSet >::iterator s = sets.begin(); s != sets.end(); s++ ) {
+		s->vertices = new osg::Vec3Array( s->size );
+		if ( s->hasNormals )
+			s->normals = new osg::Vec3Array( s->size );
+		if ( s->hasTexcoords )
+			s->texcoords = new osg::Vec2Array( s->size );
 	}
 
-	for ( map< material*, osg::Geometry* >::iterator i = geomMap.begin(); i != geomMap.end(); i++ ) {
+	// runRange() only waits for its own chunks, so this is fine from a parser worker too
+	MeshFaceRange range( slots, sets, data );
+	WorkerPool::getSharedPool()->runRange( &range, slots.size(), FACE_GRAIN );
+
+	// one Geometry for each material, drawn in one go
+	for ( vector< MeshFaceSet >::iterator s = sets.begin(); s != sets.end(); s++ ) {
+		if ( s->size == 0 )
+			continue;
+
+		osg::Geometry* geom = new osg::Geometry();
+		geom->setVertexArray( s->vertices.get() );
+		if ( s->hasNormals ) {
+			geom->setNormalArray( s->normals.get() );
+			geom->setNormalBinding( osg::Geometry::BIND_PER_VERTEX );
+		}
+		if ( s->hasTexcoords )
+			geom->setTexCoordArray( 0, s->texcoords.get() );
+		geom->addPrimitiveSet( new osg::DrawArrays( osg::PrimitiveSet::TRIANGLES, 0, s->size ) );
+
 		osg::Geode* geode = new osg::Geode();
-		material* mat = i->first;
+		material* mat = s->mat;
 		if(mat == NULL){
 			// set default material
 			mat = new material();
 			mat->setTexture("mesh");
 		}
-		geode->addDrawable( i->second );
-		//geode->setStateSet( mat );
+		geode->addDrawable( geom );
 		SceneBuilder::assignBZMaterial(mat, geode);
 		group->addChild( geode );
 	}
-	}
-	
-	setThisNode( group );
 }
-
-
-/*
- * Trangulation stuff
- */
-
-// triangulation parameters
-static osg::Vec3 Normal; // FIXME, uNormal, vNormal;
-//static fvec2* MVertsSpace = NULL;
-static const vector<MeshVertex>* Verts;
-static int Count = 0;
-static int* WorkSet = NULL;
-
-
-static inline bool makeNormal()
-{
-  // Newell method
-  Normal[0] = Normal[1] = Normal[2] = 0.0f;
-  for (int i = 0; i < Count; i++) {
-	  const osg::Vec3& v0 = (*Verts)[i].vertex;
-	  const osg::Vec3& v1 = (*Verts)[(i + 1) % Count].vertex;
-    Normal[0] += ((v0.y() - v1.y()) * (v0.z() + v1.z()));
-    Normal[1] += ((v0.z() - v1.z()) * (v0.x() + v1.x()));
-    Normal[2] += ((v0.x() - v1.x()) * (v0.y() + v1.y()));
-  }
-
-  // normalize
-  Normal.normalize();
-
-  if (Normal.length() == 0)
-	  return false;
-  else
-	return true;
-}
-
-
-static inline bool isConvex(int w0, int w1, int w2)
-{
-  // caution: faces can fold around the normal
-  const int v0 = WorkSet[w0];
-  const int v1 = WorkSet[w1];
-  const int v2 = WorkSet[w2];
-  const osg::Vec3 e0 = (*Verts)[v1].vertex - (*Verts)[v0].vertex;
-  const osg::Vec3 e1 = (*Verts)[v2].vertex - (*Verts)[v1].vertex;
-  const osg::Vec3 cross = e0 ^ e1;
-  if (cross * Normal <= 0.0f) {
-    return false;
-  }
-  return true;
-}
-
-
-static inline bool isFaceClear(int w0, int w1, int w2)
-{
-  int i;
-  const int v0 = WorkSet[w0];
-  const int v1 = WorkSet[w1];
-  const int v2 = WorkSet[w2];
-
-  // setup the edges
-  osg::Vec3 edges[3];
-  edges[0] = (*Verts)[v1].vertex - (*Verts)[v0].vertex;
-  edges[1] = (*Verts)[v2].vertex - (*Verts)[v1].vertex;
-  edges[2] = (*Verts)[v0].vertex - (*Verts)[v2].vertex;
-
-  // get the triangle normal
-  osg::Vec3 normal = edges[0] ^ edges[1];
-
-  // setup the planes
-  osg::Vec4 planes[3];
-  osg::Vec3 c0 = edges[0] ^ normal;
-  planes[0].set( c0[0], c0[1], c0[2], -(c0 * (*Verts)[v0].vertex));
-  osg::Vec3 c1 = edges[1] ^ normal;
-  planes[0].set( c1[0], c1[1], c1[2], -(c1 * (*Verts)[v1].vertex));
-  osg::Vec3 c2 = edges[2] ^ normal;
-  planes[0].set( c2[0], c2[1], c2[2], -(c2 * (*Verts)[v2].vertex));
-
-  for (int w = 0; w < Count; w++) {
-    if ((w == w0) || (w == w1) || (w == w2)) {
-      continue; // FIXME: lazy
-    }
-    const int v = WorkSet[w];
-    for (i = 0; i < 3; i++) {
-		const float dist = (*Verts)[v].vertex * osg::Vec3(planes[i][0], planes[i][1], planes[i][2]) + planes[i][3];
-      if (dist > 0.0f) {
-	break; // this point is clear
-      }
-    }
-    if (i == 3) {
-      return false;
-    }
-  }
-  return true;
-}
-
-
-static inline float getDot(int w0, int w1, int w2)
-{
-  const int v0 = WorkSet[w0];
-  const int v1 = WorkSet[w1];
-  const int v2 = WorkSet[w2];
-  osg::Vec3 e0 = (*Verts)[v1].vertex - (*Verts)[v0].vertex;
-  osg::Vec3 e1 = (*Verts)[v2].vertex - (*Verts)[v1].vertex;
-  e0.normalize();
-  e1.normalize();
-  return e0 * e1;
-}
-
-
-void mesh::triangulateFace(const vector<MeshVertex>& verts,
-		     std::vector<TriIndices>& tris)
-{
-  tris.clear();
-
-  Verts = &verts;
-  Count = verts.size();
-  WorkSet = new int[Count];
-  for (int i = 0; i < Count; i++) {
-    WorkSet[i] = i;
-  }
-  makeNormal();
-
-  int best = 0;
-  bool left = false;
-  bool first = true;
-  float score = 0.0f;
-
-  while (Count >= 3) {
-    bool convex = false;
-    bool faceClear = false;
-
-    int offset;
-    if (best == Count) {
-      offset = Count - 1;
-    } else {
-      offset = (best % Count);
-    }
-
-    // stripping pattern
-    if (left) {
-      offset = (offset + (Count - 1)) % Count;
-    }
-    left = !left;
-
-    // find the best triangle
-    for (int w = offset; w < offset + (Count - 2); w++) {
-      const int w0 = (w + 0) % Count;
-      const int w1 = (w + 1) % Count;
-      const int w2 = (w + 2) % Count;
-
-      const bool convex2 = isConvex(w0, w1, w2);
-      if (convex && !convex2) {
-	continue;
-      }
-
-      const bool faceClear2 = isFaceClear(w0, w1, w2);
-      if ((faceClear && !faceClear2) && (convex || !convex2)) {
-	continue;
-      }
-
-      if (first) {
-	const float score2 = 2.0f - getDot(w0, w1, w2);
-	if ((score2 < score) &&
-	    (convex || !convex2) && (faceClear || !faceClear2)) {
-	  continue;
-	} else {
-	  score = score2;
-	}
-      }
-
-      best = w0;
-      if (convex && faceClear) {
-	break;
-      }
-      convex = convex2;
-      faceClear = faceClear2;
-    }
-
-    first = false;
-
-    // add the triangle
-    TriIndices ti;
-    ti.indices[0] = WorkSet[(best + 0) % Count];
-    ti.indices[1] = WorkSet[(best + 1) % Count];
-    ti.indices[2] = WorkSet[(best + 2) % Count];
-    tris.push_back(ti);
-
-    // remove the middle vertex
-    const int m = (best + 1) % Count;
-    memmove(WorkSet + m, WorkSet + m + 1, (Count - m - 1) * sizeof(int));
-    Count--;
-  }
-
-  delete[] WorkSet;
-
-  return;
-}
\ No newline at end of file
@@ -129,8 +129,9 @@ bool pyramid::parse( std::string& line ) {
 	if ( key == "meshpyr" )
 		return true;
 	
+	// the geometry is turned over in finalize()
 	if ( key == "flipz" ) {
-		setFlipz(true);
+		flipz = true;
 		return true;
 	}
 	
@@ -170,6 +171,9 @@ bool pyramid::parse( std::string& line ) {
 }
 
 void pyramid::finalize() {
+	if( builtFlipz != flipz )
+		updateGeometry();
+
 	// just regen UV coords based on any size changes
 	Primitives::rebuildPyramidUV( (osg::Group*)getThisNode(), getSize() );
 	refreshMaterial();
@@ -244,6 +248,7 @@ void pyramid::setFlipz( bool value ) {
 void pyramid::updateGeometry() {
 	osg::Node* node = Primitives::buildPyramid( osg::Vec3( 1, 1, 1 ), getFlipz() );
 	setThisNode( node );
+	builtFlipz = flipz;
 	
 	//loop thru material slots an update the nodes
 	for (int i = 0; i < FaceCount; i++) {
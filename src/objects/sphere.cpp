@@ -154,6 +154,7 @@ int sphere::render(void) {
 
 void sphere::setSize( osg::Vec3 newSize ) {
 	realSize = newSize;
+	setChanged();
 	updateGeometry();
 }
 
@@ -175,6 +175,7 @@ string teleporter::toString(void) {
 
 void teleporter::setSize( osg::Vec3 newSize ) {
 	realSize = newSize;
+	setChanged();
 	updateGeometry();
 }
 
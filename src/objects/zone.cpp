@@ -31,6 +31,8 @@ void zone::setDefaults() {
 string zone::get(void) { return toString(); }
 
 int zone::update( UpdateMessage& message ) {
+	setChanged();
+
 	switch( message.type ) {
 		case UpdateMessage::SET_POSITION: 	// handle a new position
 			setPos( *(message.getAsPosition()) );
@@ -0,0 +1,61 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "render/DrawInfoLOD.h"
+
+#include <osg/CullStack>
+
+#include <float.h>
+
+DrawInfoLOD::DrawInfoLOD() : osg::LOD() {
+	setCenterMode( osg::LOD::USE_BOUNDING_SPHERE_CENTER );
+}
+
+void DrawInfoLOD::addLevel( osg::Node* node, float lengthPerPixel ) {
+	// the level before this one stops where this one starts
+	unsigned int count = getNumChildren();
+	if( count > 0 )
+		setRange( count - 1, getMinRange( count - 1 ), lengthPerPixel );
+
+	addChild( node, ( count == 0 ? 0.0f : lengthPerPixel ), FLT_MAX );
+}
+
+void DrawInfoLOD::traverse( osg::NodeVisitor& nv ) {
+	unsigned int count = osg::minimum( getNumChildren(), (unsigned int)_rangeList.size() );
+	if( count == 0 )
+		return;
+
+	if( nv.getTraversalMode() == osg::NodeVisitor::TRAVERSE_ALL_CHILDREN ) {
+		osg::Group::traverse( nv );
+		return;
+	}
+
+	if( nv.getTraversalMode() != osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN )
+		return;
+
+	osg::CullStack* cull = dynamic_cast< osg::CullStack* >( &nv );
+	if( nv.getVisitorType() != osg::NodeVisitor::CULL_VISITOR || cull == NULL ) {
+		_children[0]->accept( nv );
+		return;
+	}
+
+	// how long a pixel is at the center of the mesh, in the mesh's own units
+	float pixels = cull->pixelSize( getCenter(), 1.0f );
+	float lengthPerPixel = ( pixels > 0.0f ? 1.0f / pixels : FLT_MAX );
+
+	// the coarsest level whose lengthPerPixel has been reached
+	unsigned int level = 0;
+	while( level + 1 < count && _rangeList[ level + 1 ].first <= lengthPerPixel )
+		level++;
+
+	_children[ level ]->accept( nv );
+}
@@ -0,0 +1,572 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "render/MeshOptimizer.h"
+
+#include "render/Triangulator.h"
+#include "MeshFace.h"
+#include "DrawInfo.h"
+
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+const unsigned int MeshOptimizer::CACHE_SIZE = 16;
+
+const float MeshOptimizer::NORMAL_TOLERANCE = 1e-4f;
+const float MeshOptimizer::TEXCOORD_TOLERANCE = 1e-5f;
+
+MeshOptimizer::Report::Report() {
+	vertices[0] = vertices[1] = 0;
+	normals[0] = normals[1] = 0;
+	texcoords[0] = texcoords[1] = 0;
+	faces = droppedFaces = 0;
+	faceMisses[0] = faceMisses[1] = 0;
+	faceTriangles = 0;
+	corners[0] = corners[1] = 0;
+	drawInfoMisses[0] = drawInfoMisses[1] = 0;
+	drawInfoTriangles = 0;
+}
+
+void MeshOptimizer::Report::add( const Report& other ) {
+	for( int i = 0; i < 2; i++ ) {
+		vertices[i] += other.vertices[i];
+		normals[i] += other.normals[i];
+		texcoords[i] += other.texcoords[i];
+		faceMisses[i] += other.faceMisses[i];
+		corners[i] += other.corners[i];
+		drawInfoMisses[i] += other.drawInfoMisses[i];
+	}
+	faces += other.faces;
+	droppedFaces += other.droppedFaces;
+	faceTriangles += other.faceTriangles;
+	drawInfoTriangles += other.drawInfoTriangles;
+}
+
+MeshOptimizer::MeshOptimizer( float weldDistance ) :
+	weldDistance( weldDistance ) { }
+
+/*
+ * Welding
+ */
+
+static unsigned int hashCell( const long long* cell ) {
+	unsigned long long h = ( cell[0] * 73856093ULL ) ^ ( cell[1] * 19349663ULL ) ^ ( cell[2] * 83492791ULL );
+	return (unsigned int)( h ^ ( h >> 32 ) );
+}
+
+// find, for each point, the first point within tolerance of it (possibly itself), by hashing
+// them into cells as wide as the tolerance and looking through the neighboring cells
+template< class V >
+static void weld( const vector< V >& points, float tolerance, vector< int >& representative ) {
+	const int dims = V::num_components;
+	unsigned int count = points.size();
+	representative.resize( count );
+
+	unsigned int buckets = 1;
+	while( buckets < 2 * count )
+		buckets <<= 1;
+	vector< int > head( buckets, -1 );
+	vector< int > next( count, -1 );
+
+	double cellSize = ( tolerance > 0.0f ? tolerance : 1.0 );
+	double tolerance2 = (double)tolerance * tolerance;
+
+	// a point can match one in the next cell over, unless only identical points match
+	int reach = ( tolerance > 0.0f ? 1 : 0 );
+	int neighbors = 1;
+	for( int d = 0; d < dims; d++ )
+		neighbors *= 2 * reach + 1;
+
+	for( unsigned int i = 0; i < count; i++ ) {
+		const V& p = points[i];
+
+		long long cell[3] = { 0, 0, 0 };
+		for( int d = 0; d < dims; d++ ) {
+			double c = floor( p[d] / cellSize );
+			cell[d] = ( fabs( c ) < 1e15 ? (long long)c : 0 );
+		}
+
+		int match = -1;
+		for( int n = 0; n < neighbors && match < 0; n++ ) {
+			long long neighbor[3] = { cell[0], cell[1], cell[2] };
+			for( int d = 0, code = n; d < dims; d++, code /= 2 * reach + 1 )
+				neighbor[d] += code % ( 2 * reach + 1 ) - reach;
+
+			for( int j = head[ hashCell( neighbor ) & ( buckets - 1 ) ]; j >= 0; j = next[j] ) {
+				double distance2 = 0.0;
+				for( int d = 0; d < dims; d++ )
+					distance2 += ( (double)points[j][d] - p[d] ) * ( (double)points[j][d] - p[d] );
+				if( distance2 <= tolerance2 ) {
+					match = j;
+					break;
+				}
+			}
+		}
+
+		if( match >= 0 ) {
+			representative[i] = match;
+			continue;
+		}
+
+		representative[i] = i;
+		unsigned int bucket = hashCell( cell ) & ( buckets - 1 );
+		next[i] = head[ bucket ];
+		head[ bucket ] = i;
+	}
+}
+
+// the new index of an old point, adding its representative to the new points if it's
+// the first time it's used
+template< class V >
+static int useIndex( int index, const vector< int >& representative, vector< int >& map,
+					 const vector< V >& points, vector< V >& used ) {
+	if( index < 0 || index >= (int)representative.size() )
+		return index;
+
+	int r = representative[ index ];
+	if( map[r] < 0 ) {
+		map[r] = used.size();
+		used.push_back( points[r] );
+	}
+	return map[r];
+}
+
+// does every index point into an array of a size?
+static bool indicesInRange( const int* indices, unsigned int count, unsigned int size ) {
+	if( indices == NULL )
+		return true;
+	for( unsigned int i = 0; i < count; i++ ) {
+		if( indices[i] < 0 || indices[i] >= (int)size )
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Corners
+ */
+
+// a vertex as the GPU sees it
+struct CornerKey {
+	int vertex;
+	int normal;
+	int texcoord;
+	unsigned int index;
+
+	bool operator <( const CornerKey& other ) const {
+		if( vertex != other.vertex )
+			return vertex < other.vertex;
+		if( normal != other.normal )
+			return normal < other.normal;
+		if( texcoord != other.texcoord )
+			return texcoord < other.texcoord;
+		return index < other.index;
+	}
+
+	bool sameCorner( const CornerKey& other ) const {
+		return vertex == other.vertex && normal == other.normal && texcoord == other.texcoord;
+	}
+};
+
+// give each distinct corner an id; returns how many there are
+static unsigned int numberCorners( vector< CornerKey >& keys, vector< unsigned int >& ids ) {
+	ids.resize( keys.size() );
+	sort( keys.begin(), keys.end() );
+
+	unsigned int count = 0;
+	for( unsigned int i = 0; i < keys.size(); i++ ) {
+		if( i > 0 && !keys[i].sameCorner( keys[i - 1] ) )
+			count++;
+		ids[ keys[i].index ] = count;
+	}
+	return ( keys.empty() ? 0 : count + 1 );
+}
+
+/*
+ * Vertex cache
+ */
+
+unsigned int MeshOptimizer::countMisses( const vector< unsigned int >& triangles, unsigned int idCount ) {
+	// the miss that brought each id into the cache (0 if it never was); an id falls
+	// out after CACHE_SIZE more misses
+	vector< unsigned int > loaded( idCount, 0 );
+	unsigned int misses = 0;
+
+	for( unsigned int i = 0; i < triangles.size(); i++ ) {
+		unsigned int id = triangles[i];
+		if( loaded[id] == 0 || misses - loaded[id] >= CACHE_SIZE )
+			loaded[id] = ++misses;
+	}
+
+	return misses;
+}
+
+void MeshOptimizer::tipsify( const vector< unsigned int >& start, const vector< unsigned int >& ids,
+							 unsigned int idCount, vector< unsigned int >& order ) {
+	unsigned int count = start.size() - 1;
+	order.clear();
+	order.reserve( count );
+
+	// the polygons around each id
+	vector< unsigned int > adjacencyStart( idCount + 1, 0 );
+	for( unsigned int i = 0; i < ids.size(); i++ )
+		adjacencyStart[ ids[i] + 1 ]++;
+	for( unsigned int i = 0; i < idCount; i++ )
+		adjacencyStart[i + 1] += adjacencyStart[i];
+
+	vector< unsigned int > adjacency( ids.size() );
+	vector< unsigned int > fill( adjacencyStart.begin(), adjacencyStart.end() - 1 );
+	for( unsigned int p = 0; p < count; p++ ) {
+		for( unsigned int k = start[p]; k < start[p + 1]; k++ )
+			adjacency[ fill[ ids[k] ]++ ] = p;
+	}
+
+	// how many polygons still to be emitted use each id, and when it was last put in the cache
+	vector< unsigned int > live( idCount );
+	for( unsigned int i = 0; i < idCount; i++ )
+		live[i] = adjacencyStart[i + 1] - adjacencyStart[i];
+	vector< unsigned int > cacheTime( idCount, 0 );
+	unsigned int time = CACHE_SIZE + 1;
+
+	vector< unsigned char > emitted( count, 0 );
+	vector< unsigned int > deadEnd;
+	vector< unsigned int > candidates;
+	unsigned int cursor = 0;
+
+	while( cursor < idCount && live[ cursor ] == 0 )
+		cursor++;
+	int fanning = ( cursor < idCount ? (int)cursor : -1 );
+
+	while( fanning >= 0 ) {
+		// emit every polygon around the fanning id
+		candidates.clear();
+		for( unsigned int a = adjacencyStart[ fanning ]; a < adjacencyStart[ fanning + 1 ]; a++ ) {
+			unsigned int p = adjacency[a];
+			if( emitted[p] )
+				continue;
+			emitted[p] = 1;
+			order.push_back( p );
+
+			for( unsigned int k = start[p]; k < start[p + 1]; k++ ) {
+				unsigned int id = ids[k];
+				deadEnd.push_back( id );
+				candidates.push_back( id );
+				live[id]--;
+				if( time - cacheTime[id] > CACHE_SIZE )
+					cacheTime[id] = time++;
+			}
+		}
+
+		// fan around the candidate that will still be in the cache, and oldest in it,
+		// once the rest of its polygons are emitted
+		int best = -1;
+		int bestPriority = -1;
+		for( unsigned int i = 0; i < candidates.size(); i++ ) {
+			unsigned int id = candidates[i];
+			if( live[id] == 0 )
+				continue;
+			int priority = 0;
+			if( time - cacheTime[id] + 2 * live[id] <= CACHE_SIZE )
+				priority = time - cacheTime[id];
+			if( priority > bestPriority ) {
+				bestPriority = priority;
+				best = id;
+			}
+		}
+
+		// otherwise, the latest id that still has polygons, or the next one in order
+		while( best < 0 && !deadEnd.empty() ) {
+			unsigned int id = deadEnd.back();
+			deadEnd.pop_back();
+			if( live[id] > 0 )
+				best = id;
+		}
+		if( best < 0 ) {
+			while( cursor < idCount && live[ cursor ] == 0 )
+				cursor++;
+			best = ( cursor < idCount ? (int)cursor : -1 );
+		}
+
+		fanning = best;
+	}
+}
+
+/*
+ * Meshes
+ */
+
+void MeshOptimizer::optimize( MeshData& data, DrawInfo* drawInfo, Report& report ) {
+	const vector< osg::Vec3 >& vertices = data.getVertices();
+	const vector< osg::Vec3 >& normals = data.getNormals();
+	const vector< osg::Vec2 >& texcoords = data.getTexcoords();
+
+	report.vertices[0] = vertices.size();
+	report.normals[0] = normals.size();
+	report.texcoords[0] = texcoords.size();
+	report.faces = data.getFaceCount();
+
+	// merge what's close enough
+	vector< int > vertexRep, normalRep, texcoordRep;
+	weld( vertices, weldDistance, vertexRep );
+	weld( normals, NORMAL_TOLERANCE, normalRep );
+	weld( texcoords, TEXCOORD_TOLERANCE, texcoordRep );
+
+	// the faces that can be drawn, their corners before and after welding, and the
+	// triangles they're cut into (as corner numbers within the face)
+	vector< unsigned int > kept;
+	vector< unsigned int > cornerStart( 1, 0 );
+	vector< CornerKey > before, after;
+	vector< unsigned int > triangleStart( 1, 0 );
+	vector< unsigned int > triangleCorners;
+	Triangulator triangulator;
+
+	for( unsigned int i = 0; i < data.getFaceCount(); i++ ) {
+		MeshFace face = data.getFace( i );
+		unsigned int count = face.getCount();
+		const int* vertexIndices = face.getVertices();
+		const int* normalIndices = face.getNormals();
+		const int* texcoordIndices = face.getTexcoords();
+
+		if( count < 3 ||
+			!indicesInRange( vertexIndices, count, vertices.size() ) ||
+			!indicesInRange( normalIndices, count, normals.size() ) ||
+			!indicesInRange( texcoordIndices, count, texcoords.size() ) ) {
+			report.droppedFaces++;
+			continue;
+		}
+
+		kept.push_back( i );
+		for( unsigned int c = 0; c < count; c++ ) {
+			CornerKey key;
+			key.index = before.size();
+			key.vertex = vertexIndices[c];
+			key.normal = ( normalIndices != NULL ? normalIndices[c] : -1 );
+			key.texcoord = ( texcoordIndices != NULL ? texcoordIndices[c] : -1 );
+			before.push_back( key );
+
+			key.vertex = vertexRep[ key.vertex ];
+			key.normal = ( key.normal >= 0 ? normalRep[ key.normal ] : -1 );
+			key.texcoord = ( key.texcoord >= 0 ? texcoordRep[ key.texcoord ] : -1 );
+			after.push_back( key );
+		}
+		cornerStart.push_back( before.size() );
+
+		triangulator.triangulate( &vertices[0], vertexIndices, count, triangleCorners );
+		triangleStart.push_back( triangleCorners.size() );
+	}
+
+	vector< unsigned int > beforeIds, afterIds;
+	unsigned int beforeCount = numberCorners( before, beforeIds );
+	unsigned int afterCount = numberCorners( after, afterIds );
+
+	// order the faces for the cache, and see how well each order does
+	vector< unsigned int > order;
+	tipsify( cornerStart, afterIds, afterCount, order );
+
+	vector< unsigned int > triangles;
+	triangles.reserve( triangleCorners.size() );
+	for( unsigned int k = 0; k < kept.size(); k++ ) {
+		for( unsigned int t = triangleStart[k]; t < triangleStart[k + 1]; t++ )
+			triangles.push_back( beforeIds[ cornerStart[k] + triangleCorners[t] ] );
+	}
+	report.faceTriangles = triangles.size() / 3;
+	report.faceMisses[0] = countMisses( triangles, beforeCount );
+
+	triangles.clear();
+	for( unsigned int o = 0; o < order.size(); o++ ) {
+		unsigned int k = order[o];
+		for( unsigned int t = triangleStart[k]; t < triangleStart[k + 1]; t++ )
+			triangles.push_back( afterIds[ cornerStart[k] + triangleCorners[t] ] );
+	}
+	report.faceMisses[1] = countMisses( triangles, afterCount );
+
+	// rebuild the mesh in that order, numbering the vertices, normals and texcoords
+	// in the order they're first used
+	MeshData optimized;
+	vector< osg::Vec3 > newVertices, newNormals;
+	vector< osg::Vec2 > newTexcoords;
+	vector< int > vertexMap( vertices.size(), -1 );
+	vector< int > normalMap( normals.size(), -1 );
+	vector< int > texcoordMap( texcoords.size(), -1 );
+
+	vector< int > vertexIndices, normalIndices, texcoordIndices;
+	for( unsigned int o = 0; o < order.size(); o++ ) {
+		MeshFace face = data.getFace( kept[ order[o] ] );
+		unsigned int count = face.getCount();
+
+		vertexIndices.resize( count );
+		normalIndices.resize( count );
+		texcoordIndices.resize( count );
+		for( unsigned int c = 0; c < count; c++ ) {
+			vertexIndices[c] = useIndex( face.getVertices()[c], vertexRep, vertexMap, vertices, newVertices );
+			if( face.getNormals() != NULL )
+				normalIndices[c] = useIndex( face.getNormals()[c], normalRep, normalMap, normals, newNormals );
+			if( face.getTexcoords() != NULL )
+				texcoordIndices[c] = useIndex( face.getTexcoords()[c], texcoordRep, texcoordMap, texcoords, newTexcoords );
+		}
+
+		// links point at vertices and normals too
+		const MeshFace::SpecialData* special = face.getSpecialData();
+		MeshFace::SpecialData remapped;
+		if( special != NULL ) {
+			remapped = *special;
+			MeshFace::LinkGeometry* geometry[2] = { &remapped.linkSrcGeo, &remapped.linkDstGeo };
+			for( int g = 0; g < 2; g++ ) {
+				geometry[g]->centerIndex = useIndex( geometry[g]->centerIndex, vertexRep, vertexMap, vertices, newVertices );
+				geometry[g]->sDirIndex = useIndex( geometry[g]->sDirIndex, normalRep, normalMap, normals, newNormals );
+				geometry[g]->tDirIndex = useIndex( geometry[g]->tDirIndex, normalRep, normalMap, normals, newNormals );
+				geometry[g]->pDirIndex = useIndex( geometry[g]->pDirIndex, normalRep, normalMap, normals, newNormals );
+			}
+		}
+
+		optimized.addFace( &vertexIndices[0],
+						   face.getNormals() != NULL ? &normalIndices[0] : NULL,
+						   face.getTexcoords() != NULL ? &texcoordIndices[0] : NULL,
+						   count, face.getMaterial(), face.getPhysicsDriver(), face.getFlags(),
+						   special != NULL ? &remapped : NULL );
+	}
+
+	// a drawinfo without arrays of its own uses the mesh's
+	if( drawInfo != NULL && drawInfo->getVertices().empty() ) {
+		vector< Index3D >& corners = drawInfo->getCorners();
+		for( vector< Index3D >::iterator c = corners.begin(); c != corners.end(); c++ ) {
+			c->a = useIndex( c->a, vertexRep, vertexMap, vertices, newVertices );
+			c->b = useIndex( c->b, normalRep, normalMap, normals, newNormals );
+			c->c = useIndex( c->c, texcoordRep, texcoordMap, texcoords, newTexcoords );
+		}
+	}
+
+	for( unsigned int i = 0; i < newVertices.size(); i++ )
+		optimized.addVertex( newVertices[i] );
+	for( unsigned int i = 0; i < newNormals.size(); i++ )
+		optimized.addNormal( newNormals[i] );
+	for( unsigned int i = 0; i < newTexcoords.size(); i++ )
+		optimized.addTexcoord( newTexcoords[i] );
+
+	data = optimized;
+
+	report.vertices[1] = newVertices.size();
+	report.normals[1] = newNormals.size();
+	report.texcoords[1] = newTexcoords.size();
+
+	if( drawInfo != NULL )
+		optimizeDrawInfo( drawInfo, report );
+}
+
+void MeshOptimizer::optimizeDrawInfo( DrawInfo* drawInfo, Report& report ) {
+	vector< Index3D >& corners = drawInfo->getCorners();
+	report.corners[0] = corners.size();
+
+	// merge the corners that are now the same
+	vector< CornerKey > keys( corners.size() );
+	for( unsigned int i = 0; i < corners.size(); i++ ) {
+		keys[i].vertex = corners[i].a;
+		keys[i].normal = corners[i].b;
+		keys[i].texcoord = corners[i].c;
+		keys[i].index = i;
+	}
+	vector< unsigned int > ids;
+	unsigned int idCount = numberCorners( keys, ids );
+
+	// the first corner with each id stands for the rest
+	vector< int > first( idCount, -1 );
+	for( unsigned int i = 0; i < corners.size(); i++ ) {
+		if( first[ ids[i] ] < 0 )
+			first[ ids[i] ] = i;
+	}
+
+	vector< LODCommand* > commands;
+	vector< LOD >& lods = drawInfo->getLods();
+	for( vector< LOD >::iterator l = lods.begin(); l != lods.end(); l++ ) {
+		vector< LOD::MaterialSet* >& matSets = l->getMaterialSets();
+		for( vector< LOD::MaterialSet* >::iterator m = matSets.begin(); m != matSets.end(); m++ ) {
+			for( vector< LODCommand >::iterator c = (*m)->commands.begin(); c != (*m)->commands.end(); c++ ) {
+				if( c->getName() != "sphere" && c->getName() != "dlist" )
+					commands.push_back( &(*c) );
+			}
+		}
+	}
+
+	// point the commands at the merged corners, reordering triangle lists for the cache.
+	// Indices out of range (which nothing draws) are dropped, along with their triangles.
+	vector< int > args;
+	vector< unsigned int > triangles, start, order;
+	for( unsigned int i = 0; i < commands.size(); i++ ) {
+		vector< int > oldArgs = commands[i]->getArgs();
+		bool tris = ( commands[i]->getName() == "tris" );
+
+		args.clear();
+		triangles.clear();
+		for( unsigned int j = 0; j < oldArgs.size(); ) {
+			unsigned int size = ( tris ? 3 : 1 );
+			if( j + size > oldArgs.size() )
+				break;
+
+			bool inRange = true;
+			for( unsigned int k = j; k < j + size; k++ )
+				inRange = inRange && oldArgs[k] >= 0 && oldArgs[k] < (int)corners.size();
+
+			if( inRange ) {
+				for( unsigned int k = j; k < j + size; k++ ) {
+					args.push_back( oldArgs[k] );
+					triangles.push_back( ids[ oldArgs[k] ] );
+				}
+			}
+			j += size;
+		}
+
+		if( tris && triangles.size() > 0 ) {
+			vector< unsigned int > beforeIds( args.begin(), args.end() );
+			report.drawInfoMisses[0] += countMisses( beforeIds, corners.size() );
+			report.drawInfoTriangles += triangles.size() / 3;
+
+			start.resize( triangles.size() / 3 + 1 );
+			for( unsigned int t = 0; t < start.size(); t++ )
+				start[t] = 3 * t;
+			tipsify( start, triangles, idCount, order );
+
+			vector< unsigned int > reordered;
+			reordered.reserve( triangles.size() );
+			for( unsigned int t = 0; t < order.size(); t++ ) {
+				for( unsigned int k = 0; k < 3; k++ )
+					reordered.push_back( triangles[ 3 * order[t] + k ] );
+			}
+			report.drawInfoMisses[1] += countMisses( reordered, idCount );
+			triangles = reordered;
+		}
+
+		args.resize( triangles.size() );
+		for( unsigned int j = 0; j < triangles.size(); j++ )
+			args[j] = first[ triangles[j] ];
+		commands[i]->setArgs( args );
+	}
+
+	// keep the corners the commands use, in the order they first use them
+	vector< int > corner( corners.size(), -1 );
+	vector< Index3D > used;
+	for( unsigned int i = 0; i < commands.size(); i++ ) {
+		args = commands[i]->getArgs();
+		for( unsigned int j = 0; j < args.size(); j++ ) {
+			if( corner[ args[j] ] < 0 ) {
+				corner[ args[j] ] = used.size();
+				used.push_back( corners[ args[j] ] );
+			}
+			args[j] = corner[ args[j] ];
+		}
+		commands[i]->setArgs( args );
+	}
+
+	corners = used;
+	report.corners[1] = corners.size();
+}
@@ -0,0 +1,579 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "render/MeshSimplifier.h"
+
+#include "render/MeshOptimizer.h"
+#include "render/Triangulator.h"
+#include "MeshFace.h"
+#include "DrawInfo.h"
+
+#include <algorithm>
+#include <iterator>
+#include <float.h>
+#include <math.h>
+
+using namespace std;
+
+const float MeshSimplifier::REDUCTION = 0.25f;
+
+// a level that keeps more than this fraction of the one before isn't worth having
+#define MIN_REDUCTION 0.9f
+
+// how much more the boundary constraints count than the faces
+#define BOUNDARY_WEIGHT 1000.0
+
+// the least cosine of the angle a collapse may turn a triangle through (about 60 degrees)
+#define MIN_TURN 0.5
+
+// errors smaller than this (relative to the mesh's size) are none at all
+#define EXACT 1e-6
+
+MeshSimplifier::Quadric::Quadric() {
+	for( int i = 0; i < 6; i++ )
+		a[i] = 0.0;
+	b[0] = b[1] = b[2] = 0.0;
+	c = 0.0;
+}
+
+void MeshSimplifier::Quadric::addPlane( const osg::Vec3d& n, double d, double weight ) {
+	a[0] += weight * n.x() * n.x();
+	a[1] += weight * n.x() * n.y();
+	a[2] += weight * n.x() * n.z();
+	a[3] += weight * n.y() * n.y();
+	a[4] += weight * n.y() * n.z();
+	a[5] += weight * n.z() * n.z();
+	b[0] += weight * d * n.x();
+	b[1] += weight * d * n.y();
+	b[2] += weight * d * n.z();
+	c += weight * d * d;
+}
+
+void MeshSimplifier::Quadric::add( const Quadric& other ) {
+	for( int i = 0; i < 6; i++ )
+		a[i] += other.a[i];
+	for( int i = 0; i < 3; i++ )
+		b[i] += other.b[i];
+	c += other.c;
+}
+
+double MeshSimplifier::Quadric::evaluate( const osg::Vec3d& p ) const {
+	double x = p.x(), y = p.y(), z = p.z();
+	double cost = a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z
+				+ a[3] * y * y + 2.0 * a[4] * y * z + a[5] * z * z
+				+ 2.0 * ( b[0] * x + b[1] * y + b[2] * z ) + c;
+
+	// rounding can take it a little below zero
+	return max( cost, 0.0 );
+}
+
+MeshSimplifier::MeshSimplifier() :
+	liveTriangles( 0 ),
+	error( 0.0 ) { }
+
+unsigned int MeshSimplifier::cornerFor( int vertex, int normal, int texcoord ) {
+	pair< int, pair< int, int > > key( vertex, make_pair( normal, texcoord ) );
+	map< pair< int, pair< int, int > >, unsigned int >::iterator i = cornerIndex.find( key );
+	if( i != cornerIndex.end() )
+		return i->second;
+
+	unsigned int corner = cornerVertex.size();
+	cornerVertex.push_back( vertex );
+	cornerNormal.push_back( normal );
+	cornerTexcoord.push_back( texcoord );
+	cornerIndex[ key ] = corner;
+	return corner;
+}
+
+// the unit normal of a triangle, and its plane's offset; returns false if it has no area
+static bool planeOf( const osg::Vec3d& p0, const osg::Vec3d& p1, const osg::Vec3d& p2, osg::Vec3d& normal, double& d ) {
+	normal = ( p1 - p0 ) ^ ( p2 - p0 );
+	double length = normal.length();
+	if( length <= 0.0 )
+		return false;
+	normal /= length;
+	d = -( normal * p0 );
+	return true;
+}
+
+void MeshSimplifier::findBoundaries() {
+	// the triangles on each edge
+	map< Edge, vector< unsigned int > > edges;
+	for( unsigned int t = 0; t < triangles.size(); t++ ) {
+		for( int k = 0; k < 3; k++ )
+			edges[ edge( triangles[t].vertex[k], triangles[t].vertex[ ( k + 1 ) % 3 ] ) ].push_back( t );
+	}
+
+	// an edge is a boundary if it's open, between materials, or has more than two triangles;
+	// each of its triangles gets a plane through it, square to the triangle, to keep it in place
+	for( map< Edge, vector< unsigned int > >::iterator e = edges.begin(); e != edges.end(); e++ ) {
+		const vector< unsigned int >& on = e->second;
+		bool boundary = ( on.size() != 2 || triangles[ on[0] ].group != triangles[ on[1] ].group );
+		if( !boundary )
+			continue;
+
+		boundaryEdges.insert( e->first );
+		boundaryCount[ e->first.first ]++;
+		boundaryCount[ e->first.second ]++;
+
+		const osg::Vec3d& p0 = positions[ e->first.first ];
+		const osg::Vec3d& p1 = positions[ e->first.second ];
+		for( unsigned int i = 0; i < on.size(); i++ ) {
+			const Triangle& tri = triangles[ on[i] ];
+			osg::Vec3d normal;
+			double d;
+			if( !planeOf( positions[ tri.vertex[0] ], positions[ tri.vertex[1] ], positions[ tri.vertex[2] ], normal, d ) )
+				continue;
+
+			osg::Vec3d side = ( p1 - p0 ) ^ normal;
+			double length = side.length();
+			if( length <= 0.0 )
+				continue;
+			side /= length;
+
+			Quadric constraint, weighted;
+			constraint.addPlane( side, -( side * p0 ), 1.0 );
+			weighted.addPlane( side, -( side * p0 ), BOUNDARY_WEIGHT );
+			for( int k = 0; k < 2; k++ ) {
+				unsigned int v = ( k == 0 ? e->first.first : e->first.second );
+				errorQuadrics[v].add( constraint );
+				quadrics[v].add( weighted );
+			}
+		}
+	}
+}
+
+bool MeshSimplifier::canCollapse( unsigned int from, unsigned int to ) {
+	if( from == to || removed[ from ] || removed[ to ] )
+		return false;
+
+	// a vertex on a boundary may only slide along it, and one where boundaries meet (or end) can't move
+	if( boundaryCount[ from ] > 0 ) {
+		if( boundaryCount[ from ] != 2 || boundaryEdges.find( edge( from, to ) ) == boundaryEdges.end() )
+			return false;
+	}
+
+	// the vertices both are joined to must be just the ones across the triangles on the edge,
+	// or the collapse would pinch the surface
+	fromNeighbors.clear();
+	toNeighbors.clear();
+	unsigned int shared = 0;
+	for( unsigned int i = 0; i < vertexTriangles[ from ].size(); i++ ) {
+		const Triangle& tri = triangles[ vertexTriangles[ from ][i] ];
+		if( tri.removed )
+			continue;
+		bool hasTo = false;
+		for( int k = 0; k < 3; k++ ) {
+			if( tri.vertex[k] != from )
+				fromNeighbors.push_back( tri.vertex[k] );
+			hasTo = hasTo || tri.vertex[k] == to;
+		}
+		if( hasTo )
+			shared++;
+	}
+	if( shared == 0 )
+		return false;
+	for( unsigned int i = 0; i < vertexTriangles[ to ].size(); i++ ) {
+		const Triangle& tri = triangles[ vertexTriangles[ to ][i] ];
+		if( tri.removed )
+			continue;
+		for( int k = 0; k < 3; k++ ) {
+			if( tri.vertex[k] != to )
+				toNeighbors.push_back( tri.vertex[k] );
+		}
+	}
+	sort( fromNeighbors.begin(), fromNeighbors.end() );
+	fromNeighbors.erase( unique( fromNeighbors.begin(), fromNeighbors.end() ), fromNeighbors.end() );
+	sort( toNeighbors.begin(), toNeighbors.end() );
+	toNeighbors.erase( unique( toNeighbors.begin(), toNeighbors.end() ), toNeighbors.end() );
+
+	commonNeighbors.clear();
+	set_intersection( fromNeighbors.begin(), fromNeighbors.end(), toNeighbors.begin(), toNeighbors.end(), back_inserter( commonNeighbors ) );
+	if( commonNeighbors.size() != shared )
+		return false;
+
+	// no triangle that's left may lose its area, or turn far enough to fold over or stand on edge
+	const osg::Vec3d& target = positions[ to ];
+	for( unsigned int i = 0; i < vertexTriangles[ from ].size(); i++ ) {
+		const Triangle& tri = triangles[ vertexTriangles[ from ][i] ];
+		if( tri.removed || tri.vertex[0] == to || tri.vertex[1] == to || tri.vertex[2] == to )
+			continue;
+
+		osg::Vec3d before[3], after[3];
+		for( int k = 0; k < 3; k++ ) {
+			before[k] = positions[ tri.vertex[k] ];
+			after[k] = ( tri.vertex[k] == from ? target : before[k] );
+		}
+		osg::Vec3d oldNormal = ( before[1] - before[0] ) ^ ( before[2] - before[0] );
+		osg::Vec3d newNormal = ( after[1] - after[0] ) ^ ( after[2] - after[0] );
+		double newLength = newNormal.length();
+		if( newLength <= 0.0 || oldNormal * newNormal < MIN_TURN * oldNormal.length() * newLength )
+			return false;
+	}
+
+	return true;
+}
+
+void MeshSimplifier::consider( unsigned int a, unsigned int b ) {
+	Collapse best;
+	best.cost = DBL_MAX;
+	for( int way = 0; way < 2; way++ ) {
+		unsigned int from = ( way == 0 ? a : b );
+		unsigned int to = ( way == 0 ? b : a );
+		if( !canCollapse( from, to ) )
+			continue;
+
+		Quadric q = quadrics[ from ];
+		q.add( quadrics[ to ] );
+		double cost = q.evaluate( positions[ to ] );
+		if( cost < best.cost ) {
+			best.cost = cost;
+			best.from = from;
+			best.to = to;
+		}
+	}
+	if( best.cost == DBL_MAX )
+		return;
+
+	best.fromVersion = versions[ best.from ];
+	best.toVersion = versions[ best.to ];
+	heap.push_back( best );
+	push_heap( heap.begin(), heap.end() );
+}
+
+void MeshSimplifier::considerAround( unsigned int v ) {
+	vector< unsigned int > neighbors;
+	for( unsigned int i = 0; i < vertexTriangles[ v ].size(); i++ ) {
+		const Triangle& tri = triangles[ vertexTriangles[ v ][i] ];
+		if( tri.removed )
+			continue;
+		for( int k = 0; k < 3; k++ ) {
+			if( tri.vertex[k] != v )
+				neighbors.push_back( tri.vertex[k] );
+		}
+	}
+	sort( neighbors.begin(), neighbors.end() );
+	neighbors.erase( unique( neighbors.begin(), neighbors.end() ), neighbors.end() );
+
+	for( unsigned int i = 0; i < neighbors.size(); i++ )
+		consider( v, neighbors[i] );
+}
+
+void MeshSimplifier::collapse( unsigned int from, unsigned int to ) {
+	Quadric q = errorQuadrics[ from ];
+	q.add( errorQuadrics[ to ] );
+	error = max( error, q.evaluate( positions[ to ] ) );
+
+	// the corners of from become the ones of to that they're joined to across the edge, so
+	// normals and texture coordinates stay smooth where they were
+	map< unsigned int, unsigned int > cornerMap;
+	vector< unsigned int > neighbors;
+	vector< unsigned int >& around = vertexTriangles[ from ];
+	for( unsigned int i = 0; i < around.size(); i++ ) {
+		Triangle& tri = triangles[ around[i] ];
+		if( tri.removed )
+			continue;
+		int fromAt = -1, toAt = -1;
+		for( int k = 0; k < 3; k++ ) {
+			if( tri.vertex[k] == from )
+				fromAt = k;
+			else {
+				neighbors.push_back( tri.vertex[k] );
+				if( tri.vertex[k] == to )
+					toAt = k;
+			}
+		}
+		if( toAt < 0 )
+			continue;
+
+		cornerMap.insert( make_pair( tri.corner[ fromAt ], tri.corner[ toAt ] ) );
+		tri.removed = true;
+		liveTriangles--;
+	}
+
+	vector< unsigned int >& target = vertexTriangles[ to ];
+	for( unsigned int i = 0; i < around.size(); i++ ) {
+		Triangle& tri = triangles[ around[i] ];
+		if( tri.removed )
+			continue;
+		for( int k = 0; k < 3; k++ ) {
+			if( tri.vertex[k] != from )
+				continue;
+			map< unsigned int, unsigned int >::iterator m = cornerMap.find( tri.corner[k] );
+			if( m == cornerMap.end() ) {
+				unsigned int corner = cornerFor( to, cornerNormal[ tri.corner[k] ], cornerTexcoord[ tri.corner[k] ] );
+				m = cornerMap.insert( make_pair( tri.corner[k], corner ) ).first;
+			}
+			tri.vertex[k] = to;
+			tri.corner[k] = m->second;
+		}
+		target.push_back( around[i] );
+	}
+
+	// drop the triangles that are gone from to's list while it's being changed anyway
+	unsigned int kept = 0;
+	for( unsigned int i = 0; i < target.size(); i++ ) {
+		if( !triangles[ target[i] ].removed )
+			target[ kept++ ] = target[i];
+	}
+	target.resize( kept );
+	vector< unsigned int >().swap( around );
+
+	// the boundary edges of from are now to's
+	for( unsigned int i = 0; i < neighbors.size() && boundaryCount[ from ] > 0; i++ ) {
+		unsigned int w = neighbors[i];
+		if( boundaryEdges.erase( edge( from, w ) ) == 0 )
+			continue;
+		boundaryCount[ from ]--;
+		boundaryCount[ w ]--;
+		if( w != to && boundaryEdges.insert( edge( to, w ) ).second ) {
+			boundaryCount[ to ]++;
+			boundaryCount[ w ]++;
+		}
+	}
+
+	quadrics[ to ].add( quadrics[ from ] );
+	errorQuadrics[ to ].add( errorQuadrics[ from ] );
+	removed[ from ] = 1;
+	versions[ from ]++;
+	versions[ to ]++;
+
+	considerAround( to );
+}
+
+void MeshSimplifier::simplify( unsigned int target ) {
+	while( liveTriangles > target && !heap.empty() ) {
+		pop_heap( heap.begin(), heap.end() );
+		Collapse next = heap.back();
+		heap.pop_back();
+
+		if( versions[ next.from ] != next.fromVersion || versions[ next.to ] != next.toVersion )
+			continue;
+
+		// the neighborhood may have changed since it was queued
+		if( !canCollapse( next.from, next.to ) )
+			continue;
+
+		collapse( next.from, next.to );
+	}
+}
+
+void MeshSimplifier::snapshot( vector< vector< unsigned int > >& groups ) {
+	for( unsigned int i = 0; i < groups.size(); i++ )
+		groups[i].clear();
+
+	for( unsigned int t = 0; t < triangles.size(); t++ ) {
+		if( triangles[t].removed )
+			continue;
+		for( int k = 0; k < 3; k++ )
+			groups[ triangles[t].group ].push_back( triangles[t].corner[k] );
+	}
+}
+
+DrawInfo* MeshSimplifier::buildDrawInfo( const MeshData& data, unsigned int levels, vector< Level >& made ) {
+	made.clear();
+	if( levels == 0 )
+		return NULL;
+
+	const vector< osg::Vec3 >& vertices = data.getVertices();
+	unsigned int normalCount = data.getNormals().size();
+	unsigned int texcoordCount = data.getTexcoords().size();
+
+	positions.assign( vertices.begin(), vertices.end() );
+
+	// triangulate the faces, with a group for each material
+	vector< material* > materials;
+	map< material*, unsigned int > groupOf;
+	Triangulator triangulator;
+	vector< unsigned int > faceTriangles;
+	for( unsigned int f = 0; f < data.getFaceCount(); f++ ) {
+		MeshFace face = data.getFace( f );
+		unsigned int count = face.getCount();
+		const int* vs = face.getVertices();
+		const int* ns = face.getNormals();
+		const int* ts = face.getTexcoords();
+
+		// faces with indices out of range aren't drawn
+		bool inRange = true;
+		for( unsigned int i = 0; i < count; i++ ) {
+			inRange = inRange && vs[i] >= 0 && vs[i] < (int)vertices.size();
+			inRange = inRange && ( ns == NULL || ( ns[i] >= 0 && ns[i] < (int)normalCount ) );
+			inRange = inRange && ( ts == NULL || ( ts[i] >= 0 && ts[i] < (int)texcoordCount ) );
+		}
+		if( count < 3 || !inRange )
+			continue;
+
+		material* mat = face.getMaterial();
+		if( mat == NULL )
+			return NULL;
+		map< material*, unsigned int >::iterator g = groupOf.find( mat );
+		if( g == groupOf.end() ) {
+			g = groupOf.insert( make_pair( mat, (unsigned int)materials.size() ) ).first;
+			materials.push_back( mat );
+		}
+
+		faceTriangles.clear();
+		triangulator.triangulate( &vertices[0], vs, count, faceTriangles );
+		for( unsigned int i = 0; i + 2 < faceTriangles.size(); i += 3 ) {
+			Triangle tri;
+			for( int k = 0; k < 3; k++ ) {
+				unsigned int c = faceTriangles[ i + k ];
+				tri.vertex[k] = vs[c];
+
+				// corners without a normal or texcoord get the first one, if the mesh has any
+				tri.corner[k] = cornerFor( vs[c], ( ns != NULL ? ns[c] : 0 ), ( ts != NULL ? ts[c] : 0 ) );
+			}
+			tri.group = g->second;
+			tri.removed = false;
+
+			// triangles using a vertex twice have nothing to draw
+			if( tri.vertex[0] == tri.vertex[1] || tri.vertex[1] == tri.vertex[2] || tri.vertex[0] == tri.vertex[2] )
+				continue;
+			triangles.push_back( tri );
+		}
+	}
+	if( triangles.empty() )
+		return NULL;
+	liveTriangles = triangles.size();
+
+	// the bounds of what's drawn
+	osg::Vec3d low( DBL_MAX, DBL_MAX, DBL_MAX ), high( -DBL_MAX, -DBL_MAX, -DBL_MAX );
+	for( unsigned int t = 0; t < triangles.size(); t++ ) {
+		for( int k = 0; k < 3; k++ ) {
+			const osg::Vec3d& p = positions[ triangles[t].vertex[k] ];
+			for( int i = 0; i < 3; i++ ) {
+				low[i] = min( low[i], p[i] );
+				high[i] = max( high[i], p[i] );
+			}
+		}
+	}
+	osg::Vec3d center = ( low + high ) * 0.5;
+	double radius = ( high - center ).length();
+
+	unsigned int vertexCount = positions.size();
+	errorQuadrics.assign( vertexCount, Quadric() );
+	vertexTriangles.assign( vertexCount, vector< unsigned int >() );
+	versions.assign( vertexCount, 0 );
+	removed.assign( vertexCount, 0 );
+	boundaryCount.assign( vertexCount, 0 );
+	for( unsigned int t = 0; t < triangles.size(); t++ ) {
+		const Triangle& tri = triangles[t];
+		osg::Vec3d normal;
+		double d;
+		bool flat = planeOf( positions[ tri.vertex[0] ], positions[ tri.vertex[1] ], positions[ tri.vertex[2] ], normal, d );
+		for( int k = 0; k < 3; k++ ) {
+			if( flat )
+				errorQuadrics[ tri.vertex[k] ].addPlane( normal, d, 1.0 );
+			vertexTriangles[ tri.vertex[k] ].push_back( t );
+		}
+	}
+	quadrics = errorQuadrics;
+	findBoundaries();
+
+	heap.clear();
+	for( unsigned int v = 0; v < vertexCount; v++ ) {
+		for( unsigned int i = 0; i < vertexTriangles[v].size(); i++ ) {
+			const Triangle& tri = triangles[ vertexTriangles[v][i] ];
+			for( int k = 0; k < 3; k++ ) {
+				// each edge once, from its lower end
+				if( tri.vertex[k] > v )
+					consider( v, tri.vertex[k] );
+			}
+		}
+	}
+
+	// make the levels, each from the one before.  A simplification that changes nothing
+	// replaces the level before it, since it looks the same for less.
+	vector< vector< vector< unsigned int > > > snapshots;
+	snapshots.push_back( vector< vector< unsigned int > >( materials.size() ) );
+	snapshot( snapshots.back() );
+	Level full = { liveTriangles, 0.0f };
+	made.push_back( full );
+
+	while( made.size() < levels ) {
+		unsigned int before = made.back().triangles;
+		unsigned int target = (unsigned int)( before * REDUCTION );
+		if( target == 0 )
+			break;
+		simplify( target );
+		if( liveTriangles == 0 || liveTriangles > before * MIN_REDUCTION )
+			break;
+
+		double distance = sqrt( error );
+		if( distance <= EXACT * radius ) {
+			snapshot( snapshots.back() );
+			made.back().triangles = liveTriangles;
+			continue;
+		}
+
+		// keep lengthPerPixel rising, so each level is drawn before the next
+		Level level = { liveTriangles, (float)max( distance, 2.0 * made.back().lengthPerPixel ) };
+		made.push_back( level );
+		snapshots.push_back( vector< vector< unsigned int > >( materials.size() ) );
+		snapshot( snapshots.back() );
+	}
+
+	// number the corners the levels use in the order they're first used, putting each
+	// triangle list in an order that reuses the vertex cache
+	vector< int > number( cornerVertex.size(), -1 );
+	vector< Index3D > corners;
+	vector< unsigned int > start, order;
+	for( unsigned int l = 0; l < snapshots.size(); l++ ) {
+		for( unsigned int g = 0; g < snapshots[l].size(); g++ ) {
+			vector< unsigned int >& tris = snapshots[l][g];
+			if( tris.empty() )
+				continue;
+
+			start.resize( tris.size() / 3 + 1 );
+			for( unsigned int t = 0; t < start.size(); t++ )
+				start[t] = 3 * t;
+			MeshOptimizer::tipsify( start, tris, cornerVertex.size(), order );
+
+			vector< unsigned int > reordered;
+			reordered.reserve( tris.size() );
+			for( unsigned int t = 0; t < order.size(); t++ ) {
+				for( int k = 0; k < 3; k++ ) {
+					unsigned int c = tris[ 3 * order[t] + k ];
+					if( number[c] < 0 ) {
+						number[c] = corners.size();
+						corners.push_back( Index3D( cornerVertex[c], cornerNormal[c], cornerTexcoord[c] ) );
+					}
+					reordered.push_back( number[c] );
+				}
+			}
+			tris = reordered;
+		}
+	}
+
+	DrawInfo* drawInfo = new DrawInfo();
+	drawInfo->getCorners() = corners;
+	drawInfo->setExtents( Point3D( low.x(), low.y(), low.z() ), Point3D( high.x(), high.y(), high.z() ) );
+	drawInfo->setSphere( Point3D( center.x(), center.y(), center.z() ), (float)( radius * radius ) );
+
+	vector< LOD >& lods = drawInfo->getLods();
+	for( unsigned int l = 0; l < snapshots.size(); l++ ) {
+		lods.push_back( LOD() );
+		LOD& lod = lods.back();
+		lod.setLengthPerPixel( made[l].lengthPerPixel );
+
+		for( unsigned int g = 0; g < snapshots[l].size(); g++ ) {
+			if( snapshots[l][g].empty() )
+				continue;
+			LOD::MaterialSet* matSet = new LOD::MaterialSet();
+			matSet->matref = materials[g]->getName();
+			matSet->commands.push_back( LODCommand( "tris", vector< int >( snapshots[l][g].begin(), snapshots[l][g].end() ) ) );
+			lod.getMaterialSets().push_back( matSet );
+		}
+	}
+
+	return drawInfo;
+}
@@ -0,0 +1,469 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "render/ObjectBVH.h"
+
+#include "objects/bz2object.h"
+
+#include <osg/ComputeBoundsVisitor>
+#include <osgUtil/IntersectionVisitor>
+#include <osgUtil/LineSegmentIntersector>
+
+#include <algorithm>
+
+using namespace std;
+
+const unsigned int ObjectBVH::LEAF_SIZE = 4;
+
+// how many buckets the centers are sorted into when looking for the best split
+static const int BINS = 16;
+
+static float surfaceArea( const osg::BoundingBox& box ) {
+	if( !box.valid() )
+		return 0.0f;
+
+	osg::Vec3 size = box._max - box._min;
+	return 2.0f * ( size.x() * size.y() + size.y() * size.z() + size.z() * size.x() );
+}
+
+// where a segment (given as its start and the inverse of its direction) enters a box, as a
+// fraction of its length.  Axes the segment runs parallel to give NaNs, which the comparisons skip.
+static bool hitBox( const osg::BoundingBox& box, const osg::Vec3& start, const osg::Vec3& inverse, float& distance ) {
+	float enter = 0.0f;
+	float leave = 1.0f;
+
+	for( int axis = 0; axis < 3; axis++ ) {
+		float t0 = ( box._min[ axis ] - start[ axis ] ) * inverse[ axis ];
+		float t1 = ( box._max[ axis ] - start[ axis ] ) * inverse[ axis ];
+		if( t0 > t1 )
+			swap( t0, t1 );
+
+		if( t0 > enter )
+			enter = t0;
+		if( t1 < leave )
+			leave = t1;
+		if( enter > leave )
+			return false;
+	}
+
+	distance = enter;
+	return true;
+}
+
+// whether a box is inside every plane of a volume (1), outside one of them (-1), or neither (0)
+static int classify( const osg::Polytope& volume, const osg::BoundingBox& box ) {
+	int result = 1;
+	const osg::Polytope::PlaneList& planes = volume.getPlaneList();
+	for( osg::Polytope::PlaneList::const_iterator i = planes.begin(); i != planes.end(); i++ ) {
+		int side = i->intersect( box );
+		if( side < 0 )
+			return -1;
+		if( side == 0 )
+			result = 0;
+	}
+	return result;
+}
+
+// for partitioning the leaves
+struct HasBound {
+	template< typename T > bool operator()( const T& leaf ) const { return leaf.bound.valid(); }
+};
+
+struct BelowSplit {
+	int axis;
+	float min;
+	float scale;
+	int split;
+
+	template< typename T > bool operator()( const T& leaf ) const {
+		int bin = (int)( ( leaf.bound.center()[ axis ] - min ) * scale );
+		return ( bin < BINS ? bin : BINS - 1 ) < split;
+	}
+};
+
+struct CenterLess {
+	int axis;
+
+	template< typename T > bool operator()( const T& a, const T& b ) const {
+		return a.bound.center()[ axis ] < b.bound.center()[ axis ];
+	}
+};
+
+ObjectBVH::ObjectBVH() {
+	needsBuild = false;
+	refits = 0;
+	tested = 0;
+}
+
+void ObjectBVH::addObject( bz2object* obj ) {
+	if( obj == NULL || leafIndex.count( obj ) > 0 )
+		return;
+
+	Leaf leaf;
+	leaf.object = obj;
+	leaf.dirty = true;
+	leaf.node = -1;
+
+	leafIndex[ obj ] = leaves.size();
+	leaves.push_back( leaf );
+	moved.push_back( obj );
+	needsBuild = true;
+}
+
+void ObjectBVH::removeObject( bz2object* obj ) {
+	map< bz2object*, unsigned int >::iterator i = leafIndex.find( obj );
+	if( i == leafIndex.end() )
+		return;
+
+	// move the last leaf into the hole; the tree is rebuilt before it's used again
+	unsigned int index = i->second;
+	leafIndex.erase( i );
+	if( index + 1 < leaves.size() ) {
+		leaves[ index ] = leaves.back();
+		leafIndex[ leaves[ index ].object ] = index;
+	}
+	leaves.pop_back();
+	needsBuild = true;
+}
+
+void ObjectBVH::updateObject( bz2object* obj ) {
+	map< bz2object*, unsigned int >::iterator i = leafIndex.find( obj );
+	if( i == leafIndex.end() || leaves[ i->second ].dirty )
+		return;
+
+	leaves[ i->second ].dirty = true;
+	moved.push_back( obj );
+}
+
+void ObjectBVH::clear() {
+	leaves.clear();
+	leafIndex.clear();
+	nodes.clear();
+	moved.clear();
+	needsBuild = false;
+	refits = 0;
+}
+
+osg::BoundingBox ObjectBVH::computeBound( bz2object* obj ) {
+	// this starts at the object itself, so its own transform is included
+	osg::ComputeBoundsVisitor visitor;
+	obj->accept( visitor );
+	return visitor.getBoundingBox();
+}
+
+void ObjectBVH::updateBound( unsigned int leaf ) {
+	Leaf& l = leaves[ leaf ];
+	bool hadBound = l.bound.valid();
+
+	l.bound = computeBound( l.object );
+	l.dirty = false;
+
+	// objects without bounds are kept out of the tree
+	if( hadBound != l.bound.valid() )
+		needsBuild = true;
+}
+
+void ObjectBVH::refit( unsigned int leaf ) {
+	updateBound( leaf );
+
+	int n = leaves[ leaf ].node;
+	if( needsBuild || n < 0 )
+		return;
+
+	// the leaf node fits its leaves again, and each ancestor fits its children
+	Node& node = nodes[ n ];
+	node.bound.init();
+	for( unsigned int i = node.first; i < node.first + node.count; i++ )
+		node.bound.expandBy( leaves[i].bound );
+
+	for( n = node.parent; n >= 0; n = nodes[ n ].parent ) {
+		osg::BoundingBox bound;
+		bound.expandBy( nodes[ nodes[ n ].left ].bound );
+		bound.expandBy( nodes[ nodes[ n ].right ].bound );
+		nodes[ n ].bound = bound;
+	}
+
+	refits++;
+}
+
+void ObjectBVH::refresh() {
+	// only the objects that were said to have moved are looked at
+	for( vector< bz2object* >::iterator i = moved.begin(); i != moved.end(); i++ ) {
+		map< bz2object*, unsigned int >::iterator leaf = leafIndex.find( *i );
+		if( leaf == leafIndex.end() || !leaves[ leaf->second ].dirty )
+			continue;
+
+		if( needsBuild )
+			updateBound( leaf->second );
+		else
+			refit( leaf->second );
+	}
+	moved.clear();
+
+	// refitting only ever grows nodes, so after a lot of it the tree is better off rebuilt
+	if( needsBuild || refits > leaves.size() / 4 + 16 )
+		build();
+}
+
+void ObjectBVH::build() {
+	nodes.clear();
+	needsBuild = false;
+	refits = 0;
+
+	// leaves without bounds go to the end, outside the tree
+	unsigned int count = partition( leaves.begin(), leaves.end(), HasBound() ) - leaves.begin();
+	for( unsigned int i = count; i < leaves.size(); i++ )
+		leaves[i].node = -1;
+
+	if( count > 0 ) {
+		nodes.reserve( 2 * ( count / LEAF_SIZE ) + 1 );
+		buildNode( 0, count, -1 );
+	}
+
+	for( unsigned int i = 0; i < leaves.size(); i++ )
+		leafIndex[ leaves[i].object ] = i;
+}
+
+int ObjectBVH::buildNode( unsigned int first, unsigned int count, int parent ) {
+	int index = nodes.size();
+	nodes.push_back( Node() );
+
+	osg::BoundingBox bound;
+	osg::BoundingBox centers;
+	for( unsigned int i = first; i < first + count; i++ ) {
+		bound.expandBy( leaves[i].bound );
+		centers.expandBy( leaves[i].bound.center() );
+	}
+
+	Node& node = nodes[ index ];
+	node.bound = bound;
+	node.parent = parent;
+	node.left = node.right = -1;
+	node.first = first;
+	node.count = count;
+
+	if( count <= LEAF_SIZE ) {
+		for( unsigned int i = first; i < first + count; i++ )
+			leaves[i].node = index;
+		return index;
+	}
+
+	// split along the axis the centers are most spread out on
+	osg::Vec3 extent = centers._max - centers._min;
+	int axis = 0;
+	if( extent.y() > extent[ axis ] )
+		axis = 1;
+	if( extent.z() > extent[ axis ] )
+		axis = 2;
+
+	unsigned int middle = first;
+
+	if( extent[ axis ] > 0.0f ) {
+		// sort the centers into bins, and find the split between bins with the lowest
+		// surface area cost (area times count, on each side)
+		BelowSplit below;
+		below.axis = axis;
+		below.min = centers._min[ axis ];
+		below.scale = BINS / extent[ axis ];
+
+		unsigned int binCounts[ BINS ] = { 0 };
+		osg::BoundingBox binBounds[ BINS ];
+		for( unsigned int i = first; i < first + count; i++ ) {
+			int bin = (int)( ( leaves[i].bound.center()[ axis ] - below.min ) * below.scale );
+			if( bin >= BINS )
+				bin = BINS - 1;
+			binCounts[ bin ]++;
+			binBounds[ bin ].expandBy( leaves[i].bound );
+		}
+
+		float rightCosts[ BINS ];
+		osg::BoundingBox right;
+		unsigned int rightCount = 0;
+		for( int b = BINS - 1; b > 0; b-- ) {
+			right.expandBy( binBounds[b] );
+			rightCount += binCounts[b];
+			rightCosts[b] = surfaceArea( right ) * rightCount;
+		}
+
+		osg::BoundingBox left;
+		unsigned int leftCount = 0;
+		float bestCost = 0.0f;
+		below.split = 0;
+		for( int b = 1; b < BINS; b++ ) {
+			left.expandBy( binBounds[ b - 1 ] );
+			leftCount += binCounts[ b - 1 ];
+			float cost = surfaceArea( left ) * leftCount + rightCosts[b];
+			if( below.split == 0 || cost < bestCost ) {
+				bestCost = cost;
+				below.split = b;
+			}
+		}
+
+		middle = partition( leaves.begin() + first, leaves.begin() + first + count, below ) - leaves.begin();
+	}
+
+	// everything landed on one side (or on one spot); split the count in half instead
+	if( middle == first || middle == first + count ) {
+		CenterLess less;
+		less.axis = axis;
+		middle = first + count / 2;
+		nth_element( leaves.begin() + first, leaves.begin() + middle, leaves.begin() + first + count, less );
+	}
+
+	// the children may reallocate the node array, so don't keep a reference across them
+	int leftChild = buildNode( first, middle - first, index );
+	int rightChild = buildNode( middle, first + count - middle, index );
+	nodes[ index ].left = leftChild;
+	nodes[ index ].right = rightChild;
+
+	return index;
+}
+
+void ObjectBVH::collect( const osg::Vec3& start, const osg::Vec3& end, vector< Candidate >& candidates ) {
+	if( nodes.empty() )
+		return;
+
+	osg::Vec3 direction = end - start;
+	osg::Vec3 inverse( 1.0f / direction.x(), 1.0f / direction.y(), 1.0f / direction.z() );
+
+	vector< int > stack;
+	stack.push_back( 0 );
+
+	while( !stack.empty() ) {
+		const Node& node = nodes[ stack.back() ];
+		stack.pop_back();
+
+		float distance;
+		if( !hitBox( node.bound, start, inverse, distance ) )
+			continue;
+
+		if( node.left >= 0 ) {
+			stack.push_back( node.left );
+			stack.push_back( node.right );
+			continue;
+		}
+
+		for( unsigned int i = node.first; i < node.first + node.count; i++ ) {
+			Candidate candidate;
+			candidate.leaf = i;
+			if( hitBox( leaves[i].bound, start, inverse, candidate.distance ) )
+				candidates.push_back( candidate );
+		}
+	}
+}
+
+void ObjectBVH::collect( int node, vector< bz2object* >& hits ) {
+	const Node& n = nodes[ node ];
+	if( n.left >= 0 ) {
+		collect( n.left, hits );
+		collect( n.right, hits );
+		return;
+	}
+
+	for( unsigned int i = n.first; i < n.first + n.count; i++ )
+		hits.push_back( leaves[i].object );
+}
+
+void ObjectBVH::intersect( const osg::Polytope& volume, vector< bz2object* >& hits ) {
+	refresh();
+
+	if( nodes.empty() )
+		return;
+
+	vector< int > stack;
+	stack.push_back( 0 );
+
+	while( !stack.empty() ) {
+		int index = stack.back();
+		const Node& node = nodes[ index ];
+		stack.pop_back();
+
+		int side = classify( volume, node.bound );
+		if( side < 0 )
+			continue;
+
+		// everything under a node that's inside is too
+		if( side > 0 ) {
+			collect( index, hits );
+			continue;
+		}
+
+		if( node.left >= 0 ) {
+			stack.push_back( node.left );
+			stack.push_back( node.right );
+			continue;
+		}
+
+		for( unsigned int i = node.first; i < node.first + node.count; i++ ) {
+			if( classify( volume, leaves[i].bound ) > 0 )
+				hits.push_back( leaves[i].object );
+		}
+	}
+}
+
+osg::BoundingBox ObjectBVH::getBound( bz2object* obj ) {
+	map< bz2object*, unsigned int >::iterator i = leafIndex.find( obj );
+	if( i == leafIndex.end() )
+		return osg::BoundingBox();
+
+	return leaves[ i->second ].bound;
+}
+
+void ObjectBVH::intersect( const osg::Vec3& start, const osg::Vec3& end, vector< bz2object* >& hits ) {
+	refresh();
+
+	vector< Candidate > candidates;
+	collect( start, end, candidates );
+	sort( candidates.begin(), candidates.end() );
+
+	for( vector< Candidate >::iterator i = candidates.begin(); i != candidates.end(); i++ )
+		hits.push_back( leaves[ i->leaf ].object );
+}
+
+bz2object* ObjectBVH::pick( const osg::Vec3& start, const osg::Vec3& end, unsigned int mask, osg::Vec3* point ) {
+	refresh();
+
+	vector< Candidate > candidates;
+	collect( start, end, candidates );
+	sort( candidates.begin(), candidates.end() );
+
+	bz2object* nearest = NULL;
+	double nearestRatio = 2.0;
+	tested = 0;
+
+	for( vector< Candidate >::iterator i = candidates.begin(); i != candidates.end(); i++ ) {
+		// nothing further along can be in front of what was already hit
+		if( i->distance > nearestRatio )
+			break;
+
+		bz2object* obj = leaves[ i->leaf ].object;
+
+		osg::ref_ptr< osgUtil::LineSegmentIntersector > intersector = new osgUtil::LineSegmentIntersector( start, end );
+		osgUtil::IntersectionVisitor visitor( intersector.get() );
+		visitor.setTraversalMask( mask );
+		obj->accept( visitor );
+		tested++;
+
+		if( !intersector->containsIntersections() )
+			continue;
+
+		const osgUtil::LineSegmentIntersector::Intersection& hit = intersector->getFirstIntersection();
+		if( hit.ratio < nearestRatio ) {
+			nearest = obj;
+			nearestRatio = hit.ratio;
+			if( point != NULL )
+				*point = hit.getWorldIntersectPoint();
+		}
+	}
+
+	return nearest;
+}
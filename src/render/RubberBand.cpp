@@ -0,0 +1,71 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "render/RubberBand.h"
+
+#include "render/StaticBatch.h"
+
+#include <osg/Geode>
+#include <osg/LineWidth>
+
+RubberBand::RubberBand() : osg::Camera() {
+	// draw after the scene, on top of it, in window coordinates
+	setReferenceFrame( osg::Transform::ABSOLUTE_RF );
+	setRenderOrder( osg::Camera::POST_RENDER );
+	setClearMask( 0 );
+	setViewMatrix( osg::Matrix::identity() );
+	setProjectionMatrixAsOrtho2D( 0, 1, 0, 1 );
+
+	// it's only drawn, never picked
+	setNodeMask( StaticBatch::DRAW_MASK );
+
+	vertices = new osg::Vec3Array();
+	loop = new osg::DrawArrays( osg::PrimitiveSet::LINE_LOOP, 0, 0 );
+
+	osg::Vec4Array* color = new osg::Vec4Array();
+	color->push_back( osg::Vec4( 1.0, 1.0, 0.0, 1.0 ) );
+
+	geometry = new osg::Geometry();
+	geometry->setUseDisplayList( false );
+	geometry->setDataVariance( osg::Object::DYNAMIC );
+	geometry->setVertexArray( vertices.get() );
+	geometry->setColorArray( color );
+	geometry->setColorBinding( osg::Geometry::BIND_OVERALL );
+	geometry->addPrimitiveSet( loop.get() );
+
+	osg::Geode* geode = new osg::Geode();
+	geode->addDrawable( geometry.get() );
+
+	osg::StateSet* states = geode->getOrCreateStateSet();
+	states->setMode( GL_LIGHTING, osg::StateAttribute::OFF | osg::StateAttribute::PROTECTED );
+	states->setMode( GL_DEPTH_TEST, osg::StateAttribute::OFF | osg::StateAttribute::PROTECTED );
+	states->setTextureMode( 0, GL_TEXTURE_2D, osg::StateAttribute::OFF | osg::StateAttribute::PROTECTED );
+	states->setAttributeAndModes( new osg::LineWidth( 1.0f ) );
+	states->setRenderBinDetails( 1000, "RenderBin" );
+
+	addChild( geode );
+}
+
+void RubberBand::setOutline( const std::vector< osg::Vec2 >& points ) {
+	vertices->clear();
+	if( points.size() >= 2 ) {
+		for( std::vector< osg::Vec2 >::const_iterator i = points.begin(); i != points.end(); i++ )
+			vertices->push_back( osg::Vec3( i->x(), i->y(), 0 ) );
+	}
+
+	loop->setCount( vertices->size() );
+	geometry->dirtyBound();
+}
+
+void RubberBand::setWindowSize( int width, int height ) {
+	setProjectionMatrixAsOrtho2D( 0, width, 0, height );
+}
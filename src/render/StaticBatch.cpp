@@ -0,0 +1,843 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "render/StaticBatch.h"
+
+#include "objects/bz2object.h"
+#include "model/Primitives.h"
+
+#include <osg/Version>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Billboard>
+#include <osg/LOD>
+#include <osg/NodeVisitor>
+#include <osg/Transform>
+#include <osg/TriangleIndexFunctor>
+#include <osg/Program>
+#include <osg/Shader>
+#include <osg/Uniform>
+
+// instanced drawing needs glVertexAttribDivisor(), which OpenSceneGraph wraps from 3.2 on.
+// Without it, unit meshes are merged like everything else.
+#ifdef OSG_MIN_VERSION_REQUIRED
+#if OSG_MIN_VERSION_REQUIRED( 3, 2, 0 )
+#define USE_INSTANCING
+#include <osg/VertexAttribDivisor>
+#endif
+#endif
+
+#include <math.h>
+
+using namespace std;
+
+const unsigned int StaticBatch::PICK_MASK = 0x1;
+const unsigned int StaticBatch::DRAW_MASK = 0x2;
+const float StaticBatch::CELL_SIZE = 64.0f;
+
+bool StaticBatch::instancing = false;
+
+// the StateSets that apply to a drawable, outermost first (empty ones are left out)
+typedef vector< osg::StateSet* > StateStack;
+
+static bool isEmpty( osg::StateSet* states ) {
+	return states->getModeList().empty() &&
+		   states->getAttributeList().empty() &&
+		   states->getTextureModeList().empty() &&
+		   states->getTextureAttributeList().empty() &&
+		   states->getUniformList().empty() &&
+		   states->getRenderingHint() == osg::StateSet::DEFAULT_BIN &&
+		   states->getRenderBinMode() == osg::StateSet::INHERIT_RENDERBIN_DETAILS;
+}
+
+// order StateSet stacks by content, so that equal copies land in the same batch
+struct StateStackLess {
+	bool operator()( const StateStack& a, const StateStack& b ) const {
+		if( a.size() != b.size() )
+			return a.size() < b.size();
+
+		for( unsigned int i = 0; i < a.size(); i++ ) {
+			if( a[i] == b[i] )
+				continue;
+
+			int result = a[i]->compare( *b[i], true );
+			if( result != 0 )
+				return result < 0;
+		}
+
+		return false;
+	}
+};
+
+// one Geometry of an object, and where it goes
+struct Piece {
+	osg::Geometry* geometry;
+	osg::Matrix matrix;
+	StateStack states;
+
+	// for a side of a unit mesh, where its vertices sit in its texture rectangle, and the
+	// rectangle (u0, v0, u1, v1).  NULL if the piece can't be drawn as an instance.
+	osg::Vec2Array* corners;
+	osg::Vec4 rect;
+};
+
+#ifdef USE_INSTANCING
+
+// whether a Geometry's texture coordinates are only the unit mesh's corners stretched
+// over a rectangle, and if so, which rectangle
+static bool findRect( osg::Geometry* geometry, osg::Vec2Array* corners, osg::Vec4& rect ) {
+	rect.set( 0, 0, 0, 0 );
+
+	osg::Vec2Array* texCoords = (osg::Vec2Array*)geometry->getTexCoordArray( 0 );
+	if( texCoords == NULL )
+		return true;
+	if( texCoords->size() != corners->size() )
+		return false;
+
+	for( unsigned int i = 0; i < corners->size(); i++ ) {
+		const osg::Vec2& corner = (*corners)[i];
+		const osg::Vec2& uv = (*texCoords)[i];
+		if( corner.x() == 0 )
+			rect[0] = uv.x();
+		else if( corner.x() == 1 )
+			rect[2] = uv.x();
+		if( corner.y() == 0 )
+			rect[1] = uv.y();
+		else if( corner.y() == 1 )
+			rect[3] = uv.y();
+	}
+
+	for( unsigned int i = 0; i < corners->size(); i++ ) {
+		const osg::Vec2& corner = (*corners)[i];
+		osg::Vec2 expected( rect[0] + corner.x() * ( rect[2] - rect[0] ), rect[1] + corner.y() * ( rect[3] - rect[1] ) );
+		osg::Vec2 error = expected - (*texCoords)[i];
+		float tolerance = 1e-4f * ( 1.0f + (*texCoords)[i].length() );
+		if( fabsf( error.x() ) > tolerance || fabsf( error.y() ) > tolerance )
+			return false;
+	}
+
+	return true;
+}
+
+#endif
+
+// collects an object's Geometries, and whether all of them can be merged
+class BatchCollector : public osg::NodeVisitor {
+
+public:
+
+	BatchCollector() : osg::NodeVisitor( osg::NodeVisitor::NODE_VISITOR, osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN ) {
+		mergeable = true;
+	}
+
+	vector< Piece > pieces;
+	bool mergeable;
+
+	void apply( osg::LOD& node ) { mergeable = false; }
+	void apply( osg::Billboard& node ) { mergeable = false; }
+
+	void apply( osg::Geode& node ) {
+		osg::NodePath& path = getNodePath();
+
+		Piece piece;
+		piece.matrix = osg::computeLocalToWorld( path );
+		for( osg::NodePath::iterator i = path.begin(); i != path.end(); i++ ) {
+			if( (*i)->getStateSet() != NULL && !isEmpty( (*i)->getStateSet() ) )
+				piece.states.push_back( (*i)->getStateSet() );
+		}
+
+		for( unsigned int i = 0; i < node.getNumDrawables(); i++ ) {
+			osg::Geometry* geometry = node.getDrawable( i )->asGeometry();
+			if( geometry == NULL || !canMerge( geometry ) ) {
+				mergeable = false;
+				return;
+			}
+
+			piece.geometry = geometry;
+			piece.corners = NULL;
+#ifdef USE_INSTANCING
+			osg::Vec2Array* corners = Primitives::getUnitCorners( geometry->getVertexArray() );
+			if( corners != NULL && geometry->getColorArray() == NULL && findRect( geometry, corners, piece.rect ) )
+				piece.corners = corners;
+#endif
+			pieces.push_back( piece );
+
+			osg::StateSet* states = geometry->getStateSet();
+			if( states != NULL && !isEmpty( states ) )
+				pieces.back().states.push_back( states );
+		}
+	}
+
+private:
+
+	static bool perVertex( osg::Array* array, osg::Geometry::AttributeBinding binding, unsigned int count ) {
+		if( array == NULL || binding == osg::Geometry::BIND_OFF )
+			return true;
+		if( binding == osg::Geometry::BIND_OVERALL )
+			return array->getNumElements() >= 1;
+		return binding == osg::Geometry::BIND_PER_VERTEX && array->getNumElements() >= count;
+	}
+
+	static bool canMerge( osg::Geometry* geometry ) {
+		osg::Vec3Array* vertices = dynamic_cast< osg::Vec3Array* >( geometry->getVertexArray() );
+		if( vertices == NULL )
+			return false;
+
+		unsigned int count = vertices->size();
+
+		if( geometry->getNormalArray() != NULL && dynamic_cast< osg::Vec3Array* >( geometry->getNormalArray() ) == NULL )
+			return false;
+		if( !perVertex( geometry->getNormalArray(), geometry->getNormalBinding(), count ) )
+			return false;
+
+		if( geometry->getColorArray() != NULL && dynamic_cast< osg::Vec4Array* >( geometry->getColorArray() ) == NULL )
+			return false;
+		if( !perVertex( geometry->getColorArray(), geometry->getColorBinding(), count ) )
+			return false;
+
+		for( unsigned int unit = 0; unit < geometry->getNumTexCoordArrays(); unit++ ) {
+			osg::Array* texCoords = geometry->getTexCoordArray( unit );
+			if( texCoords == NULL )
+				continue;
+			if( unit > 0 || dynamic_cast< osg::Vec2Array* >( texCoords ) == NULL || texCoords->getNumElements() < count )
+				return false;
+		}
+
+		// points and lines would be lost
+		for( unsigned int i = 0; i < geometry->getNumPrimitiveSets(); i++ ) {
+			GLenum mode = geometry->getPrimitiveSet( i )->getMode();
+			if( mode == GL_POINTS || mode == GL_LINES || mode == GL_LINE_STRIP || mode == GL_LINE_LOOP )
+				return false;
+		}
+
+		return true;
+	}
+};
+
+// collects the triangles of a Geometry as indices into the merged arrays
+struct TriangleCollector {
+	osg::DrawElementsUInt* triangles;
+	unsigned int base;
+
+	void operator()( unsigned int a, unsigned int b, unsigned int c ) {
+		triangles->push_back( base + a );
+		triangles->push_back( base + b );
+		triangles->push_back( base + c );
+	}
+};
+
+// the merged geometry for one StateSet stack
+class Batch {
+
+public:
+
+	Batch() {
+		vertices = new osg::Vec3Array();
+		triangles = new osg::DrawElementsUInt( GL_TRIANGLES );
+	}
+
+	void add( Piece& piece ) {
+		osg::Geometry* geometry = piece.geometry;
+		osg::Vec3Array* v = (osg::Vec3Array*)geometry->getVertexArray();
+		osg::Vec3Array* n = (osg::Vec3Array*)geometry->getNormalArray();
+		osg::Vec4Array* c = (osg::Vec4Array*)geometry->getColorArray();
+		osg::Vec2Array* t = (osg::Vec2Array*)geometry->getTexCoordArray( 0 );
+
+		if( n != NULL && geometry->getNormalBinding() == osg::Geometry::BIND_OFF )
+			n = NULL;
+		if( c != NULL && geometry->getColorBinding() == osg::Geometry::BIND_OFF )
+			c = NULL;
+
+		unsigned int base = vertices->size();
+		unsigned int count = v->size();
+
+		// the other arrays are either missing or as long as the vertex array
+		if( n != NULL && !normals.valid() ) {
+			normals = new osg::Vec3Array();
+			normals->resize( base, osg::Vec3( 0, 0, 1 ) );
+		}
+		if( c != NULL && !colors.valid() ) {
+			colors = new osg::Vec4Array();
+			colors->resize( base, osg::Vec4( 1, 1, 1, 1 ) );
+		}
+		if( t != NULL && !texCoords.valid() ) {
+			texCoords = new osg::Vec2Array();
+			texCoords->resize( base, osg::Vec2( 0, 0 ) );
+		}
+
+		// normals go through the inverse transpose
+		osg::Matrix inverse = osg::Matrix::inverse( piece.matrix );
+		bool overallNormal = ( n != NULL && geometry->getNormalBinding() == osg::Geometry::BIND_OVERALL );
+		bool overallColor = ( c != NULL && geometry->getColorBinding() == osg::Geometry::BIND_OVERALL );
+
+		for( unsigned int i = 0; i < count; i++ ) {
+			vertices->push_back( (*v)[i] * piece.matrix );
+
+			if( normals.valid() ) {
+				if( n != NULL ) {
+					osg::Vec3 normal = osg::Matrix::transform3x3( inverse, (*n)[ overallNormal ? 0 : i ] );
+					normal.normalize();
+					normals->push_back( normal );
+				}
+				else
+					normals->push_back( osg::Vec3( 0, 0, 1 ) );
+			}
+
+			if( colors.valid() )
+				colors->push_back( c != NULL ? (*c)[ overallColor ? 0 : i ] : osg::Vec4( 1, 1, 1, 1 ) );
+
+			if( texCoords.valid() )
+				texCoords->push_back( t != NULL ? (*t)[i] : osg::Vec2( 0, 0 ) );
+		}
+
+		osg::TriangleIndexFunctor< TriangleCollector > collector;
+		collector.triangles = triangles.get();
+		collector.base = base;
+		geometry->accept( collector );
+	}
+
+	osg::Geometry* build() {
+		osg::Geometry* geometry = new osg::Geometry();
+		geometry->setUseDisplayList( false );
+		geometry->setUseVertexBufferObjects( true );
+
+		geometry->setVertexArray( vertices.get() );
+		if( normals.valid() ) {
+			geometry->setNormalArray( normals.get() );
+			geometry->setNormalBinding( osg::Geometry::BIND_PER_VERTEX );
+		}
+		if( colors.valid() ) {
+			geometry->setColorArray( colors.get() );
+			geometry->setColorBinding( osg::Geometry::BIND_PER_VERTEX );
+		}
+		if( texCoords.valid() )
+			geometry->setTexCoordArray( 0, texCoords.get() );
+
+		geometry->addPrimitiveSet( triangles.get() );
+		return geometry;
+	}
+
+	// how much its arrays and indices take
+	unsigned int getBytes() {
+		unsigned int bytes = vertices->size() * sizeof( osg::Vec3 ) + triangles->size() * sizeof( GLuint );
+		if( normals.valid() )
+			bytes += normals->size() * sizeof( osg::Vec3 );
+		if( colors.valid() )
+			bytes += colors->size() * sizeof( osg::Vec4 );
+		if( texCoords.valid() )
+			bytes += texCoords->size() * sizeof( osg::Vec2 );
+		return bytes;
+	}
+
+	// the first stack seen with these contents; the batch draws with it
+	StateStack states;
+
+private:
+
+	osg::ref_ptr< osg::Vec3Array > vertices;
+	osg::ref_ptr< osg::Vec3Array > normals;
+	osg::ref_ptr< osg::Vec4Array > colors;
+	osg::ref_ptr< osg::Vec2Array > texCoords;
+	osg::ref_ptr< osg::DrawElementsUInt > triangles;
+};
+
+#ifdef USE_INSTANCING
+
+// the per-instance attributes: three rows of the object's transform, and its texture rectangle
+static const unsigned int INSTANCE_ROWS = 12;
+static const unsigned int INSTANCE_RECT = 15;
+
+// Instances are lit per vertex the way the fixed-function pipeline lights everything else:
+// every light's ambient, diffuse and specular terms, with attenuation and spotlights, for a
+// viewer at infinity.  GLSL 1.20 can't tell which lights are enabled, so a light that is set up
+// but switched off would still light the instances.  Lights nothing sets up keep OpenGL's
+// black defaults, and light 0 is the viewer's headlight, which is always on.
+static const char* instanceVertexSource =
+	"#version 120\n"
+	"attribute vec4 instanceRow0;\n"
+	"attribute vec4 instanceRow1;\n"
+	"attribute vec4 instanceRow2;\n"
+	"attribute vec4 instanceRect;\n"
+	"varying vec2 texCoord;\n"
+	"varying vec4 lightColor;\n"
+	"void main() {\n"
+	"	vec4 local = vec4( gl_Vertex.xyz, 1.0 );\n"
+	"	vec4 world = vec4( dot( instanceRow0, local ), dot( instanceRow1, local ), dot( instanceRow2, local ), 1.0 );\n"
+	"	gl_Position = gl_ModelViewProjectionMatrix * world;\n"
+	"	vec2 uv = mix( instanceRect.xy, instanceRect.zw, gl_MultiTexCoord0.xy );\n"
+	"	texCoord = ( gl_TextureMatrix[0] * vec4( uv, 0.0, 1.0 ) ).xy;\n"
+	"	vec3 normal = vec3( dot( instanceRow0.xyz, gl_Normal ), dot( instanceRow1.xyz, gl_Normal ), dot( instanceRow2.xyz, gl_Normal ) );\n"
+	"	normal = normalize( gl_NormalMatrix * normal );\n"
+	"	vec3 eye = ( gl_ModelViewMatrix * world ).xyz;\n"
+	"	vec4 color = gl_FrontLightModelProduct.sceneColor;\n"
+	"	for( int i = 0; i < gl_MaxLights; i++ ) {\n"
+	"		vec3 toLight = gl_LightSource[i].position.xyz;\n"
+	"		float attenuation = 1.0;\n"
+	"		if( gl_LightSource[i].position.w != 0.0 ) {\n"
+	"			toLight -= eye;\n"
+	"			float range = length( toLight );\n"
+	"			attenuation = 1.0 / ( gl_LightSource[i].constantAttenuation + gl_LightSource[i].linearAttenuation * range +\n"
+	"								  gl_LightSource[i].quadraticAttenuation * range * range );\n"
+	"			if( gl_LightSource[i].spotCutoff <= 90.0 ) {\n"
+	"				float spot = dot( normalize( -toLight ), normalize( gl_LightSource[i].spotDirection ) );\n"
+	"				attenuation *= ( spot < gl_LightSource[i].spotCosCutoff ? 0.0 : pow( spot, gl_LightSource[i].spotExponent ) );\n"
+	"			}\n"
+	"		}\n"
+	"		toLight = normalize( toLight );\n"
+	"		float diffuse = max( dot( normal, toLight ), 0.0 );\n"
+	"		vec4 lit = gl_FrontLightProduct[i].ambient + gl_FrontLightProduct[i].diffuse * diffuse;\n"
+	"		if( diffuse > 0.0 ) {\n"
+	"			float specular = max( dot( normal, normalize( toLight + vec3( 0.0, 0.0, 1.0 ) ) ), 0.0 );\n"
+	"			lit += gl_FrontLightProduct[i].specular * pow( specular, gl_FrontMaterial.shininess );\n"
+	"		}\n"
+	"		color += attenuation * lit;\n"
+	"	}\n"
+	"	lightColor = clamp( color, 0.0, 1.0 );\n"
+	"	lightColor.a = gl_FrontMaterial.diffuse.a;\n"
+	"}\n";
+
+static const char* instanceFragmentSource =
+	"#version 120\n"
+	"uniform sampler2D texture0;\n"
+	"uniform bool textured;\n"
+	"varying vec2 texCoord;\n"
+	"varying vec4 lightColor;\n"
+	"void main() {\n"
+	"	vec4 color = lightColor;\n"
+	"	if( textured )\n"
+	"		color *= texture2D( texture0, texCoord );\n"
+	"	gl_FragColor = color;\n"
+	"}\n";
+
+// the program and attribute divisors every instanced batch draws with
+static osg::StateSet* getInstanceStates() {
+	static osg::ref_ptr< osg::StateSet > states;
+	if( states.valid() )
+		return states.get();
+
+	osg::Program* program = new osg::Program();
+	program->addShader( new osg::Shader( osg::Shader::VERTEX, instanceVertexSource ) );
+	program->addShader( new osg::Shader( osg::Shader::FRAGMENT, instanceFragmentSource ) );
+	program->addBindAttribLocation( "instanceRow0", INSTANCE_ROWS );
+	program->addBindAttribLocation( "instanceRow1", INSTANCE_ROWS + 1 );
+	program->addBindAttribLocation( "instanceRow2", INSTANCE_ROWS + 2 );
+	program->addBindAttribLocation( "instanceRect", INSTANCE_RECT );
+
+	states = new osg::StateSet();
+	states->setAttributeAndModes( program, osg::StateAttribute::ON );
+	states->addUniform( new osg::Uniform( "texture0", 0 ) );
+	for( unsigned int i = INSTANCE_ROWS; i <= INSTANCE_RECT; i++ )
+		states->setAttribute( new osg::VertexAttribDivisor( i, 1 ) );
+
+	return states.get();
+}
+
+// whether the innermost StateSet that says anything about texture unit 0 turns it on
+static bool isTextured( const StateStack& states ) {
+	bool textured = false;
+	for( StateStack::const_iterator i = states.begin(); i != states.end(); i++ ) {
+		osg::StateAttribute::GLModeValue mode = (*i)->getTextureMode( 0, GL_TEXTURE_2D );
+		if( mode != osg::StateAttribute::INHERIT )
+			textured = ( mode & osg::StateAttribute::ON ) != 0;
+		else if( (*i)->getTextureAttribute( 0, osg::StateAttribute::TEXTURE ) != NULL )
+			textured = true;
+	}
+	return textured;
+}
+
+#endif
+
+// every instance of one side of a unit mesh with one StateSet stack.  The side's vertex and
+// normal arrays are shared with the objects; each instance only adds its slot in the
+// per-instance arrays, which can be rewritten when the object is edited.
+class StaticBatch::Instances : public osg::Referenced {
+
+public:
+
+	Instances( Piece& piece ) {
+		vertices = piece.geometry->getVertexArray();
+		states = piece.states;
+
+		for( int i = 0; i < 3; i++ )
+			rows[i] = new osg::Vec4Array();
+		rects = new osg::Vec4Array();
+
+		osg::Geometry* unit = piece.geometry;
+		geometry = new osg::Geometry();
+		geometry->setUseDisplayList( false );
+		geometry->setUseVertexBufferObjects( true );
+
+		// slots are rewritten in place, so the draw thread has to be done with it before they are
+		geometry->setDataVariance( osg::Object::DYNAMIC );
+
+		geometry->setVertexArray( unit->getVertexArray() );
+		if( unit->getNormalArray() != NULL && unit->getNormalBinding() != osg::Geometry::BIND_OFF ) {
+			// the unit box's normal indices are 0..3, so its normals can be used as they are
+			geometry->setNormalArray( unit->getNormalArray() );
+			geometry->setNormalBinding( unit->getNormalBinding() == osg::Geometry::BIND_OVERALL ? osg::Geometry::BIND_OVERALL : osg::Geometry::BIND_PER_VERTEX );
+		}
+		geometry->setTexCoordArray( 0, piece.corners );
+
+#ifdef USE_INSTANCING
+		for( int i = 0; i < 3; i++ ) {
+			geometry->setVertexAttribArray( INSTANCE_ROWS + i, rows[i].get() );
+			geometry->setVertexAttribBinding( INSTANCE_ROWS + i, osg::Geometry::BIND_PER_VERTEX );
+		}
+		geometry->setVertexAttribArray( INSTANCE_RECT, rects.get() );
+		geometry->setVertexAttribBinding( INSTANCE_RECT, osg::Geometry::BIND_PER_VERTEX );
+
+		geometry->getOrCreateStateSet()->addUniform( new osg::Uniform( "textured", isTextured( states ) ) );
+#endif
+
+		for( unsigned int i = 0; i < unit->getNumPrimitiveSets(); i++ )
+			geometry->addPrimitiveSet( (osg::PrimitiveSet*)unit->getPrimitiveSet( i )->clone( osg::CopyOp::SHALLOW_COPY ) );
+	}
+
+	// whether a piece draws the same side with the same states
+	bool matches( Piece& piece ) {
+		StateStackLess less;
+		return piece.corners != NULL && piece.geometry->getVertexArray() == vertices &&
+			   !less( piece.states, states ) && !less( states, piece.states );
+	}
+
+	// add an instance, and return its slot
+	unsigned int add( Piece& piece ) {
+		unsigned int slot = rects->size();
+		for( int i = 0; i < 3; i++ )
+			rows[i]->push_back( osg::Vec4() );
+		rects->push_back( osg::Vec4() );
+
+		set( slot, piece );
+		return slot;
+	}
+
+	// rewrite an instance's slot
+	void set( unsigned int slot, Piece& piece ) {
+		const osg::Matrix& m = piece.matrix;
+		for( int i = 0; i < 3; i++ ) {
+			(*rows[i])[ slot ].set( m( 0, i ), m( 1, i ), m( 2, i ), m( 3, i ) );
+			rows[i]->dirty();
+		}
+		(*rects)[ slot ] = piece.rect;
+		rects->dirty();
+
+		// the bound only grows; it's redone when the cell is rebuilt
+		const osg::Vec3Array* v = (const osg::Vec3Array*)vertices;
+		for( unsigned int i = 0; i < v->size(); i++ )
+			bound.expandBy( (*v)[i] * m );
+		geometry->setInitialBound( bound );
+		geometry->dirtyBound();
+	}
+
+	osg::Geometry* build() {
+#ifdef USE_INSTANCING
+		for( unsigned int i = 0; i < geometry->getNumPrimitiveSets(); i++ )
+			geometry->getPrimitiveSet( i )->setNumInstances( rects->size() );
+#endif
+		return geometry.get();
+	}
+
+	// how much the per-instance arrays take; the side's own arrays are shared with the objects
+	unsigned int getBytes() {
+		return rects->size() * 4 * sizeof( osg::Vec4 );
+	}
+
+	StateStack states;
+
+private:
+
+	const osg::Array* vertices;
+
+	osg::ref_ptr< osg::Geometry > geometry;
+	osg::ref_ptr< osg::Vec4Array > rows[3];
+	osg::ref_ptr< osg::Vec4Array > rects;
+	osg::BoundingBox bound;
+};
+
+// put a batch under a chain of Groups carrying its StateSets, so edits to them show up
+static osg::Node* wrap( osg::Geode* geode, StateStack& states ) {
+	osg::Node* node = geode;
+	if( !states.empty() ) {
+		geode->setStateSet( states.back() );
+		for( int s = (int)states.size() - 2; s >= 0; s-- ) {
+			osg::Group* group = new osg::Group();
+			group->setStateSet( states[s] );
+			group->addChild( node );
+			node = group;
+		}
+	}
+	return node;
+}
+
+// instanced batches are keyed by the side they draw, then by states
+typedef pair< const osg::Array*, StateStack > InstanceKey;
+
+struct InstanceKeyLess {
+	bool operator()( const InstanceKey& a, const InstanceKey& b ) const {
+		if( a.first != b.first )
+			return a.first < b.first;
+		return StateStackLess()( a.second, b.second );
+	}
+};
+
+StaticBatch::StaticBatch() : osg::Group() {
+	batchedCount = 0;
+	batchCount = 0;
+	batchBytes = 0;
+	builtInstancing = instancing;
+
+	// the batches are only drawn; picking goes to the objects
+	setNodeMask( DRAW_MASK );
+}
+
+StaticBatch::~StaticBatch() {
+}
+
+void StaticBatch::setInstancing( bool value ) { instancing = value; }
+bool StaticBatch::getInstancing() { return instancing; }
+
+StaticBatch::CellKey StaticBatch::cellFor( bz2object* obj ) {
+	const osg::BoundingSphere& bound = obj->getBound();
+	return CellKey( (int)floorf( bound.center().x() / CELL_SIZE ), (int)floorf( bound.center().y() / CELL_SIZE ) );
+}
+
+void StaticBatch::markDirty( const CellKey& key ) {
+	Cell& cell = cells[ key ];
+	if( !cell.node.valid() ) {
+		cell.node = new osg::Group();
+		cell.dirty = false;
+		cell.batched = cell.batches = cell.bytes = 0;
+		addChild( cell.node.get() );
+	}
+
+	if( !cell.dirty ) {
+		cell.dirty = true;
+		dirtyCells.push_back( key );
+	}
+}
+
+void StaticBatch::addObject( bz2object* obj ) {
+	if( obj == NULL || entryIndex.count( obj ) > 0 )
+		return;
+
+	Entry entry;
+	entry.object = obj;
+	entry.cell = cellFor( obj );
+	entry.revision = obj->getRevision();
+	entry.selected = obj->isSelected();
+	entry.built = false;
+
+	entryIndex[ obj ] = entries.size();
+	entries.push_back( entry );
+
+	cells[ entry.cell ].members.insert( obj );
+	markDirty( entry.cell );
+}
+
+void StaticBatch::removeObject( bz2object* obj ) {
+	map< bz2object*, unsigned int >::iterator i = entryIndex.find( obj );
+	if( i == entryIndex.end() )
+		return;
+
+	unsigned int index = i->second;
+	CellKey key = entries[ index ].cell;
+	cells[ key ].members.erase( obj );
+	markDirty( key );
+
+	// it draws itself again wherever it ends up
+	obj->setNodeMask( ~0u );
+
+	// move the last entry into the hole
+	entryIndex.erase( i );
+	if( index + 1 < entries.size() ) {
+		entries[ index ] = entries.back();
+		entryIndex[ entries[ index ].object ] = index;
+	}
+	entries.pop_back();
+}
+
+void StaticBatch::refresh() {
+	// the draw that used these finished before this frame's update began
+	retired.clear();
+
+	// instancing was switched on or off:  every cell has to be built again
+	if( builtInstancing != instancing ) {
+		builtInstancing = instancing;
+		for( map< CellKey, Cell >::iterator i = cells.begin(); i != cells.end(); i++ )
+			markDirty( i->first );
+	}
+
+	// see which objects changed since their cell was built.  This is one pass over an array
+	// of small records, which is far cheaper than drawing the objects one at a time.
+	for( vector< Entry >::iterator i = entries.begin(); i != entries.end(); i++ ) {
+		bz2object* obj = i->object;
+		bool selected = obj->isSelected();
+
+		// selected objects are moved and edited a lot; they only matter once they're let go
+		if( selected ) {
+			if( !i->selected )
+				markDirty( i->cell );
+			continue;
+		}
+
+		if( i->selected || !i->built || i->revision != obj->getRevision() ) {
+			CellKey key = cellFor( obj );
+
+			// an edited instance that stays in its cell only needs its slots rewritten
+			if( key == i->cell && !i->selected && i->built && updateInstances( cells[ key ], obj ) ) {
+				i->revision = obj->getRevision();
+				continue;
+			}
+
+			if( key != i->cell ) {
+				cells[ i->cell ].members.erase( obj );
+				markDirty( i->cell );
+				i->cell = key;
+				cells[ key ].members.insert( obj );
+			}
+			markDirty( key );
+		}
+	}
+
+	for( vector< CellKey >::iterator i = dirtyCells.begin(); i != dirtyCells.end(); i++ ) {
+		map< CellKey, Cell >::iterator cell = cells.find( *i );
+		if( cell == cells.end() )
+			continue;
+
+		batchedCount -= cell->second.batched;
+		batchCount -= cell->second.batches;
+		batchBytes -= cell->second.bytes;
+
+		rebuild( cell->first, cell->second );
+
+		batchedCount += cell->second.batched;
+		batchCount += cell->second.batches;
+		batchBytes += cell->second.bytes;
+
+		// drop cells nothing is in anymore
+		if( cell->second.members.empty() ) {
+			retired.push_back( cell->second.node.get() );
+			removeChild( cell->second.node.get() );
+			cells.erase( cell );
+		}
+	}
+	dirtyCells.clear();
+}
+
+bool StaticBatch::updateInstances( Cell& cell, bz2object* obj ) {
+	map< bz2object*, vector< Slot > >::iterator i = cell.slots.find( obj );
+	if( i == cell.slots.end() )
+		return false;
+
+	BatchCollector collector;
+	obj->accept( collector );
+
+	vector< Slot >& slots = i->second;
+	if( !collector.mergeable || collector.pieces.size() != slots.size() )
+		return false;
+	for( unsigned int p = 0; p < slots.size(); p++ ) {
+		if( !slots[p].instances->matches( collector.pieces[p] ) )
+			return false;
+	}
+
+	for( unsigned int p = 0; p < slots.size(); p++ )
+		slots[p].instances->set( slots[p].index, collector.pieces[p] );
+	return true;
+}
+
+void StaticBatch::rebuild( const CellKey& key, Cell& cell ) {
+	cell.dirty = false;
+	cell.batched = 0;
+	cell.batches = 0;
+	cell.bytes = 0;
+	for( unsigned int i = 0; i < cell.node->getNumChildren(); i++ )
+		retired.push_back( cell.node->getChild( i ) );
+	cell.node->removeChildren( 0, cell.node->getNumChildren() );
+	cell.slots.clear();
+
+	map< StateStack, Batch, StateStackLess > batches;
+	map< InstanceKey, osg::ref_ptr< Instances >, InstanceKeyLess > instances;
+
+	for( set< bz2object* >::iterator i = cell.members.begin(); i != cell.members.end(); i++ ) {
+		bz2object* obj = *i;
+		Entry& entry = entries[ entryIndex[ obj ] ];
+		entry.revision = obj->getRevision();
+		entry.selected = obj->isSelected();
+		entry.built = true;
+
+		// let it draw itself until it turns out to be mergeable
+		obj->setNodeMask( ~0u );
+
+		if( entry.selected )
+			continue;
+
+		BatchCollector collector;
+		obj->accept( collector );
+		if( !collector.mergeable || collector.pieces.empty() )
+			continue;
+
+		// objects made only of instances remember their slots, so that edits can rewrite them
+		vector< Slot > slots;
+		bool instanced = true;
+
+		for( vector< Piece >::iterator p = collector.pieces.begin(); p != collector.pieces.end(); p++ ) {
+			if( p->corners != NULL && builtInstancing ) {
+				osg::ref_ptr< Instances >& batch = instances[ InstanceKey( p->geometry->getVertexArray(), p->states ) ];
+				if( !batch.valid() )
+					batch = new Instances( *p );
+
+				Slot slot;
+				slot.instances = batch;
+				slot.index = batch->add( *p );
+				slots.push_back( slot );
+				continue;
+			}
+
+			Batch& batch = batches[ p->states ];
+			if( batch.states.empty() )
+				batch.states = p->states;
+			batch.add( *p );
+			instanced = false;
+		}
+
+		if( instanced )
+			cell.slots[ obj ].swap( slots );
+
+		obj->setNodeMask( PICK_MASK );
+		cell.batched++;
+	}
+
+	for( map< StateStack, Batch, StateStackLess >::iterator i = batches.begin(); i != batches.end(); i++ ) {
+		osg::Geode* geode = new osg::Geode();
+		geode->addDrawable( i->second.build() );
+		cell.node->addChild( wrap( geode, i->second.states ) );
+		cell.batches++;
+		cell.bytes += i->second.getBytes();
+	}
+
+#ifdef USE_INSTANCING
+	// the instanced batches all hang off a Group with the instancing program
+	if( !instances.empty() ) {
+		osg::Group* group = new osg::Group();
+		group->setStateSet( getInstanceStates() );
+		cell.node->addChild( group );
+
+		for( map< InstanceKey, osg::ref_ptr< Instances >, InstanceKeyLess >::iterator i = instances.begin(); i != instances.end(); i++ ) {
+			osg::Geode* geode = new osg::Geode();
+			geode->addDrawable( i->second->build() );
+			group->addChild( wrap( geode, i->second->states ) );
+			cell.batches++;
+			cell.bytes += i->second->getBytes();
+		}
+	}
+#endif
+}
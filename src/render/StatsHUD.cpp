@@ -0,0 +1,100 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "render/StatsHUD.h"
+
+#include "render/StaticBatch.h"
+#include "TextUtils.h"
+
+#include <osg/Geode>
+
+// the size of the text, and its distance from the window's edges (in pixels)
+#define HUD_TEXT_SIZE 14.0f
+#define HUD_MARGIN 8.0f
+
+FrameStats::FrameStats() {
+	frame = 0;
+	time = event = update = cull = draw = 0.0;
+	objects = visibleObjects = selectedObjects = 0;
+	batchedObjects = batches = batchBytes = 0;
+	drawables = primitiveSets = triangles = vertices = 0;
+	stateGraphs = 0;
+	materials = cachedStateSets = 0;
+}
+
+std::string FrameStats::getCSVHeader() {
+	return "frame,time,event_ms,update_ms,cull_ms,draw_ms,"
+		   "objects,visible_objects,selected_objects,batched_objects,batches,batch_bytes,"
+		   "drawables,primitive_sets,triangles,vertices,state_changes,materials,cached_statesets\n";
+}
+
+std::string FrameStats::getCSVRow() const {
+	return TextUtils::format( "%u,%.4f,%.3f,%.3f,%.3f,%.3f,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+							  frame, time, event, update, cull, draw,
+							  objects, visibleObjects, selectedObjects, batchedObjects, batches, batchBytes,
+							  drawables, primitiveSets, triangles, vertices, stateGraphs, materials, cachedStateSets );
+}
+
+StatsHUD::StatsHUD() : osg::Camera() {
+	// draw after the scene, on top of it, in window coordinates
+	setReferenceFrame( osg::Transform::ABSOLUTE_RF );
+	setRenderOrder( osg::Camera::POST_RENDER );
+	setClearMask( 0 );
+	setViewMatrix( osg::Matrix::identity() );
+	setProjectionMatrixAsOrtho2D( 0, 1, 0, 1 );
+
+	// it's only drawn, never picked
+	setNodeMask( StaticBatch::DRAW_MASK );
+
+	// the text changes every frame, so the draw thread has to be done with it before the next
+	text = new osgText::Text();
+	text->setDataVariance( osg::Object::DYNAMIC );
+	text->setCharacterSize( HUD_TEXT_SIZE );
+	text->setAlignment( osgText::Text::LEFT_TOP );
+	text->setColor( osg::Vec4( 1.0, 1.0, 0.0, 1.0 ) );
+	text->setBackdropType( osgText::Text::OUTLINE );
+	text->setBackdropColor( osg::Vec4( 0.0, 0.0, 0.0, 1.0 ) );
+	text->setPosition( osg::Vec3( HUD_MARGIN, 1.0 - HUD_MARGIN, 0 ) );
+
+	osg::Geode* geode = new osg::Geode();
+	geode->addDrawable( text.get() );
+
+	osg::StateSet* states = geode->getOrCreateStateSet();
+	states->setMode( GL_LIGHTING, osg::StateAttribute::OFF | osg::StateAttribute::PROTECTED );
+	states->setMode( GL_DEPTH_TEST, osg::StateAttribute::OFF | osg::StateAttribute::PROTECTED );
+	states->setRenderBinDetails( 1000, "RenderBin" );
+
+	addChild( geode );
+}
+
+void StatsHUD::setStats( const FrameStats& stats ) {
+	double total = stats.event + stats.update + stats.cull + stats.draw;
+
+	text->setText( TextUtils::format(
+		"Frame %u\n"
+		"Event %.2f ms  Update %.2f ms  Cull %.2f ms  Draw %.2f ms  (%.2f ms)\n"
+		"Objects %u  In view %u  Selected %u\n"
+		"Batched %u objects in %u batches (%u KB)\n"
+		"Drawables %u  Primitive sets %u  Triangles %u  Vertices %u\n"
+		"State changes %u  Materials %u  Cached StateSets %u",
+		stats.frame,
+		stats.event, stats.update, stats.cull, stats.draw, total,
+		stats.objects, stats.visibleObjects, stats.selectedObjects,
+		stats.batchedObjects, stats.batches, stats.batchBytes / 1024,
+		stats.drawables, stats.primitiveSets, stats.triangles, stats.vertices,
+		stats.stateGraphs, stats.materials, stats.cachedStateSets ) );
+}
+
+void StatsHUD::setWindowSize( int width, int height ) {
+	setProjectionMatrixAsOrtho2D( 0, width, 0, height );
+	text->setPosition( osg::Vec3( HUD_MARGIN, height - HUD_MARGIN, 0 ) );
+}
@@ -0,0 +1,281 @@
+/* BZWorkbench
+ * Copyright (c) 1993 - 2010 Tim Riker
+ *
+ * This package is free software;  you can redistribute it and/or
+ * modify it under the terms of the license found in the file
+ * named COPYING that should have accompanied this file.
+ *
+ * THIS PACKAGE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "render/Triangulator.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+// the most cells a side of the reflex corner grid gets
+#define MAX_GRID_SIDE 1024
+
+int Triangulator::project( const osg::Vec3d& normal ) {
+	double x = fabs( normal.x() ), y = fabs( normal.y() ), z = fabs( normal.z() );
+	if( x == 0.0 && y == 0.0 && z == 0.0 )
+		return -1;
+
+	if( z >= x && z >= y )
+		return 2;
+	return ( y >= x ? 1 : 0 );
+}
+
+void Triangulator::fan( unsigned int count, std::vector< unsigned int >& triangles ) {
+	for( unsigned int i = 1; i + 1 < count; i++ ) {
+		triangles.push_back( 0 );
+		triangles.push_back( i );
+		triangles.push_back( i + 1 );
+	}
+}
+
+double Triangulator::area( unsigned int a, unsigned int b, unsigned int c ) const {
+	const osg::Vec2d& pa = points[a];
+	const osg::Vec2d& pb = points[b];
+	const osg::Vec2d& pc = points[c];
+	return ( pb.x() - pa.x() ) * ( pc.y() - pb.y() ) - ( pb.y() - pa.y() ) * ( pc.x() - pb.x() );
+}
+
+void Triangulator::buildGrid() {
+	unsigned int count = points.size();
+
+	unsigned int reflexCount = 0;
+	gridMin.set( DBL_MAX, DBL_MAX );
+	gridMax.set( -DBL_MAX, -DBL_MAX );
+	for( unsigned int i = 0; i < count; i++ ) {
+		if( !reflex[i] )
+			continue;
+		reflexCount++;
+		gridMin.set( std::min( gridMin.x(), points[i].x() ), std::min( gridMin.y(), points[i].y() ) );
+		gridMax.set( std::max( gridMax.x(), points[i].x() ), std::max( gridMax.y(), points[i].y() ) );
+	}
+
+	// about one reflex corner per cell, and cells about as wide as they're high
+	double width = gridMax.x() - gridMin.x(), height = gridMax.y() - gridMin.y();
+	double aspect = ( width > 0.0 && height > 0.0 ? width / height : 1.0 );
+	if( height <= 0.0 && width > 0.0 )
+		aspect = reflexCount;
+	else if( width <= 0.0 && height > 0.0 )
+		aspect = 1.0 / std::max( 1u, reflexCount );
+
+	columns = std::max( 1, std::min( MAX_GRID_SIDE, (int)ceil( sqrt( reflexCount * aspect ) ) ) );
+	rows = std::max( 1, std::min( MAX_GRID_SIDE, (int)ceil( (double)reflexCount / columns ) ) );
+	cellScale.set( gridMax.x() > gridMin.x() ? columns / ( gridMax.x() - gridMin.x() ) : 0.0,
+				   gridMax.y() > gridMin.y() ? rows / ( gridMax.y() - gridMin.y() ) : 0.0 );
+
+	cellStart.assign( columns * rows + 1, 0 );
+	cellItems.resize( reflexCount );
+	cellEnd.clear();
+	if( reflexCount == 0 )
+		return;
+
+	// count, then place, each cell's corners
+	for( unsigned int i = 0; i < count; i++ ) {
+		if( !reflex[i] )
+			continue;
+		int column = std::min( columns - 1, (int)( ( points[i].x() - gridMin.x() ) * cellScale.x() ) );
+		int row = std::min( rows - 1, (int)( ( points[i].y() - gridMin.y() ) * cellScale.y() ) );
+		cellStart[ row * columns + column + 1 ]++;
+	}
+	for( int i = 0; i < columns * rows; i++ )
+		cellStart[ i + 1 ] += cellStart[i];
+
+	std::vector< unsigned int > fill( cellStart.begin(), cellStart.end() - 1 );
+	for( unsigned int i = 0; i < count; i++ ) {
+		if( !reflex[i] )
+			continue;
+		int column = std::min( columns - 1, (int)( ( points[i].x() - gridMin.x() ) * cellScale.x() ) );
+		int row = std::min( rows - 1, (int)( ( points[i].y() - gridMin.y() ) * cellScale.y() ) );
+		cellItems[ fill[ row * columns + column ]++ ] = i;
+	}
+
+	cellEnd.swap( fill );
+}
+
+bool Triangulator::isEar( unsigned int corner ) {
+	unsigned int a = prev[ corner ], b = corner, c = next[ corner ];
+	const osg::Vec2d& pa = points[a];
+	const osg::Vec2d& pb = points[b];
+	const osg::Vec2d& pc = points[c];
+
+	// the ear's bounds
+	osg::Vec2d low( std::min( pa.x(), std::min( pb.x(), pc.x() ) ), std::min( pa.y(), std::min( pb.y(), pc.y() ) ) );
+	osg::Vec2d high( std::max( pa.x(), std::max( pb.x(), pc.x() ) ), std::max( pa.y(), std::max( pb.y(), pc.y() ) ) );
+	if( cellItems.empty() || high.x() < gridMin.x() || high.y() < gridMin.y() || low.x() > gridMax.x() || low.y() > gridMax.y() )
+		return true;
+
+	int row0 = std::max( 0, (int)( ( low.y() - gridMin.y() ) * cellScale.y() ) );
+	int row1 = std::min( rows - 1, (int)( ( high.y() - gridMin.y() ) * cellScale.y() ) );
+
+	// a little slack, so corners on the ear's edges aren't missed by rounding
+	double slack = 1e-9 * ( ( gridMax.x() - gridMin.x() ) + ( gridMax.y() - gridMin.y() ) );
+
+	for( int row = row0; row <= row1; row++ ) {
+		// only the cells the ear crosses in this row, so long thin ears don't look at their whole bounds
+		double bottom = ( rows > 1 ? gridMin.y() + row / cellScale.y() - slack : -DBL_MAX );
+		double top = ( rows > 1 ? gridMin.y() + ( row + 1 ) / cellScale.y() + slack : DBL_MAX );
+
+		double left = DBL_MAX, right = -DBL_MAX;
+		const osg::Vec2d* ear[3] = { &pa, &pb, &pc };
+		for( int i = 0; i < 3; i++ ) {
+			const osg::Vec2d& p = *ear[i];
+			const osg::Vec2d& q = *ear[ ( i + 1 ) % 3 ];
+			if( p.y() >= bottom && p.y() <= top ) {
+				left = std::min( left, p.x() );
+				right = std::max( right, p.x() );
+			}
+
+			// where the edge crosses the row's bottom and top
+			double crossings[2] = { bottom, top };
+			for( int j = 0; j < 2; j++ ) {
+				double y = crossings[j];
+				if( ( p.y() - y ) * ( q.y() - y ) < 0.0 ) {
+					double x = p.x() + ( y - p.y() ) * ( q.x() - p.x() ) / ( q.y() - p.y() );
+					left = std::min( left, x );
+					right = std::max( right, x );
+				}
+			}
+		}
+		if( left > right )
+			continue;
+
+		int column0 = std::max( 0, (int)( ( left - slack - gridMin.x() ) * cellScale.x() ) );
+		int column1 = std::min( columns - 1, (int)( ( right + slack - gridMin.x() ) * cellScale.x() ) );
+
+		for( int column = column0; column <= column1; column++ ) {
+			int cell = row * columns + column;
+			for( unsigned int i = cellStart[ cell ]; i < cellEnd[ cell ]; i++ ) {
+				unsigned int r = cellItems[i];
+
+				// corners that are gone, or not reflex any more, are dropped from the cell as they're found
+				if( removed[r] || !reflex[r] ) {
+					cellItems[i--] = cellItems[ --cellEnd[ cell ] ];
+					continue;
+				}
+				if( r == a || r == b || r == c )
+					continue;
+
+				// corners at the same place as the ear's (where a face touches itself) don't block it
+				const osg::Vec2d& p = points[r];
+				if( p == pa || p == pb || p == pc )
+					continue;
+
+				// inside, or on an edge
+				if( area( a, b, r ) >= 0.0 && area( b, c, r ) >= 0.0 && area( c, a, r ) >= 0.0 )
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void Triangulator::consider( unsigned int corner ) {
+	// whatever was queued for it is stale now
+	stamps[ corner ]++;
+
+	if( reflex[ corner ] || !isEar( corner ) )
+		return;
+
+	// the cosine of the turn at the corner:  the sharper the ear, the sooner it's clipped
+	osg::Vec2d e0 = points[ corner ] - points[ prev[ corner ] ];
+	osg::Vec2d e1 = points[ next[ corner ] ] - points[ corner ];
+	double lengths = e0.length() * e1.length();
+
+	Candidate candidate;
+	candidate.sharpness = ( lengths > 0.0 ? -( e0 * e1 ) / lengths : 1.0 );
+	candidate.corner = corner;
+	candidate.stamp = stamps[ corner ];
+	heap.push_back( candidate );
+	std::push_heap( heap.begin(), heap.end() );
+}
+
+void Triangulator::clip( std::vector< unsigned int >& triangles ) {
+	unsigned int count = points.size();
+	// grow geometrically, since callers append face after face
+	size_t needed = triangles.size() + 3 * ( count - 2 );
+	if( triangles.capacity() < needed )
+		triangles.reserve( std::max( needed, 2 * triangles.capacity() ) );
+
+	next.resize( count );
+	prev.resize( count );
+	for( unsigned int i = 0; i < count; i++ ) {
+		next[i] = ( i + 1 ) % count;
+		prev[i] = ( i + count - 1 ) % count;
+	}
+
+	// straight corners count as reflex:  they can't be clipped, and they can block an ear
+	reflex.resize( count );
+	for( unsigned int i = 0; i < count; i++ )
+		reflex[i] = ( area( prev[i], i, next[i] ) <= 0.0 );
+
+	removed.assign( count, 0 );
+	stamps.assign( count, 0 );
+	heap.clear();
+
+	buildGrid();
+
+	for( unsigned int i = 0; i < count; i++ )
+		consider( i );
+
+	unsigned int remaining = count;
+	unsigned int last = 0;
+	while( remaining > 3 ) {
+		unsigned int ear = count;
+		while( !heap.empty() ) {
+			Candidate candidate = heap.front();
+			std::pop_heap( heap.begin(), heap.end() );
+			heap.pop_back();
+
+			if( !removed[ candidate.corner ] && candidate.stamp == stamps[ candidate.corner ] ) {
+				ear = candidate.corner;
+				break;
+			}
+		}
+
+		// no ears left, so the face isn't simple; take the first convex corner, or any corner
+		if( ear == count ) {
+			ear = last;
+			unsigned int i = last;
+			do {
+				if( !reflex[i] ) {
+					ear = i;
+					break;
+				}
+				i = next[i];
+			} while( i != last );
+		}
+
+		unsigned int a = prev[ ear ], c = next[ ear ];
+		triangles.push_back( a );
+		triangles.push_back( ear );
+		triangles.push_back( c );
+
+		removed[ ear ] = 1;
+		next[a] = c;
+		prev[c] = a;
+		remaining--;
+		last = a;
+
+		// clipping an ear can only make its neighbours more convex
+		if( reflex[a] && area( prev[a], a, c ) > 0.0 )
+			reflex[a] = 0;
+		if( reflex[c] && area( a, c, next[c] ) > 0.0 )
+			reflex[c] = 0;
+
+		consider( a );
+		consider( c );
+	}
+
+	triangles.push_back( prev[ last ] );
+	triangles.push_back( last );
+	triangles.push_back( next[ last ] );
+}
@@ -12,6 +12,17 @@
 
 #include "windows/RenderWindow.h"
 
+#include <FL/x.H>
+
+// the native windows OSG can draw into
+#if defined( _WIN32 )
+	#include <osgViewer/api/Win32/GraphicsWindowWin32>
+	#define INHERITED_WINDOWS
+#elif !defined( __APPLE__ )
+	#include <osgViewer/api/X11/GraphicsWindowX11>
+	#define INHERITED_WINDOWS
+#endif
+
 // constructor with model
 RenderWindow::RenderWindow() :
 	Fl_Gl_Window(DEFAULT_WIDTH, DEFAULT_HEIGHT) {
@@ -43,6 +54,9 @@ void RenderWindow::resize(int x, int y, int w, int h) {
 	// resize the OSG render window
 	_gw->getEventQueue()->windowResize(x, y, w, h );
     _gw->resized(x,y,w,h);
+
+	if( _threadedGW.valid() )
+		_threadedGW->resized( 0, 0, w, h );
 	
 	// resize the FLTK window
     Fl_Gl_Window::resize(x,y,w,h);	
@@ -89,3 +103,60 @@ int RenderWindow::handle(int event) {
             return Fl_Gl_Window::handle(event);
     }
 }
+
+void RenderWindow::flush() {
+	if( _threadedGW.valid() ) {
+		draw();
+		return;
+	}
+
+	Fl_Gl_Window::flush();
+}
+
+osgViewer::GraphicsWindow* RenderWindow::getActiveGraphicsWindow() {
+	if( _threadedGW.valid() )
+		return _threadedGW.get();
+	return _gw.get();
+}
+
+bool RenderWindow::setThreadedContext( bool threaded ) {
+	if( threaded == _threadedGW.valid() )
+		return true;
+
+	if( !threaded ) {
+		_threadedGW->close();
+		_threadedGW = NULL;
+		return true;
+	}
+
+#ifdef INHERITED_WINDOWS
+	if( !shown() )
+		return false;
+
+	// FLTK's window, with a GL context of OSG's own that its draw thread can make current
+	osg::ref_ptr< osg::GraphicsContext::Traits > traits = new osg::GraphicsContext::Traits();
+	traits->x = 0;
+	traits->y = 0;
+	traits->width = w();
+	traits->height = h();
+	traits->windowDecoration = false;
+	traits->doubleBuffer = true;
+	traits->depth = 24;
+	#ifdef _WIN32
+		traits->inheritedWindowData = new osgViewer::GraphicsWindowWin32::WindowData( fl_xid( this ) );
+	#else
+		traits->inheritedWindowData = new osgViewer::GraphicsWindowX11::WindowData( fl_xid( this ) );
+	#endif
+
+	osg::ref_ptr< osg::GraphicsContext > context = osg::GraphicsContext::createGraphicsContext( traits.get() );
+	osgViewer::GraphicsWindow* window = dynamic_cast< osgViewer::GraphicsWindow* >( context.get() );
+	if( window == NULL || !window->valid() )
+		return false;
+
+	_threadedGW = window;
+	return true;
+#else
+	// FLTK's windows here aren't ones OSG can inherit
+	return false;
+#endif
+}
@@ -13,9 +13,36 @@
 #include "windows/View.h"
 #include "dialogs/MenuBar.h"
 #include "objects/waterLevel.h"
+#include "model/ObserverChangeSet.h"
+#include "model/TextureLoader.h"
+
+#include <osg/Polytope>
+
+#include <algorithm>
+#include <float.h>
+
+// how often to look for textures that have finished loading
+#define TEXTURE_POLL 0.1
 
 const double View::DEFAULT_ZOOM = 75.0;
 
+// runs applyChanges() in the update traversal
+class SceneUpdateCallback : public osg::NodeCallback {
+
+public:
+
+	SceneUpdateCallback( View* _view ) { view = _view; }
+
+	virtual void operator()( osg::Node* node, osg::NodeVisitor* nv ) {
+		view->applyChanges();
+		traverse( node, nv );
+	}
+
+private:
+
+	View* view;
+};
+
 // view constructor
 View::View(Model* m, MainWindow* _mw, int _x, int _y, int _w, int _h, const char *_label) :
 	RenderWindow(_x,_y,_w,_h) {
@@ -52,6 +79,11 @@ View::View(Model* m, MainWindow* _mw, int _x, int _y, int _w, int _h, const char
    // add the ground to the root node
    this->root->addChild( ground );
 
+   // the unselected objects are drawn from merged geometry; the objects themselves are only picked
+   this->batch = new StaticBatch();
+   this->root->addChild( batch.get() );
+   this->getCamera()->setCullMask( StaticBatch::DRAW_MASK );
+
 	// set the key modifiers to false
    this->modifiers = map< int, bool >();
    this->modifiers[ FL_SHIFT ] = false;
@@ -64,6 +96,8 @@ View::View(Model* m, MainWindow* _mw, int _x, int _y, int _w, int _h, const char
 	if(objects.size() > 0) {
 		for(Model::objRefList::iterator _i = objects.begin(); _i != objects.end(); _i++) {
 			root->addChild( _i->get() );
+			batch->addObject( _i->get() );
+			pickTree.addObject( _i->get() );
 		}
 	}
 
@@ -75,6 +109,21 @@ View::View(Model* m, MainWindow* _mw, int _x, int _y, int _w, int _h, const char
    // NOTE: this has to be the LAST child on the list, because it doesn't have Z-bufferring enabled!
    this->root->addChild( selection );
 
+   // the box/lasso outline draws over everything, selection included
+   this->rubberBand = new RubberBand();
+   this->root->addChild( rubberBand.get() );
+
+   // and so do the statistics, when they're shown
+   this->statsHUD = new StatsHUD();
+   this->statsHUD->setNodeMask( 0 );
+   this->root->addChild( statsHUD.get() );
+   this->statsShown = false;
+   this->frameTrace = NULL;
+   this->tracedFrame = 0;
+
+   // the model's changes are applied to the scene in the update traversal
+   this->root->setUpdateCallback( new SceneUpdateCallback( this ) );
+
 	// add the root node to the scene
    this->setSceneData( root );
 
@@ -108,6 +157,9 @@ View::View(Model* m, MainWindow* _mw, int _x, int _y, int _w, int _h, const char
    scaleSnapSize = 1;
    translateSnapSize = 1;
    rotateSnapSize = 15;
+
+   // textures load in the background; watch for them coming in
+   Fl::add_timeout( TEXTURE_POLL, TextureCallback, this );
 }
 
 // build the mouse button map
@@ -122,6 +174,13 @@ void View::buildMouseButtonMap() {
 
 // destructor
 View::~View() {
+	Fl::remove_timeout( TextureCallback, this );
+
+	// the draw thread has to be gone before RenderWindow closes its context
+	stopThreading();
+
+	stopFrameTrace();
+
 	if(eventHandlers)
 		delete eventHandlers;
 }
@@ -129,7 +188,159 @@ View::~View() {
 
 // draw method (really simple)
 void View::draw(void) {
+	// the scene is brought up to date in the update traversal (see applyChanges())
 	frame();
+
+	if( statsShown || frameTrace != NULL )
+		recordFrameStats();
+}
+
+void View::setStatsHUD( bool show ) {
+	statsShown = show;
+
+	// culling is over by the time frame() returns, so the mask can change here
+	statsHUD->setNodeMask( show ? StaticBatch::DRAW_MASK : 0 );
+	collectStats();
+	redraw();
+}
+
+bool View::startFrameTrace( const char* filename ) {
+	stopFrameTrace();
+
+	// written as it goes, so a trace cut short still has what was recorded
+	BZWWriter* writer = new BZWWriter();
+	if( !writer->open( filename, false ) ) {
+		delete writer;
+		return false;
+	}
+
+	writer->write( FrameStats::getCSVHeader() );
+	frameTrace = writer;
+	tracedFrame = 0;
+
+	collectStats();
+	redraw();
+	return true;
+}
+
+bool View::stopFrameTrace() {
+	if( frameTrace == NULL )
+		return true;
+
+	bool written = frameTrace->close();
+	delete frameTrace;
+	frameTrace = NULL;
+
+	collectStats();
+	return written;
+}
+
+void View::collectStats() {
+	bool collect = statsShown || frameTrace != NULL;
+
+	// event and update times are the viewer's; cull and draw times, and what was drawn, the camera's
+	osg::Stats* stats = getViewerStats();
+	if( stats != NULL ) {
+		stats->collectStats( "event", collect );
+		stats->collectStats( "update", collect );
+	}
+
+	stats = getCamera()->getStats();
+	if( stats != NULL ) {
+		stats->collectStats( "rendering", collect );
+		stats->collectStats( "scene", collect );
+	}
+}
+
+// an attribute of a frame's statistics, or 0 if it wasn't recorded
+static double getStatistic( osg::Stats* stats, unsigned int frameNumber, const char* name ) {
+	double value = 0.0;
+	if( !stats->getAttribute( frameNumber, name, value ) )
+		return 0.0;
+	return value;
+}
+
+bool View::getFrameStats( FrameStats& frameStats ) {
+	osg::Stats* viewerStats = getViewerStats();
+	osg::Stats* cameraStats = getCamera()->getStats();
+	if( viewerStats == NULL || cameraStats == NULL )
+		return false;
+
+	// with a draw thread, frame() returns while the latest frame is still being drawn
+	unsigned int frameNumber = viewerStats->getLatestFrameNumber();
+	if( getThreadingModel() == osgViewer::ViewerBase::DrawThreadPerContext ||
+		getThreadingModel() == osgViewer::ViewerBase::CullThreadPerCameraDrawThreadPerContext ) {
+		if( frameNumber == 0 )
+			return false;
+		frameNumber--;
+	}
+
+	frameStats.frame = frameNumber;
+	frameStats.time = getStatistic( viewerStats, frameNumber, "Event traversal begin time" );
+	frameStats.event = 1000.0 * getStatistic( viewerStats, frameNumber, "Event traversal time taken" );
+	frameStats.update = 1000.0 * getStatistic( viewerStats, frameNumber, "Update traversal time taken" );
+	frameStats.cull = 1000.0 * getStatistic( cameraStats, frameNumber, "Cull traversal time taken" );
+	frameStats.draw = 1000.0 * getStatistic( cameraStats, frameNumber, "Draw traversal time taken" );
+
+	// what survived culling, as the cull traversal counted it
+	frameStats.drawables = (unsigned int)getStatistic( cameraStats, frameNumber, "Visible number of drawables" );
+	frameStats.primitiveSets = (unsigned int)getStatistic( cameraStats, frameNumber, "Visible number of PrimitiveSets" );
+	frameStats.vertices = (unsigned int)getStatistic( cameraStats, frameNumber, "Visible vertex count" );
+	frameStats.stateGraphs = (unsigned int)getStatistic( cameraStats, frameNumber, "Visible number of materials" );
+	frameStats.triangles = (unsigned int)( getStatistic( cameraStats, frameNumber, "Visible number of GL_TRIANGLES" ) +
+										   getStatistic( cameraStats, frameNumber, "Visible number of GL_TRIANGLE_STRIP" ) +
+										   getStatistic( cameraStats, frameNumber, "Visible number of GL_TRIANGLE_FAN" ) +
+										   2.0 * getStatistic( cameraStats, frameNumber, "Visible number of GL_QUADS" ) +
+										   2.0 * getStatistic( cameraStats, frameNumber, "Visible number of GL_QUAD_STRIP" ) );
+
+	// the objects in the view frustum, from the picking tree (batched objects aren't culled one by one)
+	osg::Polytope frustum;
+	frustum.setToUnitFrustum();
+	frustum.transformProvidingInverse( getCamera()->getViewMatrix() * getCamera()->getProjectionMatrix() );
+
+	std::vector< bz2object* > inside;
+	pickTree.intersect( frustum, inside );
+
+	frameStats.objects = model->_getObjects().size();
+	frameStats.visibleObjects = inside.size();
+	frameStats.selectedObjects = model->_getSelection().size();
+	frameStats.batchedObjects = batch->getBatchedCount();
+	frameStats.batches = batch->getBatchCount();
+	frameStats.batchBytes = batch->getBatchBytes();
+
+	unsigned int requested;
+	material::getFinalMaterialStats( requested, frameStats.materials );
+	frameStats.cachedStateSets = SceneBuilder::getStateCacheSize();
+
+	return true;
+}
+
+void View::recordFrameStats() {
+	FrameStats stats;
+	if( !getFrameStats( stats ) )
+		return;
+
+	if( statsShown ) {
+		osg::Viewport* viewport = getCamera()->getViewport();
+		if( viewport != NULL )
+			statsHUD->setWindowSize( (int)viewport->width(), (int)viewport->height() );
+
+		statsHUD->setStats( stats );
+	}
+
+	// the same frame is reported again if nothing was drawn since
+	if( frameTrace != NULL && stats.frame != tracedFrame ) {
+		frameTrace->write( stats.getCSVRow() );
+		tracedFrame = stats.frame;
+	}
+}
+
+// keep drawing while textures load, so the update traversal swaps them in
+void View::TextureCallback_real() {
+	if( TextureLoader::getSharedLoader()->isBusy() )
+		redraw();
+
+	Fl::repeat_timeout( TEXTURE_POLL, TextureCallback, this );
 }
 
 // scale the selection based on the distance from the camera to the center to ensure it stays the same size
@@ -224,15 +435,136 @@ int View::handle(int event) {
 
 // update method (inherited from Observer)
 void View::update( Observable* obs, void* data ) {
+	PendingChange change;
+	change.observable = obs;
+	change.hasMessage = ( data != NULL );
+	change.type = ObserverMessage::UPDATE_OBJECT;
+	change.data = NULL;
 
-	// refresh the selection
-	selection->update( obs, data );
-
-	// process data
 	if( data != NULL ) {
 		// get the message
 		ObserverMessage* obs_msg = (ObserverMessage*)(data);
+		change.type = obs_msg->type;
+		change.data = obs_msg->data;
+
+		// hold on to the objects, so the model can let go of them before the change is applied
+		switch( obs_msg->type ) {
+			case ObserverMessage::ADD_OBJECT :
+			case ObserverMessage::REMOVE_OBJECT :
+			case ObserverMessage::UPDATE_OBJECT :
+				change.keep.push_back( (bz2object*)(obs_msg->data) );
+				break;
 
+			case ObserverMessage::CHANGE_SET : {
+				change.changes = *(ObserverChangeSet*)(obs_msg->data);
+
+				for( std::vector< void* >::iterator i = change.changes.added.begin(); i != change.changes.added.end(); i++ )
+					change.keep.push_back( (bz2object*)(*i) );
+				for( std::vector< void* >::iterator i = change.changes.removed.begin(); i != change.changes.removed.end(); i++ )
+					change.keep.push_back( (bz2object*)(*i) );
+				for( std::vector< void* >::iterator i = change.changes.updated.begin(); i != change.changes.updated.end(); i++ )
+					change.keep.push_back( (bz2object*)(*i) );
+				break;
+			}
+			default:
+				break;
+		}
+
+		// picking doesn't wait for the next frame
+		updatePickTree( change.type, obs_msg->type == ObserverMessage::CHANGE_SET ? &change.changes : change.data );
+	}
+
+	pendingChanges.push_back( change );
+
+	// refresh the scene
+	redraw();
+}
+
+void View::updatePickTree( ObserverMessage::ObserverMessageType type, void* data ) {
+	switch( type ) {
+		case ObserverMessage::ADD_OBJECT :
+			pickTree.addObject( (bz2object*)data );
+			break;
+
+		case ObserverMessage::REMOVE_OBJECT :
+			pickTree.removeObject( (bz2object*)data );
+			break;
+
+		case ObserverMessage::UPDATE_OBJECT :
+			pickTree.updateObject( (bz2object*)data );
+			break;
+
+		case ObserverMessage::CHANGE_SET : {
+			ObserverChangeSet* changes = (ObserverChangeSet*)data;
+			for( std::vector< void* >::iterator i = changes->removed.begin(); i != changes->removed.end(); i++ )
+				pickTree.removeObject( (bz2object*)(*i) );
+			for( std::vector< void* >::iterator i = changes->added.begin(); i != changes->added.end(); i++ )
+				pickTree.addObject( (bz2object*)(*i) );
+			for( std::vector< void* >::iterator i = changes->updated.begin(); i != changes->updated.end(); i++ )
+				pickTree.updateObject( (bz2object*)(*i) );
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+void View::applyChanges() {
+	// the draw that might have used these finished before this frame started
+	retired.clear();
+
+	std::vector< PendingChange > changes;
+	changes.swap( pendingChanges );
+	for( std::vector< PendingChange >::iterator i = changes.begin(); i != changes.end(); i++ ) {
+		applyChange( *i );
+
+		// removed objects could still be in the draw that's under way
+		retired.insert( retired.end(), i->keep.begin(), i->keep.end() );
+	}
+
+	// merge whatever was unselected or edited since the last frame
+	batch->refresh();
+
+	// and swap in any textures that came in since
+	TextureLoader::getSharedLoader()->update();
+}
+
+// sets the DataVariance of the drawables under a node
+class DrawVarianceVisitor : public osg::NodeVisitor {
+
+public:
+
+	DrawVarianceVisitor( osg::Object::DataVariance _variance ) : osg::NodeVisitor( osg::NodeVisitor::TRAVERSE_ALL_CHILDREN ) {
+		variance = _variance;
+	}
+
+	virtual void apply( osg::Geode& geode ) {
+		for( unsigned int i = 0; i < geode.getNumDrawables(); i++ )
+			geode.getDrawable( i )->setDataVariance( variance );
+	}
+
+private:
+
+	osg::Object::DataVariance variance;
+};
+
+void View::setDrawVariance( bz2object* obj ) {
+	// the objects' StateSets are swapped out rather than changed, so they can stay static
+	DrawVarianceVisitor visitor( obj->isSelected() ? osg::Object::DYNAMIC : osg::Object::STATIC );
+	obj->accept( visitor );
+}
+
+void View::applyChange( PendingChange& change ) {
+
+	// the message, as it was sent
+	ObserverMessage message( change.type, change.type == ObserverMessage::CHANGE_SET ? &change.changes : change.data );
+
+	// refresh the selection
+	selection->update( change.observable, change.hasMessage ? &message : NULL );
+
+	// process data
+	if( change.hasMessage ) {
+		ObserverMessage* obs_msg = &message;
 		// process the message
 		switch( obs_msg->type ) {
 			// add an object to the scene
@@ -244,6 +576,7 @@ void View::update( Observable* obs, void* data ) {
 				else
 					getRootNode()->addChild( obj );
 
+				batch->addObject( obj );
 
 				break;
 			}
@@ -251,6 +584,7 @@ void View::update( Observable* obs, void* data ) {
 			case ObserverMessage::REMOVE_OBJECT : {
 				bz2object* obj = (bz2object*)(obs_msg->data);
 				getRootNode()->removeChild( obj );
+				batch->removeObject( obj );
 
 				break;
 			}
@@ -259,6 +593,7 @@ void View::update( Observable* obs, void* data ) {
 				// in this case, the data will contain a pointer to the modified world object
 				world* bzworld = (world*)(obs_msg->data);
 
+				retired.push_back( ground );
 				root->removeChild( ground );
 				ground = new Ground( bzworld->getSize(), model->getWaterLevelData()->getHeight() );
 				root->insertChild(0, ground);
@@ -273,17 +608,226 @@ void View::update( Observable* obs, void* data ) {
 				else
 					SceneBuilder::markUnselectedAndRestoreStateSet( obj );
 
+				setDrawVariance( obj );
+
+				break;
+			}
+			// everything that changed during a batch; rebuild the scene once for all of it
+			case ObserverMessage::CHANGE_SET : {
+				ObserverChangeSet* changes = (ObserverChangeSet*)(obs_msg->data);
+				
+				if( changes->removed.size() > 0 || changes->added.size() > 0 ) {
+					// take out only the removed children, a run of neighbours at a time, from the back
+					// so the indices still to go don't move
+					std::vector< unsigned int > removed;
+					removed.reserve( changes->removed.size() );
+					for( std::vector< void* >::iterator i = changes->removed.begin(); i != changes->removed.end(); i++ ) {
+						unsigned int index = root->getChildIndex( (bz2object*)(*i) );
+						if( index < root->getNumChildren() )
+							removed.push_back( index );
+					}
+					std::sort( removed.begin(), removed.end() );
+					removed.erase( std::unique( removed.begin(), removed.end() ), removed.end() );
+					
+					while( !removed.empty() ) {
+						unsigned int count = 1;
+						while( count < removed.size() && removed[ removed.size() - count - 1 ] + count == removed.back() )
+							count++;
+						root->removeChildren( removed.back() - count + 1, count );
+						removed.resize( removed.size() - count );
+					}
+					
+					// new objects go after everything else, so the Ground stays first
+					for( std::vector< void* >::iterator i = changes->added.begin(); i != changes->added.end(); i++ )
+						root->addChild( (bz2object*)(*i) );
+					
+					for( std::vector< void* >::iterator i = changes->removed.begin(); i != changes->removed.end(); i++ )
+						batch->removeObject( (bz2object*)(*i) );
+					for( std::vector< void* >::iterator i = changes->added.begin(); i != changes->added.end(); i++ )
+						batch->addObject( (bz2object*)(*i) );
+				}
+				
+				if( changes->worldChanged ) {
+					world* bzworld = (world*)(changes->world);
+					
+					retired.push_back( ground );
+					root->removeChild( ground );
+					ground = new Ground( bzworld->getSize(), model->getWaterLevelData()->getHeight() );
+					root->insertChild(0, ground);
+				}
+				
+				for( std::vector< void* >::iterator i = changes->updated.begin(); i != changes->updated.end(); i++ ) {
+					bz2object* obj = (bz2object*)(*i);
+					if( obj->isSelected() )
+						SceneBuilder::markSelectedAndPreserveStateSet( obj );
+					else
+						SceneBuilder::markUnselectedAndRestoreStateSet( obj );
+
+					setDrawVariance( obj );
+				}
+				
 				break;
 			}
 			default:
 				break;
 		}
 	}
+}
 
-	// refresh the scene
+bool View::setThreading( osgViewer::ViewerBase::ThreadingModel model ) {
+	if( model == getThreadingModel() )
+		return true;
+
+	// the threads have to be stopped before the camera changes contexts
+	stopThreading();
+
+	if( !setThreadedContext( model != osgViewer::ViewerBase::SingleThreaded ) )
+		return false;
+
+	getCamera()->setGraphicsContext( getActiveGraphicsWindow() );
+	getCamera()->setViewport( new osg::Viewport( 0, 0, w(), h() ) );
+
+	// a new context is realized, and the threads started, by the next frame()
+	setThreadingModel( model );
+	redraw();
+
+	return true;
+}
+
+// pick an object through the BVH, instead of running an intersector over the whole scene
+bz2object* View::pickObject( float x, float y ) {
+	// find the camera under the point, as computeIntersections() does
+	float localX = 0.0f, localY = 0.0f;
+	const osg::Camera* camera = getCameraContainingPosition( x, y, localX, localY );
+	if( camera == NULL )
+		camera = getCamera();
+
+	// take the point back from window (or clip) coordinates into the world, at the near and far planes
+	osg::Matrix matrix = camera->getViewMatrix() * camera->getProjectionMatrix();
+	float nearZ = -1.0f;
+	if( camera->getViewport() != NULL ) {
+		matrix.postMult( camera->getViewport()->computeWindowMatrix() );
+		nearZ = 0.0f;
+	}
+	osg::Matrix inverse = osg::Matrix::inverse( matrix );
+
+	osg::Vec3 start = osg::Vec3( localX, localY, nearZ ) * inverse;
+	osg::Vec3 end = osg::Vec3( localX, localY, 1.0f ) * inverse;
+
+	return pickTree.pick( start, end, StaticBatch::PICK_MASK );
+}
+
+// the matrix from world to window coordinates of the camera under a point, and the point in that window
+static const osg::Camera* getWindowMatrix( osgViewer::Viewer* viewer, const osg::Vec2& point, osg::Matrix& matrix, osg::Vec2& local ) {
+	float localX = point.x(), localY = point.y();
+	const osg::Camera* camera = viewer->getCameraContainingPosition( point.x(), point.y(), localX, localY );
+	if( camera == NULL )
+		camera = viewer->getCamera();
+
+	matrix = camera->getViewMatrix() * camera->getProjectionMatrix();
+	if( camera->getViewport() != NULL )
+		matrix.postMult( camera->getViewport()->computeWindowMatrix() );
+
+	local.set( localX, localY );
+	return camera;
+}
+
+// is a point inside a polygon? (even-odd rule)
+static bool insidePolygon( const std::vector< osg::Vec2 >& polygon, const osg::Vec2& point ) {
+	bool inside = false;
+	for( unsigned int i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++ ) {
+		const osg::Vec2& a = polygon[i];
+		const osg::Vec2& b = polygon[j];
+		if( ( a.y() > point.y() ) != ( b.y() > point.y() ) &&
+			point.x() < ( b.x() - a.x() ) * ( point.y() - a.y() ) / ( b.y() - a.y() ) + a.x() )
+			inside = !inside;
+	}
+	return inside;
+}
+
+// draw the outline of the region being dragged out
+void View::setSelectionOutline( const std::vector< osg::Vec2 >& outline ) {
+	std::vector< osg::Vec2 > points;
+	if( outline.size() > 0 ) {
+		osg::Matrix matrix;
+		osg::Vec2 local;
+		const osg::Camera* camera = getWindowMatrix( this, outline[0], matrix, local );
+		if( camera->getViewport() != NULL )
+			rubberBand->setWindowSize( (int)camera->getViewport()->width(), (int)camera->getViewport()->height() );
+
+		for( std::vector< osg::Vec2 >::const_iterator i = outline.begin(); i != outline.end(); i++ ) {
+			getWindowMatrix( this, *i, matrix, local );
+			points.push_back( local );
+		}
+	}
+
+	rubberBand->setOutline( points );
 	redraw();
 }
 
+// select everything inside a box or lasso.  The BVH culls the world down to the objects inside the
+// slab of the view frustum behind the outline's bounding rectangle, and only those get tested against
+// the outline itself, so dragging over thousands of objects costs about as much as the objects inside.
+void View::selectRegion( const std::vector< osg::Vec2 >& outline, bool add ) {
+	if( outline.size() < 3 )
+		return;
+
+	// the outline, in the window of the camera it was drawn over
+	osg::Matrix matrix;
+	osg::Vec2 local;
+	const osg::Camera* camera = getWindowMatrix( this, outline[0], matrix, local );
+
+	std::vector< osg::Vec2 > polygon;
+	osg::Vec2 low( FLT_MAX, FLT_MAX ), high( -FLT_MAX, -FLT_MAX );
+	for( std::vector< osg::Vec2 >::const_iterator i = outline.begin(); i != outline.end(); i++ ) {
+		getWindowMatrix( this, *i, matrix, local );
+		polygon.push_back( local );
+
+		low.set( osg::minimum( low.x(), local.x() ), osg::minimum( low.y(), local.y() ) );
+		high.set( osg::maximum( high.x(), local.x() ), osg::maximum( high.y(), local.y() ) );
+	}
+
+	// the bounding rectangle in clip coordinates
+	if( camera->getViewport() != NULL ) {
+		const osg::Viewport* viewport = camera->getViewport();
+		low.set( 2.0f * ( low.x() - viewport->x() ) / viewport->width() - 1.0f, 2.0f * ( low.y() - viewport->y() ) / viewport->height() - 1.0f );
+		high.set( 2.0f * ( high.x() - viewport->x() ) / viewport->width() - 1.0f, 2.0f * ( high.y() - viewport->y() ) / viewport->height() - 1.0f );
+	}
+
+	// the slab of the frustum behind it, taken back into the world
+	osg::Polytope volume;
+	volume.add( osg::Plane( 1.0, 0.0, 0.0, -low.x() ) );
+	volume.add( osg::Plane( -1.0, 0.0, 0.0, high.x() ) );
+	volume.add( osg::Plane( 0.0, 1.0, 0.0, -low.y() ) );
+	volume.add( osg::Plane( 0.0, -1.0, 0.0, high.y() ) );
+	volume.add( osg::Plane( 0.0, 0.0, 1.0, 1.0 ) );
+	volume.add( osg::Plane( 0.0, 0.0, -1.0, 1.0 ) );
+	volume.transformProvidingInverse( camera->getViewMatrix() * camera->getProjectionMatrix() );
+
+	std::vector< bz2object* > inside;
+	pickTree.intersect( volume, inside );
+
+	// the volume only holds the outline's bounding rectangle, so check the corners against the outline itself
+	std::vector< bz2object* > selected;
+	for( std::vector< bz2object* >::iterator i = inside.begin(); i != inside.end(); i++ ) {
+		osg::BoundingBox bound = pickTree.getBound( *i );
+		bool contained = true;
+		for( unsigned int c = 0; c < 8 && contained; c++ ) {
+			osg::Vec3 corner = bound.corner( c ) * matrix;
+			contained = insidePolygon( polygon, osg::Vec2( corner.x(), corner.y() ) );
+		}
+		if( contained )
+			selected.push_back( *i );
+	}
+
+	// one notification for the lot
+	model->beginBatch();
+	if( !add )
+		model->_unselectAll();
+	model->_setSelected( selected );
+	model->commitBatch();
+}
+
 // is a button pressed?
 bool View::isPressed( int value ) {
 	return modifiers[ value ];
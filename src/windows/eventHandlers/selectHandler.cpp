@@ -24,6 +24,11 @@ selectHandler::selectHandler( View* _view, osgGA::MatrixManipulator* manipulator
 	translateSnap = osg::Vec3( 0, 0, 0 );
 	scaleSnap = osg::Vec3( 0, 0, 0 );
 	rotateSnap = 0;
+
+	regionMode = REGION_NONE;
+	regionActive = false;
+	regionAdd = false;
+	manipulatorMask = 0;
 }
 
 // handle an event
@@ -37,6 +42,10 @@ bool selectHandler::handle( const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAd
     	case osgGA::GUIEventAdapter::DRAG :
 
     		viewer = dynamic_cast<View*>(&aa);
+		if( viewer != NULL && regionActive ) {
+			dragRegion( viewer, ea );
+			return true;
+		}
 		if( viewer != NULL ) {
 			Renderable* lsobj = (Renderable*)lastSelected;
 			if( lsobj != NULL && lsobj->getName() == Selection_NODE_NAME ) {
@@ -75,6 +84,11 @@ bool selectHandler::handle( const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAd
     		return false;
 
 		case osgGA::GUIEventAdapter::RELEASE:
+			if( regionActive ) {
+				viewer = dynamic_cast<View*>(&aa);
+				if( viewer != NULL )
+					endRegion( viewer, ea );
+			}
 			translateSnap = osg::Vec3( 0, 0, 0 );
 			scaleSnap = osg::Vec3( 0, 0, 0 );
 			rotateSnap = 0;
@@ -91,6 +105,11 @@ bool selectHandler::handle( const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAd
 					if ( pickSelector( viewer, ea ) ) {
        					return true;
 					}
+					// drag out a region to select, if that's the mode
+					else if ( regionMode != REGION_NONE ) {
+						beginRegion( viewer, ea );
+						return true;
+					}
 					// only pick an object if a selector couldn't be picked
 					else if ( pickObject( viewer, ea ) ) {
 						return true;
@@ -114,45 +133,30 @@ bool selectHandler::handle( const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAd
     }
 }
 
-// use the OSG intersection API to pick objects
+// pick objects through the View's bounding volume hierarchy
 bool selectHandler::pickObject(View* viewer, const osgGA::GUIEventAdapter& ea) {
 
-	// intersections with the scene
-    osgUtil::LineSegmentIntersector::Intersections intersections;
+	// only the objects whose bounds are under the mouse get their triangles tested
+	bz2object* obj = viewer->pickObject( ea.getX(), ea.getY() );
+	if(obj != NULL) {
 
-	// get the intersections from the point in the view where we clicked
-    if(viewer->computeIntersections( ea.getX(), ea.getY(), intersections ) ) {
-    	// iterate through the intersections
-    	for(osgUtil::LineSegmentIntersector::Intersections::iterator hitr = intersections.begin(); hitr != intersections.end(); ++hitr) {
-
-            if(hitr->nodePath.empty())
-            	continue;
-
-            for(unsigned int i = 0; i < hitr->nodePath.size(); i++) {
-            	// only look for bz2objects
-            	bz2object* obj = dynamic_cast< bz2object* > ( hitr->nodePath[i] );
-            	if(obj != NULL) {
-
-            		if(!viewer->isPressed( FL_SHIFT )) {
-            			viewer->unselectAll();
-            		}
+		if(!viewer->isPressed( FL_SHIFT )) {
+			viewer->unselectAll();
+		}
 
-					if(!viewer->isSelected( obj )) {
-						viewer->setSelected( obj );
-						// viewer->requestMainWindow()->configure( obj );
-					}
-					else {
-						viewer->setUnselected( obj );
-					}
+		if(!viewer->isSelected( obj )) {
+			viewer->setSelected( obj );
+			// viewer->requestMainWindow()->configure( obj );
+		}
+		else {
+			viewer->setUnselected( obj );
+		}
 
-            		// save the last selected object
-            		lastSelected = obj;
+		// save the last selected object
+		lastSelected = obj;
 
-            		return true;
-            	}
-            }
-        }
-    }
+		return true;
+	}
 
 	// if nothing was under the mouse, unselect everything
 	viewer->unselectAll();
@@ -162,14 +166,67 @@ bool selectHandler::pickObject(View* viewer, const osgGA::GUIEventAdapter& ea) {
     return false;
 }
 
+// start dragging out a region
+void selectHandler::beginRegion( View* viewer, const osgGA::GUIEventAdapter& ea ) {
+	regionActive = true;
+	regionAdd = viewer->isPressed( FL_SHIFT );
+	regionStart = osg::Vec2( ea.getX(), ea.getY() );
+
+	region.clear();
+	region.push_back( regionStart );
+
+	// keep the camera from turning while the region is dragged out
+	manipulatorMask = cameraManipulator->getIgnoreHandledEventsMask();
+	cameraManipulator->setIgnoreHandledEventsMask( manipulatorMask | osgGA::GUIEventAdapter::DRAG );
+}
+
+// grow the region to the mouse
+void selectHandler::dragRegion( View* viewer, const osgGA::GUIEventAdapter& ea ) {
+	osg::Vec2 point( ea.getX(), ea.getY() );
+
+	if( regionMode == REGION_BOX ) {
+		region.clear();
+		region.push_back( regionStart );
+		region.push_back( osg::Vec2( point.x(), regionStart.y() ) );
+		region.push_back( point );
+		region.push_back( osg::Vec2( regionStart.x(), point.y() ) );
+	}
+	// only add lasso points a few pixels apart, so slow drags don't pile them up
+	else if( ( point - region.back() ).length() >= 3.0f ) {
+		region.push_back( point );
+	}
+
+	viewer->setSelectionOutline( region );
+}
+
+// select what's in the region, or pick under the mouse if it was only a click
+void selectHandler::endRegion( View* viewer, const osgGA::GUIEventAdapter& ea ) {
+	regionActive = false;
+	cameraManipulator->setIgnoreHandledEventsMask( manipulatorMask );
+
+	osg::BoundingBox extent;
+	for( std::vector< osg::Vec2 >::iterator i = region.begin(); i != region.end(); i++ )
+		extent.expandBy( osg::Vec3( i->x(), i->y(), 0 ) );
+
+	if( region.size() < 3 || ( extent.xMax() - extent.xMin() < 3 && extent.yMax() - extent.yMin() < 3 ) )
+		pickObject( viewer, ea );
+	else
+		viewer->selectRegion( region, regionAdd );
+
+	region.clear();
+	viewer->setSelectionOutline( region );
+}
+
 // use the OSG intersection API to pick objects
 bool selectHandler::pickSelector(View* viewer, const osgGA::GUIEventAdapter& ea) {
 
-	// intersections with the scene
+	// intersections with the selector (the objects don't need to be looked at)
     osgUtil::LineSegmentIntersector::Intersections intersections;
+    osg::NodePath selector;
+    selector.push_back( viewer->getSelectionNode() );
 
 	// get the intersections from the point in the view where we clicked
-    if(viewer->computeIntersections( ea.getX(), ea.getY(), intersections ) ) {
+    if(viewer->computeIntersections( ea.getX(), ea.getY(), selector, intersections, StaticBatch::PICK_MASK ) ) {
     	// iterate through the intersections
     	for(osgUtil::LineSegmentIntersector::Intersections::iterator hitr = intersections.begin(); hitr != intersections.end(); ++hitr) {
 
@@ -204,36 +261,20 @@ bool selectHandler::pickSelector(View* viewer, const osgGA::GUIEventAdapter& ea)
 // TODO: get this to work properly
 bool selectHandler::configureObject(View* viewer, const osgGA::GUIEventAdapter& ea) {
 
-	// intersections with the scene
-    osgUtil::LineSegmentIntersector::Intersections intersections;
-
-	// get the intersections from the point in the view where we clicked
-    if(viewer->computeIntersections( ea.getX(), ea.getY(), intersections ) ) {
-    	// iterate through the intersections
-    	for(osgUtil::LineSegmentIntersector::Intersections::iterator hitr = intersections.begin(); hitr != intersections.end(); ++hitr) {
-
-            if(hitr->nodePath.empty())
-            	continue;
+	// see what's under the mouse
+	bz2object* obj = viewer->pickObject( ea.getX(), ea.getY() );
+	if(obj != NULL/* && obj->isSelected()*/) {
+		// tell the MainWindow to open up a configuration menu
+		MainWindow* mw = viewer->requestMainWindow();
 
-            for(unsigned int i = 0; i < hitr->nodePath.size(); i++) {
-            	// only look for bz2objects
-            	bz2object* obj = dynamic_cast< bz2object* > ( hitr->nodePath[i] );
-            	if(obj != NULL/* && obj->isSelected()*/) {
-            	   	// tell the MainWindow to open up a configuration menu
-            	   	MainWindow* mw = viewer->requestMainWindow();
-
-            	   	if(mw) {
-            	   		mw->configure( obj );
-            	   		lastSelected = obj;
-            	   		return true;
-            	   	}
-
-            	   	return false;
-            	}
-            }
+		if(mw) {
+			mw->configure( obj );
+			lastSelected = obj;
+			return true;
+		}
 
-        }
-    }
+		return false;
+	}
 
     lastSelected = NULL;
     lastSelectedData = NULL;
@@ -338,6 +379,10 @@ bool selectHandler::dragSelector( View* viewer, const osgGA::GUIEventAdapter& ea
 				}
 			}
 
+			// the pick tree only refits the objects it's told about
+			for(Model::objRefList::iterator i = selected.begin(); i != selected.end(); i++)
+				view->updateObject( i->get() );
+
 			// finally, transform the selector itself
 			selection->rebuildAxes( selected );
 		}
@@ -419,6 +464,10 @@ bool selectHandler::rotateSelector( View* viewer, const osgGA::GUIEventAdapter&
 				}
 			}
 
+			// the pick tree only refits the objects it's told about
+			for(Model::objRefList::iterator i = selected.begin(); i != selected.end(); i++)
+				view->updateObject( i->get() );
+
 			// finally, transform the selector itself
 			selection->rebuildAxes( selected );
 		}
@@ -525,6 +574,10 @@ bool selectHandler::scaleSelector( View* viewer, const osgGA::GUIEventAdapter& e
 					(*i)->update( msg );
 				}
 			}
+
+			// the pick tree only refits the objects it's told about
+			for(Model::objRefList::iterator i = selected.begin(); i != selected.end(); i++)
+				view->updateObject( i->get() );
 		}
 	}
 